@@ -0,0 +1,91 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisUpdateLatencyBenchmark.h"
+
+#include <QTest>
+
+#include <KoColor.h>
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+
+#include "kis_image.h"
+#include "kis_paint_layer.h"
+#include "kis_paint_device.h"
+#include "kis_image_config.h"
+#include "krita_utils.h"
+
+const int IMAGE_WIDTH = 4096;
+const int IMAGE_HEIGHT = 4096;
+
+void KisUpdateLatencyBenchmark::benchmarkLayerStackUpdate_data()
+{
+    QTest::addColumn<int>("numLayers");
+    QTest::addColumn<bool>("workStealing");
+
+    const QVector<int> layerCounts({8, 32, 128});
+
+    Q_FOREACH (int numLayers, layerCounts) {
+        QTest::newRow(QString("%1 layers, fixed jobs").arg(numLayers).toLatin1()) << numLayers << false;
+        QTest::newRow(QString("%1 layers, work stealing").arg(numLayers).toLatin1()) << numLayers << true;
+    }
+}
+
+/**
+ * Measures the time between a layer being made dirty and the moment
+ * the image projection is updated. The dirty rect is exactly one update
+ * patch, so the scheduler processes it with a single merge walker, which
+ * has to composite the whole layer stack. Without work stealing the
+ * walker is processed by one thread, while the others are idle.
+ */
+void KisUpdateLatencyBenchmark::benchmarkLayerStackUpdate()
+{
+    QFETCH(int, numLayers);
+    QFETCH(bool, workStealing);
+
+    KisImageConfig cfg(false);
+    const bool oldWorkStealing = cfg.enableWorkStealing();
+    cfg.setEnableWorkStealing(workStealing);
+
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisImageSP image = new KisImage(0, IMAGE_WIDTH, IMAGE_HEIGHT, cs, "benchmark image");
+
+    KisPaintLayerSP bottomLayer;
+
+    for (int i = 0; i < numLayers; i++) {
+        KisPaintLayerSP layer = new KisPaintLayer(image, QString("layer %1").arg(i), OPACITY_OPAQUE_U8 / 2);
+        layer->paintDevice()->fill(image->bounds(), KoColor(QColor::fromHsv(i * 360 / numLayers, 255, 255), cs));
+        image->addNode(layer, image->root());
+
+        if (!bottomLayer) {
+            bottomLayer = layer;
+        }
+    }
+
+    image->refreshGraphAsync();
+    image->waitForDone();
+
+    const QRect updateRect(QPoint(), KritaUtils::optimalPatchSize());
+
+    QBENCHMARK {
+        bottomLayer->setDirty(updateRect);
+        image->waitForDone();
+    }
+
+    cfg.setEnableWorkStealing(oldWorkStealing);
+}
+
+QTEST_MAIN(KisUpdateLatencyBenchmark)
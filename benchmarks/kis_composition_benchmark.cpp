@@ -44,10 +44,13 @@
 #include <KoColorSpace.h>
 #include <KoCompositeOp.h>
 #include <KoColorSpaceRegistry.h>
+#include <KoColorModelStandardIds.h>
 
 #include <KoColorSpaceTraits.h>
 #include <KoCompositeOpAlphaDarken.h>
 #include <KoCompositeOpOver.h>
+#include <KoCompositeOpCopy2.h>
+#include <KoCompositeOpGeneric.h>
 #include <KoOptimizedCompositeOpFactory.h>
 #include <KoAlphaDarkenParamsWrapper.h>
 
@@ -127,6 +130,27 @@ struct RandomGenerator<quint8>
     boost::mt11213b m_rnd;
 };
 
+template <>
+struct RandomGenerator<quint16>
+{
+    RandomGenerator(int seed)
+        : m_smallint(0,65535),
+          m_rnd(seed)
+    {
+    }
+
+    quint16 operator() () {
+        return m_smallint(m_rnd);
+    }
+
+    quint16 unit() {
+        return KoColorSpaceMathsTraits<quint16>::unitValue;
+    }
+
+    boost::uniform_smallint<int> m_smallint;
+    boost::mt11213b m_rnd;
+};
+
 template <>
 struct RandomGenerator<float>
 {
@@ -157,6 +181,27 @@ struct RandomGenerator<double> : RandomGenerator<float>
     }
 };
 
+#ifdef HAVE_OPENEXR
+template <>
+struct RandomGenerator<half>
+{
+    RandomGenerator(int seed)
+        : m_rnd(seed)
+    {
+    }
+
+    half operator() () {
+        return half(m_rnd());
+    }
+
+    half unit() {
+        return KoColorSpaceMathsTraits<half>::unitValue;
+    }
+
+    RandomGenerator<float> m_rnd;
+};
+#endif
+
 
 template <typename channel_type>
 void generateDataLine(uint seed, int numPixels, quint8 *srcPixels, quint8 *dstPixels, quint8 *mask, AlphaRange srcAlphaRange, AlphaRange dstAlphaRange)
@@ -222,7 +267,8 @@ QVector<Tile> generateTiles(int size,
                             const int dstAlignmentShift,
                             AlphaRange srcAlphaRange,
                             AlphaRange dstAlphaRange,
-                            const quint32 pixelSize)
+                            const quint32 pixelSize,
+                            bool useHalfChannels = false)
 {
     QVector<Tile> tiles(size);
 
@@ -253,8 +299,14 @@ QVector<Tile> generateTiles(int size,
         }
         tiles[i].mask = (quint8*)ptr;
 
-        if (pixelSize == 4) {
+        if (useHalfChannels) {
+#ifdef HAVE_OPENEXR
+            generateDataLine<half>(1, numPixels, tiles[i].src, tiles[i].dst, tiles[i].mask, srcAlphaRange, dstAlphaRange);
+#endif
+        } else if (pixelSize == 4) {
             generateDataLine<quint8>(1, numPixels, tiles[i].src, tiles[i].dst, tiles[i].mask, srcAlphaRange, dstAlphaRange);
+        } else if (pixelSize == 8) {
+            generateDataLine<quint16>(1, numPixels, tiles[i].src, tiles[i].dst, tiles[i].mask, srcAlphaRange, dstAlphaRange);
         } else if (pixelSize == 16) {
             generateDataLine<float>(1, numPixels, tiles[i].src, tiles[i].dst, tiles[i].mask, srcAlphaRange, dstAlphaRange);
         } else {
@@ -326,12 +378,13 @@ bool compareTwoOps(bool haveMask, const KoCompositeOp *op1, const KoCompositeOp
 {
     Q_ASSERT(op1->colorSpace()->pixelSize() == op2->colorSpace()->pixelSize());
     const quint32 pixelSize = op1->colorSpace()->pixelSize();
+    const bool useHalfChannels = op1->colorSpace()->colorDepthId() == Float16BitsColorDepthID;
     const int alignment = 16;
-    QVector<Tile> tiles = generateTiles(2, alignment, alignment, ALPHA_RANDOM, ALPHA_RANDOM, op1->colorSpace()->pixelSize());
+    QVector<Tile> tiles = generateTiles(2, alignment, alignment, ALPHA_RANDOM, ALPHA_RANDOM, op1->colorSpace()->pixelSize(), useHalfChannels);
 
     KoCompositeOp::ParameterInfo params;
-    params.dstRowStride  = 4 * rowStride;
-    params.srcRowStride  = 4 * rowStride;
+    params.dstRowStride  = pixelSize * rowStride;
+    params.srcRowStride  = pixelSize * rowStride;
     params.maskRowStride = rowStride;
     params.rows          = processRect.height();
     params.cols          = processRect.width();
@@ -351,9 +404,19 @@ bool compareTwoOps(bool haveMask, const KoCompositeOp *op1, const KoCompositeOp
     op2->composite(params);
 
     bool compareResult = true;
-    if (pixelSize == 4) {
+    if (useHalfChannels) {
+#ifdef HAVE_OPENEXR
+        // the legacy ops round every intermediate value to half
+        compareResult = compareTwoOpsPixels<half>(tiles, half(4e-3));
+#endif
+    }
+    else if (pixelSize == 4) {
         compareResult = compareTwoOpsPixels<quint8>(tiles, 10);
     }
+    else if (pixelSize == 8) {
+        // the same tolerance as for the 8-bit channels
+        compareResult = compareTwoOpsPixels<quint16>(tiles, 10 * 257);
+    }
     else if (pixelSize == 16) {
         compareResult = compareTwoOpsPixels<float>(tiles, 2e-7);
     }
@@ -406,14 +469,17 @@ void benchmarkCompositeOp(const KoCompositeOp *op,
 {
     QString testName = getTestName(haveMask, srcAlignmentShift, dstAlignmentShift, srcAlphaRange, dstAlphaRange);
 
+    const quint32 pixelSize = op->colorSpace()->pixelSize();
+    const bool useHalfChannels = op->colorSpace()->colorDepthId() == Float16BitsColorDepthID;
+
     QVector<Tile> tiles =
-        generateTiles(numTiles, srcAlignmentShift, dstAlignmentShift, srcAlphaRange, dstAlphaRange, op->colorSpace()->pixelSize());
+        generateTiles(numTiles, srcAlignmentShift, dstAlignmentShift, srcAlphaRange, dstAlphaRange, pixelSize, useHalfChannels);
 
-    const int tileOffset = 4 * (processRect.y() * rowStride + processRect.x());
+    const int tileOffset = pixelSize * (processRect.y() * rowStride + processRect.x());
 
     KoCompositeOp::ParameterInfo params;
-    params.dstRowStride  = 4 * rowStride;
-    params.srcRowStride  = 4 * rowStride;
+    params.dstRowStride  = pixelSize * rowStride;
+    params.srcRowStride  = pixelSize * rowStride;
     params.maskRowStride = rowStride;
     params.rows          = processRect.height();
     params.cols          = processRect.width();
@@ -710,6 +776,113 @@ void KisCompositionBenchmark::compareRgbF32OverOps()
     delete opAct;
 }
 
+void KisCompositionBenchmark::compareRgbU16AlphaDarkenOps()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb16();
+    KoCompositeOp *opAct = KoOptimizedCompositeOpFactory::createAlphaDarkenOpCreamyU16(cs);
+    KoCompositeOp *opExp = new KoCompositeOpAlphaDarken<KoBgrU16Traits, KoAlphaDarkenParamsWrapperCreamy>(cs);
+
+    QVERIFY(compareTwoOps(true, opAct, opExp));
+
+    delete opExp;
+    delete opAct;
+}
+
+void KisCompositionBenchmark::compareRgbU16OverOps()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb16();
+    KoCompositeOp *opAct = KoOptimizedCompositeOpFactory::createOverOpU16(cs);
+    KoCompositeOp *opExp = new KoCompositeOpOver<KoBgrU16Traits>(cs);
+
+    QVERIFY(compareTwoOps(true, opAct, opExp));
+
+    delete opExp;
+    delete opAct;
+}
+
+void KisCompositionBenchmark::compareRgbU16CopyOps()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb16();
+    KoCompositeOp *opAct = KoOptimizedCompositeOpFactory::createCopyOpU16(cs);
+    KoCompositeOp *opExp = new KoCompositeOpCopy2<KoBgrU16Traits>(cs);
+
+    QVERIFY(compareTwoOps(true, opAct, opExp));
+
+    delete opExp;
+    delete opAct;
+}
+
+template<quint8 compositeFunc(quint8, quint8)>
+bool compareGenericSCOps32(const QString &id)
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KoCompositeOp *opAct = KoOptimizedCompositeOpFactory::createGenericSCOp32(cs, id, id, KoCompositeOp::categoryMix());
+    KoCompositeOp *opExp = new KoCompositeOpGenericSC<KoBgrU8Traits, compositeFunc>(cs, id, id, KoCompositeOp::categoryMix());
+
+    bool result = true;
+
+    // no vectorized version is created when vector instructions are disabled
+    if (opAct) {
+        result = compareTwoOps(true, opAct, opExp) && compareTwoOps(false, opAct, opExp);
+
+        if (!result) {
+            qWarning() << "Failed to compare op" << id;
+        }
+    }
+
+    delete opExp;
+    delete opAct;
+
+    return result;
+}
+
+void KisCompositionBenchmark::compareRgbF16AlphaDarkenOps()
+{
+#ifdef HAVE_OPENEXR
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->colorSpace("RGBA", "F16", "");
+    KoCompositeOp *opAct = KoOptimizedCompositeOpFactory::createAlphaDarkenOpCreamyF16(cs);
+    KoCompositeOp *opExp = new KoCompositeOpAlphaDarken<KoRgbF16Traits, KoAlphaDarkenParamsWrapperCreamy>(cs);
+
+    QVERIFY(compareTwoOps(true, opAct, opExp));
+    QVERIFY(compareTwoOps(false, opAct, opExp));
+
+    delete opExp;
+    delete opAct;
+#endif
+}
+
+void KisCompositionBenchmark::compareRgbF16OverOps()
+{
+#ifdef HAVE_OPENEXR
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->colorSpace("RGBA", "F16", "");
+    KoCompositeOp *opAct = KoOptimizedCompositeOpFactory::createOverOpF16(cs);
+    KoCompositeOp *opExp = new KoCompositeOpOver<KoRgbF16Traits>(cs);
+
+    QVERIFY(compareTwoOps(true, opAct, opExp));
+    QVERIFY(compareTwoOps(false, opAct, opExp));
+
+    delete opExp;
+    delete opAct;
+#endif
+}
+
+void KisCompositionBenchmark::compareRgb8GenericSCOps()
+{
+    QVERIFY(compareGenericSCOps32<&cfMultiply<quint8>>(COMPOSITE_MULT));
+    QVERIFY(compareGenericSCOps32<&cfScreen<quint8>>(COMPOSITE_SCREEN));
+    QVERIFY(compareGenericSCOps32<&cfOverlay<quint8>>(COMPOSITE_OVERLAY));
+    QVERIFY(compareGenericSCOps32<&cfHardLight<quint8>>(COMPOSITE_HARD_LIGHT));
+    QVERIFY(compareGenericSCOps32<&cfAddition<quint8>>(COMPOSITE_ADD));
+    QVERIFY(compareGenericSCOps32<&cfSubtract<quint8>>(COMPOSITE_SUBTRACT));
+    QVERIFY(compareGenericSCOps32<&cfLinearBurn<quint8>>(COMPOSITE_LINEAR_BURN));
+    QVERIFY(compareGenericSCOps32<&cfDarkenOnly<quint8>>(COMPOSITE_DARKEN));
+    QVERIFY(compareGenericSCOps32<&cfLightenOnly<quint8>>(COMPOSITE_LIGHTEN));
+    QVERIFY(compareGenericSCOps32<&cfDifference<quint8>>(COMPOSITE_DIFF));
+    QVERIFY(compareGenericSCOps32<&cfExclusion<quint8>>(COMPOSITE_EXCLUSION));
+    QVERIFY(compareGenericSCOps32<&cfGrainMerge<quint8>>(COMPOSITE_GRAIN_MERGE));
+    QVERIFY(compareGenericSCOps32<&cfGrainExtract<quint8>>(COMPOSITE_GRAIN_EXTRACT));
+}
+
 void KisCompositionBenchmark::testRgb8CompositeAlphaDarkenLegacy()
 {
     const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
@@ -774,6 +947,116 @@ void KisCompositionBenchmark::testRgbF32CompositeOverOptimized()
     delete op;
 }
 
+void KisCompositionBenchmark::testRgbU16CompositeAlphaDarkenLegacy()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb16();
+    KoCompositeOp *op = new KoCompositeOpAlphaDarken<KoBgrU16Traits, KoAlphaDarkenParamsWrapperCreamy>(cs);
+    benchmarkCompositeOp(op, "RGBU16 Legacy");
+    delete op;
+}
+
+void KisCompositionBenchmark::testRgbU16CompositeAlphaDarkenOptimized()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb16();
+    KoCompositeOp *op = KoOptimizedCompositeOpFactory::createAlphaDarkenOpCreamyU16(cs);
+    benchmarkCompositeOp(op, "RGBU16 Optimized");
+    delete op;
+}
+
+void KisCompositionBenchmark::testRgbU16CompositeOverLegacy()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb16();
+    KoCompositeOp *op = new KoCompositeOpOver<KoBgrU16Traits>(cs);
+    benchmarkCompositeOp(op, "RGBU16 Legacy");
+    delete op;
+}
+
+void KisCompositionBenchmark::testRgbU16CompositeOverOptimized()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb16();
+    KoCompositeOp *op = KoOptimizedCompositeOpFactory::createOverOpU16(cs);
+    benchmarkCompositeOp(op, "RGBU16 Optimized");
+    delete op;
+}
+
+void KisCompositionBenchmark::testRgbF16CompositeAlphaDarkenLegacy()
+{
+#ifdef HAVE_OPENEXR
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->colorSpace("RGBA", "F16", "");
+    KoCompositeOp *op = new KoCompositeOpAlphaDarken<KoRgbF16Traits, KoAlphaDarkenParamsWrapperCreamy>(cs);
+    benchmarkCompositeOp(op, "RGBF16 Legacy");
+    delete op;
+#endif
+}
+
+void KisCompositionBenchmark::testRgbF16CompositeAlphaDarkenOptimized()
+{
+#ifdef HAVE_OPENEXR
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->colorSpace("RGBA", "F16", "");
+    KoCompositeOp *op = KoOptimizedCompositeOpFactory::createAlphaDarkenOpCreamyF16(cs);
+    benchmarkCompositeOp(op, "RGBF16 Optimized");
+    delete op;
+#endif
+}
+
+void KisCompositionBenchmark::testRgbF16CompositeOverLegacy()
+{
+#ifdef HAVE_OPENEXR
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->colorSpace("RGBA", "F16", "");
+    KoCompositeOp *op = new KoCompositeOpOver<KoRgbF16Traits>(cs);
+    benchmarkCompositeOp(op, "RGBF16 Legacy");
+    delete op;
+#endif
+}
+
+void KisCompositionBenchmark::testRgbF16CompositeOverOptimized()
+{
+#ifdef HAVE_OPENEXR
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->colorSpace("RGBA", "F16", "");
+    KoCompositeOp *op = KoOptimizedCompositeOpFactory::createOverOpF16(cs);
+    benchmarkCompositeOp(op, "RGBF16 Optimized");
+    delete op;
+#endif
+}
+
+void KisCompositionBenchmark::testRgb8CompositeMultiplyLegacy()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KoCompositeOp *op = new KoCompositeOpGenericSC<KoBgrU8Traits, &cfMultiply<quint8>>(cs, COMPOSITE_MULT, "Multiply", KoCompositeOp::categoryArithmetic());
+    benchmarkCompositeOp(op, "Legacy");
+    delete op;
+}
+
+void KisCompositionBenchmark::testRgb8CompositeMultiplyOptimized()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KoCompositeOp *op = KoOptimizedCompositeOpFactory::createGenericSCOp32(cs, COMPOSITE_MULT, "Multiply", KoCompositeOp::categoryArithmetic());
+    if (!op) {
+        QSKIP("Vector instructions are not available");
+    }
+    benchmarkCompositeOp(op, "Optimized");
+    delete op;
+}
+
+void KisCompositionBenchmark::testRgb8CompositeOverlayLegacy()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KoCompositeOp *op = new KoCompositeOpGenericSC<KoBgrU8Traits, &cfOverlay<quint8>>(cs, COMPOSITE_OVERLAY, "Overlay", KoCompositeOp::categoryMix());
+    benchmarkCompositeOp(op, "Legacy");
+    delete op;
+}
+
+void KisCompositionBenchmark::testRgb8CompositeOverlayOptimized()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KoCompositeOp *op = KoOptimizedCompositeOpFactory::createGenericSCOp32(cs, COMPOSITE_OVERLAY, "Overlay", KoCompositeOp::categoryMix());
+    if (!op) {
+        QSKIP("Vector instructions are not available");
+    }
+    benchmarkCompositeOp(op, "Optimized");
+    delete op;
+}
+
 void KisCompositionBenchmark::testRgb8CompositeAlphaDarkenReal_Aligned()
 {
     const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
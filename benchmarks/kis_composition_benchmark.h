@@ -46,6 +46,15 @@ private Q_SLOTS:
     void compareOverOpsNoMask();
     void compareRgbF32OverOps();
 
+    void compareRgbU16AlphaDarkenOps();
+    void compareRgbU16OverOps();
+    void compareRgbU16CopyOps();
+
+    void compareRgbF16AlphaDarkenOps();
+    void compareRgbF16OverOps();
+
+    void compareRgb8GenericSCOps();
+
     void testRgb8CompositeAlphaDarkenLegacy();
     void testRgb8CompositeAlphaDarkenOptimized();
 
@@ -58,6 +67,24 @@ private Q_SLOTS:
     void testRgbF32CompositeOverLegacy();
     void testRgbF32CompositeOverOptimized();
 
+    void testRgbU16CompositeAlphaDarkenLegacy();
+    void testRgbU16CompositeAlphaDarkenOptimized();
+
+    void testRgbU16CompositeOverLegacy();
+    void testRgbU16CompositeOverOptimized();
+
+    void testRgbF16CompositeAlphaDarkenLegacy();
+    void testRgbF16CompositeAlphaDarkenOptimized();
+
+    void testRgbF16CompositeOverLegacy();
+    void testRgbF16CompositeOverOptimized();
+
+    void testRgb8CompositeMultiplyLegacy();
+    void testRgb8CompositeMultiplyOptimized();
+
+    void testRgb8CompositeOverlayLegacy();
+    void testRgb8CompositeOverlayOptimized();
+
     void testRgb8CompositeAlphaDarkenReal_Aligned();
     void testRgb8CompositeOverReal_Aligned();
 
@@ -39,6 +39,8 @@
 #include "KisGlobalResourcesInterface.h"
 
 #include "tiles3/kis_tile_data_store.h"
+#include "tiles3/swap/kis_tile_compressor_2.h"
+#include "kis_datamanager.h"
 #include "kis_surrogate_undo_adapter.h"
 #include "kis_image_config.h"
 #define LOAD_PRESET_OR_RETURN(preset, fileName)                         \
@@ -230,4 +232,195 @@ void KisLowMemoryBenchmark::memory2000History100Pool500HugeBrush()
                       2000, 600, 500, 0);
 }
 
+/**
+ * Compresses and decompresses tiles of a painted layer with every
+ * codec available for the swap and reports throughput (in MiB/s of
+ * uncompressed data) and compression ratio for each of them
+ */
+void KisLowMemoryBenchmark::benchmarkSwapCodecs()
+{
+    QString presetFileName = "autobrush_300px.kpp";
+    KisPaintOpPresetSP preset(new KisPaintOpPreset(QString(FILES_DATA_DIR) + '/' + presetFileName));
+    LOAD_PRESET_OR_RETURN(preset, presetFileName);
+
+    const int imageSize = 2000;
+    const int numPasses = 10;
+
+    const KoColorSpace *colorSpace = KoColorSpaceRegistry::instance()->rgb8();
+    KisImageSP image = new KisImage(0, imageSize, imageSize, colorSpace, "codec sample image");
+    KisLayerSP layer = new KisPaintLayer(image, "codec sample layer", OPACITY_OPAQUE_U8, colorSpace);
+    image->addNode(layer, image->root());
+
+    KisPainter painter(layer->paintDevice());
+    painter.setPaintColor(KoColor(Qt::black, colorSpace));
+    painter.setPaintOpPreset(preset, layer, image);
+
+    KisDistanceInformation currentDistance;
+    for (qreal y = 150; y < imageSize; y += 250) {
+        KisPaintInformation pi1(QPointF(150, y), 0.0);
+        KisPaintInformation pi2(QPointF(imageSize - 150, y + 100), 1.0);
+        painter.paintLine(pi1, pi2, &currentDistance);
+    }
+
+    KisDataManagerSP dm = layer->paintDevice()->dataManager();
+    const QRect extent = dm->extent();
+
+    QVector<KisTileSP> tiles;
+    for (int row = extent.top() / KisTileData::HEIGHT; row <= extent.bottom() / KisTileData::HEIGHT; row++) {
+        for (int col = extent.left() / KisTileData::WIDTH; col <= extent.right() / KisTileData::WIDTH; col++) {
+            tiles << dm->getTile(col, row, false);
+        }
+    }
+
+    QVERIFY(!tiles.isEmpty());
+
+    KisTiledDataManager scratchDm(colorSpace->pixelSize(), dm->defaultPixel());
+
+    const qint64 tileDataSize = qint64(colorSpace->pixelSize()) * KisTileData::WIDTH * KisTileData::HEIGHT;
+    const qreal totalMiB = qreal(tileDataSize) * tiles.size() * numPasses / (1 << 20);
+
+    Q_FOREACH (KisCompressionFactory::CodecId codec, KisCompressionFactory::availableCodecs()) {
+        KisTileCompressor2 compressor(codec);
+
+        QVector<QByteArray> buffers(tiles.size());
+        qint64 compressedSize = 0;
+
+        QElapsedTimer timer;
+        timer.start();
+
+        for (int pass = 0; pass < numPasses; pass++) {
+            compressedSize = 0;
+
+            for (int i = 0; i < tiles.size(); i++) {
+                tiles[i]->lockForRead();
+                KisTileData *td = tiles[i]->tileData();
+
+                buffers[i].resize(compressor.tileDataBufferSize(td));
+
+                qint32 bytesWritten = 0;
+                compressor.compressTileData(td, (quint8*)buffers[i].data(), buffers[i].size(), bytesWritten);
+                tiles[i]->unlockForRead();
+
+                buffers[i].resize(bytesWritten);
+                compressedSize += bytesWritten;
+            }
+        }
+
+        const qint64 compressionTime = timer.restart();
+
+        KisTileSP scratchTile = scratchDm.getTile(0, 0, true);
+        scratchTile->lockForWrite();
+
+        for (int pass = 0; pass < numPasses; pass++) {
+            for (int i = 0; i < tiles.size(); i++) {
+                compressor.decompressTileData((quint8*)buffers[i].data(), buffers[i].size(), scratchTile->tileData());
+            }
+        }
+
+        const qint64 decompressionTime = timer.elapsed();
+
+        scratchTile->unlockForWrite();
+
+        qDebug() << "Codec" << KisCompressionFactory::name(codec)
+                 << "tiles:" << tiles.size()
+                 << "ratio:" << qreal(compressedSize) / (tileDataSize * tiles.size())
+                 << "compression (MiB/s):" << totalMiB / qMax(qint64(1), compressionTime) * 1000
+                 << "decompression (MiB/s):" << totalMiB / qMax(qint64(1), decompressionTime) * 1000;
+    }
+}
+
+/**
+ * Fills \p numDevices paint devices with content, only \p numDistinctDevices
+ * of which are different, and returns the amount of memory occupied by
+ * their tiles. The content is written independently into every device,
+ * as it happens when a document is loaded from a file, so no tiles
+ * are shared by COW.
+ */
+qint64 KisLowMemoryBenchmark::deduplicationMemoryUsage(bool deduplicate, int numDevices, int numDistinctDevices)
+{
+    KisImageConfig config(false);
+    config.setEnableTileDeduplication(deduplicate);
+
+    KisTileDataStore *store = KisTileDataStore::instance();
+    store->testingRereadConfig();
+
+    const KoColorSpace *colorSpace = KoColorSpaceRegistry::instance()->rgb8();
+    const QRect rect(0, 0, 1024, 1024);
+
+    QByteArray bytes(rect.width() * rect.height() * colorSpace->pixelSize(), 0);
+
+    const qint64 memoryBefore = store->memoryMetric();
+
+    QVector<KisPaintDeviceSP> devices;
+
+    for (int i = 0; i < numDevices; i++) {
+        // a cheap LCG gives us noise that cannot be compressed
+        quint32 state = i % numDistinctDevices;
+        for (int j = 0; j < bytes.size(); j++) {
+            state = state * 1664525 + 1013904223;
+            bytes[j] = state >> 24;
+        }
+
+        KisPaintDeviceSP device = new KisPaintDevice(colorSpace);
+        device->writeBytes((quint8*)bytes.data(), rect);
+        device->dataManager()->commit();
+
+        devices << device;
+    }
+
+    const qint64 memoryAfter = store->memoryMetric();
+
+    config.setEnableTileDeduplication(false);
+    store->testingRereadConfig();
+
+    return (memoryAfter - memoryBefore) * KisTileData::WIDTH * KisTileData::HEIGHT;
+}
+
+void KisLowMemoryBenchmark::benchmarkDeduplication(const QString &name, int numDevices, int numDistinctDevices)
+{
+    const KisTileDataStore::MemoryStatistics statsBefore =
+        KisTileDataStore::instance()->memoryStatistics();
+
+    QElapsedTimer timer;
+    timer.start();
+
+    const qint64 plainMemory = deduplicationMemoryUsage(false, numDevices, numDistinctDevices);
+    const qint64 plainTime = timer.restart();
+
+    const qint64 deduplicatedMemory = deduplicationMemoryUsage(true, numDevices, numDistinctDevices);
+    const qint64 deduplicatedTime = timer.elapsed();
+
+    const KisTileDataStore::MemoryStatistics statsAfter =
+        KisTileDataStore::instance()->memoryStatistics();
+
+    const qreal MiB = 1 << 20;
+
+    qDebug() << name
+             << "devices:" << numDevices
+             << "distinct:" << numDistinctDevices
+             << "plain (MiB):" << plainMemory / MiB
+             << "deduplicated (MiB):" << deduplicatedMemory / MiB
+             << "saved (MiB):" << (plainMemory - deduplicatedMemory) / MiB
+             << "hits:" << statsAfter.deduplicationHits - statsBefore.deduplicationHits
+             << "plain time (ms):" << plainTime
+             << "deduplicated time (ms):" << deduplicatedTime;
+}
+
+/**
+ * Eight copies of the same layer, e.g. a duplicated group
+ * loaded from a file
+ */
+void KisLowMemoryBenchmark::benchmarkDeduplicationDuplicatedLayers()
+{
+    benchmarkDeduplication("Duplicated layers", 8, 1);
+}
+
+/**
+ * A 24-frames animation cycle made of four unique drawings
+ */
+void KisLowMemoryBenchmark::benchmarkDeduplicationRepeatingFrames()
+{
+    benchmarkDeduplication("Repeating frames", 24, 4);
+}
+
 QTEST_MAIN(KisLowMemoryBenchmark)
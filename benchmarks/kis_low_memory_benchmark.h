@@ -31,6 +31,11 @@ private Q_SLOTS:
 
     void memory2000History100Pool500HugeBrush();
 
+    void benchmarkSwapCodecs();
+
+    void benchmarkDeduplicationDuplicatedLayers();
+    void benchmarkDeduplicationRepeatingFrames();
+
 private:
     void benchmarkWideArea(const QString presetFileName,
                            const QRectF &rect, qreal vstep,
@@ -40,6 +45,9 @@ private:
                            int softLimitMiB,
                            int poolLimitMiB,
                            int index);
+
+    void benchmarkDeduplication(const QString &name, int numDevices, int numDistinctDevices);
+    qint64 deduplicationMemoryUsage(bool deduplicate, int numDevices, int numDistinctDevices);
 };
 
 #endif /* __KIS_LOW_MEMORY_BENCHMARK_H */
@@ -0,0 +1,34 @@
+# - Find LZ4
+# Find the LZ4 fast compression library <https://lz4.github.io/lz4/>
+# This module defines
+#  LZ4_FOUND, whether the library has been found
+#  LZ4_INCLUDE_DIR, where to find lz4.h
+#  LZ4_LIBRARIES, the libraries needed to use LZ4
+#
+# Redistribution and use is allowed according to the terms of the BSD license.
+# For details see the accompanying COPYING-CMAKE-SCRIPTS file.
+
+find_package(PkgConfig QUIET)
+
+if(PKG_CONFIG_FOUND)
+   pkg_check_modules(PC_LZ4 QUIET liblz4)
+endif()
+
+find_path(LZ4_INCLUDE_DIR lz4.h
+          HINTS
+          ${PC_LZ4_INCLUDEDIR}
+          ${PC_LZ4_INCLUDE_DIRS}
+         )
+
+find_library(LZ4_LIBRARIES NAMES lz4 liblz4
+             HINTS
+             ${PC_LZ4_LIBDIR}
+             ${PC_LZ4_LIBRARY_DIRS}
+            )
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(LZ4
+                                  REQUIRED_VARS LZ4_LIBRARIES LZ4_INCLUDE_DIR
+                                 )
+
+mark_as_advanced(LZ4_INCLUDE_DIR LZ4_LIBRARIES)
@@ -0,0 +1,34 @@
+# - Find ZSTD
+# Find the Zstandard compression library <https://facebook.github.io/zstd/>
+# This module defines
+#  ZSTD_FOUND, whether the library has been found
+#  ZSTD_INCLUDE_DIR, where to find zstd.h
+#  ZSTD_LIBRARIES, the libraries needed to use Zstandard
+#
+# Redistribution and use is allowed according to the terms of the BSD license.
+# For details see the accompanying COPYING-CMAKE-SCRIPTS file.
+
+find_package(PkgConfig QUIET)
+
+if(PKG_CONFIG_FOUND)
+   pkg_check_modules(PC_ZSTD QUIET libzstd)
+endif()
+
+find_path(ZSTD_INCLUDE_DIR zstd.h
+          HINTS
+          ${PC_ZSTD_INCLUDEDIR}
+          ${PC_ZSTD_INCLUDE_DIRS}
+         )
+
+find_library(ZSTD_LIBRARIES NAMES zstd libzstd zstd_static
+             HINTS
+             ${PC_ZSTD_LIBDIR}
+             ${PC_ZSTD_LIBRARY_DIRS}
+            )
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(ZSTD
+                                  REQUIRED_VARS ZSTD_LIBRARIES ZSTD_INCLUDE_DIR
+                                 )
+
+mark_as_advanced(ZSTD_INCLUDE_DIR ZSTD_LIBRARIES)
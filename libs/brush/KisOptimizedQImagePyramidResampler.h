@@ -0,0 +1,229 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KISOPTIMIZEDQIMAGEPYRAMIDRESAMPLER_H
+#define KISOPTIMIZEDQIMAGEPYRAMIDRESAMPLER_H
+
+#include <type_traits>
+
+#include <kis_assert.h>
+
+#include "KisQImagePyramidResampler.h"
+#include "KisQImagePyramidResamplerFactoryImpl.h"
+
+/**
+ * Samples the rows of the dab. The generic version samples one pixel
+ * at a time, the vectorized one samples Vc::float_v::size() pixels at
+ * once and uses the generic version for the tail of the row.
+ *
+ * The pixels are premultiplied while filtering, so the color of the
+ * transparent pixels doesn't leak into the dab.
+ */
+template<Vc::Implementation _impl,
+         typename EnableDummyType = void>
+struct KisQImagePyramidRowSampler
+{
+    typedef KisQImagePyramidResampler::Level Level;
+
+    static inline void accumulate(QRgb pixel, float weight, float *acc) {
+        const float weightedAlpha = weight * qAlpha(pixel);
+
+        acc[0] += weightedAlpha;
+        acc[1] += weightedAlpha * qRed(pixel);
+        acc[2] += weightedAlpha * qGreen(pixel);
+        acc[3] += weightedAlpha * qBlue(pixel);
+    }
+
+    static inline void sample(const Level &level, float u, float v, float weight, float *acc) {
+        u = qBound(0.0f, u, float(level.width - 1));
+        v = qBound(0.0f, v, float(level.height - 1));
+
+        const int x0 = qMin(int(u), level.width - 2);
+        const int y0 = qMin(int(v), level.height - 2);
+        const float fx = u - x0;
+        const float fy = v - y0;
+
+        const QRgb *pixel = level.bits + y0 * level.pixelsPerLine + x0;
+
+        accumulate(pixel[0], weight * (1.0f - fx) * (1.0f - fy), acc);
+        accumulate(pixel[1], weight * fx * (1.0f - fy), acc);
+        accumulate(pixel[level.pixelsPerLine], weight * (1.0f - fx) * fy, acc);
+        accumulate(pixel[level.pixelsPerLine + 1], weight * fx * fy, acc);
+    }
+
+    static inline QRgb pack(float alpha, float red, float green, float blue) {
+        const int roundedAlpha = qRound(alpha);
+        if (roundedAlpha <= 0) return 0;
+
+        const float alphaRec = 1.0f / alpha;
+
+        return qRgba(qBound(0, qRound(red * alphaRec), 255),
+                     qBound(0, qRound(green * alphaRec), 255),
+                     qBound(0, qRound(blue * alphaRec), 255),
+                     qMin(roundedAlpha, 255));
+    }
+
+    static void resampleRow(const Level *levels, int numLevels, int numSamples,
+                            int y, int startX, int endX, QRgb *dst)
+    {
+        for (int x = startX; x < endX; x++) {
+            float acc[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+
+            for (int i = 0; i < numLevels; i++) {
+                const Level &level = levels[i];
+                const QPointF pt = level.dstToLevel.map(QPointF(x, y));
+
+                const float stepX = level.sampleStep.x();
+                const float stepY = level.sampleStep.y();
+                const float weight = level.weight / numSamples;
+
+                float u = pt.x() - 0.5f * (numSamples - 1) * stepX;
+                float v = pt.y() - 0.5f * (numSamples - 1) * stepY;
+
+                for (int j = 0; j < numSamples; j++) {
+                    sample(level, u, v, weight, acc);
+                    u += stepX;
+                    v += stepY;
+                }
+            }
+
+            dst[x] = pack(acc[0], acc[1], acc[2], acc[3]);
+        }
+    }
+};
+
+#ifdef HAVE_VC
+
+template<Vc::Implementation _impl>
+struct KisQImagePyramidRowSampler<
+        _impl,
+        typename std::enable_if<_impl != Vc::ScalarImpl>::type>
+{
+    typedef KisQImagePyramidResampler::Level Level;
+    typedef KisQImagePyramidRowSampler<Vc::ScalarImpl> ScalarSampler;
+
+    using int_v = Vc::SimdArray<int, Vc::float_v::size()>;
+
+    static inline Vc::float_v channel(const int_v &pixel, int shift) {
+        return Vc::simd_cast<Vc::float_v>((pixel >> shift) & int_v(0xff));
+    }
+
+    static inline void accumulate(const int_v &pixel, const Vc::float_v &weight, Vc::float_v *acc) {
+        const Vc::float_v weightedAlpha = weight * channel(pixel, 24);
+
+        acc[0] += weightedAlpha;
+        acc[1] += weightedAlpha * channel(pixel, 16);
+        acc[2] += weightedAlpha * channel(pixel, 8);
+        acc[3] += weightedAlpha * channel(pixel, 0);
+    }
+
+    static inline void sample(const Level &level, Vc::float_v u, Vc::float_v v,
+                              const Vc::float_v &weight, Vc::float_v *acc) {
+        const Vc::float_v zeroValue(Vc::Zero);
+        const Vc::float_v oneValue(Vc::One);
+
+        u = Vc::min(Vc::max(u, zeroValue), Vc::float_v(float(level.width - 1)));
+        v = Vc::min(Vc::max(v, zeroValue), Vc::float_v(float(level.height - 1)));
+
+        const int_v x0 = Vc::min(Vc::simd_cast<int_v>(u), int_v(level.width - 2));
+        const int_v y0 = Vc::min(Vc::simd_cast<int_v>(v), int_v(level.height - 2));
+        const Vc::float_v fx = u - Vc::simd_cast<Vc::float_v>(x0);
+        const Vc::float_v fy = v - Vc::simd_cast<Vc::float_v>(y0);
+
+        const int *bits = reinterpret_cast<const int*>(level.bits);
+        const int_v index = y0 * int_v(level.pixelsPerLine) + x0;
+
+        accumulate(int_v(bits, index), weight * (oneValue - fx) * (oneValue - fy), acc);
+        accumulate(int_v(bits, index + int_v(1)), weight * fx * (oneValue - fy), acc);
+        accumulate(int_v(bits, index + int_v(level.pixelsPerLine)), weight * (oneValue - fx) * fy, acc);
+        accumulate(int_v(bits, index + int_v(level.pixelsPerLine + 1)), weight * fx * fy, acc);
+    }
+
+    static void resampleRow(const Level *levels, int numLevels, int numSamples,
+                            int y, int startX, int endX, QRgb *dst)
+    {
+        const int vectorSize = Vc::float_v::size();
+
+        alignas(64) float alpha[vectorSize];
+        alignas(64) float red[vectorSize];
+        alignas(64) float green[vectorSize];
+        alignas(64) float blue[vectorSize];
+
+        int x = startX;
+
+        for (; x + vectorSize <= endX; x += vectorSize) {
+            Vc::float_v acc[4] = {Vc::float_v(Vc::Zero), Vc::float_v(Vc::Zero),
+                                  Vc::float_v(Vc::Zero), Vc::float_v(Vc::Zero)};
+
+            const Vc::float_v xValue = Vc::float_v::IndexesFromZero() + Vc::float_v(float(x));
+
+            for (int i = 0; i < numLevels; i++) {
+                const Level &level = levels[i];
+                const QTransform &t = level.dstToLevel;
+
+                const float stepX = level.sampleStep.x();
+                const float stepY = level.sampleStep.y();
+                const Vc::float_v weight(level.weight / numSamples);
+
+                Vc::float_v u = Vc::float_v(float(t.m11())) * xValue +
+                    Vc::float_v(float(t.m21() * y + t.dx() - 0.5 * (numSamples - 1) * stepX));
+                Vc::float_v v = Vc::float_v(float(t.m12())) * xValue +
+                    Vc::float_v(float(t.m22() * y + t.dy() - 0.5 * (numSamples - 1) * stepY));
+
+                for (int j = 0; j < numSamples; j++) {
+                    sample(level, u, v, weight, acc);
+                    u += Vc::float_v(stepX);
+                    v += Vc::float_v(stepY);
+                }
+            }
+
+            acc[0].store(alpha, Vc::Aligned);
+            acc[1].store(red, Vc::Aligned);
+            acc[2].store(green, Vc::Aligned);
+            acc[3].store(blue, Vc::Aligned);
+
+            for (int i = 0; i < vectorSize; i++) {
+                dst[x + i] = ScalarSampler::pack(alpha[i], red[i], green[i], blue[i]);
+            }
+        }
+
+        ScalarSampler::resampleRow(levels, numLevels, numSamples, y, x, endX, dst);
+    }
+};
+
+#endif /* HAVE_VC */
+
+template<Vc::Implementation _impl>
+class KisOptimizedQImagePyramidResampler : public KisQImagePyramidResampler
+{
+public:
+    void resample(const Level *levels, int numLevels, int numSamples, QImage *dst) const override
+    {
+        KIS_SAFE_ASSERT_RECOVER_RETURN(dst->format() == QImage::Format_ARGB32);
+        KIS_SAFE_ASSERT_RECOVER_RETURN(numLevels > 0 && numSamples > 0);
+
+        const int width = dst->width();
+        const int height = dst->height();
+
+        for (int y = 0; y < height; y++) {
+            QRgb *dstRow = reinterpret_cast<QRgb*>(dst->scanLine(y));
+            KisQImagePyramidRowSampler<_impl>::resampleRow(levels, numLevels, numSamples,
+                                                           y, 0, width, dstRow);
+        }
+    }
+};
+
+#endif // KISOPTIMIZEDQIMAGEPYRAMIDRESAMPLER_H
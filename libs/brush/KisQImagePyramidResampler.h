@@ -0,0 +1,66 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KISQIMAGEPYRAMIDRESAMPLER_H
+#define KISQIMAGEPYRAMIDRESAMPLER_H
+
+#include <QImage>
+#include <QTransform>
+#include <QPointF>
+
+/**
+ * Resamples the levels of KisQImagePyramid into the dab image. Every
+ * destination pixel is a bilinear sample of one or two neighbouring
+ * pyramid levels (trilinear filtering). When the dab is squeezed along
+ * one of the axes, a few samples are taken along the squeezed axis and
+ * averaged (anisotropic filtering).
+ *
+ * The levels are expected to be in QImage::Format_ARGB32 and to have a
+ * transparent border of at least one pixel, so the samples outside the
+ * level are transparent.
+ */
+class KisQImagePyramidResampler
+{
+public:
+    struct Level {
+        const QRgb *bits = 0;
+        int pixelsPerLine = 0;
+        int width = 0;
+        int height = 0;
+
+        /// maps the integer position of the destination pixel into the
+        /// level coordinates, where the center of the pixel (0,0) is (0,0)
+        QTransform dstToLevel;
+
+        /// the distance between the neighbouring anisotropic samples
+        /// in the level coordinates
+        QPointF sampleStep;
+
+        /// the weight of the level in the trilinear filtering
+        float weight = 1.0;
+    };
+
+public:
+    virtual ~KisQImagePyramidResampler() {}
+
+    /**
+     * Fills \p dst with the weighted sum of \p numLevels levels (one or
+     * two), each one sampled \p numSamples times
+     */
+    virtual void resample(const Level *levels, int numLevels, int numSamples, QImage *dst) const = 0;
+};
+
+#endif // KISQIMAGEPYRAMIDRESAMPLER_H
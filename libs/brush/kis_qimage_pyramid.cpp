@@ -18,22 +18,139 @@
 
 #include "kis_qimage_pyramid.h"
 
-#include <limits>
-#include <QPainter>
+#include <cmath>
+#include <QCache>
+#include <QGlobalStatic>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QtMath>
 #include <kis_debug.h>
+#include <kis_global.h>
+
+#include "KisQImagePyramidResampler.h"
+#include "KisQImagePyramidResamplerFactoryImpl.h"
 
 #define MIPMAP_SIZE_THRESHOLD 512
 #define MAX_MIPMAP_SCALE 8.0
 
 #define QPAINTER_WORKAROUND_BORDER 1
 
+#define MAX_ANISOTROPIC_SAMPLES 8
+#define IMAGE_CACHE_SIZE_KB 4096
+
+/**
+ * The precision of the image cache keys. The scale and the ratio are
+ * quantized relatively (1%), the rotation by one degree and the subpixel
+ * offset by a quarter of a pixel, which is finer than the subpixel
+ * precision levels of the dab cache.
+ */
+#define CACHE_SCALE_PRECISION 0.01
+#define CACHE_ROTATION_PRECISION (M_PI / 180.0)
+#define CACHE_SUBPIXEL_PRECISION 0.25
+
+namespace {
+
+struct ResamplerHolder
+{
+    ResamplerHolder()
+        : resampler(createOptimizedClass<KisQImagePyramidResamplerFactoryImpl>(0))
+    {
+    }
+
+    QScopedPointer<KisQImagePyramidResampler> resampler;
+};
+
+Q_GLOBAL_STATIC(ResamplerHolder, s_resamplerHolder)
+
+struct ImageCacheKey
+{
+    int scale;
+    int ratio;
+    int rotation;
+    int subPixelX;
+    int subPixelY;
+
+    /**
+     * The size of the image is a part of the key, so that the image
+     * taken from the cache has exactly the size the caller expects,
+     * even if the quantized values are on the edge of a pixel.
+     */
+    QSize size;
+
+    bool operator==(const ImageCacheKey &rhs) const {
+        return scale == rhs.scale &&
+            ratio == rhs.ratio &&
+            rotation == rhs.rotation &&
+            subPixelX == rhs.subPixelX &&
+            subPixelY == rhs.subPixelY &&
+            size == rhs.size;
+    }
+};
+
+uint qHash(const ImageCacheKey &key, uint seed)
+{
+    // our overload hides the ones of Qt
+    using ::qHash;
+
+    uint hash = qHash(key.scale, seed);
+    hash ^= qHash(key.ratio, seed) * 3;
+    hash ^= qHash(key.rotation, seed) * 5;
+    hash ^= qHash(key.subPixelX, seed) * 7;
+    hash ^= qHash(key.subPixelY, seed) * 11;
+    hash ^= qHash(key.size.width(), seed) * 13;
+    hash ^= qHash(key.size.height(), seed) * 17;
+    return hash;
+}
+
+inline int quantizeRelative(qreal value)
+{
+    return qRound(std::log(qMax(value, 1e-6)) / std::log1p(CACHE_SCALE_PRECISION));
+}
+
+inline int quantize(qreal value, qreal precision)
+{
+    return qRound(value / precision);
+}
+
+ImageCacheKey imageCacheKey(KisDabShape const& shape,
+                            qreal subPixelX, qreal subPixelY,
+                            const QSize &size)
+{
+    const qreal rotation =
+        qIsNaN(shape.rotation()) ? 0.0 : normalizeAngle(shape.rotation());
+
+    ImageCacheKey key;
+    key.scale = quantizeRelative(shape.scale());
+    key.ratio = quantizeRelative(shape.ratio());
+    key.rotation = quantize(rotation, CACHE_ROTATION_PRECISION);
+    key.subPixelX = quantize(subPixelX, CACHE_SUBPIXEL_PRECISION);
+    key.subPixelY = quantize(subPixelY, CACHE_SUBPIXEL_PRECISION);
+    key.size = size;
+
+    return key;
+}
+
+}
+
+/**
+ * The images created by the pyramid. The cost of the image is counted
+ * in kibibytes.
+ */
+struct KisQImagePyramid::ImageCache
+{
+    ImageCache() : images(IMAGE_CACHE_SIZE_KB) {}
+
+    QMutex mutex;
+    QCache<ImageCacheKey, QImage> images;
+};
+
 
 KisQImagePyramid::KisQImagePyramid(const QImage &baseImage, bool useSmoothingForEnlarging)
 {
     KIS_SAFE_ASSERT_RECOVER_RETURN(!baseImage.isNull());
 
     m_originalSize = baseImage.size();
-
+    m_imageCache.reset(new ImageCache());
 
     qreal scale = MAX_MIPMAP_SCALE;
 
@@ -257,8 +374,8 @@ void KisQImagePyramid::appendPyramidLevel(const QImage &image)
      *
      * See a unittest in: KisGbrBrushTest::testQPainterTransformationBorder
      */
-    
-QSize levelSize = image.size();
+
+    QSize levelSize = image.size();
     QImage tmp = image.convertToFormat(QImage::Format_ARGB32);
     tmp = tmp.copy(-QPAINTER_WORKAROUND_BORDER,
                    -QPAINTER_WORKAROUND_BORDER,
@@ -293,31 +410,112 @@ QImage KisQImagePyramid::createImage(KisDabShape const& shape,
                              srcImage.height() - 2 * QPAINTER_WORKAROUND_BORDER);
     }
 
+    const ImageCacheKey key = imageCacheKey(shape, subPixelX, subPixelY, dstSize);
+
+    {
+        QMutexLocker l(&m_imageCache->mutex);
+
+        QImage *cachedImage = m_imageCache->images.object(key);
+        if (cachedImage) {
+            return *cachedImage;
+        }
+    }
+
+    QImage dstImage = resampleImage(shape, subPixelX, subPixelY, dstSize);
+
+    {
+        QMutexLocker l(&m_imageCache->mutex);
+
+        const int cost = qMax(1, dstImage.bytesPerLine() * dstImage.height() / 1024);
+        m_imageCache->images.insert(key, new QImage(dstImage), cost);
+    }
+
+    return dstImage;
+}
+
+QImage KisQImagePyramid::resampleImage(KisDabShape const& shape,
+                                       qreal subPixelX, qreal subPixelY,
+                                       const QSize &dstSize) const
+{
     QImage dstImage(dstSize, QImage::Format_ARGB32);
     dstImage.fill(0);
 
+    if (shape.scaleX() <= 0.0 || shape.scaleY() <= 0.0) return dstImage;
 
     /**
-     * QPainter has one more bug: when a QTransform is TxTranslate, it
-     * does wrong sampling (probably, Nearest Neighbour) even though
-     * we tell it directly that we need SmoothPixmapTransform.
+     * The level of details is chosen by the larger of the two scales, so
+     * the less squeezed axis of the dab gets all the details it needs. The
+     * other axis is filtered with a few samples taken along it.
      *
-     * So here is a workaround: we set a negligible scale to convince
-     * Qt we use a non-only-translating transform.
+     * The fractional part of the level of details is the weight of the
+     * coarser level in the trilinear filtering.
      */
-    while (transform.type() == QTransform::TxTranslate) {
-        const qreal scale = transform.m11();
-        const qreal fakeScale = scale - 10 * std::numeric_limits<qreal>::epsilon();
-        transform *= QTransform::fromScale(fakeScale, fakeScale);
+    const qreal maxScale = qMax(shape.scaleX(), shape.scaleY());
+    const int lastLevel = m_levels.size() - 1;
+    const qreal lod = qBound(0.0, std::log2(m_baseScale / maxScale), qreal(lastLevel));
+
+    const int finerLevel = qMin(qFloor(lod + 1e-6), lastLevel);
+    qreal coarserWeight = qMax(0.0, lod - finerLevel);
+
+    if (finerLevel == lastLevel || coarserWeight < 1e-6) {
+        coarserWeight = 0.0;
+    }
+
+    const int numLevels = coarserWeight > 0.0 ? 2 : 1;
+    int numSamples = 1;
+
+    KisQImagePyramidResampler::Level levels[2];
+
+    for (int i = 0; i < numLevels; i++) {
+        const int levelIndex = finerLevel + i;
+        const PyramidLevel &pyramidLevel = m_levels[levelIndex];
+
+        QTransform levelTransform;
+        QSize levelDstSize;
+
+        calculateParams(shape, subPixelX, subPixelY,
+                        m_originalSize, m_baseScale / (1 << levelIndex), pyramidLevel.size,
+                        &levelTransform, &levelDstSize);
+
+        KIS_SAFE_ASSERT_RECOVER_NOOP(levelDstSize == dstSize);
+
+        bool isInvertible = false;
+        const QTransform invertedTransform = levelTransform.inverted(&isInvertible);
+        if (!isInvertible) return dstImage;
+
+        // the footprint of a dab pixel in the level pixels
+        const qreal footprintX = qreal(pyramidLevel.size.width()) / m_originalSize.width() / shape.scaleX();
+        const qreal footprintY = qreal(pyramidLevel.size.height()) / m_originalSize.height() / shape.scaleY();
+
+        if (i == 0) {
+            const qreal anisotropy =
+                qMax(footprintX, footprintY) / qMax(qMin(footprintX, footprintY), 1.0);
+
+            numSamples = qBound(1, qCeil(anisotropy - 1e-6), MAX_ANISOTROPIC_SAMPLES);
+        }
+
+        KisQImagePyramidResampler::Level &resamplerLevel = levels[i];
+
+        resamplerLevel.bits = reinterpret_cast<const QRgb*>(pyramidLevel.image.constBits());
+        resamplerLevel.pixelsPerLine = pyramidLevel.image.bytesPerLine() / sizeof(QRgb);
+        resamplerLevel.width = pyramidLevel.image.width();
+        resamplerLevel.height = pyramidLevel.image.height();
+
+        // dab pixel centers are mapped into the centers of the level pixels
+        resamplerLevel.dstToLevel =
+            QTransform::fromTranslate(0.5, 0.5) *
+            invertedTransform *
+            QTransform::fromTranslate(QPAINTER_WORKAROUND_BORDER - 0.5,
+                                      QPAINTER_WORKAROUND_BORDER - 0.5);
+
+        resamplerLevel.sampleStep = footprintX >= footprintY ?
+            QPointF(footprintX / numSamples, 0.0) :
+            QPointF(0.0, footprintY / numSamples);
+
+        resamplerLevel.weight = i == 0 ? 1.0 - coarserWeight : coarserWeight;
     }
 
-    QPainter gc(&dstImage);
-    gc.setTransform(
-        QTransform::fromTranslate(-QPAINTER_WORKAROUND_BORDER,
-                                  -QPAINTER_WORKAROUND_BORDER) * transform);
-    gc.setRenderHints(QPainter::SmoothPixmapTransform);
-    gc.drawImage(QPointF(), srcImage);
-    gc.end();
+    s_resamplerHolder->resampler->resample(levels, numLevels, numSamples, &dstImage);
 
     return dstImage;
 }
@@ -21,6 +21,7 @@
 
 #include <QImage>
 #include <QVector>
+#include <QSharedPointer>
 #include <kis_dab_shape.h>
 #include <kritabrush_export.h>
 
@@ -38,6 +39,15 @@ public:
 
     static QSizeF characteristicSize(const QSize &originalSize, KisDabShape const&);
 
+    /**
+     * Returns the brush image transformed by \p shape and shifted by the
+     * subpixel offset. The images are resampled from the two closest
+     * pyramid levels and cached per size. The shape and the subpixel
+     * offset are quantized in the cache key, so the requests for nearly
+     * the same shape (e.g. the sizes a pressure curve generates) share
+     * one image. The cache is used by all the callers of the brush,
+     * including the previews and the outlines, not only the paintops.
+     */
     QImage createImage(KisDabShape const&,
                        qreal subPixelX, qreal subPixelY) const;
 
@@ -50,6 +60,10 @@ private:
     int findNearestLevel(qreal scale, qreal *baseScale) const;
     void appendPyramidLevel(const QImage &image);
 
+    QImage resampleImage(KisDabShape const& shape,
+                         qreal subPixelX, qreal subPixelY,
+                         const QSize &dstSize) const;
+
     static void calculateParams(KisDabShape const& shape,
                                 qreal subPixelX, qreal subPixelY,
                                 const QSize &originalSize,
@@ -74,6 +88,11 @@ private:
     };
 
     QVector<PyramidLevel> m_levels;
+
+    struct ImageCache;
+
+    // the copies of the pyramid have the same levels, so they share the cache
+    QSharedPointer<ImageCache> m_imageCache;
 };
 
 #endif /* __KIS_QIMAGE_PYRAMID_H */
@@ -0,0 +1,110 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisQImagePyramidBenchmark.h"
+
+#include <QPainter>
+#include <QRadialGradient>
+#include <QtMath>
+
+#include "kis_qimage_pyramid.h"
+
+/**
+ * All the benchmarks shrink a big brush (like the ones imported from
+ * ABR or PNG files) to the random size in range [minScale, 1.0], which
+ * is what the size dynamics does.
+ */
+static const qreal minScale = 0.02;
+
+static qreal randomScale()
+{
+    return minScale + qreal(qrand()) / RAND_MAX * (1.0 - minScale);
+}
+
+void KisQImagePyramidBenchmark::initTestCase()
+{
+    m_brushImage = QImage(1024, 1024, QImage::Format_ARGB32);
+    m_brushImage.fill(0);
+
+    QRadialGradient gradient(QPointF(512, 512), 512);
+    gradient.setColorAt(0.0, Qt::black);
+    gradient.setColorAt(1.0, Qt::transparent);
+
+    QPainter gc(&m_brushImage);
+    gc.fillRect(m_brushImage.rect(), gradient);
+
+    // a few sharp details to make the filtering visible
+    gc.setPen(QPen(Qt::black, 3));
+    for (int i = 0; i < 1024; i += 64) {
+        gc.drawLine(i, 0, 1024 - i, 1024);
+    }
+    gc.end();
+}
+
+void KisQImagePyramidBenchmark::benchmarkSizeDynamics()
+{
+    KisQImagePyramid pyramid(m_brushImage);
+    qsrand(1);
+
+    QBENCHMARK {
+        QImage image = pyramid.createImage(KisDabShape(randomScale(), 1.0, 0.0), 0.0, 0.0);
+        QVERIFY(!image.isNull()); // avoid compiler elimination of unused code!
+    }
+}
+
+void KisQImagePyramidBenchmark::benchmarkSizeAndRotationDynamics()
+{
+    KisQImagePyramid pyramid(m_brushImage);
+    qsrand(1);
+
+    QBENCHMARK {
+        const qreal rotation = qreal(qrand()) / RAND_MAX * 2 * M_PI;
+        QImage image = pyramid.createImage(KisDabShape(randomScale(), 1.0, rotation), 0.3, 0.7);
+        QVERIFY(!image.isNull());
+    }
+}
+
+void KisQImagePyramidBenchmark::benchmarkSqueezedDabs()
+{
+    KisQImagePyramid pyramid(m_brushImage);
+    qsrand(1);
+
+    QBENCHMARK {
+        const qreal rotation = qreal(qrand()) / RAND_MAX * 2 * M_PI;
+        QImage image = pyramid.createImage(KisDabShape(randomScale(), 0.2, rotation), 0.3, 0.7);
+        QVERIFY(!image.isNull());
+    }
+}
+
+void KisQImagePyramidBenchmark::benchmarkCachedSizes()
+{
+    KisQImagePyramid pyramid(m_brushImage);
+
+    // the pressure curve usually gives a limited set of sizes
+    QVector<qreal> scales;
+    for (int i = 0; i < 16; i++) {
+        scales << minScale + i * (1.0 - minScale) / 16;
+    }
+
+    int i = 0;
+
+    QBENCHMARK {
+        QImage image = pyramid.createImage(KisDabShape(scales[i++ % scales.size()], 1.0, 0.0), 0.0, 0.0);
+        QVERIFY(!image.isNull());
+    }
+}
+
+QTEST_MAIN(KisQImagePyramidBenchmark)
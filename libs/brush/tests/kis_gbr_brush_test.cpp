@@ -251,6 +251,186 @@ void KisGbrBrushTest::testPyramidDabTransform()
     QCOMPARE(dabTransformHelper(KisDabShape(1.0, 0.5, M_PI / 4)), QSize(160, 160));
 }
 
+void KisGbrBrushTest::testPyramidResampling()
+{
+    const QRgb color = qRgba(10, 100, 200, 255);
+
+    QImage image(64, 64, QImage::Format_ARGB32);
+    image.fill(color);
+
+    KisQImagePyramid pyramid(image);
+
+    // squeezed and rotated, so the trilinear and anisotropic filtering are used
+    const KisDabShape shape(0.37, 0.6, 0.7);
+
+    QImage result = pyramid.createImage(shape, 0.3, 0.2);
+    QCOMPARE(result.size(), KisQImagePyramid::imageSize(image.size(), shape, 0.3, 0.2));
+
+    // the inner pixels are sampled from the opaque area only
+    const QPoint center(result.width() / 2, result.height() / 2);
+    QCOMPARE(result.pixel(center), color);
+
+    // the corners are outside the rotated dab
+    QCOMPARE(qAlpha(result.pixel(0, 0)), 0);
+
+    // the resampling is deterministic
+    QCOMPARE(pyramid.createImage(shape, 0.3, 0.2), result);
+}
+
+/**
+ * Renders the dab the way the pyramid did before the trilinear
+ * filtering: the nearest level is transformed with QPainter
+ */
+QImage KisGbrBrushTest::qpainterPyramidImage(const KisQImagePyramid &pyramid,
+                                             const KisDabShape &shape,
+                                             qreal subPixelX, qreal subPixelY)
+{
+    qreal baseScale = -1.0;
+    const int level = pyramid.findNearestLevel(shape.scale(), &baseScale);
+    const QImage &srcImage = pyramid.m_levels[level].image;
+
+    QTransform transform;
+    QSize dstSize;
+
+    KisQImagePyramid::calculateParams(shape, subPixelX, subPixelY,
+                                      pyramid.m_originalSize, baseScale, pyramid.m_levels[level].size,
+                                      &transform, &dstSize);
+
+    QImage dstImage(dstSize, QImage::Format_ARGB32);
+    dstImage.fill(0);
+
+    QPainter gc(&dstImage);
+    gc.setTransform(QTransform::fromTranslate(-1, -1) * transform);
+    gc.setRenderHints(QPainter::SmoothPixmapTransform);
+    gc.drawImage(QPointF(), srcImage);
+    gc.end();
+
+    return dstImage;
+}
+
+void KisGbrBrushTest::testPyramidResamplingGradient()
+{
+    QImage image(128, 128, QImage::Format_ARGB32);
+
+    {
+        // a triangle wave, so the shifts of the dab are visible everywhere
+        QLinearGradient gradient(QPointF(0, 0), QPointF(48, 24));
+        gradient.setSpread(QGradient::ReflectSpread);
+        gradient.setColorAt(0.0, Qt::red);
+        gradient.setColorAt(1.0, Qt::blue);
+
+        QPainter gc(&image);
+        gc.setCompositionMode(QPainter::CompositionMode_Source);
+        gc.fillRect(image.rect(), gradient);
+    }
+
+    KisQImagePyramid pyramid(image);
+
+    // the scale is between the levels, so the trilinear filtering is used
+    const KisDabShape shape(0.37, 0.6, 0.7);
+
+    const QImage result = pyramid.createImage(shape, 0.3, 0.2);
+    const QImage reference = qpainterPyramidImage(pyramid, shape, 0.3, 0.2);
+    QCOMPARE(result.size(), reference.size());
+
+    int numPixels = 0;
+    int maxDifference = 0;
+    qint64 totalDifference = 0;
+
+    for (int y = 0; y < result.height(); y++) {
+        for (int x = 0; x < result.width(); x++) {
+            const QRgb pixel = result.pixel(x, y);
+            const QRgb referencePixel = reference.pixel(x, y);
+
+            // the edges of the dab are filtered differently
+            if (qAlpha(pixel) != 255 || qAlpha(referencePixel) != 255) continue;
+
+            const int difference =
+                qMax(qAbs(qRed(pixel) - qRed(referencePixel)),
+                     qMax(qAbs(qGreen(pixel) - qGreen(referencePixel)),
+                          qAbs(qBlue(pixel) - qBlue(referencePixel))));
+
+            maxDifference = qMax(maxDifference, difference);
+            totalDifference += difference;
+            numPixels++;
+        }
+    }
+
+    QVERIFY(numPixels > result.width() * result.height() / 4);
+
+    /**
+     * The coarser level and the anisotropic samples blur the kinks of
+     * the wave a bit, but a shifted dab or the level weights not summing
+     * up to one differ in every pixel
+     */
+    const qreal meanDifference = qreal(totalDifference) / numPixels;
+    QVERIFY2(meanDifference < 4.0, QString("mean difference: %1").arg(meanDifference).toLatin1());
+    QVERIFY2(maxDifference < 40, QString("max difference: %1").arg(maxDifference).toLatin1());
+}
+
+void KisGbrBrushTest::testPyramidAnisotropicFiltering()
+{
+    // horizontal stripes, 8 px high
+    QImage image(256, 256, QImage::Format_ARGB32);
+    image.fill(Qt::white);
+
+    {
+        QPainter gc(&image);
+        for (int y = 0; y < image.height(); y += 16) {
+            gc.fillRect(QRect(0, y, image.width(), 8), Qt::black);
+        }
+    }
+
+    KisQImagePyramid pyramid(image);
+
+    /**
+     * The level of details is chosen by the horizontal scale, the stripes
+     * are 2 px high there. The vertical footprint of a dab pixel is 4 px
+     * of the level, so the anisotropic samples must cover a whole period
+     * of the stripes and the dab becomes uniformly gray. Sampling the
+     * level once or along the wrong axis shows the stripes.
+     */
+    const KisDabShape shape(0.25, 0.25, 0.0);
+
+    const QImage result = pyramid.createImage(shape, 0.0, 0.0);
+    QCOMPARE(result.size(), QSize(64, 16));
+
+    for (int y = 2; y < result.height() - 2; y++) {
+        for (int x = 2; x < result.width() - 2; x++) {
+            const QRgb pixel = result.pixel(x, y);
+
+            if (qAbs(qGray(pixel) - 128) > 3 || qAlpha(pixel) != 255) {
+                qDebug() << "pixel" << x << y << "gray" << qGray(pixel) << "alpha" << qAlpha(pixel);
+                QFAIL("the stripes are not filtered out");
+            }
+        }
+    }
+}
+
+void KisGbrBrushTest::testPyramidImageCache()
+{
+    QImage image(64, 64, QImage::Format_ARGB32);
+    image.fill(qRgba(10, 100, 200, 255));
+
+    KisQImagePyramid pyramid(image);
+
+    const KisDabShape shape(0.37, 0.6, 0.7);
+    const QImage result = pyramid.createImage(shape, 0.3, 0.2);
+
+    // the same dab is taken from the cache
+    QCOMPARE(pyramid.createImage(shape, 0.3, 0.2).cacheKey(), result.cacheKey());
+
+    // the nearly equal shapes share the cached dab
+    const KisDabShape closeShape(0.3701, 0.6001, 0.7001);
+    QCOMPARE(pyramid.createImage(closeShape, 0.31, 0.21).cacheKey(), result.cacheKey());
+
+    // the other sizes are resampled
+    const KisDabShape otherShape(0.5, 0.6, 0.7);
+    const QImage otherResult = pyramid.createImage(otherShape, 0.3, 0.2);
+    QVERIFY(otherResult.cacheKey() != result.cacheKey());
+    QCOMPARE(otherResult.size(), KisQImagePyramid::imageSize(image.size(), otherShape, 0.3, 0.2));
+}
+
 // see comment in KisQImagePyramid::appendPyramidLevel
 void KisGbrBrushTest::testQPainterTransformationBorder()
 {
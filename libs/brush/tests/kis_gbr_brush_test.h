@@ -21,6 +21,9 @@
 
 #include <QtTest>
 
+class KisQImagePyramid;
+class KisDabShape;
+
 class KisGbrBrushTest : public QObject
 {
     Q_OBJECT
@@ -29,6 +32,10 @@ class KisGbrBrushTest : public QObject
     void testMaskGenerationSingleColor();
     void testMaskGenerationDevColor();
 
+    static QImage qpainterPyramidImage(const KisQImagePyramid &pyramid,
+                                       const KisDabShape &shape,
+                                       qreal subPixelX, qreal subPixelY);
+
 private Q_SLOTS:
 
     void testImageGeneration();
@@ -40,6 +47,10 @@ private Q_SLOTS:
 
     void testPyramidLevelRounding();
     void testPyramidDabTransform();
+    void testPyramidResampling();
+    void testPyramidResamplingGradient();
+    void testPyramidAnisotropicFiltering();
+    void testPyramidImageCache();
 
     void testQPainterTransformationBorder();
 };
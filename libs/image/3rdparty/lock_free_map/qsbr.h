@@ -15,19 +15,28 @@
 #include <QMutex>
 #include <QMutexLocker>
 #include <kis_lockless_stack.h>
+#include <KisEpochDomain.h>
 
 #define CALL_MEMBER(obj, pmf) ((obj).*(pmf))
 
+/**
+ * The reclamation is epoch based (see KisEpochDomain): the readers
+ * only mark their own per-thread records, so the lookups of different
+ * threads don't write into shared memory. The enqueued actions are
+ * tagged with the epoch they were retired in and executed when no
+ * reader can reference their objects anymore.
+ */
 class QSBR
 {
 private:
     struct Action {
         void (*func)(void*);
         quint64 param[4]; // Size limit found experimentally. Verified by assert below.
+        int epoch;
 
         Action() = default;
 
-        Action(void (*f)(void*), void* p, quint64 paramSize) : func(f)
+        Action(void (*f)(void*), void* p, quint64 paramSize, int _epoch) : func(f), epoch(_epoch)
         {
             KIS_ASSERT(paramSize <= sizeof(param)); // Verify size limit.
             memcpy(&param, p, paramSize);
@@ -39,33 +48,56 @@ private:
         }
     };
 
-    QAtomicInt m_rawPointerUsers;
     KisLocklessStack<Action> m_pendingActions;
     KisLocklessStack<Action> m_migrationReclaimActions;
 
+    /**
+     * Executes the actions of the pool that cannot be referenced by
+     * anyone anymore. The call never blocks: the epoch domain is shared
+     * by all the maps, so waiting for it would mean waiting for the
+     * readers of unrelated maps. If \p force is true, the epoch is
+     * advanced as far as possible. The actions that are still not safe
+     * stay in the pool.
+     */
     void releasePoolSafely(KisLocklessStack<Action> *pool, bool force = false) {
+        if (pool->isEmpty()) return;
+
         KisLocklessStack<Action> tmp;
         tmp.mergeFrom(*pool);
         if (tmp.isEmpty()) return;
 
-        if (force || tmp.size() > 4096) {
-            while (m_rawPointerUsers.loadAcquire());
+        KisEpochDomain *domain = KisEpochDomain::instance();
+
+        int epoch = domain->tryAdvanceEpoch();
+        if (force) {
+            // one more step lets all the retired actions go when
+            // there are no active readers
+            epoch = domain->tryAdvanceEpoch();
+        }
+
+        KisLocklessStack<Action> notReady;
 
-            Action action;
-            while (tmp.pop(action)) {
+        Action action;
+        while (tmp.pop(action)) {
+            if (KisEpochDomain::isSafeToReclaim(action.epoch, epoch)) {
                 action();
-            }
-        } else {
-            if (!m_rawPointerUsers.loadAcquire()) {
-                Action action;
-                while (tmp.pop(action)) {
-                    action();
-                }
             } else {
-                // push elements back to the source
-                pool->mergeFrom(tmp);
+                notReady.push(action);
             }
         }
+
+        // push elements back to the source
+        pool->mergeFrom(notReady);
+    }
+
+    /**
+     * Executes all the actions of the pool without checking the epoch
+     */
+    void releasePoolUnconditionally(KisLocklessStack<Action> *pool) {
+        Action action;
+        while (pool->pop(action)) {
+            action();
+        }
     }
 
 public:
@@ -85,11 +117,12 @@ public:
         };
 
         Closure closure = {pmf, target};
+        const int epoch = KisEpochDomain::instance()->currentEpoch();
 
         if (migration) {
-            m_migrationReclaimActions.push(Action(Closure::thunk, &closure, sizeof(closure)));
+            m_migrationReclaimActions.push(Action(Closure::thunk, &closure, sizeof(closure), epoch));
         } else {
-            m_pendingActions.push(Action(Closure::thunk, &closure, sizeof(closure)));
+            m_pendingActions.push(Action(Closure::thunk, &closure, sizeof(closure), epoch));
         }
     }
 
@@ -105,18 +138,31 @@ public:
         releasePoolSafely(&m_migrationReclaimActions, true);
     }
 
+    /**
+     * Executes all the pending actions of the map, so that the objects
+     * it retired are freed deterministically. The epochs are not
+     * checked: the caller guarantees that nobody can access the map
+     * anymore, e.g. it is being destroyed. The readers of the other
+     * maps don't hold pointers into this one, so they don't matter.
+     */
+    void drain()
+    {
+        releasePoolUnconditionally(&m_pendingActions);
+        releasePoolUnconditionally(&m_migrationReclaimActions);
+    }
+
     void lockRawPointerAccess()
     {
-        m_rawPointerUsers.ref();
+        KisEpochDomain::instance()->enterCriticalSection();
     }
 
     void unlockRawPointerAccess()
     {
-        m_rawPointerUsers.deref();
+        KisEpochDomain::instance()->exitCriticalSection();
     }
 
     bool sanityRawPointerAccessLocked() const {
-        return m_rawPointerUsers.loadAcquire();
+        return KisEpochDomain::instance()->inCriticalSection();
     }
 };
 
@@ -0,0 +1,217 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include "KisEpochDomain.h"
+
+#include <QThread>
+
+#include "kis_assert.h"
+
+namespace {
+/**
+ * The epoch is stored in the thread state shifted by one bit, so we
+ * limit it to 30 bits and let it wrap around
+ */
+const int EpochMask = 0x3FFFFFFF;
+}
+
+struct KisEpochDomain::ThreadRecord
+{
+    /**
+     * (epoch << 1) | 1 while the thread is in a critical section,
+     * zero otherwise
+     */
+    QAtomicInt state;
+
+    QAtomicInt inUse;
+
+    /**
+     * The object the thread is working with, see enterObjectSection()
+     */
+    QAtomicPointer<const void> object;
+
+    /**
+     * Accessed by the owner thread only
+     */
+    int nestingLevel = 0;
+
+    ThreadRecord *next = 0;
+
+    // keep the records of different threads in different cache lines
+    char padding[64];
+};
+
+/**
+ * Returns the record to the domain when the thread exits. The
+ * records are never freed, they are reused by new threads.
+ */
+struct KisEpochDomain::ThreadRecordHandle
+{
+    ThreadRecordHandle(ThreadRecord *_record) : record(_record) {}
+
+    ~ThreadRecordHandle() {
+        record->nestingLevel = 0;
+        record->state.storeRelease(0);
+        record->object.storeRelease(0);
+        record->inUse.storeRelease(0);
+    }
+
+    ThreadRecord *record;
+};
+
+KisEpochDomain::KisEpochDomain()
+    : m_globalEpoch(0),
+      m_records(0)
+{
+}
+
+KisEpochDomain::~KisEpochDomain()
+{
+}
+
+KisEpochDomain* KisEpochDomain::instance()
+{
+    /**
+     * The domain is used by the maps owned by the global objects,
+     * e.g. KisTileDataStore, so it must outlive all of them. We just
+     * never destroy it.
+     */
+    static KisEpochDomain *s_instance = new KisEpochDomain();
+    return s_instance;
+}
+
+void KisEpochDomain::enterCriticalSection()
+{
+    ThreadRecord *record = currentThreadRecord();
+
+    if (!record->nestingLevel++) {
+        const int epoch = m_globalEpoch.loadAcquire();
+
+        /**
+         * The full barrier guarantees that the state is published
+         * before any shared pointer is read by the thread
+         */
+        record->state.fetchAndStoreOrdered((epoch << 1) | 1);
+    }
+}
+
+void KisEpochDomain::exitCriticalSection()
+{
+    ThreadRecord *record = currentThreadRecord();
+    KIS_SAFE_ASSERT_RECOVER_RETURN(record->nestingLevel > 0);
+
+    if (!--record->nestingLevel) {
+        record->state.storeRelease(0);
+    }
+}
+
+bool KisEpochDomain::inCriticalSection()
+{
+    return currentThreadRecord()->nestingLevel > 0;
+}
+
+int KisEpochDomain::currentEpoch() const
+{
+    return m_globalEpoch.loadAcquire();
+}
+
+int KisEpochDomain::tryAdvanceEpoch()
+{
+    // the full barrier pairs with the one in enterCriticalSection()
+    const int epoch = m_globalEpoch.fetchAndAddOrdered(0);
+    const int activeState = (epoch << 1) | 1;
+
+    for (ThreadRecord *record = m_records.loadAcquire(); record; record = record->next) {
+        const int state = record->state.loadAcquire();
+
+        if (state && state != activeState) {
+            return epoch;
+        }
+    }
+
+    m_globalEpoch.testAndSetOrdered(epoch, (epoch + 1) & EpochMask);
+    return m_globalEpoch.loadAcquire();
+}
+
+bool KisEpochDomain::isSafeToReclaim(int retireEpoch, int epoch)
+{
+    return ((epoch - retireEpoch) & EpochMask) >= 2;
+}
+
+void KisEpochDomain::synchronize()
+{
+    KIS_SAFE_ASSERT_RECOVER_RETURN(!inCriticalSection());
+
+    const int startEpoch = currentEpoch();
+
+    while (!isSafeToReclaim(startEpoch, tryAdvanceEpoch())) {
+        QThread::yieldCurrentThread();
+    }
+}
+
+void KisEpochDomain::enterObjectSection(const void *object)
+{
+    ThreadRecord *record = currentThreadRecord();
+    KIS_SAFE_ASSERT_RECOVER_NOOP(!record->object.load());
+
+    // the full barrier pairs with the one of the waiting thread
+    record->object.fetchAndStoreOrdered(object);
+}
+
+void KisEpochDomain::exitObjectSection()
+{
+    currentThreadRecord()->object.storeRelease(0);
+}
+
+void KisEpochDomain::waitForObjectSection(const void *object)
+{
+    for (ThreadRecord *record = m_records.loadAcquire(); record; record = record->next) {
+        while (record->object.loadAcquire() == object) {
+            QThread::yieldCurrentThread();
+        }
+    }
+}
+
+KisEpochDomain::ThreadRecord* KisEpochDomain::currentThreadRecord()
+{
+    ThreadRecordHandle *handle = m_threadRecords.localData();
+
+    if (!handle) {
+        handle = new ThreadRecordHandle(acquireThreadRecord());
+        m_threadRecords.setLocalData(handle);
+    }
+
+    return handle->record;
+}
+
+KisEpochDomain::ThreadRecord* KisEpochDomain::acquireThreadRecord()
+{
+    for (ThreadRecord *record = m_records.loadAcquire(); record; record = record->next) {
+        if (!record->inUse.loadAcquire() && record->inUse.testAndSetOrdered(0, 1)) {
+            return record;
+        }
+    }
+
+    ThreadRecord *record = new ThreadRecord();
+    record->inUse.store(1);
+
+    ThreadRecord *head = 0;
+    do {
+        head = m_records.loadAcquire();
+        record->next = head;
+    } while (!m_records.testAndSetOrdered(head, record));
+
+    return record;
+}
@@ -0,0 +1,114 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#ifndef KISEPOCHDOMAIN_H
+#define KISEPOCHDOMAIN_H
+
+#include <QAtomicInt>
+#include <QAtomicPointer>
+#include <QThreadStorage>
+
+#include "kritaimage_export.h"
+
+/**
+ * @brief Epoch-based memory reclamation shared by all the lock-free maps
+ * of the image library.
+ *
+ * A thread that is going to access raw pointers stored in a shared
+ * structure enters a critical section. Entering the section only writes
+ * into a record that belongs to the calling thread, so the readers never
+ * fight for the same cache line.
+ *
+ * An object that has been unlinked from the structure is retired with
+ * the current global epoch (see currentEpoch()). The global epoch can be
+ * advanced only when all the threads that are inside a critical section
+ * have observed it. Therefore, when the global epoch is two steps ahead
+ * of the retire epoch, nobody can reference the object anymore and it
+ * is safe to delete it (see isSafeToReclaim()).
+ */
+class KRITAIMAGE_EXPORT KisEpochDomain
+{
+public:
+    static KisEpochDomain* instance();
+
+    /**
+     * Marks the current thread as accessing the shared raw pointers.
+     * The calls can be nested.
+     */
+    void enterCriticalSection();
+    void exitCriticalSection();
+
+    /**
+     * Returns true if the current thread is in a critical section
+     */
+    bool inCriticalSection();
+
+    /**
+     * The epoch the objects should be retired with
+     */
+    int currentEpoch() const;
+
+    /**
+     * Tries to advance the global epoch and returns the new one. The
+     * epoch is not advanced if some thread has not observed it yet.
+     */
+    int tryAdvanceEpoch();
+
+    /**
+     * Returns true if the object retired with \p retireEpoch cannot be
+     * referenced by anyone when the global epoch is \p epoch
+     */
+    static bool isSafeToReclaim(int retireEpoch, int epoch);
+
+    /**
+     * Blocks until all the threads that were in a critical section at
+     * the moment of the call have left it. Must not be called from
+     * a critical section.
+     */
+    void synchronize();
+
+    /**
+     * Marks the current thread as working with \p object. It lets
+     * another thread wait until nobody works with the object (see
+     * waitForObjectSection()) without any shared counter. The sections
+     * cannot be nested and must not wait for anything.
+     */
+    void enterObjectSection(const void *object);
+    void exitObjectSection();
+
+    /**
+     * Blocks until no thread is in a section of \p object. The caller
+     * should publish its intent (e.g. raise a flag checked by the
+     * section owners) with a full barrier before calling it.
+     */
+    void waitForObjectSection(const void *object);
+
+private:
+    KisEpochDomain();
+    ~KisEpochDomain();
+
+    struct ThreadRecord;
+    struct ThreadRecordHandle;
+
+    ThreadRecord* currentThreadRecord();
+    ThreadRecord* acquireThreadRecord();
+
+private:
+    QAtomicInt m_globalEpoch;
+    QAtomicPointer<ThreadRecord> m_records;
+    QThreadStorage<ThreadRecordHandle*> m_threadRecords;
+};
+
+#endif // KISEPOCHDOMAIN_H
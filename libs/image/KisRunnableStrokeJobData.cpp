@@ -21,6 +21,8 @@
 #include <QRunnable>
 #include <kis_assert.h>
 
+#include "KisWorkStealingExecutor.h"
+
 KisRunnableStrokeJobData::KisRunnableStrokeJobData(QRunnable *runnable, KisStrokeJobData::Sequentiality sequentiality, KisStrokeJobData::Exclusivity exclusivity)
     : KisRunnableStrokeJobDataBase(sequentiality, exclusivity),
       m_runnable(runnable)
@@ -33,6 +35,13 @@ KisRunnableStrokeJobData::KisRunnableStrokeJobData(std::function<void ()> func,
 {
 }
 
+KisRunnableStrokeJobData::KisRunnableStrokeJobData(int numTasks, std::function<void (int)> func, KisStrokeJobData::Sequentiality sequentiality, KisStrokeJobData::Exclusivity exclusivity)
+    : KisRunnableStrokeJobDataBase(sequentiality, exclusivity),
+      m_numTasks(numTasks),
+      m_taskFunc(func)
+{
+}
+
 KisRunnableStrokeJobData::~KisRunnableStrokeJobData() {
     if (m_runnable && m_runnable->autoDelete()) {
         delete m_runnable;
@@ -44,5 +53,7 @@ void KisRunnableStrokeJobData::run() {
         m_runnable->run();
     } else if (m_func) {
         m_func();
+    } else if (m_taskFunc) {
+        KisWorkStealingExecutor::runParallelOnCurrentExecutor(m_numTasks, m_taskFunc);
     }
 }
@@ -33,6 +33,17 @@ public:
     KisRunnableStrokeJobData(std::function<void()> func, KisStrokeJobData::Sequentiality sequentiality = KisStrokeJobData::SEQUENTIAL,
                              KisStrokeJobData::Exclusivity exclusivity = KisStrokeJobData::NORMAL);
 
+    /**
+     * Creates a job that consists of \p numTasks independent tasks.
+     * When the job is executed by an update thread, the idle update
+     * threads may steal some of the tasks (see KisWorkStealingExecutor).
+     * The job is still considered finished only when all the tasks are
+     * completed, so the sequentiality of the job is respected.
+     */
+    KisRunnableStrokeJobData(int numTasks, std::function<void(int)> func,
+                             KisStrokeJobData::Sequentiality sequentiality = KisStrokeJobData::SEQUENTIAL,
+                             KisStrokeJobData::Exclusivity exclusivity = KisStrokeJobData::NORMAL);
+
     ~KisRunnableStrokeJobData();
 
     void run() override;
@@ -40,6 +51,9 @@ public:
 private:
     QRunnable *m_runnable = 0;
     std::function<void()> m_func;
+
+    int m_numTasks = 0;
+    std::function<void(int)> m_taskFunc;
 };
 
 #endif // KISRUNNABLESTROKEJOBDATA_H
@@ -0,0 +1,193 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include "KisTileDependencyGraph.h"
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <QWaitCondition>
+
+#include "kis_assert.h"
+#include "kis_algebra_2d.h"
+#include "KisWorkStealingExecutor.h"
+
+struct KisTileDependencyGraph::Task
+{
+    std::function<void()> func;
+    QVector<int> dependents;
+    int numDependencies = 0;
+};
+
+/**
+ * Keeps the tasks whose dependencies are completed. The ready tasks are
+ * taken in LIFO order, so a thread that has just completed a step of a
+ * cell tends to continue with the next step of the same cell, while its
+ * data is still in cache.
+ */
+struct KisTileDependencyGraph::Scheduler
+{
+    Scheduler(QVector<Task> &_tasks)
+        : tasks(_tasks),
+          remainingDependencies(_tasks.size())
+    {
+        for (int i = 0; i < tasks.size(); i++) {
+            remainingDependencies[i] = tasks[i].numDependencies;
+
+            if (!tasks[i].numDependencies) {
+                readyTasks.append(i);
+            }
+        }
+    }
+
+    void processTasks() {
+        QMutexLocker l(&mutex);
+
+        while (numCompletedTasks < tasks.size()) {
+            if (readyTasks.isEmpty()) {
+                taskReady.wait(&mutex);
+                continue;
+            }
+
+            const int index = readyTasks.takeLast();
+
+            l.unlock();
+            tasks[index].func();
+            l.relock();
+
+            numCompletedTasks++;
+
+            bool hasNewTasks = false;
+
+            Q_FOREACH (int dependent, tasks[index].dependents) {
+                if (!--remainingDependencies[dependent]) {
+                    readyTasks.append(dependent);
+                    hasNewTasks = true;
+                }
+            }
+
+            if (hasNewTasks || numCompletedTasks == tasks.size()) {
+                taskReady.wakeAll();
+            }
+        }
+    }
+
+    QVector<Task> &tasks;
+    QVector<int> remainingDependencies;
+    QVector<int> readyTasks;
+    int numCompletedTasks = 0;
+
+    QMutex mutex;
+    QWaitCondition taskReady;
+};
+
+KisTileDependencyGraph::KisTileDependencyGraph(int cellSize)
+    : m_cellSize(cellSize)
+{
+}
+
+KisTileDependencyGraph::~KisTileDependencyGraph()
+{
+}
+
+int KisTileDependencyGraph::addTask(std::function<void()> func, const QVector<int> &dependencies)
+{
+    const int index = m_tasks.size();
+
+    Task task;
+    task.func = func;
+    task.numDependencies = dependencies.size();
+    m_tasks.append(task);
+
+    Q_FOREACH (int dependency, dependencies) {
+        KIS_SAFE_ASSERT_RECOVER_NOOP(dependency < index);
+        m_tasks[dependency].dependents.append(index);
+    }
+
+    return index;
+}
+
+void KisTileDependencyGraph::addCellTasks(const QRect &rect, CellTask task)
+{
+    using namespace KisAlgebra2D;
+
+    if (rect.isEmpty()) return;
+
+    const int firstCol = divideFloor(rect.left(), m_cellSize);
+    const int firstRow = divideFloor(rect.top(), m_cellSize);
+    const int lastCol = divideFloor(rect.right(), m_cellSize);
+    const int lastRow = divideFloor(rect.bottom(), m_cellSize);
+
+    for (int row = firstRow; row <= lastRow; row++) {
+        for (int col = firstCol; col <= lastCol; col++) {
+            const QRect cellRect =
+                rect & QRect(col * m_cellSize, row * m_cellSize, m_cellSize, m_cellSize);
+
+            QVector<int> dependencies;
+
+            auto it = m_lastCellTasks.find(qMakePair(col, row));
+            if (it != m_lastCellTasks.end()) {
+                dependencies << *it;
+            } else if (m_lastBarrier >= 0) {
+                dependencies << m_lastBarrier;
+            }
+
+            const int index = addTask(std::bind(task, cellRect), dependencies);
+            m_lastCellTasks[qMakePair(col, row)] = index;
+        }
+    }
+}
+
+void KisTileDependencyGraph::addBarrierTask(BarrierTask task)
+{
+    QVector<int> dependencies = m_lastCellTasks.values().toVector();
+
+    if (m_lastBarrier >= 0) {
+        dependencies << m_lastBarrier;
+    }
+
+    m_lastBarrier = addTask(task, dependencies);
+    m_lastCellTasks.clear();
+}
+
+int KisTileDependencyGraph::numTasks() const
+{
+    return m_tasks.size();
+}
+
+void KisTileDependencyGraph::run(KisWorkStealingExecutor *executor)
+{
+    if (m_tasks.isEmpty()) return;
+
+    Scheduler scheduler(m_tasks);
+
+    if (executor && executor->hasIdleThreads()) {
+        /**
+         * Every participant of the executor becomes a worker that
+         * processes the ready tasks until the whole graph is done. If
+         * no idle thread joins, the calling thread processes
+         * everything in the first worker and the others exit
+         * immediately.
+         */
+        const int numWorkers = qMax(1, QThread::idealThreadCount());
+
+        executor->runParallel(numWorkers,
+                              [&scheduler] (int) {
+                                  scheduler.processTasks();
+                              });
+    } else {
+        scheduler.processTasks();
+    }
+}
@@ -0,0 +1,95 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#ifndef KISTILEDEPENDENCYGRAPH_H
+#define KISTILEDEPENDENCYGRAPH_H
+
+#include <functional>
+
+#include <QHash>
+#include <QPair>
+#include <QRect>
+#include <QVector>
+
+#include "kritaimage_export.h"
+
+class KisWorkStealingExecutor;
+
+/**
+ * @brief A dependency graph of the tasks of a layer stack recomposition.
+ *
+ * The image area is divided into a grid of cells. A cell task processes
+ * one cell of one step of the recomposition (e.g. composites a layer onto
+ * the projection within the cell). Every cell task depends on the previous
+ * task of the same cell, so the steps of a cell are executed in order, but
+ * the cells are independent of each other. It lets the lower cells go
+ * up the layer stack as soon as they are ready, without waiting for the
+ * rest of the rect.
+ *
+ * A step that reads pixels outside the cell it writes (e.g. a blur, whose
+ * need rect is bigger than its change rect) is added as a barrier task. It
+ * depends on all the tasks added before it, and all the tasks added after
+ * it depend on it.
+ *
+ * The graph is built in one thread and then executed with run().
+ */
+class KRITAIMAGE_EXPORT KisTileDependencyGraph
+{
+public:
+    typedef std::function<void(const QRect&)> CellTask;
+    typedef std::function<void()> BarrierTask;
+
+public:
+    KisTileDependencyGraph(int cellSize);
+    ~KisTileDependencyGraph();
+
+    /**
+     * Adds a task for every cell intersecting \p rect. The task is
+     * called with the intersection of the cell and the rect.
+     */
+    void addCellTasks(const QRect &rect, CellTask task);
+
+    /**
+     * Adds a task that depends on everything added before it
+     */
+    void addBarrierTask(BarrierTask task);
+
+    int numTasks() const;
+
+    /**
+     * Executes the tasks respecting the dependencies. If \p executor is
+     * not null, the independent tasks are processed in parallel by its
+     * threads. Otherwise, they are executed in the calling thread.
+     */
+    void run(KisWorkStealingExecutor *executor);
+
+private:
+    struct Task;
+    struct Scheduler;
+
+    int addTask(std::function<void()> func, const QVector<int> &dependencies);
+
+private:
+    const int m_cellSize;
+    QVector<Task> m_tasks;
+
+    /**
+     * The last task added for every cell since the last barrier
+     */
+    QHash<QPair<int, int>, int> m_lastCellTasks;
+    int m_lastBarrier = -1;
+};
+
+#endif // KISTILEDEPENDENCYGRAPH_H
@@ -0,0 +1,306 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include "KisWorkStealingExecutor.h"
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QSharedPointer>
+#include <QThreadPool>
+#include <QThreadStorage>
+#include <QVector>
+#include <QWaitCondition>
+
+#include "kis_assert.h"
+
+namespace {
+
+/**
+ * The range of the task indexes owned by a participant. Both ends are
+ * packed into one 64-bit word, so the owner taking a task from the
+ * front and a thief cutting the back half can race with a single CAS.
+ */
+inline quint64 packRange(quint32 begin, quint32 end)
+{
+    return (quint64(begin) << 32) | end;
+}
+
+inline quint32 rangeBegin(quint64 range)
+{
+    return quint32(range >> 32);
+}
+
+inline quint32 rangeEnd(quint64 range)
+{
+    return quint32(range & 0xFFFFFFFF);
+}
+
+struct CurrentExecutor
+{
+    KisWorkStealingExecutor *executor = 0;
+};
+
+QThreadStorage<CurrentExecutor> s_currentExecutor;
+
+}
+
+struct KisWorkStealingExecutor::TaskGroup
+{
+    struct Slot
+    {
+        QAtomicInteger<quint64> range;
+
+        // keep the slots of different threads in different cache lines
+        char padding[56];
+    };
+
+    TaskGroup(int _numTasks, int numSlots, std::function<void(int)> _func)
+        : func(_func),
+          numTasks(_numTasks),
+          slots(numSlots)
+    {
+        slots[0].range.store(packRange(0, numTasks));
+        numParticipants.store(1);
+    }
+
+    /**
+     * Takes the first task from the range of the slot. Returns -1 if
+     * the range is empty.
+     */
+    int takeTask(int slotIndex) {
+        QAtomicInteger<quint64> &range = slots[slotIndex].range;
+
+        while (1) {
+            const quint64 value = range.loadAcquire();
+            const quint32 begin = rangeBegin(value);
+            const quint32 end = rangeEnd(value);
+
+            if (begin >= end) return -1;
+
+            if (range.testAndSetOrdered(value, packRange(begin + 1, end))) {
+                return begin;
+            }
+        }
+    }
+
+    /**
+     * Moves the back half of the largest range of the other
+     * participants into our own slot. Returns false if there is
+     * nothing to steal anymore.
+     */
+    bool steal(int slotIndex) {
+        while (1) {
+            int victim = -1;
+            quint64 victimValue = 0;
+            quint32 victimSize = 0;
+
+            const int numSlots = qMin(numParticipants.loadAcquire(), slots.size());
+
+            for (int i = 0; i < numSlots; i++) {
+                if (i == slotIndex) continue;
+
+                const quint64 value = slots[i].range.loadAcquire();
+                const quint32 begin = rangeBegin(value);
+                const quint32 end = rangeEnd(value);
+
+                if (begin < end && end - begin > victimSize) {
+                    victim = i;
+                    victimValue = value;
+                    victimSize = end - begin;
+                }
+            }
+
+            if (victim < 0) return false;
+
+            const quint32 begin = rangeBegin(victimValue);
+            const quint32 end = rangeEnd(victimValue);
+            const quint32 middle = begin + victimSize / 2;
+
+            if (slots[victim].range.testAndSetOrdered(victimValue, packRange(begin, middle))) {
+                slots[slotIndex].range.storeRelease(packRange(middle, end));
+                return true;
+            }
+        }
+    }
+
+    void runTasks(int slotIndex, bool isHelper) {
+        do {
+            int task = -1;
+            while ((task = takeTask(slotIndex)) >= 0) {
+                func(task);
+
+                if (isHelper) {
+                    numStolenTasks.ref();
+                }
+
+                if (numCompletedTasks.fetchAndAddOrdered(1) + 1 == numTasks) {
+                    QMutexLocker l(&mutex);
+                    doneCondition.wakeAll();
+                }
+            }
+        } while (steal(slotIndex));
+    }
+
+    void waitForDone() {
+        QMutexLocker l(&mutex);
+        while (numCompletedTasks.loadAcquire() < numTasks) {
+            doneCondition.wait(&mutex);
+        }
+    }
+
+    std::function<void(int)> func;
+    const int numTasks;
+    QVector<Slot> slots;
+
+    QAtomicInt numParticipants;
+    QAtomicInt numCompletedTasks;
+    QAtomicInt numStolenTasks;
+
+    QMutex mutex;
+    QWaitCondition doneCondition;
+};
+
+class KisWorkStealingExecutor::HelperRunnable : public QRunnable
+{
+public:
+    HelperRunnable(QSharedPointer<TaskGroup> group)
+        : m_group(group)
+    {
+        setAutoDelete(true);
+    }
+
+    void run() override {
+        const int slotIndex = m_group->numParticipants.fetchAndAddOrdered(1);
+
+        /**
+         * The helper might have been started when all the tasks have
+         * already been completed. Then it will just find nothing
+         * to steal.
+         */
+        if (slotIndex < m_group->slots.size()) {
+            m_group->runTasks(slotIndex, true);
+        }
+    }
+
+private:
+    QSharedPointer<TaskGroup> m_group;
+};
+
+KisWorkStealingExecutor::KisWorkStealingExecutor(QThreadPool *threadPool)
+    : m_threadPool(threadPool),
+      m_enabled(true),
+      m_numStolenTasks(0)
+{
+}
+
+KisWorkStealingExecutor::~KisWorkStealingExecutor()
+{
+    m_helperPool.waitForDone();
+}
+
+void KisWorkStealingExecutor::setEnabled(bool value)
+{
+    m_enabled.storeRelease(value);
+}
+
+bool KisWorkStealingExecutor::isEnabled() const
+{
+    return m_enabled.loadAcquire();
+}
+
+bool KisWorkStealingExecutor::hasIdleThreads() const
+{
+    return isEnabled() &&
+        m_threadPool->activeThreadCount() < m_threadPool->maxThreadCount();
+}
+
+void KisWorkStealingExecutor::runParallel(int numTasks, std::function<void(int)> func)
+{
+    if (numTasks <= 0) return;
+
+    const int maxThreadCount = m_threadPool->maxThreadCount();
+    const int numIdleThreads = maxThreadCount - m_threadPool->activeThreadCount();
+    const int maxHelpers = qMin(numTasks - 1, numIdleThreads);
+
+    if (!isEnabled() || maxHelpers <= 0) {
+        for (int i = 0; i < numTasks; i++) {
+            func(i);
+        }
+        return;
+    }
+
+    QSharedPointer<TaskGroup> group(new TaskGroup(numTasks, maxHelpers + 1, func));
+
+    // the helpers of all the groups together use as many threads as
+    // the update pool has
+    if (m_helperPool.maxThreadCount() != maxThreadCount) {
+        m_helperPool.setMaxThreadCount(maxThreadCount);
+    }
+
+    /**
+     * The helpers are started in our own pool, so they never occupy
+     * the threads of the update pool. tryStart() never queues the
+     * runnable, so a helper is not started late when all the tasks
+     * are already done.
+     */
+    for (int i = 0; i < maxHelpers; i++) {
+        HelperRunnable *helper = new HelperRunnable(group);
+        if (!m_helperPool.tryStart(helper)) {
+            delete helper;
+            break;
+        }
+    }
+
+    group->runTasks(0, false);
+    group->waitForDone();
+
+    m_numStolenTasks.fetchAndAddOrdered(group->numStolenTasks.loadAcquire());
+}
+
+qint64 KisWorkStealingExecutor::numStolenTasks() const
+{
+    return m_numStolenTasks.loadAcquire();
+}
+
+KisWorkStealingExecutor* KisWorkStealingExecutor::currentExecutor()
+{
+    return s_currentExecutor.hasLocalData() ?
+        s_currentExecutor.localData().executor : 0;
+}
+
+void KisWorkStealingExecutor::runParallelOnCurrentExecutor(int numTasks, std::function<void(int)> func)
+{
+    KisWorkStealingExecutor *executor = currentExecutor();
+
+    if (executor && executor->hasIdleThreads()) {
+        executor->runParallel(numTasks, func);
+    } else {
+        for (int i = 0; i < numTasks; i++) {
+            func(i);
+        }
+    }
+}
+
+KisWorkStealingExecutor::CurrentExecutorScope::CurrentExecutorScope(KisWorkStealingExecutor *executor)
+    : m_previousExecutor(KisWorkStealingExecutor::currentExecutor())
+{
+    s_currentExecutor.localData().executor = executor;
+}
+
+KisWorkStealingExecutor::CurrentExecutorScope::~CurrentExecutorScope()
+{
+    s_currentExecutor.localData().executor = m_previousExecutor;
+}
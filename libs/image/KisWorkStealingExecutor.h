@@ -0,0 +1,123 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#ifndef KISWORKSTEALINGEXECUTOR_H
+#define KISWORKSTEALINGEXECUTOR_H
+
+#include <functional>
+
+#include <QAtomicInt>
+#include <QThreadPool>
+
+#include "kritaimage_export.h"
+
+/**
+ * @brief Splits a job running in an update thread into small tasks,
+ * which can be stolen by the idle threads of the same thread pool.
+ *
+ * The update scheduler hands out whole jobs (e.g. a merge walker) to the
+ * threads of KisUpdaterContext. When one of the jobs is much bigger than
+ * the others, one thread works while the rest of them sleep. The job can
+ * use runParallel() to split its work into independent tasks. The calling
+ * thread executes the tasks itself, and helper threads join it and steal
+ * halves of the remaining task ranges.
+ *
+ * The helpers run in a separate pool owned by the executor, so the jobs
+ * the scheduler starts in the update pool never wait behind them. The
+ * number of helpers is limited by the number of the update threads that
+ * are idle when runParallel() is called.
+ *
+ * runParallel() returns only when all the tasks are completed, so from
+ * the point of view of the scheduler the job is still executed as a
+ * whole. It means that the stroke and barrier ordering is not affected.
+ * The stolen tasks run under the exclusivity lock held by the parent
+ * job, so they must not try to take it themselves.
+ *
+ * The executor is bound to the update thread with CurrentExecutorScope
+ * while the thread executes a job. The code that runs inside the job
+ * (e.g. KisAsyncMerger or KisRunnableStrokeJobData) fetches it with
+ * currentExecutor().
+ */
+class KRITAIMAGE_EXPORT KisWorkStealingExecutor
+{
+public:
+    KisWorkStealingExecutor(QThreadPool *threadPool);
+    ~KisWorkStealingExecutor();
+
+    /**
+     * When the executor is disabled, runParallel() executes all the
+     * tasks in the calling thread
+     */
+    void setEnabled(bool value);
+    bool isEnabled() const;
+
+    /**
+     * Returns true if there are idle threads in the update pool, so
+     * the helpers can take their place right now. Splitting the work into small pieces
+     * has its cost, so the callers may want to check it beforehand.
+     */
+    bool hasIdleThreads() const;
+
+    /**
+     * Calls \p func for every index in range [0, numTasks) and waits
+     * until all the calls are completed. The calls may be executed in
+     * any order and in different threads.
+     */
+    void runParallel(int numTasks, std::function<void(int)> func);
+
+    /**
+     * Returns the total number of tasks executed by the helper
+     * threads, not by the thread that called runParallel()
+     */
+    qint64 numStolenTasks() const;
+
+    /**
+     * Returns the executor bound to the current thread or null if the
+     * current thread is not an update thread
+     */
+    static KisWorkStealingExecutor* currentExecutor();
+
+    /**
+     * Runs the tasks on the current executor if there is one and it
+     * has idle threads. Otherwise, runs them in the current thread.
+     */
+    static void runParallelOnCurrentExecutor(int numTasks, std::function<void(int)> func);
+
+    /**
+     * Binds the executor to the current thread for the lifetime of
+     * the object
+     */
+    class KRITAIMAGE_EXPORT CurrentExecutorScope
+    {
+    public:
+        CurrentExecutorScope(KisWorkStealingExecutor *executor);
+        ~CurrentExecutorScope();
+
+    private:
+        KisWorkStealingExecutor *m_previousExecutor;
+    };
+
+private:
+    struct TaskGroup;
+    class HelperRunnable;
+
+private:
+    QThreadPool *m_threadPool;
+    QThreadPool m_helperPool;
+    QAtomicInt m_enabled;
+    QAtomicInteger<qint64> m_numStolenTasks;
+};
+
+#endif // KISWORKSTEALINGEXECUTOR_H
@@ -23,6 +23,8 @@
 #include <QBitArray>
 
 #include <KoChannelInfo.h>
+#include <KoColorSpace.h>
+#include <KoCompositeOp.h>
 #include <KoCompositeOpRegistry.h>
 
 #include "kis_node_visitor.h"
@@ -46,6 +48,9 @@
 #include "kis_refresh_subtree_walker.h"
 
 #include "kis_abstract_projection_plane.h"
+#include "KisWorkStealingExecutor.h"
+#include "KisTileDependencyGraph.h"
+#include "krita_utils.h"
 
 
 //#define DEBUG_MERGER
@@ -57,6 +62,196 @@
 #define DEBUG_NODE_ACTION(message, type, leaf, rect)
 #endif
 
+namespace {
+
+/**
+ * The size of the pieces the big rects are split into when there
+ * are idle update threads that can process them in parallel
+ */
+const int PARALLEL_PATCH_SIZE = 128;
+
+/**
+ * The size of the cells of the tile dependency graph
+ */
+const int DEPENDENCY_GRAPH_CELL_SIZE = 128;
+
+/**
+ * The size of the cells the fused runs of layers are blended in. It
+ * is equal to the size of a tile, so the destination tile stays in
+ * cache while all the layers of the run are blended into it.
+ */
+const int FUSED_CELL_SIZE = 64;
+
+/**
+ * Calls \p func for the whole \p rect or, if the current update
+ * thread has idle neighbours, splits the rect into tile-aligned
+ * patches and shares them with the neighbours. The patches do not
+ * overlap, so the callback may write into the same device
+ * concurrently.
+ */
+void runOnPatches(const QRect &rect, std::function<void(const QRect&)> func)
+{
+    KisWorkStealingExecutor *executor = KisWorkStealingExecutor::currentExecutor();
+
+    if (executor && executor->hasIdleThreads()) {
+        const QVector<QRect> patches =
+            KritaUtils::splitRectIntoPatches(rect, QSize(PARALLEL_PATCH_SIZE, PARALLEL_PATCH_SIZE));
+
+        if (patches.size() > 1) {
+            executor->runParallel(patches.size(),
+                                  [&patches, &func] (int i) {
+                                      func(patches[i]);
+                                  });
+            return;
+        }
+    }
+
+    func(rect);
+}
+
+bool canBeFused(const KisMergeWalker::JobItem &item, const QRect &applyRect)
+{
+    return !(item.m_position & KisMergeWalker::N_EXTRA) &&
+        item.m_applyRect == applyRect &&
+        item.m_leaf &&
+        item.m_leaf->isPlainOverLayer();
+}
+
+/**
+ * Pops from \p leafStack the items that directly follow \p item and can
+ * be blended into the projection together with it. The run never goes
+ * beyond the topmost item of a group. If \p item cannot be fused, the
+ * returned run consists of \p item only.
+ */
+QVector<KisMergeWalker::JobItem> collectFusedRun(const KisMergeWalker::JobItem &item,
+                                                 KisMergeWalker::LeafStack &leafStack)
+{
+    QVector<KisMergeWalker::JobItem> run;
+    run << item;
+
+    if (!canBeFused(item, item.m_applyRect)) return run;
+
+    while (!(run.last().m_position & KisMergeWalker::N_TOPMOST) &&
+           !leafStack.isEmpty() &&
+           canBeFused(leafStack.top(), item.m_applyRect)) {
+
+        run << leafStack.pop();
+    }
+
+    return run;
+}
+
+bool needsRecalculation(const KisMergeWalker::JobItem &item)
+{
+    // plain paint layers don't depend on the lower nodes, so
+    // N_ABOVE_FILTHY doesn't need any update
+    return item.m_position & (KisMergeWalker::N_FILTHY |
+                              KisMergeWalker::N_FILTHY_PROJECTION);
+}
+
+/**
+ * A layer of a fused run, see compositeFusedCells()
+ */
+struct FusedLayer
+{
+    KisPaintDeviceSP device;
+    quint8 opacity;
+};
+
+/**
+ * Blends all \p layers into \p projection cell by cell. Every cell
+ * of the projection is read into a buffer once, all the layers of the
+ * run are blended into the buffer with the Normal composite op and the
+ * result is written back once, so the destination tiles are not
+ * locked and copied for every layer of the run.
+ */
+void compositeFusedCells(KisPaintDeviceSP projection,
+                         const QVector<FusedLayer> &layers,
+                         const QRect &rect)
+{
+    const KoColorSpace *dstCs = projection->colorSpace();
+    const KoCompositeOp *op = dstCs->compositeOp(COMPOSITE_OVER);
+    const int dstPixelSize = dstCs->pixelSize();
+
+    QVector<quint8> dstBuffer(FUSED_CELL_SIZE * FUSED_CELL_SIZE * dstPixelSize);
+    QVector<quint8> srcBuffer;
+
+    const QVector<QRect> cells =
+        KritaUtils::splitRectIntoPatches(rect, QSize(FUSED_CELL_SIZE, FUSED_CELL_SIZE));
+
+    Q_FOREACH (const QRect &cell, cells) {
+        bool cellIsRead = false;
+
+        Q_FOREACH (const FusedLayer &layer, layers) {
+            const QRect srcRect = cell & layer.device->extent();
+            if (srcRect.isEmpty()) continue;
+
+            if (!cellIsRead) {
+                projection->readBytes(dstBuffer.data(), cell);
+                cellIsRead = true;
+            }
+
+            const KoColorSpace *srcCs = layer.device->colorSpace();
+            const int srcPixelSize = srcCs->pixelSize();
+
+            srcBuffer.resize(srcRect.width() * srcRect.height() * srcPixelSize);
+            layer.device->readBytes(srcBuffer.data(), srcRect);
+
+            const int dstRowStride = cell.width() * dstPixelSize;
+            const QPoint offset = srcRect.topLeft() - cell.topLeft();
+
+            KoCompositeOp::ParameterInfo params;
+            params.dstRowStart = dstBuffer.data() + offset.y() * dstRowStride + offset.x() * dstPixelSize;
+            params.dstRowStride = dstRowStride;
+            params.srcRowStart = srcBuffer.constData();
+            params.srcRowStride = srcRect.width() * srcPixelSize;
+            params.rows = srcRect.height();
+            params.cols = srcRect.width();
+            params.opacity = float(layer.opacity) / 255.0f;
+
+            // the same parameters as KisPainter::bitBlt() uses
+            dstCs->bitBlt(srcCs, params, op,
+                          KoColorConversionTransformation::internalRenderingIntent(),
+                          KoColorConversionTransformation::internalConversionFlags());
+        }
+
+        if (cellIsRead) {
+            projection->writeBytes(dstBuffer.constData(), cell);
+        }
+    }
+}
+
+/**
+ * Recalculates the layers of \p run if needed and blends them into
+ * \p projection, sharing the patches with the idle update threads.
+ */
+void compositeFusedRun(const QVector<KisMergeWalker::JobItem> &run,
+                       KisPaintDeviceSP projection,
+                       KisNodeSP startNode, const QRect &rect)
+{
+    QVector<FusedLayer> layers;
+
+    Q_FOREACH (const KisMergeWalker::JobItem &item, run) {
+        if (needsRecalculation(item)) {
+            item.m_leaf->projectionPlane()->recalculate(rect, startNode);
+        }
+
+        KisPaintDeviceSP device = item.m_leaf->projection();
+        if (!device) continue;
+
+        layers << FusedLayer{device, item.m_leaf->opacity()};
+    }
+
+    runOnPatches(rect,
+                 [projection, layers] (const QRect &patch) {
+                     compositeFusedCells(projection, layers, patch);
+                 });
+
+    DEBUG_NODE_ACTION("Compositing fused run", run.size(), run.first().m_leaf, rect);
+}
+
+}
+
 
 class KisUpdateOriginalVisitor : public KisNodeVisitor
 {
@@ -216,7 +411,30 @@ private:
 /*                     KisAsyncMerger                                */
 /*********************************************************************/
 
+void KisAsyncMerger::setUseTileDependencyGraph(bool value)
+{
+    m_useTileDependencyGraph = value;
+}
+
+void KisAsyncMerger::setUseFusedCompositing(bool value)
+{
+    m_useFusedCompositing = value;
+}
+
 void KisAsyncMerger::startMerge(KisBaseRectsWalker &walker, bool notifyClones) {
+    if (m_useTileDependencyGraph) {
+        KisWorkStealingExecutor *executor = KisWorkStealingExecutor::currentExecutor();
+
+        if (executor && executor->hasIdleThreads()) {
+            mergeWithDependencyGraph(walker);
+
+            if(notifyClones) {
+                doNotifyClones(walker);
+            }
+            return;
+        }
+    }
+
     KisMergeWalker::LeafStack &leafStack = walker.leafStack();
 
     const bool useTempProjections = walker.needRectVaries();
@@ -261,6 +479,20 @@ void KisAsyncMerger::startMerge(KisBaseRectsWalker &walker, bool notifyClones) {
             setupProjection(currentLeaf, applyRect, useTempProjections);
         }
 
+        if (m_useFusedCompositing && m_currentProjection) {
+            const QVector<KisMergeWalker::JobItem> run = collectFusedRun(item, leafStack);
+
+            if (run.size() > 1) {
+                compositeFusedRun(run, m_currentProjection, walker.startNode(), applyRect);
+
+                if(run.last().m_position & KisMergeWalker::N_TOPMOST) {
+                    writeProjection(run.last().m_leaf, useTempProjections, applyRect);
+                    resetProjection();
+                }
+                continue;
+            }
+        }
+
         KisUpdateOriginalVisitor originalVisitor(applyRect,
                                                  m_currentProjection,
                                                  walker.cropRect());
@@ -318,12 +550,218 @@ void KisAsyncMerger::startMerge(KisBaseRectsWalker &walker, bool notifyClones) {
     }
 }
 
+/**
+ * Does the same as the loop in startMerge(), but doesn't execute the
+ * actions immediately. They are put into a tile dependency graph,
+ * which is executed when the whole walker has been processed.
+ *
+ * Actions that write and read the same tile-aligned cell are added
+ * as cell tasks. Actions that may read outside the area they write,
+ * e.g. updating the original of an adjustment layer or recalculating
+ * a layer with a blur mask, are added as barriers.
+ */
+void KisAsyncMerger::mergeWithDependencyGraph(KisBaseRectsWalker &walker)
+{
+    KisMergeWalker::LeafStack &leafStack = walker.leafStack();
+
+    const bool useTempProjections = walker.needRectVaries();
+    const QRect cropRect = walker.cropRect();
+    const KisNodeSP startNode = walker.startNode();
+
+    KisTileDependencyGraph graph(DEPENDENCY_GRAPH_CELL_SIZE);
+
+    while(!leafStack.isEmpty()) {
+        KisMergeWalker::JobItem item = leafStack.pop();
+        KisProjectionLeafSP currentLeaf = item.m_leaf;
+
+        KIS_SAFE_ASSERT_RECOVER_BREAK(currentLeaf);
+        KIS_SAFE_ASSERT_RECOVER_BREAK(currentLeaf->node());
+        KIS_SAFE_ASSERT_RECOVER_BREAK(currentLeaf->isLayer());
+
+        const QRect applyRect = item.m_applyRect;
+        KisAbstractProjectionPlaneSP plane = currentLeaf->projectionPlane();
+
+        if (currentLeaf->isRoot()) {
+            graph.addBarrierTask(
+                [plane, applyRect, startNode] () {
+                    plane->recalculate(applyRect, startNode);
+                });
+            continue;
+        }
+
+        if(item.m_position & KisMergeWalker::N_EXTRA) {
+            DEBUG_NODE_ACTION("Updating", "N_EXTRA", currentLeaf, applyRect);
+
+            KisPaintDeviceSP projection = m_currentProjection;
+            KisNodeSP node = currentLeaf->node();
+
+            graph.addBarrierTask(
+                [currentLeaf, plane, applyRect, projection, cropRect, node] () {
+                    KisUpdateOriginalVisitor originalVisitor(applyRect, projection, cropRect);
+                    currentLeaf->accept(originalVisitor);
+                    plane->recalculate(applyRect, node);
+                });
+            continue;
+        }
+
+        if (!m_currentProjection) {
+            setupProjection(currentLeaf, applyRect, useTempProjections, &graph);
+        }
+
+        if (m_useFusedCompositing && m_currentProjection) {
+            const QVector<KisMergeWalker::JobItem> run = collectFusedRun(item, leafStack);
+
+            if (run.size() > 1) {
+                QVector<FusedLayer> layers;
+
+                Q_FOREACH (const KisMergeWalker::JobItem &runItem, run) {
+                    KisAbstractProjectionPlaneSP runPlane = runItem.m_leaf->projectionPlane();
+
+                    if (needsRecalculation(runItem)) {
+                        graph.addCellTasks(applyRect,
+                            [runPlane, startNode] (const QRect &rc) {
+                                runPlane->recalculate(rc, startNode);
+                            });
+                    }
+
+                    /**
+                     * The fused layers have no masks, so their projection
+                     * is the original and it is safe to take the device
+                     * before the recalculation tasks are executed
+                     */
+                    KisPaintDeviceSP device = runItem.m_leaf->projection();
+                    if (!device) continue;
+
+                    layers << FusedLayer{device, runItem.m_leaf->opacity()};
+                }
+
+                KisPaintDeviceSP projection = m_currentProjection;
+
+                graph.addCellTasks(applyRect,
+                    [projection, layers] (const QRect &rc) {
+                        compositeFusedCells(projection, layers, rc);
+                    });
+
+                DEBUG_NODE_ACTION("Compositing fused run", run.size(), currentLeaf, applyRect);
+
+                if(run.last().m_position & KisMergeWalker::N_TOPMOST) {
+                    if (m_currentProjection != m_finalProjection) {
+                        KisPaintDeviceSP srcDevice = m_currentProjection;
+                        KisPaintDeviceSP dstDevice = m_finalProjection;
+
+                        graph.addCellTasks(applyRect,
+                            [srcDevice, dstDevice] (const QRect &rc) {
+                                KisPainter::copyAreaOptimized(rc.topLeft(), srcDevice, dstDevice, rc);
+                            });
+                    }
+
+                    resetProjection();
+                }
+                continue;
+            }
+        }
+
+        const bool isVisible = currentLeaf->visible() || currentLeaf->hasClones();
+        bool needsOriginalUpdate = false;
+        bool needsRecalculation = false;
+        KisNodeSP filthyNode = startNode;
+
+        if(item.m_position & KisMergeWalker::N_FILTHY) {
+            DEBUG_NODE_ACTION("Updating", "N_FILTHY", currentLeaf, applyRect);
+            needsOriginalUpdate = needsRecalculation = isVisible;
+        }
+        else if(item.m_position & KisMergeWalker::N_ABOVE_FILTHY) {
+            DEBUG_NODE_ACTION("Updating", "N_ABOVE_FILTHY", currentLeaf, applyRect);
+            needsOriginalUpdate = needsRecalculation =
+                isVisible && currentLeaf->dependsOnLowerNodes();
+            filthyNode = currentLeaf->node();
+        }
+        else if(item.m_position & KisMergeWalker::N_FILTHY_PROJECTION) {
+            DEBUG_NODE_ACTION("Updating", "N_FILTHY_PROJECTION", currentLeaf, applyRect);
+            needsRecalculation = isVisible;
+        }
+
+        /**
+         * The originals of the adjustment layers are calculated from
+         * the projection of the lower layers, and the originals of the
+         * clones are merged from their sources. The other layers don't
+         * update their originals in the merger.
+         */
+        const bool originalReadsOtherCells =
+            needsOriginalUpdate &&
+            (currentLeaf->dependsOnLowerNodes() ||
+             currentLeaf->node()->inherits("KisCloneLayer"));
+
+        if (originalReadsOtherCells) {
+            KisPaintDeviceSP projection = m_currentProjection;
+
+            graph.addBarrierTask(
+                [currentLeaf, plane, applyRect, projection, cropRect, filthyNode] () {
+                    KisUpdateOriginalVisitor originalVisitor(applyRect, projection, cropRect);
+                    currentLeaf->accept(originalVisitor);
+                    plane->recalculate(applyRect, filthyNode);
+                });
+        } else if (needsRecalculation) {
+            // the masks and layer styles may need pixels outside the cell
+            if (plane->needRect(applyRect) == applyRect) {
+                graph.addCellTasks(applyRect,
+                    [plane, filthyNode] (const QRect &rc) {
+                        plane->recalculate(rc, filthyNode);
+                    });
+            } else {
+                graph.addBarrierTask(
+                    [plane, applyRect, filthyNode] () {
+                        plane->recalculate(applyRect, filthyNode);
+                    });
+            }
+        }
+
+        if (m_currentProjection && currentLeaf->visible()) {
+            KisPaintDeviceSP projection = m_currentProjection;
+
+            graph.addCellTasks(applyRect,
+                [projection, plane] (const QRect &rc) {
+                    KisPainter gc(projection);
+                    plane->apply(&gc, rc);
+                });
+
+            DEBUG_NODE_ACTION("Compositing projection", "", currentLeaf, applyRect);
+        }
+
+        if(item.m_position & KisMergeWalker::N_TOPMOST) {
+            if (m_currentProjection && m_currentProjection != m_finalProjection) {
+                KisPaintDeviceSP srcDevice = m_currentProjection;
+                KisPaintDeviceSP dstDevice = m_finalProjection;
+
+                graph.addCellTasks(applyRect,
+                    [srcDevice, dstDevice] (const QRect &rc) {
+                        KisPainter::copyAreaOptimized(rc.topLeft(), srcDevice, dstDevice, rc);
+                    });
+
+                DEBUG_NODE_ACTION("Writing projection", "", currentLeaf->parent(), applyRect);
+            }
+
+            resetProjection();
+        }
+    }
+
+    graph.run(KisWorkStealingExecutor::currentExecutor());
+
+    if(m_currentProjection) {
+        warnImage << "BUG: The walker hasn't reached the root layer!";
+        warnImage << "     Start node:" << walker.startNode() << "Requested rect:" << walker.requestedRect();
+        warnImage << "     An inconsistency in the walkers occurred!";
+        warnImage << "     Please report a bug describing how you got this message.";
+        resetProjection();
+    }
+}
+
 void KisAsyncMerger::resetProjection() {
     m_currentProjection = 0;
     m_finalProjection = 0;
 }
 
-void KisAsyncMerger::setupProjection(KisProjectionLeafSP currentLeaf, const QRect& rect, bool useTempProjection) {
+void KisAsyncMerger::setupProjection(KisProjectionLeafSP currentLeaf, const QRect& rect, bool useTempProjection, KisTileDependencyGraph *graph) {
     KisPaintDeviceSP parentOriginal = currentLeaf->parent()->original();
 
     if (parentOriginal != currentLeaf->projection()) {
@@ -331,11 +769,27 @@ void KisAsyncMerger::setupProjection(KisProjectionLeafSP currentLeaf, const QRec
             if(!m_cachedPaintDevice)
                 m_cachedPaintDevice = new KisPaintDevice(parentOriginal->colorSpace());
             m_currentProjection = m_cachedPaintDevice;
-            m_currentProjection->prepareClone(parentOriginal);
             m_finalProjection = parentOriginal;
+
+            if (graph) {
+                KisPaintDeviceSP projection = m_currentProjection;
+                graph->addBarrierTask(
+                    [projection, parentOriginal] () {
+                        projection->prepareClone(parentOriginal);
+                    });
+            } else {
+                m_currentProjection->prepareClone(parentOriginal);
+            }
         }
         else {
-            parentOriginal->clear(rect);
+            if (graph) {
+                graph->addCellTasks(rect,
+                    [parentOriginal] (const QRect &rc) {
+                        parentOriginal->clear(rc);
+                    });
+            } else {
+                parentOriginal->clear(rect);
+            }
             m_finalProjection = m_currentProjection = parentOriginal;
         }
     }
@@ -357,7 +811,13 @@ void KisAsyncMerger::writeProjection(KisProjectionLeafSP topmostLeaf, bool useTe
     if (!m_currentProjection) return;
 
     if(m_currentProjection != m_finalProjection) {
-        KisPainter::copyAreaOptimized(rect.topLeft(), m_currentProjection, m_finalProjection, rect);
+        KisPaintDeviceSP srcDevice = m_currentProjection;
+        KisPaintDeviceSP dstDevice = m_finalProjection;
+
+        runOnPatches(rect,
+                     [srcDevice, dstDevice] (const QRect &patch) {
+                         KisPainter::copyAreaOptimized(patch.topLeft(), srcDevice, dstDevice, patch);
+                     });
     }
     DEBUG_NODE_ACTION("Writing projection", "", topmostLeaf->parent(), rect);
 }
@@ -367,8 +827,14 @@ bool KisAsyncMerger::compositeWithProjection(KisProjectionLeafSP leaf, const QRe
     if (!m_currentProjection) return true;
     if (!leaf->visible()) return true;
 
-    KisPainter gc(m_currentProjection);
-    leaf->projectionPlane()->apply(&gc, rect);
+    KisPaintDeviceSP projection = m_currentProjection;
+    KisAbstractProjectionPlaneSP plane = leaf->projectionPlane();
+
+    runOnPatches(rect,
+                 [projection, plane] (const QRect &patch) {
+                     KisPainter gc(projection);
+                     plane->apply(&gc, patch);
+                 });
 
     DEBUG_NODE_ACTION("Compositing projection", "", leaf, rect);
     return true;
@@ -24,15 +24,42 @@
 
 class QRect;
 class KisBaseRectsWalker;
+class KisTileDependencyGraph;
 
 class KRITAIMAGE_EXPORT KisAsyncMerger
 {
 public:
     void startMerge(KisBaseRectsWalker &walker, bool notifyClones = true);
 
+    /**
+     * When enabled and the current update thread has idle neighbours
+     * (see KisWorkStealingExecutor), the merger doesn't process the
+     * walker layer by layer. Instead, it builds a tile-level dependency
+     * graph of the whole walker (see KisTileDependencyGraph), so that
+     * the independent tiles are composited in parallel and every tile
+     * goes up the layer stack as soon as its lower layers are ready.
+     */
+    void setUseTileDependencyGraph(bool value);
+
+    /**
+     * When enabled, the runs of sibling paint layers that have
+     * no masks and styles and use Normal blending mode (see
+     * KisProjectionLeaf::isPlainOverLayer()) are blended into the
+     * projection in one pass. The projection is processed tile by tile:
+     * every tile is read into a buffer once, all the layers of the run
+     * are blended into the buffer and the result is written back once
+     * for the whole run.
+     *
+     * The update jobs take the value from KisImageConfig::enableFusedCompositing()
+     */
+    void setUseFusedCompositing(bool value);
+
 private:
+    void mergeWithDependencyGraph(KisBaseRectsWalker &walker);
+
     inline void resetProjection();
-    inline void setupProjection(KisProjectionLeafSP currentLeaf, const QRect& rect, bool useTempProjection);
+    inline void setupProjection(KisProjectionLeafSP currentLeaf, const QRect& rect, bool useTempProjection,
+                                KisTileDependencyGraph *graph = 0);
     inline void writeProjection(KisProjectionLeafSP topmostLeaf, bool useTempProjection, const QRect &rect);
     inline bool compositeWithProjection(KisProjectionLeafSP leaf, const QRect &rect);
     inline void doNotifyClones(KisBaseRectsWalker &walker);
@@ -62,6 +89,9 @@ private:
      * setupProjection()
      */
     KisPaintDeviceSP m_cachedPaintDevice;
+
+    bool m_useTileDependencyGraph = false;
+    bool m_useFusedCompositing = false;
 };
 
 
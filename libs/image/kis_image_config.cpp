@@ -174,6 +174,126 @@ void KisImageConfig::setSwapWindowSize(int value)
     m_config.writeEntry("swapWindowSize", value);
 }
 
+bool KisImageConfig::useMappedSwapFile(bool requestDefault) const
+{
+    return !requestDefault ?
+        m_config.readEntry("useMappedSwapFile", true) : true;
+}
+
+void KisImageConfig::setUseMappedSwapFile(bool value)
+{
+    m_config.writeEntry("useMappedSwapFile", value);
+}
+
+int KisImageConfig::swapExtentSize() const
+{
+    return m_config.readEntry("swapExtentSize", 256); // in MiB
+}
+
+void KisImageConfig::setSwapExtentSize(int value)
+{
+    m_config.writeEntry("swapExtentSize", value);
+}
+
+bool KisImageConfig::enableTilePrefetch(bool requestDefault) const
+{
+    return !requestDefault ?
+        m_config.readEntry("enableTilePrefetch", true) : true;
+}
+
+void KisImageConfig::setEnableTilePrefetch(bool value)
+{
+    m_config.writeEntry("enableTilePrefetch", value);
+}
+
+bool KisImageConfig::enableTileDeduplication(bool requestDefault) const
+{
+    return !requestDefault ?
+        m_config.readEntry("enableTileDeduplication", false) : false;
+}
+
+void KisImageConfig::setEnableTileDeduplication(bool value)
+{
+    m_config.writeEntry("enableTileDeduplication", value);
+}
+
+bool KisImageConfig::enableUniformTiles(bool requestDefault) const
+{
+    return !requestDefault ?
+        m_config.readEntry("enableUniformTiles", false) : false;
+}
+
+void KisImageConfig::setEnableUniformTiles(bool value)
+{
+    m_config.writeEntry("enableUniformTiles", value);
+}
+
+bool KisImageConfig::enableNumaTileArenas(bool requestDefault) const
+{
+    return !requestDefault ?
+        m_config.readEntry("enableNumaTileArenas", false) : false;
+}
+
+void KisImageConfig::setEnableNumaTileArenas(bool value)
+{
+    m_config.writeEntry("enableNumaTileArenas", value);
+}
+
+bool KisImageConfig::enableWorkStealing(bool requestDefault) const
+{
+    return !requestDefault ?
+        m_config.readEntry("enableWorkStealing", true) : true;
+}
+
+void KisImageConfig::setEnableWorkStealing(bool value)
+{
+    m_config.writeEntry("enableWorkStealing", value);
+}
+
+bool KisImageConfig::enableTileDependencyGraph(bool requestDefault) const
+{
+    return !requestDefault ?
+        m_config.readEntry("enableTileDependencyGraph", false) : false;
+}
+
+void KisImageConfig::setEnableTileDependencyGraph(bool value)
+{
+    m_config.writeEntry("enableTileDependencyGraph", value);
+}
+
+bool KisImageConfig::enableFusedCompositing(bool requestDefault) const
+{
+    return !requestDefault ?
+        m_config.readEntry("enableFusedCompositing", true) : true;
+}
+
+void KisImageConfig::setEnableFusedCompositing(bool value)
+{
+    m_config.writeEntry("enableFusedCompositing", value);
+}
+
+QString KisImageConfig::swapCompression(bool requestDefault) const
+{
+    return !requestDefault ?
+        m_config.readEntry("swapCompression", "LZ4") : "LZ4";
+}
+
+void KisImageConfig::setSwapCompression(const QString &value)
+{
+    m_config.writeEntry("swapCompression", value);
+}
+
+QString KisImageConfig::swapColdCompression(bool requestDefault) const
+{
+    return !requestDefault ?
+        m_config.readEntry("swapColdCompression", "ZSTD") : "ZSTD";
+}
+
+void KisImageConfig::setSwapColdCompression(const QString &value)
+{
+    m_config.writeEntry("swapColdCompression", value);
+}
+
 int KisImageConfig::tilesHardLimit() const
 {
     qreal hp = qreal(memoryHardLimitPercent()) / 100.0;
@@ -58,6 +58,89 @@ public:
     int swapWindowSize() const;
     void setSwapWindowSize(int value);
 
+    /**
+     * If true, the whole swap file is mapped into the address space
+     * (if supported by the platform), otherwise only small windows of
+     * it are mapped (see swapWindowSize()).
+     */
+    bool useMappedSwapFile(bool requestDefault = false) const;
+    void setUseMappedSwapFile(bool value);
+
+    /**
+     * The step the mapped swap file is grown with (in MiB)
+     */
+    int swapExtentSize() const;
+    void setSwapExtentSize(int value);
+
+    /**
+     * If true, the tiles that are likely to be accessed soon (the
+     * ones around the viewport and ahead of the brush) are loaded
+     * from the swap file in background
+     */
+    bool enableTilePrefetch(bool requestDefault = false) const;
+    void setEnableTilePrefetch(bool value);
+
+    /**
+     * If true, the tiles with identical content are made to share
+     * the same tile data when a transaction is committed
+     */
+    bool enableTileDeduplication(bool requestDefault = false) const;
+    void setEnableTileDeduplication(bool value);
+
+    /**
+     * If true, the tiles filled with a single color share one tile
+     * data per color, which is expanded only when somebody writes
+     * into the tile. Disabled by default, because every committed
+     * tile is scanned for uniformity.
+     */
+    bool enableUniformTiles(bool requestDefault = false) const;
+    void setEnableUniformTiles(bool value);
+
+    /**
+     * If true, the tile data allocator keeps a separate pool of free
+     * tile buffers for every NUMA node. Takes effect after restart.
+     */
+    bool enableNumaTileArenas(bool requestDefault = false) const;
+    void setEnableNumaTileArenas(bool value);
+
+    /**
+     * If true, the big update jobs are split into smaller tasks, which
+     * are executed by the idle update threads
+     */
+    bool enableWorkStealing(bool requestDefault = false) const;
+    void setEnableWorkStealing(bool value);
+
+    /**
+     * If true, the merge jobs are executed as a graph of per-tile
+     * tasks, so different tiles can go through the layer stack in
+     * parallel. Needs work stealing to be enabled.
+     */
+    bool enableTileDependencyGraph(bool requestDefault = false) const;
+    void setEnableTileDependencyGraph(bool value);
+
+    /**
+     * If true, the runs of plain Normal paint layers are blended into
+     * the projection in one pass, see KisAsyncMerger::setUseFusedCompositing()
+     */
+    bool enableFusedCompositing(bool requestDefault = false) const;
+    void setEnableFusedCompositing(bool value);
+
+    /**
+     * Name of the codec used for compressing tiles that are likely
+     * to be swapped-in soon (working tiles). Defaults to LZ4.
+     * \see KisCompressionFactory
+     */
+    QString swapCompression(bool requestDefault = false) const;
+    void setSwapCompression(const QString &value);
+
+    /**
+     * Name of the codec used for compressing cold tiles, that is
+     * undo history data. Defaults to ZSTD.
+     * \see KisCompressionFactory
+     */
+    QString swapColdCompression(bool requestDefault = false) const;
+    void setSwapColdCompression(const QString &value);
+
     int tilesHardLimit() const; // MiB
     int tilesSoftLimit() const; // MiB
     int poolLimit() const; // MiB
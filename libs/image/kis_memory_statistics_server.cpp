@@ -157,6 +157,25 @@ KisMemoryStatisticsServer::fetchMemoryStatistics(KisImageSP image) const
 
     stats.swapSize = tileStats.swapSize;
 
+    stats.swapOutTiles = tileStats.swapOutTiles;
+    stats.swapOutBatches = tileStats.swapOutBatches;
+    stats.swapOutCompressedSize = tileStats.swapOutCompressedSize;
+    stats.swapOutBackPressureStalls = tileStats.swapOutBackPressureStalls;
+
+    stats.prefetchRequests = tileStats.prefetchRequests;
+    stats.prefetchSwapIns = tileStats.prefetchSwapIns;
+    stats.prefetchHits = tileStats.prefetchHits;
+    stats.swapInMisses = tileStats.swapInMisses;
+
+    stats.deduplicationHits = tileStats.deduplicationHits;
+    stats.deduplicatedMemorySize = tileStats.deduplicatedMemorySize;
+
+    stats.allocatorThreadCacheHits = tileStats.allocatorThreadCacheHits;
+    stats.allocatorArenaTransfers = tileStats.allocatorArenaTransfers;
+    stats.allocatorSystemAllocations = tileStats.allocatorSystemAllocations;
+    stats.allocatorCachedMemorySize = tileStats.allocatorCachedMemorySize;
+    stats.allocatorArenas = tileStats.allocatorArenas;
+
     KisImageConfig cfg(true);
 
     stats.tilesHardLimit = cfg.tilesHardLimit() * MiB;
@@ -46,6 +46,25 @@ public:
 
               swapSize(0),
 
+              swapOutTiles(0),
+              swapOutBatches(0),
+              swapOutCompressedSize(0),
+              swapOutBackPressureStalls(0),
+
+              prefetchRequests(0),
+              prefetchSwapIns(0),
+              prefetchHits(0),
+              swapInMisses(0),
+
+              deduplicationHits(0),
+              deduplicatedMemorySize(0),
+
+              allocatorThreadCacheHits(0),
+              allocatorArenaTransfers(0),
+              allocatorSystemAllocations(0),
+              allocatorCachedMemorySize(0),
+              allocatorArenas(0),
+
               totalMemoryLimit(0),
               tilesHardLimit(0),
               tilesSoftLimit(0),
@@ -65,6 +84,50 @@ public:
 
         qint64 swapSize;
 
+        /**
+         * Cumulative counters of the swap-out pipeline: the number
+         * of swapped out tiles, the number of batches they were
+         * written in, the size of the compressed data and the number
+         * of times the victim selection had to wait for the
+         * compression workers
+         */
+        qint64 swapOutTiles;
+        qint64 swapOutBatches;
+        qint64 swapOutCompressedSize;
+        qint64 swapOutBackPressureStalls;
+
+        /**
+         * Cumulative counters of the tile prefetcher: the number of
+         * prefetch requests, the number of tiles it loaded from swap,
+         * the number of the loaded tiles that were accessed later and
+         * the number of tiles that had to be loaded synchronously
+         */
+        qint64 prefetchRequests;
+        qint64 prefetchSwapIns;
+        qint64 prefetchHits;
+        qint64 swapInMisses;
+
+        /**
+         * The number of tiles that have been made to share tile data
+         * with identical tiles and the amount of memory it freed
+         */
+        qint64 deduplicationHits;
+        qint64 deduplicatedMemorySize;
+
+        /**
+         * Counters of the tile data allocator: the number of
+         * allocations served by the per-thread caches, the number of
+         * batches moved between the threads and the shared arenas, the
+         * number of buffers allocated from the system, the size of the
+         * free buffers kept for reuse and the number of the arenas
+         * (more than one if NUMA arenas are enabled)
+         */
+        qint64 allocatorThreadCacheHits;
+        qint64 allocatorArenaTransfers;
+        qint64 allocatorSystemAllocations;
+        qint64 allocatorCachedMemorySize;
+        int allocatorArenas;
+
         qint64 totalMemoryLimit;
         qint64 tilesHardLimit;
         qint64 tilesSoftLimit;
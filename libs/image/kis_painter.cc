@@ -524,6 +524,14 @@ inline bool KisPainter::Private::tryReduceSourceRect(const KisPaintDevice *srcDe
     return false;
 }
 
+void KisPainter::Private::flushCompositeSpans(const KoColorSpace *srcColorSpace)
+{
+    if (compositeSpans.isEmpty()) return;
+
+    colorSpace->bitBlt(srcColorSpace, paramInfo, compositeSpans, compositeOp, renderingIntent, conversionFlags);
+    compositeSpans.clear();
+}
+
 void KisPainter::bitBltWithFixedSelection(qint32 dstX, qint32 dstY,
                                           const KisPaintDeviceSP srcDev,
                                           const KisFixedPaintDeviceSP selection,
@@ -719,12 +727,32 @@ void KisPainter::bitBltImpl(qint32 dstX, qint32 dstY,
     KisRandomConstAccessorSP srcIt = srcDev->createRandomConstAccessorNG();
     KisRandomAccessorSP dstIt = d->device->createRandomAccessorNG();
 
+    /**
+     * The chunks of the tiles are not composited one by one, but
+     * collected into a batch and passed to the composite op at once.
+     * The raw data pointers of a chunk are valid only while the
+     * accessors keep its tile locked. The accessors are asked to keep
+     * all the tiles of the rect locked, then the whole rect is a single
+     * batch. Otherwise, the batch is flushed before any of the accessors
+     * can release the tile of its first chunk.
+     */
+    const QRect srcBatchRect(srcX, srcY, srcWidth, srcHeight);
+    const QRect dstBatchRect(dstX, dstY, srcWidth, srcHeight);
+
+    bool wholeRectLocked = srcIt->reserveLockedBlocks(srcBatchRect);
+    wholeRectLocked &= dstIt->reserveLockedBlocks(dstBatchRect);
+
+    int maxBatchSize = qMin(srcIt->numLockedBlocks(), dstIt->numLockedBlocks());
+    d->compositeSpans.clear();
+
     /* Here be a huge block of verbose code that does roughly the same than
     the other bit blit operations. This one is longer than the rest in an effort to
     optimize speed and memory use */
     if (d->selection) {
         KisPaintDeviceSP selectionProjection(d->selection->projection());
         KisRandomConstAccessorSP maskIt = selectionProjection->createRandomConstAccessorNG();
+        wholeRectLocked &= maskIt->reserveLockedBlocks(dstBatchRect);
+        maxBatchSize = wholeRectLocked ? INT_MAX : qMin(maxBatchSize, maskIt->numLockedBlocks());
 
         while (rowsRemaining > 0) {
 
@@ -752,22 +780,35 @@ void KisPainter::bitBltImpl(qint32 dstX, qint32 dstY,
                 qint32 srcRowStride = srcIt->rowStride(srcX_, srcY_);
                 srcIt->moveTo(srcX_, srcY_);
 
+                /**
+                 * A solid color source tile can be composited as
+                 * a single pixel, it saves memory bandwidth
+                 */
+                if (!useOldSrcData && srcIt->isUniformBlock()) {
+                    srcRowStride = 0;
+                }
+
                 qint32 dstRowStride = dstIt->rowStride(dstX_, dstY_);
                 dstIt->moveTo(dstX_, dstY_);
 
                 qint32 maskRowStride = maskIt->rowStride(dstX_, dstY_);
                 maskIt->moveTo(dstX_, dstY_);
 
-                d->paramInfo.dstRowStart   = dstIt->rawData();
-                d->paramInfo.dstRowStride  = dstRowStride;
+                KoCompositeOp::Span span;
+                span.dstRowStart   = dstIt->rawData();
+                span.dstRowStride  = dstRowStride;
                 // if we don't use the oldRawData, we need to access the rawData of the source device.
-                d->paramInfo.srcRowStart   = useOldSrcData ? srcIt->oldRawData() : static_cast<KisRandomAccessor2*>(srcIt.data())->rawData();
-                d->paramInfo.srcRowStride  = srcRowStride;
-                d->paramInfo.maskRowStart  = static_cast<KisRandomAccessor2*>(maskIt.data())->rawData();
-                d->paramInfo.maskRowStride = maskRowStride;
-                d->paramInfo.rows          = rows;
-                d->paramInfo.cols          = columns;
-                d->colorSpace->bitBlt(srcDev->colorSpace(), d->paramInfo, d->compositeOp, d->renderingIntent, d->conversionFlags);
+                span.srcRowStart   = useOldSrcData ? srcIt->oldRawData() : static_cast<KisRandomAccessor2*>(srcIt.data())->rawData();
+                span.srcRowStride  = srcRowStride;
+                span.maskRowStart  = static_cast<KisRandomAccessor2*>(maskIt.data())->rawData();
+                span.maskRowStride = maskRowStride;
+                span.rows          = rows;
+                span.cols          = columns;
+                d->compositeSpans.append(span);
+
+                if (d->compositeSpans.size() >= maxBatchSize) {
+                    d->flushCompositeSpans(srcDev->colorSpace());
+                }
 
                 srcX_ += columns;
                 dstX_ += columns;
@@ -778,8 +819,13 @@ void KisPainter::bitBltImpl(qint32 dstX, qint32 dstY,
             dstY_ += rows;
             rowsRemaining -= rows;
         }
+
+        d->flushCompositeSpans(srcDev->colorSpace());
     }
     else {
+        if (wholeRectLocked) {
+            maxBatchSize = INT_MAX;
+        }
 
         while (rowsRemaining > 0) {
 
@@ -803,19 +849,26 @@ void KisPainter::bitBltImpl(qint32 dstX, qint32 dstY,
                 qint32 srcRowStride = srcIt->rowStride(srcX_, srcY_);
                 srcIt->moveTo(srcX_, srcY_);
 
+                if (!useOldSrcData && srcIt->isUniformBlock()) {
+                    srcRowStride = 0;
+                }
+
                 qint32 dstRowStride = dstIt->rowStride(dstX_, dstY_);
                 dstIt->moveTo(dstX_, dstY_);
 
-                d->paramInfo.dstRowStart   = dstIt->rawData();
-                d->paramInfo.dstRowStride  = dstRowStride;
+                KoCompositeOp::Span span;
+                span.dstRowStart   = dstIt->rawData();
+                span.dstRowStride  = dstRowStride;
                 // if we don't use the oldRawData, we need to access the rawData of the source device.
-                d->paramInfo.srcRowStart   = useOldSrcData ? srcIt->oldRawData() : static_cast<KisRandomAccessor2*>(srcIt.data())->rawData();
-                d->paramInfo.srcRowStride  = srcRowStride;
-                d->paramInfo.maskRowStart  = 0;
-                d->paramInfo.maskRowStride = 0;
-                d->paramInfo.rows          = rows;
-                d->paramInfo.cols          = columns;
-                d->colorSpace->bitBlt(srcDev->colorSpace(), d->paramInfo, d->compositeOp, d->renderingIntent, d->conversionFlags);
+                span.srcRowStart   = useOldSrcData ? srcIt->oldRawData() : static_cast<KisRandomAccessor2*>(srcIt.data())->rawData();
+                span.srcRowStride  = srcRowStride;
+                span.rows          = rows;
+                span.cols          = columns;
+                d->compositeSpans.append(span);
+
+                if (d->compositeSpans.size() >= maxBatchSize) {
+                    d->flushCompositeSpans(srcDev->colorSpace());
+                }
 
                 srcX_ += columns;
                 dstX_ += columns;
@@ -826,6 +879,8 @@ void KisPainter::bitBltImpl(qint32 dstX, qint32 dstY,
             dstY_ += rows;
             rowsRemaining -= rows;
         }
+
+        d->flushCompositeSpans(srcDev->colorSpace());
     }
 
     addDirtyRect(QRect(dstX, dstY, srcWidth, srcHeight));
@@ -77,6 +77,12 @@ struct Q_DECL_HIDDEN KisPainter::Private {
     QScopedPointer<KisRunnableStrokeJobsInterface> fakeRunnableStrokeJobsInterface;
     QTransform                  patternTransform;
 
+    /**
+     * The chunks of the tiles collected by bitBltImpl() to be
+     * composited in one batch
+     */
+    QVector<KoCompositeOp::Span> compositeSpans;
+
     bool tryReduceSourceRect(const KisPaintDevice *srcDev,
                              QRect *srcRect,
                              qint32 *srcX,
@@ -86,6 +92,12 @@ struct Q_DECL_HIDDEN KisPainter::Private {
                              qint32 *dstX,
                              qint32 *dstY);
 
+    /**
+     * Composites all the spans collected in compositeSpans and
+     * clears the list
+     */
+    void flushCompositeSpans(const KoColorSpace *srcColorSpace);
+
     void fillPainterPathImpl(const QPainterPath& path, const QRect &requestedRect);
 
     void applyDevice(const QRect &applyRect,
@@ -19,6 +19,7 @@
 #include "kis_projection_leaf.h"
 
 #include <KoColorSpace.h>
+#include <KoCompositeOpRegistry.h>
 
 #include "kis_layer.h"
 #include "kis_image.h"
@@ -26,6 +27,7 @@
 #include "kis_group_layer.h"
 #include "kis_selection_mask.h"
 #include "kis_adjustment_layer.h"
+#include "kis_paint_layer.h"
 
 #include "krita_utils.h"
 
@@ -352,6 +354,24 @@ bool KisProjectionLeaf::hasClones() const
     return layer ? layer->hasClones() : false;
 }
 
+bool KisProjectionLeaf::isPlainOverLayer() const
+{
+    KisPaintLayer *layer = qobject_cast<KisPaintLayer*>(m_d->node.data());
+    if (!layer || layer->isFakeNode()) return false;
+
+    if (!visible() ||
+        layer->compositeOpId() != COMPOSITE_OVER ||
+        layer->hasEffectMasks() ||
+        layer->layerStyle() ||
+        layer->projection() != layer->original()) {
+
+        return false;
+    }
+
+    const QBitArray flags = channelFlags();
+    return flags.isEmpty() || flags.count(true) == flags.size();
+}
+
 bool KisProjectionLeaf::isDroppedNode() const
 {
     return dropReason() != NodeAvailable;
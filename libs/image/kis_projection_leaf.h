@@ -59,6 +59,17 @@ public:
     bool isStillInGraph() const;
     bool hasClones() const;
 
+    /**
+     * \return true if the leaf is a visible paint layer without masks
+     * and layer styles that is composited into its parent with the
+     * Normal (COMPOSITE_OVER) blending mode and all channels enabled.
+     *
+     * The projection of such a layer is just its original, so the merger
+     * can blend a run of such sibling layers into the parent's projection
+     * in one pass, without any intermediate steps in between.
+     */
+    bool isPlainOverLayer() const;
+
     bool isDroppedNode() const;
 
     enum NodeDropReason {
@@ -19,6 +19,7 @@
 #ifndef _KIS_RANDOM_ACCESSOR_NG_H_
 #define _KIS_RANDOM_ACCESSOR_NG_H_
 
+#include <QRect>
 #include "kis_base_accessor.h"
 
 class KRITAIMAGE_EXPORT KisRandomConstAccessorNG : public KisBaseConstAccessor
@@ -31,6 +32,33 @@ public:
     virtual qint32 numContiguousColumns(qint32 x) const = 0;
     virtual qint32 numContiguousRows(qint32 y) const = 0;
     virtual qint32 rowStride(qint32 x, qint32 y) const = 0;
+
+    /**
+     * Returns true if all the pixels of the contiguous block at the
+     * current position are known to be equal to rawDataConst(), so
+     * the block can be processed as a single pixel (e.g. by passing
+     * zero row stride to a composite op). The default implementation
+     * knows nothing about the data and returns false.
+     */
+    virtual bool isUniformBlock() const { return false; }
+
+    /**
+     * Returns the number of the last visited contiguous blocks that the
+     * accessor keeps locked. The raw data pointers of these blocks stay
+     * valid until the accessor visits a new block, so they can be
+     * processed later in a batch. The default implementation guarantees
+     * it for the current block only.
+     */
+    virtual qint32 numLockedBlocks() const { return 1; }
+
+    /**
+     * Asks the accessor to keep locked all the blocks intersecting
+     * \p rect, so that the raw data pointers of the whole rect can be
+     * processed in one batch. Returns true if the accessor guarantees
+     * it, otherwise only numLockedBlocks() last blocks stay locked.
+     * The default implementation does nothing and returns false.
+     */
+    virtual bool reserveLockedBlocks(const QRect &rect) { Q_UNUSED(rect); return false; }
 };
 
 class KRITAIMAGE_EXPORT KisRandomAccessorNG : public KisRandomConstAccessorNG, public KisBaseAccessor
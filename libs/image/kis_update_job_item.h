@@ -60,6 +60,13 @@ public:
     void run() override {
         if (!isRunning()) return;
 
+        /**
+         * Let the jobs split their work and share it with the idle
+         * threads of the context
+         */
+        KisWorkStealingExecutor::CurrentExecutorScope executorScope(
+            &m_updaterContext->m_workStealingExecutor);
+
         /**
          * Here we break the idea of QThreadPool a bit. Ideally, we should split the
          * jobs into distinct QRunnable objects and pass all of them to QThreadPool.
@@ -132,6 +139,8 @@ public:
 
 #endif
 
+        m_merger.setUseTileDependencyGraph(m_updaterContext->tileDependencyGraphEnabled());
+        m_merger.setUseFusedCompositing(m_updaterContext->fusedCompositingEnabled());
         m_merger.startMerge(*m_walker);
 
         QRect changeRect = m_walker->changeRect();
@@ -306,6 +306,9 @@ void KisUpdateScheduler::updateSettings()
     m_d->updatesQueue.updateSettings();
     KisImageConfig config(true);
     m_d->defaultBalancingRatio = config.schedulerBalancingRatio();
+    m_d->updaterContext.setWorkStealingEnabled(config.enableWorkStealing());
+    m_d->updaterContext.setTileDependencyGraphEnabled(config.enableTileDependencyGraph());
+    m_d->updaterContext.setFusedCompositingEnabled(config.enableFusedCompositing());
     setThreadsLimit(config.maxNumberOfThreads());
 }
 
@@ -27,7 +27,8 @@
 const int KisUpdaterContext::useIdealThreadCountTag = -1;
 
 KisUpdaterContext::KisUpdaterContext(qint32 threadCount, KisUpdateScheduler *parent)
-    : m_scheduler(parent)
+    : m_workStealingExecutor(&m_threadPool),
+      m_scheduler(parent)
 {
     if(threadCount <= 0) {
         threadCount = QThread::idealThreadCount();
@@ -258,6 +259,42 @@ void KisUpdaterContext::jobFinished()
 void KisUpdaterContext::setTestingMode(bool value)
 {
     m_testingMode = value;
+
+    // the testing suite runs the jobs manually and expects them
+    // to be executed in the calling thread
+    if (m_testingMode) {
+        m_workStealingExecutor.setEnabled(false);
+    }
+}
+
+void KisUpdaterContext::setWorkStealingEnabled(bool value)
+{
+    m_workStealingExecutor.setEnabled(value && !m_testingMode);
+}
+
+KisWorkStealingExecutor* KisUpdaterContext::workStealingExecutor()
+{
+    return &m_workStealingExecutor;
+}
+
+void KisUpdaterContext::setTileDependencyGraphEnabled(bool value)
+{
+    m_tileDependencyGraphEnabled.storeRelease(value);
+}
+
+bool KisUpdaterContext::tileDependencyGraphEnabled() const
+{
+    return m_tileDependencyGraphEnabled.loadAcquire();
+}
+
+void KisUpdaterContext::setFusedCompositingEnabled(bool value)
+{
+    m_fusedCompositingEnabled.storeRelease(value);
+}
+
+bool KisUpdaterContext::fusedCompositingEnabled() const
+{
+    return m_fusedCompositingEnabled.loadAcquire();
 }
 
 const QVector<KisUpdateJobItem*> KisUpdaterContext::getJobs()
@@ -28,6 +28,7 @@
 #include "kis_lock_free_lod_counter.h"
 
 #include "KisUpdaterContextSnapshotEx.h"
+#include "KisWorkStealingExecutor.h"
 #include "kis_update_scheduler.h"
 
 class KisUpdateJobItem;
@@ -144,6 +145,34 @@ public:
 
     void setTestingMode(bool value);
 
+    /**
+     * Enables splitting of the running jobs into smaller tasks that
+     * can be executed by the idle threads of the context.
+     *
+     * \see KisWorkStealingExecutor
+     */
+    void setWorkStealingEnabled(bool value);
+
+    KisWorkStealingExecutor* workStealingExecutor();
+
+    /**
+     * Makes the merge jobs build a tile dependency graph and execute
+     * it on the work stealing executor.
+     *
+     * \see KisTileDependencyGraph
+     */
+    void setTileDependencyGraphEnabled(bool value);
+    bool tileDependencyGraphEnabled() const;
+
+    /**
+     * Makes the merge jobs blend the runs of plain Normal layers in
+     * one pass.
+     *
+     * \see KisAsyncMerger::setUseFusedCompositing()
+     */
+    void setFusedCompositingEnabled(bool value);
+    bool fusedCompositingEnabled() const;
+
 protected:
     static bool walkerIntersectsJob(KisBaseRectsWalkerSP walker,
                                     const KisUpdateJobItem* job);
@@ -161,9 +190,12 @@ protected:
     QMutex m_lock;
     QVector<KisUpdateJobItem*> m_jobs;
     QThreadPool m_threadPool;
+    KisWorkStealingExecutor m_workStealingExecutor;
     KisLockFreeLodCounter m_lodCounter;
     KisUpdateScheduler *m_scheduler;
     bool m_testingMode = false;
+    QAtomicInt m_tileDependencyGraphEnabled;
+    QAtomicInt m_fusedCompositingEnabled;
 
 private:
 
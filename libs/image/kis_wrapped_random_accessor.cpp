@@ -65,6 +65,17 @@ qint32 KisWrappedRandomAccessor::rowStride(qint32 x, qint32 y) const
     return KisRandomAccessor2::rowStride(x, y);
 }
 
+bool KisWrappedRandomAccessor::reserveLockedBlocks(const QRect &rect)
+{
+    /**
+     * The rects that cross the wrapping border or lie outside of it
+     * may cover a different number of tiles after wrapping, so only
+     * the ones inside the wrap rect are guaranteed to fit
+     */
+    const bool result = KisRandomAccessor2::reserveLockedBlocks(rect);
+    return result && m_wrapRect.contains(rect);
+}
+
 qint32 KisWrappedRandomAccessor::x() const
 {
     return m_currentPos.x();
@@ -35,6 +35,7 @@ public:
     qint32 numContiguousColumns(qint32 x) const override;
     qint32 numContiguousRows(qint32 y) const override;
     qint32 rowStride(qint32 x, qint32 y) const override;
+    bool reserveLockedBlocks(const QRect &rect) override;
 
     qint32 x() const override;
     qint32 y() const override;
@@ -21,8 +21,10 @@
 #include "kis_merge_walker.h"
 #include "kis_full_refresh_walker.h"
 #include "kis_async_merger.h"
+#include "KisWorkStealingExecutor.h"
 
 #include <QTest>
+#include <QThreadPool>
 #include <KoColorSpaceRegistry.h>
 #include <KoColorSpace.h>
 #include "kis_image.h"
@@ -60,7 +62,7 @@ void KisAsyncMergerTest::init()
       +-----------+
      */
 
-void KisAsyncMergerTest::testMerger()
+void testMergerImpl(bool useTileDependencyGraph)
 {
     const KoColorSpace * colorSpace = KoColorSpaceRegistry::instance()->rgb8();
     KisImageSP image = new KisImage(0, 640, 441, colorSpace, "merger test");
@@ -97,8 +99,14 @@ void KisAsyncMergerTest::testMerger()
 
     QRect cropRect(image->bounds());
 
+    QThreadPool threadPool;
+    threadPool.setMaxThreadCount(4);
+    KisWorkStealingExecutor executor(&threadPool);
+    KisWorkStealingExecutor::CurrentExecutorScope executorScope(&executor);
+
     KisMergeWalker walker(cropRect);
     KisAsyncMerger merger;
+    merger.setUseTileDependencyGraph(useTileDependencyGraph);
 
     walker.collectRects(paintLayer2, testRect1);
     merger.startMerge(walker);
@@ -133,6 +141,16 @@ void KisAsyncMergerTest::testMerger()
     QVERIFY(TestUtil::compareQImages(pt, resultProjection, referenceProjection, 5, 0, 0));
 }
 
+void KisAsyncMergerTest::testMerger()
+{
+    testMergerImpl(false);
+}
+
+void KisAsyncMergerTest::testMergerWithTileDependencyGraph()
+{
+    testMergerImpl(true);
+}
+
 
 /**
  * This in not fully automated test for child obliging in KisAsyncMerger.
@@ -508,6 +526,91 @@ void KisAsyncMergerTest::testFilterMaskOnFilterLayer()
                                   "async_merger_test", "mask_on_adj", "initial", 3));
 }
 
+/*
+  +----------------------+
+  |root                  |
+  | paint 7              |
+  | paint 6              |
+  | group                |
+  |  paint 5             |
+  |  paint 4 (hidden)    |
+  |  paint 3 (multiply)  |
+  |  paint 2             |
+  |  paint 1             |
+  | paint 0              |
+  +----------------------+
+ */
+
+QImage mergeFlatLayerStack(bool useFusedCompositing, bool useTileDependencyGraph)
+{
+    const QRect imageRect(0, 0, 300, 200);
+
+    const KoColorSpace *colorSpace = KoColorSpaceRegistry::instance()->rgb8();
+    KisImageSP image = new KisImage(0, imageRect.width(), imageRect.height(), colorSpace, "fused test");
+
+    auto createLayer = [image, colorSpace] (const QString &name, const QRect &rc,
+                                            const QColor &color, quint8 opacity) {
+        KisPaintDeviceSP device = new KisPaintDevice(colorSpace);
+        device->fill(rc, KoColor(color, colorSpace));
+        return KisLayerSP(new KisPaintLayer(image, name, opacity, device));
+    };
+
+    KisLayerSP paintLayer0 = createLayer("paint0", imageRect, Qt::white, OPACITY_OPAQUE_U8);
+    KisLayerSP paintLayer1 = createLayer("paint1", QRect(10, 10, 150, 120), QColor(255, 0, 0, 200), OPACITY_OPAQUE_U8);
+    KisLayerSP paintLayer2 = createLayer("paint2", QRect(70, 30, 170, 100), QColor(0, 255, 0, 128), 180);
+    KisLayerSP paintLayer3 = createLayer("paint3", QRect(40, 60, 200, 90), QColor(0, 0, 255, 255), 128);
+    KisLayerSP paintLayer4 = createLayer("paint4", QRect(0, 0, 100, 100), Qt::black, OPACITY_OPAQUE_U8);
+    KisLayerSP paintLayer5 = createLayer("paint5", QRect(130, 20, 150, 170), QColor(255, 255, 0, 100), 220);
+    KisLayerSP paintLayer6 = createLayer("paint6", QRect(5, 150, 290, 40), QColor(0, 255, 255, 160), OPACITY_OPAQUE_U8);
+    KisLayerSP paintLayer7 = createLayer("paint7", QRect(200, 0, 100, 200), QColor(128, 0, 255, 90), OPACITY_OPAQUE_U8);
+    KisLayerSP groupLayer = new KisGroupLayer(image, "group", 230);
+
+    paintLayer3->setCompositeOpId(COMPOSITE_MULT);
+    paintLayer4->setVisible(false);
+
+    image->addNode(paintLayer0, image->rootLayer());
+    image->addNode(groupLayer, image->rootLayer());
+    image->addNode(paintLayer6, image->rootLayer());
+    image->addNode(paintLayer7, image->rootLayer());
+    image->addNode(paintLayer1, groupLayer);
+    image->addNode(paintLayer2, groupLayer);
+    image->addNode(paintLayer3, groupLayer);
+    image->addNode(paintLayer4, groupLayer);
+    image->addNode(paintLayer5, groupLayer);
+
+    QThreadPool threadPool;
+    threadPool.setMaxThreadCount(4);
+    KisWorkStealingExecutor executor(&threadPool);
+    KisWorkStealingExecutor::CurrentExecutorScope executorScope(&executor);
+
+    KisFullRefreshWalker walker(imageRect);
+    KisAsyncMerger merger;
+    merger.setUseFusedCompositing(useFusedCompositing);
+    merger.setUseTileDependencyGraph(useTileDependencyGraph);
+
+    walker.collectRects(image->rootLayer(), imageRect);
+    merger.startMerge(walker);
+
+    // an update of a single layer of the run
+    paintLayer2->paintDevice()->fill(QRect(100, 50, 60, 60), KoColor(Qt::magenta, colorSpace));
+
+    KisMergeWalker mergeWalker(imageRect);
+    mergeWalker.collectRects(paintLayer2, QRect(100, 50, 60, 60));
+    merger.startMerge(mergeWalker);
+
+    image->waitForDone();
+
+    return image->projection()->convertToQImage(0, imageRect);
+}
+
+void KisAsyncMergerTest::testFusedCompositing()
+{
+    const QImage reference = mergeFlatLayerStack(false, false);
+
+    QCOMPARE(mergeFlatLayerStack(true, false), reference);
+    QCOMPARE(mergeFlatLayerStack(true, true), reference);
+}
+
 
 QTEST_MAIN(KisAsyncMergerTest)
 
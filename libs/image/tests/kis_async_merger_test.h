@@ -29,6 +29,7 @@ private Q_SLOTS:
     void init();
 
     void testMerger();
+    void testMergerWithTileDependencyGraph();
     void debugObligeChild();
     void testFullRefreshWithClones();
     void testSubgraphingWithoutUpdatingParent();
@@ -41,6 +42,8 @@ private Q_SLOTS:
 
     void testFilterMaskOnFilterLayer();
 
+    void testFusedCompositing();
+
 };
 
 #endif /* KIS_ASYNC_MERGER_TEST_H */
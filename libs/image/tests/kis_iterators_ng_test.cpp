@@ -494,4 +494,34 @@ void KisIteratorNGTest::randomAccessor()
     allCsApplicator(&KisIteratorNGTest::randomAccessor);
 }
 
+void KisIteratorNGTest::randomAccessorReservedBlocks()
+{
+    KisPaintDevice dev(KoColorSpaceRegistry::instance()->rgb8());
+
+    KisRandomAccessorSP ac = dev.createRandomAccessorNG();
+    const qint32 defaultLockedBlocks = ac->numLockedBlocks();
+
+    // 5 x 3 tiles
+    const QRect rc(10, 20, 300, 150);
+    QVERIFY(ac->reserveLockedBlocks(rc));
+    QCOMPARE(ac->numLockedBlocks(), 15);
+
+    for (int y = rc.top(); y <= rc.bottom(); y += 16) {
+        for (int x = rc.left(); x <= rc.right(); x += 16) {
+            ac->moveTo(x, y);
+            *ac->rawData() = 1;
+        }
+    }
+    QCOMPARE(dev.extent(), QRect(0, 0, 320, 192));
+
+    // the reserved blocks never shrink
+    QVERIFY(ac->reserveLockedBlocks(QRect(0, 0, 10, 10)));
+    QCOMPARE(ac->numLockedBlocks(), 15);
+
+    // a huge rect doesn't fit, but the accessor still keeps more blocks
+    KisRandomConstAccessorSP acc = dev.createRandomConstAccessorNG();
+    QVERIFY(!acc->reserveLockedBlocks(QRect(0, 0, 4096, 4096)));
+    QVERIFY(acc->numLockedBlocks() > defaultLockedBlocks);
+}
+
 KISTEST_MAIN(KisIteratorNGTest)
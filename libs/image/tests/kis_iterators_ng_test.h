@@ -49,6 +49,7 @@ private Q_SLOTS:
     void sequentialIteratorWithProgressIncomplete();
     void hLineIter();
     void randomAccessor();
+    void randomAccessorReservedBlocks();
 };
 
 #endif
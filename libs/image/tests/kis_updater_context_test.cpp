@@ -22,6 +22,9 @@
 #include "kistest.h"
 
 #include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QRunnable>
+#include <QThreadPool>
 #include <KoColorSpace.h>
 #include <KoColorSpaceRegistry.h>
 
@@ -30,6 +33,7 @@
 #include "kis_merge_walker.h"
 #include "kis_updater_context.h"
 #include "kis_image.h"
+#include "KisWorkStealingExecutor.h"
 
 #include "scheduler_utils.h"
 
@@ -247,5 +251,116 @@ void KisUpdaterContextTest::stressTestExclusiveJobs()
              << "/" << NUM_CHECKS * NUM_JOBS;
 }
 
+void KisUpdaterContextTest::testWorkStealingExecutor()
+{
+    const int numThreads = 4;
+    const int numTasks = 1000;
+
+    QThreadPool threadPool;
+    threadPool.setMaxThreadCount(numThreads);
+
+    KisWorkStealingExecutor executor(&threadPool);
+
+    QVector<int> executionCounts(numTasks, 0);
+    int *counts = executionCounts.data();
+    QAtomicInt numExecutedTasks;
+
+    {
+        KisWorkStealingExecutor::CurrentExecutorScope scope(&executor);
+        QCOMPARE(KisWorkStealingExecutor::currentExecutor(), &executor);
+
+        executor.runParallel(numTasks,
+                             [&] (int i) {
+                                 // every index is processed exactly once
+                                 counts[i]++;
+                                 numExecutedTasks.ref();
+
+                                 if (i % 100 == 0) {
+                                     QTest::qSleep(1);
+                                 }
+                             });
+    }
+
+    QCOMPARE(KisWorkStealingExecutor::currentExecutor(), (KisWorkStealingExecutor*)0);
+    QCOMPARE(numExecutedTasks.loadAcquire(), numTasks);
+
+    for (int i = 0; i < numTasks; i++) {
+        QCOMPARE(executionCounts[i], 1);
+    }
+
+    threadPool.waitForDone();
+
+    // a disabled executor runs everything in the calling thread
+    executor.setEnabled(false);
+    QVERIFY(!executor.hasIdleThreads());
+
+    const qint64 numStolenTasks = executor.numStolenTasks();
+    const Qt::HANDLE callerThread = QThread::currentThreadId();
+    bool allTasksInCallerThread = true;
+
+    executor.runParallel(numTasks,
+                         [&] (int) {
+                             allTasksInCallerThread &= QThread::currentThreadId() == callerThread;
+                         });
+
+    QVERIFY(allTasksInCallerThread);
+    QCOMPARE(executor.numStolenTasks(), numStolenTasks);
+}
+
+namespace {
+struct SetFlagRunnable : public QRunnable
+{
+    SetFlagRunnable(QAtomicInt *flag) : m_flag(flag) {}
+
+    void run() override {
+        m_flag->storeRelease(1);
+    }
+
+    QAtomicInt *m_flag;
+};
+}
+
+void KisUpdaterContextTest::testWorkStealingDoesNotDelayJobs()
+{
+    const int numThreads = 2;
+    const int numTasks = 8;
+
+    QThreadPool threadPool;
+    threadPool.setMaxThreadCount(numThreads);
+
+    KisWorkStealingExecutor executor(&threadPool);
+
+    QAtomicInt jobStarted;
+    QAtomicInt numTasksWithoutJob;
+
+    /**
+     * The first task schedules a job in the update pool while the
+     * helpers are busy. All the tasks wait for the job, so if the
+     * helpers occupied the threads of the update pool, the job would
+     * start only after the tasks give up waiting.
+     */
+    executor.runParallel(numTasks,
+                         [&] (int i) {
+                             if (i == 0) {
+                                 threadPool.start(new SetFlagRunnable(&jobStarted));
+                             }
+
+                             QElapsedTimer timer;
+                             timer.start();
+
+                             while (!jobStarted.loadAcquire() && timer.elapsed() < 1000) {
+                                 QTest::qSleep(1);
+                             }
+
+                             if (!jobStarted.loadAcquire()) {
+                                 numTasksWithoutJob.ref();
+                             }
+                         });
+
+    QCOMPARE(numTasksWithoutJob.loadAcquire(), 0);
+
+    threadPool.waitForDone();
+}
+
 KISTEST_MAIN(KisUpdaterContextTest)
 
@@ -153,6 +153,20 @@ public:
         m_committedFlag = true;
     }
 
+    /**
+     * Makes the committed item reference another tile data with
+     * exactly the same content. Used for tile deduplication.
+     */
+    void replaceTileData(KisTileData *td) {
+        Q_ASSERT(m_committedFlag);
+
+        td->acquire();
+        td->setMementoed(true);
+
+        releaseTileData();
+        m_tileData = td;
+    }
+
     inline KisTileSP tile(KisMementoManager *mm) {
         Q_ASSERT(m_tileData);
         return KisTileSP(new KisTile(m_col, m_row, m_tileData, mm));
@@ -19,6 +19,7 @@
 #include <QtGlobal>
 #include "kis_memento_manager.h"
 #include "kis_memento.h"
+#include "kis_tiled_data_manager.h"
 
 
 //#define DEBUG_MM
@@ -76,7 +77,8 @@
 KisMementoManager::KisMementoManager()
     : m_index(0),
       m_headsHashTable(0),
-      m_registrationBlocked(false)
+      m_registrationBlocked(false),
+      m_dataManager(0)
 {
     /**
      * Tile change/delete registration is enabled for all
@@ -90,7 +92,8 @@ KisMementoManager::KisMementoManager(const KisMementoManager& rhs)
         m_cancelledRevisions(rhs.m_cancelledRevisions),
         m_headsHashTable(rhs.m_headsHashTable, 0),
         m_currentMemento(rhs.m_currentMemento),
-        m_registrationBlocked(rhs.m_registrationBlocked)
+        m_registrationBlocked(rhs.m_registrationBlocked),
+        m_dataManager(0)
 {
     Q_ASSERT_X(!m_registrationBlocked,
                "KisMementoManager", "(impossible happened) "
@@ -194,6 +197,9 @@ void KisMementoManager::commit()
     KisMementoItemSP parentMI;
     bool newTile;
 
+    const bool collectDeduplicationCandidates =
+        KisTileDataStore::instance()->tileSharingEnabled();
+
     KisMementoItemHashTableIterator iter(&m_index);
     while ((mi = iter.tile())) {
         parentMI = m_headsHashTable.getTileLazy(mi->col(), mi->row(), newTile);
@@ -202,6 +208,10 @@ void KisMementoManager::commit()
         mi->commit();
         revisionList.append(mi);
 
+        if (collectDeduplicationCandidates && mi->type() == KisMementoItem::CHANGED) {
+            m_deduplicationCandidates.append(mi);
+        }
+
         m_headsHashTable.deleteTile(mi->col(), mi->row());
 
         iter.moveCurrentToHashTable(&m_headsHashTable);
@@ -222,6 +232,13 @@ void KisMementoManager::commit()
     KisTileDataStore::instance()->kickPooler();
 }
 
+KisMementoItemList KisMementoManager::takeDeduplicationCandidates()
+{
+    KisMementoItemList candidates;
+    candidates.swap(m_deduplicationCandidates);
+    return candidates;
+}
+
 KisTileSP KisMementoManager::getCommitedTile(qint32 col, qint32 row, bool &existingTile)
 {
     /**
@@ -414,6 +431,18 @@ void KisMementoManager::setDefaultTileData(KisTileData *defaultTileData)
     m_index.setDefaultTileData(defaultTileData);
 }
 
+void KisMementoManager::setDataManager(KisTiledDataManager *dataManager)
+{
+    m_dataManager = dataManager;
+}
+
+void KisMementoManager::notifyTileSwappedIn(qint32 col, qint32 row)
+{
+    if (m_dataManager) {
+        m_dataManager->adviseNeighbourTiles(col, row);
+    }
+}
+
 void KisMementoManager::debugPrintInfo()
 {
     printf("KisMementoManager stats:\n");
@@ -53,6 +53,8 @@ typedef KisTileHashTableIteratorTraits<KisMementoItem, QReadLocker> KisMementoIt
 #endif // USE_LOCK_FREE_HASH_TABLE
 
 
+class KisTiledDataManager;
+
 class KRITAIMAGE_EXPORT KisMementoManager
 {
 public:
@@ -87,6 +89,13 @@ public:
      */
     void commit();
 
+    /**
+     * Returns the items committed since the last call. Their tiles
+     * may be deduplicated by the data manager. The list is filled
+     * only when tile sharing is enabled in the store.
+     */
+    KisMementoItemList takeDeduplicationCandidates();
+
     /**
      * Undo and Redo stuff respectively.
      *
@@ -114,6 +123,19 @@ public:
 
     void setDefaultTileData(KisTileData *defaultTileData);
 
+    /**
+     * Sets the data manager that owns the tiles of the memento manager.
+     * It is notified when the data of a tile is swapped in.
+     */
+    void setDataManager(KisTiledDataManager *dataManager);
+
+    /**
+     * Called by a tile after its data has been swapped in. The data
+     * manager hints the swap backend about the neighbours of the
+     * tile, because they are usually read next.
+     */
+    void notifyTileSwappedIn(qint32 col, qint32 row);
+
     void debugPrintInfo();
 
 
@@ -148,6 +170,11 @@ protected:
      */
     KisHistoryList m_cancelledRevisions;
 
+    /**
+     * Items committed since the last call to takeDeduplicationCandidates()
+     */
+    KisMementoItemList m_deduplicationCandidates;
+
     /**
      * A hash table, that stores the most recently updated
      * versions of tiles. Say, HEAD revision :)
@@ -169,6 +196,8 @@ protected:
      * \see rollforward()
      */
     bool m_registrationBlocked;
+
+    KisTiledDataManager *m_dataManager;
 };
 
 #endif /* KIS_MEMENTO_MANAGER_ */
@@ -22,15 +22,18 @@
 #include <kis_debug.h>
 
 
-const quint32 KisRandomAccessor2::CACHESIZE = 4; // Define the number of tiles we keep in cache
+const quint32 KisRandomAccessor2::CACHESIZE = 4; // Define the number of tiles we keep in cache by default
+const quint32 KisRandomAccessor2::MAX_RESERVED_CACHESIZE = 256; // 1024x1024 pixels
 
 KisRandomAccessor2::KisRandomAccessor2(KisTiledDataManager *ktm, qint32 offsetX, qint32 offsetY, bool writable, KisIteratorCompleteListener *completeListener) :
         m_ktm(ktm),
         m_tilesCache(new KisTileInfo*[CACHESIZE]),
         m_tilesCacheSize(0),
+        m_tilesCacheCapacity(CACHESIZE),
         m_pixelSize(m_ktm->pixelSize()),
         m_data(0),
         m_oldData(0),
+        m_uniform(false),
         m_writable(writable),
         m_lastX(0),
         m_lastY(0),
@@ -72,6 +75,7 @@ void KisRandomAccessor2::moveTo(qint32 x, qint32 y)
             offset *= m_pixelSize;
             m_data = kti->data + offset;
             m_oldData = kti->oldData + offset;
+            m_uniform = kti->uniform;
             if (i > 0) {
                 memmove(m_tilesCache + 1, m_tilesCache, i * sizeof(KisTileInfo*));
                 m_tilesCache[0] = kti;
@@ -80,10 +84,10 @@ void KisRandomAccessor2::moveTo(qint32 x, qint32 y)
         }
     }
     // The tile wasn't in cache
-    if (m_tilesCacheSize == KisRandomAccessor2::CACHESIZE) { // Remove last element of cache
-        unlockTile(m_tilesCache[CACHESIZE-1]->tile);
-        unlockOldTile(m_tilesCache[CACHESIZE-1]->oldtile);
-        delete m_tilesCache[CACHESIZE-1];
+    if (m_tilesCacheSize == m_tilesCacheCapacity) { // Remove last element of cache
+        unlockTile(m_tilesCache[m_tilesCacheCapacity-1]->tile);
+        unlockOldTile(m_tilesCache[m_tilesCacheCapacity-1]->oldtile);
+        delete m_tilesCache[m_tilesCacheCapacity-1];
     } else {
         m_tilesCacheSize++;
     }
@@ -94,7 +98,8 @@ void KisRandomAccessor2::moveTo(qint32 x, qint32 y)
     offset *= m_pixelSize;
     m_data = kti->data + offset;
     m_oldData = kti->oldData + offset;
-    memmove(m_tilesCache + 1, m_tilesCache, (KisRandomAccessor2::CACHESIZE - 1) * sizeof(KisTileInfo*));
+    m_uniform = kti->uniform;
+    memmove(m_tilesCache + 1, m_tilesCache, (m_tilesCacheSize - 1) * sizeof(KisTileInfo*));
     m_tilesCache[0] = kti;
 }
 
@@ -127,6 +132,12 @@ KisRandomAccessor2::KisTileInfo* KisRandomAccessor2::fetchTileData(qint32 col, q
     lockTile(kti->tile);
     kti->data = kti->tile->data();
 
+    /**
+     * Writable accessors expand uniform tiles on locking, so
+     * only the read-only ones can benefit from them
+     */
+    kti->uniform = !m_writable && kti->tile->tileData()->isUniform();
+
     lockOldTile(kti->oldtile);
     kti->oldData = kti->oldtile->data();
 
@@ -153,6 +164,44 @@ qint32 KisRandomAccessor2::rowStride(qint32 x, qint32 y) const
     return m_ktm->rowStride(x - m_offsetX, y - m_offsetY);
 }
 
+bool KisRandomAccessor2::isUniformBlock() const
+{
+    return m_uniform;
+}
+
+qint32 KisRandomAccessor2::numLockedBlocks() const
+{
+    /**
+     * The tiles are evicted from the cache in LRU order, so the last
+     * m_tilesCacheCapacity visited tiles are always locked
+     */
+    return m_tilesCacheCapacity;
+}
+
+bool KisRandomAccessor2::reserveLockedBlocks(const QRect &rect)
+{
+    if (rect.isEmpty()) return true;
+
+    const qint32 numColumns =
+        m_ktm->xToCol(rect.right() - m_offsetX) - m_ktm->xToCol(rect.left() - m_offsetX) + 1;
+    const qint32 numRows =
+        m_ktm->yToRow(rect.bottom() - m_offsetY) - m_ktm->yToRow(rect.top() - m_offsetY) + 1;
+
+    const quint32 numTiles = quint32(numColumns) * quint32(numRows);
+    const quint32 newCapacity = qMin(numTiles, MAX_RESERVED_CACHESIZE);
+
+    if (newCapacity > m_tilesCacheCapacity) {
+        KisTileInfo** newCache = new KisTileInfo*[newCapacity];
+        memcpy(newCache, m_tilesCache, m_tilesCacheSize * sizeof(KisTileInfo*));
+        delete [] m_tilesCache;
+
+        m_tilesCache = newCache;
+        m_tilesCacheCapacity = newCapacity;
+    }
+
+    return numTiles <= m_tilesCacheCapacity;
+}
+
 qint32 KisRandomAccessor2::x() const
 {
     return m_lastX;
@@ -35,6 +35,7 @@ class KisRandomAccessor2 : public KisRandomAccessorNG
         KisTileSP oldtile;
         quint8* data;
         const quint8* oldData;
+        bool uniform;
         qint32 area_x1, area_y1, area_x2, area_y2;
     };
 
@@ -88,6 +89,9 @@ public:
     qint32 numContiguousColumns(qint32 x) const override;
     qint32 numContiguousRows(qint32 y) const override;
     qint32 rowStride(qint32 x, qint32 y) const override;
+    bool isUniformBlock() const override;
+    qint32 numLockedBlocks() const override;
+    bool reserveLockedBlocks(const QRect &rect) override;
     qint32 x() const override;
     qint32 y() const override;
 
@@ -95,14 +99,17 @@ private:
     KisTiledDataManager *m_ktm;
     KisTileInfo** m_tilesCache;
     quint32 m_tilesCacheSize;
+    quint32 m_tilesCacheCapacity;
     qint32 m_pixelSize;
     quint8* m_data;
     const quint8* m_oldData;
+    bool m_uniform;
     bool m_writable;
     int m_lastX, m_lastY;
     qint32 m_offsetX, m_offsetY;
     KisIteratorCompleteListener *m_completeListener;
-    static const quint32 CACHESIZE; // Define the number of tiles we keep in cache
+    static const quint32 CACHESIZE; // Define the number of tiles we keep in cache by default
+    static const quint32 MAX_RESERVED_CACHESIZE; // The limit for reserveLockedBlocks()
 
 };
 
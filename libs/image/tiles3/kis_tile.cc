@@ -175,13 +175,29 @@ inline void KisTile::blockSwapping() const
      * why we can not use atomic operations here.
      */
 
-    QMutexLocker locker(&m_swapBarrierLock);
-    Q_ASSERT(m_lockCounter >= 0);
+    bool swappedIn = false;
+
+    {
+        QMutexLocker locker(&m_swapBarrierLock);
+        Q_ASSERT(m_lockCounter >= 0);
 
-    if(!m_lockCounter++)
-        m_tileData->blockSwapping();
+        if(!m_lockCounter++) {
+            swappedIn = m_tileData->blockSwapping();
+        }
+
+        Q_ASSERT(data());
+    }
 
-    Q_ASSERT(data());
+    /**
+     * The neighbours are advised after the barrier is released,
+     * because advising locks their barriers
+     */
+    if (swappedIn) {
+        KisMementoManager *mm = m_mementoManager.loadAcquire();
+        if (mm) {
+            mm->notifyTileSwappedIn(m_col, m_row);
+        }
+    }
 }
 
 inline void KisTile::unblockSwapping() const
@@ -226,6 +242,80 @@ void KisTile::lockForRead() const
     blockSwapping();
 }
 
+bool KisTile::prefetchData() const
+{
+    KisTileData *td = 0;
+
+    {
+        /**
+         * If the tile is locked, its data is already in memory. The
+         * barrier lock is held only while taking a reference to the
+         * tile data, the swap-in itself may take a while and should
+         * not block the users of the tile.
+         */
+        QMutexLocker locker(&m_swapBarrierLock);
+        if (m_lockCounter) return false;
+
+        td = m_tileData;
+        td->ref();
+    }
+
+    /**
+     * The reference keeps the tile data alive even if the tile
+     * replaces it in the meantime. The store re-checks whether
+     * the data is still swapped out under its own lock.
+     */
+    const bool result = td->m_store->prefetchTileData(td);
+    td->deref();
+
+    return result;
+}
+
+void KisTile::adviseDataNeeded() const
+{
+    KisTileData *td = 0;
+
+    {
+        // see comment in prefetchData()
+        QMutexLocker locker(&m_swapBarrierLock);
+        if (m_lockCounter) return;
+
+        td = m_tileData;
+        td->ref();
+    }
+
+    td->m_store->adviseTileDataNeeded(td);
+    td->deref();
+}
+
+bool KisTile::deduplicate(KisMementoItem *mi)
+{
+    QMutexLocker locker(&m_swapBarrierLock);
+
+    /**
+     * Someone is working with the tile right now, it
+     * is not safe to replace its data
+     */
+    if (m_lockCounter || mi->tileData() != m_tileData) return false;
+
+    KisTileDataStore *store = m_tileData->m_store;
+
+    KisTileData *duplicate = store->acquireDuplicate(m_tileData);
+    if (!duplicate) return false;
+
+    mi->replaceTileData(duplicate);
+
+    KisTileData *oldTileData = m_tileData;
+    m_tileData = duplicate;
+
+    const qint32 pixelSize = oldTileData->pixelSize();
+    if (!oldTileData->release()) {
+        store->notifyDeduplicatedTileDataFreed(pixelSize);
+    }
+
+    return true;
+}
+
 
 #define lazyCopying() (m_tileData->m_usersCount>1)
 
@@ -269,6 +359,15 @@ void KisTile::lockForWrite()
 #endif
     }
 
+    /**
+     * The writer may change any pixel of the tile. Shared uniform
+     * tile datas have just been expanded by the COW above, so here
+     * we own the data exclusively.
+     */
+    if (m_tileData->m_uniform.loadAcquire()) {
+        m_tileData->m_uniform.storeRelease(0);
+    }
+
     DEBUG_LOG_ACTION("lock [W]");
 }
 
@@ -39,6 +39,7 @@ class KisTile;
 typedef KisSharedPtr<KisTile> KisTileSP;
 
 class KisMementoManager;
+class KisMementoItem;
 
 
 /**
@@ -92,6 +93,27 @@ public:
     void unlockForWrite();
     void unlockForRead() const;
 
+    /**
+     * Loads the tile data from the swap file if it has been swapped
+     * out. Unlike lockForRead() it doesn't prevent the data from being
+     * swapped out again. Returns true if the data has been loaded.
+     */
+    bool prefetchData() const;
+
+    /**
+     * Hints the swap backend that the tile data is going to be read
+     * soon. Unlike prefetchData() it doesn't load the data itself,
+     * the backend may start reading it from disk asynchronously.
+     */
+    void adviseDataNeeded() const;
+
+    /**
+     * Makes the tile and its committed memento item \p mi share
+     * the tile data with another tile of exactly the same content,
+     * if the store knows one. Returns true if the tile data has been
+     * replaced. The caller should hold the data manager's lock.
+     */
+    bool deduplicate(KisMementoItem *mi);
 
     /* this allows us work directly on tile's data */
     inline quint8 *data() const {
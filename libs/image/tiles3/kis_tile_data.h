@@ -88,13 +88,26 @@ inline KisTileData* KisTileData::clone() {
     return m_store->duplicateTileData(this);
 }
 
-inline void KisTileData::blockSwapping() {
+inline bool KisTileData::blockSwapping() {
+    bool swappedOut = false;
+
     m_swapLock.lockForRead();
     if(!m_data) {
         m_swapLock.unlock();
         m_store->ensureTileDataLoaded(this);
+        swappedOut = true;
     }
     resetAge();
+
+    /**
+     * The unlocked check is cheap enough for the access path, the
+     * state is changed for the tile datas loaded by the prefetcher only
+     */
+    if (m_prefetched.loadAcquire() == PrefetchedNotAccessed) {
+        m_prefetched.testAndSetOrdered(PrefetchedNotAccessed, PrefetchedAccessed);
+    }
+
+    return swappedOut;
 }
 
 inline void KisTileData::unblockSwapping() {
@@ -119,6 +132,10 @@ inline bool KisTileData::historical() const {
     return mementoed() && numUsers() <= 1;
 }
 
+inline bool KisTileData::isUniform() const {
+    return m_uniform.loadAcquire();
+}
+
 inline int KisTileData::age() const {
     return m_age;
 }
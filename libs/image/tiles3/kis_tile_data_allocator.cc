@@ -0,0 +1,440 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_tile_data_allocator.h"
+
+#include <QAtomicInt>
+#include <QDir>
+#include <QFile>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThreadStorage>
+#include <QVector>
+
+#include <boost/pool/singleton_pool.hpp>
+
+#ifdef Q_OS_LINUX
+#include <sched.h>
+#endif
+
+#include <kis_debug.h>
+#include "kis_image_config.h"
+#include "kis_tile_data_interface.h"
+
+// BPP == bytes per pixel
+#define TILE_SIZE_4BPP (4 * __TILE_DATA_WIDTH * __TILE_DATA_HEIGHT)
+#define TILE_SIZE_8BPP (8 * __TILE_DATA_WIDTH * __TILE_DATA_HEIGHT)
+
+typedef boost::singleton_pool<KisTileData, TILE_SIZE_4BPP, boost::default_user_allocator_new_delete, boost::details::pool::default_mutex, 256, 4096> BoostPool4BPP;
+typedef boost::singleton_pool<KisTileData, TILE_SIZE_8BPP, boost::default_user_allocator_new_delete, boost::details::pool::default_mutex, 128, 2048> BoostPool8BPP;
+
+namespace {
+
+const int NumSizeClasses = 3;
+
+/**
+ * The number of buffers moved between a thread cache and an arena
+ * at once. The thread cache keeps at most two batches.
+ */
+const int BatchSize = 32;
+const int MaxThreadCacheSize = 2 * BatchSize;
+
+inline int sizeClass(qint32 pixelSize)
+{
+    switch (pixelSize) {
+    case 4:
+        return 0;
+    case 8:
+        return 1;
+    case 16:
+        return 2;
+    default:
+        return -1;
+    }
+}
+
+inline qint32 bufferSize(qint32 pixelSize)
+{
+    return pixelSize * __TILE_DATA_WIDTH * __TILE_DATA_HEIGHT;
+}
+
+inline qint32 classBufferSize(int sizeClass)
+{
+    return bufferSize(4 << sizeClass);
+}
+
+quint8* systemAllocate(int sizeClass)
+{
+    switch (sizeClass) {
+    case 0:
+        return (quint8*)BoostPool4BPP::malloc();
+    case 1:
+        return (quint8*)BoostPool8BPP::malloc();
+    default:
+        return (quint8*)malloc(classBufferSize(sizeClass));
+    }
+}
+
+/**
+ * Releases a buffer that is not going to be cached anymore. The
+ * buffers of the boost pools are returned by purging the pools, so
+ * only the malloc'ed ones should be freed explicitly.
+ */
+void dropBuffer(quint8 *ptr, int sizeClass)
+{
+    if (sizeClass > 1) {
+        free(ptr);
+    }
+}
+
+struct Arena
+{
+    QMutex lock;
+    QVector<QVector<quint8*>> batches[NumSizeClasses];
+};
+
+#ifdef Q_OS_LINUX
+/**
+ * Fills \p cpuToNode with the index of the NUMA node of every CPU and
+ * returns the number of nodes
+ */
+int detectNumaNodes(QVector<int> &cpuToNode)
+{
+    QDir nodesDir("/sys/devices/system/node");
+    const QStringList nodeNames =
+        nodesDir.entryList(QStringList() << "node*", QDir::Dirs);
+
+    int numNodes = 0;
+
+    Q_FOREACH (const QString &nodeName, nodeNames) {
+        bool ok = false;
+        nodeName.mid(4).toInt(&ok);
+        if (!ok) continue;
+
+        QFile file(nodesDir.filePath(nodeName + "/cpulist"));
+        if (!file.open(QIODevice::ReadOnly)) continue;
+
+        const QString cpuList = QString::fromLatin1(file.readAll()).trimmed();
+
+        Q_FOREACH (const QString &range, cpuList.split(',', QString::SkipEmptyParts)) {
+            const QStringList limits = range.split('-');
+            const int first = limits.first().toInt();
+            const int last = limits.last().toInt();
+
+            if (last >= cpuToNode.size()) {
+                cpuToNode.resize(last + 1);
+            }
+
+            for (int cpu = first; cpu <= last; cpu++) {
+                cpuToNode[cpu] = numNodes;
+            }
+        }
+
+        numNodes++;
+    }
+
+    return numNodes;
+}
+#endif /* Q_OS_LINUX */
+
+}
+
+struct KisTileDataAllocator::Private
+{
+    QVector<Arena*> arenas;
+    QVector<int> cpuToArena;
+
+    /**
+     * Incremented by releaseCachedMemory(). The thread caches of
+     * the older generation contain the purged buffers.
+     */
+    QAtomicInt generation;
+
+    QThreadStorage<ThreadCache*> threadCaches;
+
+    mutable QMutex registryLock;
+    QList<ThreadCache*> registry;
+    qint64 finishedThreadsCacheHits = 0;
+
+    QAtomicInteger<qint64> arenaTransfers;
+    QAtomicInteger<qint64> systemAllocations;
+    QAtomicInteger<qint64> arenaMemorySize;
+
+    Arena* arenaForCurrentThread() const;
+    bool fetchBatch(Arena *arena, int sizeClass, QVector<quint8*> &buffers);
+    void returnBatch(Arena *arena, int sizeClass, QVector<quint8*> &&batch);
+};
+
+/**
+ * The cache is owned by its thread and destroyed by QThreadStorage
+ * when the thread exits. Only the counters are read by other threads.
+ */
+struct KisTileDataAllocator::ThreadCache
+{
+    ThreadCache(Private *_d)
+        : d(_d),
+          arena(_d->arenaForCurrentThread()),
+          generation(_d->generation.loadAcquire())
+    {
+        QMutexLocker l(&d->registryLock);
+        d->registry.append(this);
+    }
+
+    ~ThreadCache() {
+        if (generation.loadAcquire() == d->generation.loadAcquire()) {
+            for (int i = 0; i < NumSizeClasses; i++) {
+                if (!buffers[i].isEmpty()) {
+                    d->returnBatch(arena, i, std::move(buffers[i]));
+                }
+            }
+        } else {
+            dropBuffers();
+        }
+
+        QMutexLocker l(&d->registryLock);
+        d->registry.removeOne(this);
+        d->finishedThreadsCacheHits += hits.load();
+    }
+
+    void dropBuffers() {
+        for (int i = 0; i < NumSizeClasses; i++) {
+            Q_FOREACH (quint8 *ptr, buffers[i]) {
+                dropBuffer(ptr, i);
+            }
+            buffers[i].clear();
+        }
+        cachedMemorySize.store(0);
+    }
+
+    /**
+     * The counters are written by the owner thread only, so there is
+     * no need in atomic increments
+     */
+    void addHit() {
+        hits.store(hits.load() + 1);
+    }
+
+    void addCachedMemory(qint64 value) {
+        cachedMemorySize.store(cachedMemorySize.load() + value);
+    }
+
+    Private *d;
+    Arena *arena;
+    QAtomicInt generation;
+    QVector<quint8*> buffers[NumSizeClasses];
+
+    QAtomicInteger<qint64> hits;
+    QAtomicInteger<qint64> cachedMemorySize;
+};
+
+Arena* KisTileDataAllocator::Private::arenaForCurrentThread() const
+{
+#ifdef Q_OS_LINUX
+    if (arenas.size() > 1) {
+        const int cpu = sched_getcpu();
+        if (cpu >= 0 && cpu < cpuToArena.size()) {
+            return arenas[cpuToArena[cpu]];
+        }
+    }
+#endif /* Q_OS_LINUX */
+
+    return arenas.first();
+}
+
+bool KisTileDataAllocator::Private::fetchBatch(Arena *arena, int sizeClass, QVector<quint8*> &buffers)
+{
+    QMutexLocker l(&arena->lock);
+
+    QVector<QVector<quint8*>> &batches = arena->batches[sizeClass];
+    if (batches.isEmpty()) return false;
+
+    buffers.swap(batches.last());
+    batches.removeLast();
+
+    arenaTransfers.ref();
+    arenaMemorySize.fetchAndAddOrdered(-qint64(buffers.size()) * classBufferSize(sizeClass));
+
+    return true;
+}
+
+void KisTileDataAllocator::Private::returnBatch(Arena *arena, int sizeClass, QVector<quint8*> &&batch)
+{
+    const qint64 size = qint64(batch.size()) * classBufferSize(sizeClass);
+
+    {
+        QMutexLocker l(&arena->lock);
+        arena->batches[sizeClass].append(std::move(batch));
+    }
+
+    arenaTransfers.ref();
+    arenaMemorySize.fetchAndAddOrdered(size);
+}
+
+KisTileDataAllocator::KisTileDataAllocator()
+    : m_d(new Private)
+{
+    int numArenas = 1;
+
+#ifdef Q_OS_LINUX
+    KisImageConfig config(true);
+
+    if (config.enableNumaTileArenas()) {
+        const int numNodes = detectNumaNodes(m_d->cpuToArena);
+
+        if (numNodes > 1) {
+            numArenas = numNodes;
+        } else {
+            m_d->cpuToArena.clear();
+        }
+    }
+#endif /* Q_OS_LINUX */
+
+    for (int i = 0; i < numArenas; i++) {
+        m_d->arenas << new Arena();
+    }
+}
+
+KisTileDataAllocator::~KisTileDataAllocator()
+{
+    qDeleteAll(m_d->arenas);
+}
+
+KisTileDataAllocator* KisTileDataAllocator::instance()
+{
+    /**
+     * The tile datas may be released by the global objects on exit,
+     * so the allocator is never destroyed
+     */
+    static KisTileDataAllocator *s_instance = new KisTileDataAllocator();
+    return s_instance;
+}
+
+KisTileDataAllocator::ThreadCache* KisTileDataAllocator::currentThreadCache()
+{
+    ThreadCache *cache = m_d->threadCaches.localData();
+
+    if (!cache) {
+        cache = new ThreadCache(m_d.data());
+        m_d->threadCaches.setLocalData(cache);
+    }
+
+    const int generation = m_d->generation.loadAcquire();
+    if (cache->generation.load() != generation) {
+        cache->dropBuffers();
+        cache->generation.storeRelease(generation);
+    }
+
+    return cache;
+}
+
+quint8* KisTileDataAllocator::allocate(qint32 pixelSize)
+{
+    const int index = sizeClass(pixelSize);
+
+    if (index < 0) {
+        return (quint8*)malloc(bufferSize(pixelSize));
+    }
+
+    ThreadCache *cache = currentThreadCache();
+    QVector<quint8*> &buffers = cache->buffers[index];
+
+    if (!buffers.isEmpty()) {
+        cache->addHit();
+    } else if (m_d->fetchBatch(cache->arena, index, buffers)) {
+        cache->addCachedMemory(qint64(buffers.size()) * classBufferSize(index));
+    } else {
+        m_d->systemAllocations.ref();
+        return systemAllocate(index);
+    }
+
+    cache->addCachedMemory(-classBufferSize(index));
+    return buffers.takeLast();
+}
+
+void KisTileDataAllocator::deallocate(quint8 *ptr, qint32 pixelSize)
+{
+    const int index = sizeClass(pixelSize);
+
+    if (index < 0) {
+        free(ptr);
+        return;
+    }
+
+    ThreadCache *cache = currentThreadCache();
+    QVector<quint8*> &buffers = cache->buffers[index];
+
+    buffers.append(ptr);
+    cache->addCachedMemory(classBufferSize(index));
+
+    if (buffers.size() > MaxThreadCacheSize) {
+        const int numKept = buffers.size() - BatchSize;
+        m_d->returnBatch(cache->arena, index, buffers.mid(numKept));
+        buffers.resize(numKept);
+
+        cache->addCachedMemory(-qint64(BatchSize) * classBufferSize(index));
+    }
+}
+
+void KisTileDataAllocator::releaseCachedMemory()
+{
+    m_d->generation.ref();
+
+    Q_FOREACH (Arena *arena, m_d->arenas) {
+        QMutexLocker l(&arena->lock);
+
+        for (int i = 0; i < NumSizeClasses; i++) {
+            Q_FOREACH (const QVector<quint8*> &batch, arena->batches[i]) {
+                Q_FOREACH (quint8 *ptr, batch) {
+                    dropBuffer(ptr, i);
+                }
+            }
+            arena->batches[i].clear();
+        }
+    }
+
+    m_d->arenaMemorySize.store(0);
+
+    BoostPool4BPP::purge_memory();
+    BoostPool8BPP::purge_memory();
+}
+
+KisTileDataAllocator::Statistics KisTileDataAllocator::statistics() const
+{
+    Statistics stats;
+
+    const int generation = m_d->generation.loadAcquire();
+
+    {
+        QMutexLocker l(&m_d->registryLock);
+
+        stats.threadCacheHits = m_d->finishedThreadsCacheHits;
+
+        Q_FOREACH (ThreadCache *cache, m_d->registry) {
+            stats.threadCacheHits += cache->hits.load();
+
+            if (cache->generation.loadAcquire() == generation) {
+                stats.cachedMemorySize += cache->cachedMemorySize.load();
+            }
+        }
+    }
+
+    stats.arenaTransfers = m_d->arenaTransfers.load();
+    stats.systemAllocations = m_d->systemAllocations.load();
+    stats.cachedMemorySize += m_d->arenaMemorySize.load();
+    stats.numArenas = m_d->arenas.size();
+
+    return stats;
+}
@@ -0,0 +1,114 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_TILE_DATA_ALLOCATOR_H
+#define __KIS_TILE_DATA_ALLOCATOR_H
+
+#include <QtGlobal>
+#include <QScopedPointer>
+
+#include "kritaimage_export.h"
+
+
+/**
+ * Allocates the pixel buffers of the tile datas.
+ *
+ * The buffers of the pooled pixel sizes (4, 8 and 16 bytes per pixel)
+ * are never returned to the system directly. Every thread keeps a
+ * small cache of free buffers, which serves most of the allocations
+ * without any synchronization. When the thread cache overflows, a
+ * batch of buffers is moved into a shared arena, and when it is empty,
+ * a batch is fetched from the arena, so the arena lock is taken once
+ * per a batch, not per a tile.
+ *
+ * If NUMA arenas are enabled (see KisImageConfig::enableNumaTileArenas()),
+ * every NUMA node has its own arena, and a thread exchanges the buffers
+ * with the arena of the node it was running on when it first accessed
+ * the allocator. It keeps the memory freed on a node to be reused on
+ * the same node.
+ *
+ * The memory of the pools can be released with releaseCachedMemory().
+ * The caller should guarantee that nobody allocates the buffers
+ * concurrently (see KisTileData::releaseInternalPools()).
+ */
+class KRITAIMAGE_EXPORT KisTileDataAllocator
+{
+public:
+    struct Statistics
+    {
+        Statistics()
+            : threadCacheHits(0),
+              arenaTransfers(0),
+              systemAllocations(0),
+              cachedMemorySize(0),
+              numArenas(0)
+        {
+        }
+
+        /**
+         * Cumulative number of allocations served by the thread caches
+         */
+        qint64 threadCacheHits;
+
+        /**
+         * Cumulative number of batches moved between the thread
+         * caches and the arenas
+         */
+        qint64 arenaTransfers;
+
+        /**
+         * Cumulative number of buffers allocated from the system
+         */
+        qint64 systemAllocations;
+
+        /**
+         * The size of the free buffers kept by the thread caches and
+         * the arenas
+         */
+        qint64 cachedMemorySize;
+
+        int numArenas;
+    };
+
+public:
+    static KisTileDataAllocator* instance();
+
+    quint8* allocate(qint32 pixelSize);
+    void deallocate(quint8 *ptr, qint32 pixelSize);
+
+    /**
+     * Returns all the cached buffers to the system. The buffers cached
+     * by the threads are dropped lazily, when the thread accesses the
+     * allocator next time.
+     */
+    void releaseCachedMemory();
+
+    Statistics statistics() const;
+
+private:
+    KisTileDataAllocator();
+    ~KisTileDataAllocator();
+
+    struct ThreadCache;
+
+    ThreadCache* currentThreadCache();
+
+private:
+    struct Private;
+    const QScopedPointer<Private> m_d;
+};
+
+#endif /* __KIS_TILE_DATA_ALLOCATOR_H */
@@ -43,57 +43,6 @@ typedef KisTileDataList::iterator KisTileDataListIterator;
 typedef KisTileDataList::const_iterator KisTileDataListConstIterator;
 
 
-class SimpleCache
-{
-public:
-    SimpleCache() = default;
-    ~SimpleCache();
-
-    bool push(int pixelSize, quint8 *&ptr)
-    {
-        QReadLocker l(&m_cacheLock);
-        switch (pixelSize) {
-        case 4:
-            m_4Pool.push(ptr);
-            break;
-        case 8:
-            m_8Pool.push(ptr);
-            break;
-        case 16:
-            m_16Pool.push(ptr);
-            break;
-        default:
-            return false;
-        }
-
-        return true;
-    }
-
-    bool pop(int pixelSize, quint8 *&ptr)
-    {
-        QReadLocker l(&m_cacheLock);
-        switch (pixelSize) {
-        case 4:
-            return m_4Pool.pop(ptr);
-        case 8:
-            return m_8Pool.pop(ptr);
-        case 16:
-            return m_16Pool.pop(ptr);
-        default:
-            return false;
-        }
-    }
-
-    void clear();
-
-private:
-    QReadWriteLock m_cacheLock;
-    KisLocklessStack<quint8*> m_4Pool;
-    KisLocklessStack<quint8*> m_8Pool;
-    KisLocklessStack<quint8*> m_16Pool;
-};
-
-
 /**
  * Stores actual tile's data
  */
@@ -154,9 +103,11 @@ public:
     inline KisTileData* clone();
 
     /**
-     * Control the access of swapper to the tile data
+     * Control the access of swapper to the tile data.
+     * blockSwapping() returns true if the data had
+     * to be swapped in.
      */
-    inline void blockSwapping();
+    inline bool blockSwapping();
     inline void unblockSwapping();
 
     /**
@@ -192,6 +143,14 @@ public:
      */
     inline bool historical() const;
 
+    /**
+     * Returns true if all the pixels of the tile data are known to
+     * have the same value, the one stored in the beginning of data().
+     * The flag is set for the tile datas filled with a single pixel
+     * and is reset when the tile data is locked for writing.
+     */
+    inline bool isUniform() const;
+
     /**
      * Used for swapping purposes only.
      * Frees the memory occupied by the tile data.
@@ -282,6 +241,46 @@ private:
     //FIXME: make memory aligned
     int m_age;
 
+    enum PrefetchState {
+        NotPrefetched = 0,
+        PrefetchedNotAccessed,
+        PrefetchedAccessed
+    };
+
+    /**
+     * PrefetchState of the tile data. It is set while the tile data is
+     * tracked by the store as loaded by the prefetcher (see
+     * KisTileDataStore::collectPrefetchHits()). Used for collecting
+     * prefetch hit statistics only, the age of the prefetched tile
+     * data is not touched.
+     */
+    QAtomicInt m_prefetched;
+
+    /**
+     * Content hash deduplication state. The hash and the indexed flag
+     * are guarded by KisTileDataStore::m_deduplicationLock. The
+     * deduplicated flag is set when the tile data has become shared
+     * by tiles with identical content.
+     */
+    uint m_deduplicationHash = 0;
+    bool m_deduplicationIndexed = false;
+    bool m_deduplicated = false;
+
+    /**
+     * Set when the tile data is the shared uniform tile data of its
+     * color (see KisTileDataStore::acquireUniformTileData()). It is
+     * guarded by KisTileDataStore::m_uniformTileDataLock.
+     */
+    bool m_sharedUniform = false;
+
+    /**
+     * Set when all the pixels of the tile data have the same
+     * value. Reset by KisTile::lockForWrite(). It is read by the
+     * random accessors of other threads without any lock, hence
+     * the acquire/release semantics.
+     */
+    QAtomicInt m_uniform;
+
 
     /**
      * The primitive for controlling swapping of the tile.
@@ -317,7 +316,6 @@ private:
     //qint32 m_timeStamp;
 
     KisTileDataStore *m_store;
-    static SimpleCache m_cache;
 
 public:
     static const qint32 WIDTH;
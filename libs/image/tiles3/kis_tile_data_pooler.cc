@@ -128,6 +128,17 @@ qint32 KisTileDataPooler::numClonesNeeded(KisTileData *td) const
     qint32 numPresentClones = td->m_clonesStack.size();
     qint32 totalClones = qMin(numUsers - 1, MAX_NUM_CLONES);
 
+    /**
+     * A deduplicated tile data is shared by many tiles and memento
+     * items, but only a few of them are going to be changed. Preparing
+     * a clone for every user would eat the memory we have just saved.
+     * The same is true for the shared uniform tile data of a color,
+     * which may have thousands of users.
+     */
+    if (td->m_deduplicated || td->m_sharedUniform) {
+        totalClones = qMin(totalClones, 1);
+    }
+
     return totalClones - numPresentClones;
 }
 
@@ -215,6 +226,8 @@ void KisTileDataPooler::run()
 
         m_store->endIteration(iter);
 
+        m_store->purgeUnusedUniformTileData();
+
         DEBUG_TILE_STATISTICS();
         DEBUG_SIMPLE_ACTION("cycle finished");
     }
@@ -21,12 +21,15 @@
 #include "config-memory-leak-tracker.h"
 
 #include <QGlobalStatic>
+#include <cstring>
 
 #include "kis_tile_data_store.h"
 #include "kis_tile_data.h"
 #include "kis_debug.h"
 
 #include "kis_tile_data_store_iterators.h"
+#include "kis_tile_data_allocator.h"
+#include "kis_image_config.h"
 
 Q_GLOBAL_STATIC(KisTileDataStore, s_instance)
 
@@ -75,6 +78,10 @@ KisTileDataStore::KisTileDataStore()
       m_counter(1),
       m_clockIndex(1)
 {
+    KisImageConfig config(true);
+    m_deduplicationEnabled = config.enableTileDeduplication();
+    m_uniformTilesEnabled = config.enableUniformTiles();
+
     m_pooler.start();
     m_swapper.start();
 }
@@ -84,6 +91,8 @@ KisTileDataStore::~KisTileDataStore()
     m_pooler.terminatePooler();
     m_swapper.terminateSwapper();
 
+    purgeUnusedUniformTileData();
+
     if (numTiles() > 0) {
         errKrita << "Warning: some tiles have leaked:";
         errKrita << "\tTiles in memory:" << numTilesInMemory() << "\n"
@@ -118,6 +127,29 @@ KisTileDataStore::MemoryStatistics KisTileDataStore::memoryStatistics()
 
     stats.swapSize = m_swappedStore.totalMemoryMetric() * metricCoeff;
 
+    const KisTileDataSwapper::Statistics swapperStats = m_swapper.statistics();
+    stats.swapOutTiles = swapperStats.swapOutTiles;
+    stats.swapOutBatches = swapperStats.swapOutBatches;
+    stats.swapOutCompressedSize = swapperStats.swapOutCompressedSize;
+    stats.swapOutBackPressureStalls = swapperStats.swapOutBackPressureStalls;
+
+    stats.prefetchRequests = swapperStats.prefetchRequests;
+    stats.prefetchSwapIns = swapperStats.prefetchSwapIns;
+    collectPrefetchHits();
+    stats.prefetchHits = m_prefetchHits.loadAcquire();
+    stats.swapInMisses = m_swapInMisses.loadAcquire();
+
+    stats.deduplicationHits = m_deduplicationHits.loadAcquire();
+    stats.deduplicatedMemorySize = m_deduplicatedMemoryMetric.loadAcquire() * metricCoeff;
+
+    const KisTileDataAllocator::Statistics allocatorStats =
+        KisTileDataAllocator::instance()->statistics();
+    stats.allocatorThreadCacheHits = allocatorStats.threadCacheHits;
+    stats.allocatorArenaTransfers = allocatorStats.arenaTransfers;
+    stats.allocatorSystemAllocations = allocatorStats.systemAllocations;
+    stats.allocatorCachedMemorySize = allocatorStats.cachedMemorySize;
+    stats.allocatorArenas = allocatorStats.numArenas;
+
     return stats;
 }
 
@@ -163,6 +195,41 @@ inline void KisTileDataStore::unregisterTileDataImp(KisTileData *td)
     m_memoryMetric -= td->pixelSize();
 
     m_tileDataMap.getGC().unlockRawPointerAccess();
+
+    if (td->m_prefetched.loadAcquire()) {
+        forgetPrefetchedTileData(td);
+    }
+}
+
+void KisTileDataStore::forgetPrefetchedTileData(KisTileData *td)
+{
+    QMutexLocker locker(&m_prefetchedTilesLock);
+
+    if (m_prefetchedTiles.remove(td)) {
+        if (td->m_prefetched.fetchAndStoreOrdered(KisTileData::NotPrefetched) ==
+            KisTileData::PrefetchedAccessed) {
+
+            m_prefetchHits.ref();
+        }
+    }
+}
+
+void KisTileDataStore::collectPrefetchHits()
+{
+    QMutexLocker locker(&m_prefetchedTilesLock);
+
+    auto it = m_prefetchedTiles.begin();
+    while (it != m_prefetchedTiles.end()) {
+        KisTileData *td = *it;
+
+        if (td->m_prefetched.loadAcquire() == KisTileData::PrefetchedAccessed) {
+            td->m_prefetched = KisTileData::NotPrefetched;
+            m_prefetchHits.ref();
+            it = m_prefetchedTiles.erase(it);
+        } else {
+            ++it;
+        }
+    }
 }
 
 void KisTileDataStore::unregisterTileData(KisTileData *td)
@@ -203,6 +270,11 @@ void KisTileDataStore::freeTileData(KisTileData *td)
 
     DEBUG_FREE_ACTION(td);
 
+    if (td->m_deduplicationIndexed) {
+        QMutexLocker locker(&m_deduplicationLock);
+        forgetDeduplicationHash(td);
+    }
+
     m_iteratorLock.lockForRead();
     td->m_swapLock.lockForWrite();
 
@@ -252,6 +324,7 @@ void KisTileDataStore::ensureTileDataLoaded(KisTileData *td)
 
             m_swappedStore.swapInTileData(td);
             registerTileDataImp(td);
+            m_swapInMisses.ref();
 
             td->m_swapLock.unlock();
         }
@@ -266,6 +339,245 @@ void KisTileDataStore::ensureTileDataLoaded(KisTileData *td)
     }
 }
 
+KisTileData* KisTileDataStore::acquireUniformTileData(qint32 pixelSize, const quint8 *pixel)
+{
+    const QByteArray key(reinterpret_cast<const char*>(pixel), pixelSize);
+
+    QMutexLocker locker(&m_uniformTileDataLock);
+
+    KisTileData *td = m_uniformTileData.value(key, 0);
+
+    if (!td) {
+        td = allocTileData(pixelSize, pixel);
+        td->m_sharedUniform = true;
+        td->acquire();
+        m_uniformTileData.insert(key, td);
+    }
+
+    td->acquire();
+    return td;
+}
+
+void KisTileDataStore::purgeUnusedUniformTileData()
+{
+    QVector<KisTileData*> unusedTileData;
+
+    {
+        QMutexLocker locker(&m_uniformTileDataLock);
+
+        /**
+         * Nobody can acquire the tile data without either taking
+         * the lock or being its user already, so the check is safe
+         */
+        QHash<QByteArray, KisTileData*>::iterator it = m_uniformTileData.begin();
+        while (it != m_uniformTileData.end()) {
+            if (it.value()->numUsers() <= 1) {
+                unusedTileData.append(it.value());
+                it = m_uniformTileData.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    Q_FOREACH (KisTileData *td, unusedTileData) {
+        td->release();
+    }
+}
+
+KisTileData* KisTileDataStore::tryAcquireUniform(KisTileData *td)
+{
+    /**
+     * This function is called with td->m_swapLock held
+     */
+
+    const qint32 pixelSize = td->pixelSize();
+    const qint32 lineSize = pixelSize * KisTileData::WIDTH;
+    const quint8 *data = td->data();
+
+    if (!td->isUniform()) {
+        // check the first row pixel-by-pixel and then
+        // compare all the other rows to it
+        for (qint32 i = pixelSize; i < lineSize; i += pixelSize) {
+            if (memcmp(data, data + i, pixelSize)) return 0;
+        }
+
+        for (qint32 row = 1; row < KisTileData::HEIGHT; row++) {
+            if (memcmp(data, data + row * lineSize, lineSize)) return 0;
+        }
+    }
+
+    KisTileData *uniform = acquireUniformTileData(pixelSize, data);
+
+    if (uniform == td) {
+        uniform->release();
+        uniform = 0;
+    }
+
+    return uniform;
+}
+
+KisTileData* KisTileDataStore::acquireDuplicate(KisTileData *td)
+{
+    /**
+     * Don't wait for the swapper, just skip the tile
+     */
+    if (!td->m_swapLock.tryLockForRead()) return 0;
+
+    KisTileData *result = 0;
+
+    if (td->data() && m_uniformTilesEnabled) {
+        result = tryAcquireUniform(td);
+
+        if (result || td->isUniform()) {
+            if (result) {
+                m_deduplicationHits.ref();
+            }
+            td->m_swapLock.unlock();
+            return result;
+        }
+    }
+
+    if (td->data() && m_deduplicationEnabled) {
+        const qint32 dataSize = td->pixelSize() * KisTileData::WIDTH * KisTileData::HEIGHT;
+        const uint hash = qHashBits(td->data(), dataSize, td->pixelSize());
+
+        QMutexLocker locker(&m_deduplicationLock);
+
+        KisTileData *candidate = m_deduplicationIndex.value(hash, 0);
+
+        if (candidate && candidate != td &&
+            candidate->pixelSize() == td->pixelSize() &&
+            tryAcquireIdentical(candidate, td->data(), dataSize)) {
+
+            result = candidate;
+            m_deduplicationHits.ref();
+
+        } else if (candidate != td) {
+            /**
+             * Either there is no such content yet, or the indexed tile
+             * data has been changed since then (or is busy). In both
+             * cases the fresh tile data is a better candidate.
+             */
+            forgetDeduplicationHash(td);
+
+            td->m_deduplicationHash = hash;
+            td->m_deduplicationIndexed = true;
+            m_deduplicationIndex.insert(hash, td);
+        }
+    }
+
+    td->m_swapLock.unlock();
+
+    return result;
+}
+
+bool KisTileDataStore::tryAcquireIdentical(KisTileData *candidate, const quint8 *data, qint32 dataSize)
+{
+    /**
+     * Holding the swap lock in write mode guarantees that nobody is
+     * reading or writing the candidate at the moment. After we have
+     * acquired it, all the writers will have to do COW.
+     */
+    if (!candidate->m_swapLock.tryLockForWrite()) return false;
+
+    bool result = false;
+
+    if (candidate->data() && !memcmp(candidate->data(), data, dataSize)) {
+        /**
+         * The candidate might have been released already, so it is
+         * waiting for m_deduplicationLock in freeTileData(). Don't
+         * resurrect it.
+         */
+        int refCount = candidate->m_refCount.loadAcquire();
+        while (refCount > 0 &&
+               !candidate->m_refCount.testAndSetOrdered(refCount, refCount + 1, refCount));
+
+        if (refCount > 0) {
+            candidate->m_usersCount.ref();
+            candidate->m_deduplicated = true;
+            result = true;
+        }
+    }
+
+    candidate->m_swapLock.unlock();
+
+    return result;
+}
+
+void KisTileDataStore::forgetDeduplicationHash(KisTileData *td)
+{
+    /**
+     * This function is called with m_deduplicationLock held
+     */
+    if (!td->m_deduplicationIndexed) return;
+
+    QHash<uint, KisTileData*>::iterator it =
+        m_deduplicationIndex.find(td->m_deduplicationHash);
+
+    if (it != m_deduplicationIndex.end() && it.value() == td) {
+        m_deduplicationIndex.erase(it);
+    }
+
+    td->m_deduplicationIndexed = false;
+}
+
+bool KisTileDataStore::prefetchTileData(KisTileData *td)
+{
+    /**
+     * Unlocked check is fine here: in the worst case we will just
+     * go the slow path
+     */
+    if (td->data()) return false;
+
+    bool result = false;
+
+    /**
+     * The lock ordering is the same as in ensureTileDataLoaded()
+     */
+    QWriteLocker locker(&m_iteratorLock);
+
+    if (!td->data()) {
+        td->m_swapLock.lockForWrite();
+
+        m_swappedStore.swapInTileData(td);
+        registerTileDataImp(td);
+
+        /**
+         * The prefetched data is going to be used soon, so it is as
+         * young as the freshly loaded one. The first access is tracked
+         * with a separate state (see KisTileData::blockSwapping())
+         */
+        td->resetAge();
+
+        {
+            QMutexLocker prefetchedLocker(&m_prefetchedTilesLock);
+            m_prefetchedTiles.insert(td);
+            td->m_prefetched = KisTileData::PrefetchedNotAccessed;
+        }
+
+        td->m_swapLock.unlock();
+        result = true;
+    }
+
+    return result;
+}
+
+void KisTileDataStore::adviseTileDataNeeded(KisTileData *td)
+{
+    // see comment in prefetchTileData()
+    if (td->data()) return;
+
+    /**
+     * If the lock is taken, someone is already swapping the data
+     * in or out, so the hint is useless
+     */
+    if (!td->m_swapLock.tryLockForRead()) return;
+
+    m_swappedStore.prefetchTileData(td);
+    td->m_swapLock.unlock();
+}
+
 bool KisTileDataStore::trySwapTileData(KisTileData *td)
 {
     /**
@@ -286,6 +598,67 @@ bool KisTileDataStore::trySwapTileData(KisTileData *td)
     return result;
 }
 
+bool KisTileDataStore::tryLockForSwapOut(KisTileData *td)
+{
+    /**
+     * This function is called with m_iteratorLock acquired
+     */
+
+    if (!td->m_swapLock.tryLockForWrite()) return false;
+
+    if (!td->data()) {
+        td->m_swapLock.unlock();
+        return false;
+    }
+
+    return true;
+}
+
+void KisTileDataStore::compressForSwapOut(KisSwappedDataStore::CompressedTile *tiles, int numTiles)
+{
+    for (int i = 0; i < numTiles; i++) {
+        KisSwappedDataStore::CompressedTile &tile = tiles[i];
+        tile.compressed = false;
+
+        if (!tryLockForSwapOut(tile.td)) continue;
+
+        if (tile.td->age() > 0) {
+            m_swappedStore.compressTileData(&tile, 1);
+        }
+
+        tile.td->m_swapLock.unlock();
+    }
+}
+
+void KisTileDataStore::commitSwapOut(QVector<KisSwappedDataStore::CompressedTile> &tiles)
+{
+    /**
+     * This function is called with m_iteratorLock acquired
+     */
+
+    for (auto it = tiles.begin(); it != tiles.end(); ++it) {
+        if (!it->compressed) continue;
+
+        if (!tryLockForSwapOut(it->td)) {
+            it->compressed = false;
+        } else if (!it->td->age()) {
+            it->td->m_swapLock.unlock();
+            it->compressed = false;
+        }
+    }
+
+    m_swappedStore.writeCompressedTiles(tiles);
+
+    for (auto it = tiles.begin(); it != tiles.end(); ++it) {
+        if (!it->compressed) continue;
+
+        if (it->swappedOut) {
+            unregisterTileDataImp(it->td);
+        }
+        it->td->m_swapLock.unlock();
+    }
+}
+
 KisTileDataStoreIterator* KisTileDataStore::beginIteration()
 {
     m_iteratorLock.lockForWrite();
@@ -356,6 +729,16 @@ void KisTileDataStore::debugSwapAll()
 
 void KisTileDataStore::debugClear()
 {
+    {
+        QMutexLocker locker(&m_uniformTileDataLock);
+        m_uniformTileData.clear();
+    }
+
+    {
+        QMutexLocker locker(&m_deduplicationLock);
+        m_deduplicationIndex.clear();
+    }
+
     QWriteLocker l(&m_iteratorLock);
     ConcurrentMap<int, KisTileData*>::Iterator iter(m_tileDataMap);
 
@@ -372,6 +755,9 @@ void KisTileDataStore::debugClear()
 
 void KisTileDataStore::testingRereadConfig()
 {
+    KisImageConfig config(true);
+    m_deduplicationEnabled = config.enableTileDeduplication();
+    m_uniformTilesEnabled = config.enableUniformTiles();
     m_pooler.testingRereadConfig();
     m_swapper.testingRereadConfig();
     kickPooler();
@@ -23,6 +23,10 @@
 #include "kritaimage_export.h"
 
 #include <QReadWriteLock>
+#include <QMutex>
+#include <QHash>
+#include <QSet>
+#include <QByteArray>
 #include "kis_tile_data_interface.h"
 
 #include "kis_tile_data_pooler.h"
@@ -54,6 +58,25 @@ public:
         qint64 poolSize;
 
         qint64 swapSize;
+
+        qint64 swapOutTiles;
+        qint64 swapOutBatches;
+        qint64 swapOutCompressedSize;
+        qint64 swapOutBackPressureStalls;
+
+        qint64 prefetchRequests;
+        qint64 prefetchSwapIns;
+        qint64 prefetchHits;
+        qint64 swapInMisses;
+
+        qint64 deduplicationHits;
+        qint64 deduplicatedMemorySize;
+
+        qint64 allocatorThreadCacheHits;
+        qint64 allocatorArenaTransfers;
+        qint64 allocatorSystemAllocations;
+        qint64 allocatorCachedMemorySize;
+        int allocatorArenas;
     };
 
     MemoryStatistics memoryStatistics();
@@ -80,6 +103,17 @@ public:
         m_swapper.checkFreeMemory();
     }
 
+    /**
+     * Asynchronously loads the swapped out tiles, which are likely to
+     * be accessed soon. The tiles are processed in the order they are
+     * passed. A new request cancels the tiles of the previous one,
+     * which have not been processed yet.
+     */
+    inline void prefetchTiles(const QVector<KisTileSP> &tiles)
+    {
+        m_swapper.prefetchTiles(tiles);
+    }
+
     /**
      * \see m_memoryMetric
      */
@@ -102,6 +136,20 @@ public:
         return allocTileData(pixelSize, defPixel);
     }
 
+    /**
+     * Returns a tile data filled with \p pixel, acquired for the
+     * caller. All the uniform tiles of the same color share one tile
+     * data, which is held by the store as well, so it is never changed
+     * in place: the first write into such tile does COW.
+     */
+    KisTileData* acquireUniformTileData(qint32 pixelSize, const quint8 *pixel);
+
+    /**
+     * Frees the uniform tile datas, which are not used by anyone
+     * except the store. Called by the pooler.
+     */
+    void purgeUnusedUniformTileData();
+
     // Called by The Memento Manager after every commit
     inline void kickPooler()
     {
@@ -118,6 +166,35 @@ public:
      */
     bool trySwapTileData(KisTileData *td);
 
+    /**
+     * A split version of trySwapTileData() used by the swap-out
+     * pipeline of KisTileDataSwapper:
+     *
+     * 1) compressForSwapOut() compresses the selected tile datas. It
+     *    can be called from multiple threads at the same time. Every
+     *    tile data is locked with tryLockForSwapOut() only while it
+     *    is being compressed. The tiles that are being accessed or
+     *    have been accessed since the selection are skipped.
+     *
+     * 2) commitSwapOut() locks the compressed tile datas again,
+     *    skips the ones that have been accessed since the compression
+     *    (their data may have changed), writes the rest into the swap
+     *    file and releases the locks.
+     *
+     * The access is detected by the age of the tile data: the swapper
+     * selects old tiles only, and every access resets the age (see
+     * KisTileData::blockSwapping()).
+     *
+     * tryLockForSwapOut() may fail in case the tile is being accessed
+     * at the moment or has already been swapped out.
+     *
+     * All the functions should be called while the store is being
+     * iterated, that is, with m_iteratorLock held.
+     */
+    bool tryLockForSwapOut(KisTileData *td);
+    void compressForSwapOut(KisSwappedDataStore::CompressedTile *tiles, int numTiles);
+    void commitSwapOut(QVector<KisSwappedDataStore::CompressedTile> &tiles);
+
 
     /**
      * WARN: The following three method are only for usage
@@ -140,6 +217,78 @@ public:
      */
     void ensureTileDataLoaded(KisTileData *td);
 
+    /**
+     * Loads the tile data from the swap file without blocking it from
+     * being swapped out again. Returns true if the data has actually
+     * been loaded. The caller should guarantee that the tile data is
+     * not released while the function is running.
+     */
+    bool prefetchTileData(KisTileData *td);
+
+    /**
+     * Hints the swap backend that \p td is going to be swapped in soon.
+     * The data is not loaded, so the call is cheap enough to be done for
+     * the neighbours of every tile that misses. The caller should
+     * guarantee that the tile data is not released while the function
+     * is running.
+     */
+    void adviseTileDataNeeded(KisTileData *td);
+
+    /**
+     * Counts the prefetched tile datas that have been accessed since
+     * they were loaded. The access path only switches the prefetch
+     * state of the tile data, so it doesn't have to take any locks.
+     */
+    void collectPrefetchHits();
+
+    /**
+     * Returns true if the tiles with identical content should be
+     * deduplicated (see KisImageConfig::enableTileDeduplication())
+     */
+    inline bool deduplicationEnabled() const
+    {
+        return m_deduplicationEnabled;
+    }
+
+    /**
+     * Returns true if the solid color tiles should share their
+     * tile data (see KisImageConfig::enableUniformTiles())
+     */
+    inline bool uniformTilesEnabled() const
+    {
+        return m_uniformTilesEnabled;
+    }
+
+    /**
+     * Returns true if the data of the committed tiles may be
+     * replaced by acquireDuplicate()
+     */
+    inline bool tileSharingEnabled() const
+    {
+        return m_deduplicationEnabled || m_uniformTilesEnabled;
+    }
+
+    /**
+     * Looks up a tile data with the same content as \p td. If \p td
+     * is filled with a single color, the shared uniform tile data is
+     * returned. Otherwise the deduplication index is searched. If
+     * there is a match, it is returned acquired, otherwise \p td is
+     * added to the index and null is returned.
+     *
+     * The caller should guarantee that nobody writes into \p td
+     * while the function is running.
+     */
+    KisTileData* acquireDuplicate(KisTileData *td);
+
+    /**
+     * Called by KisTile when the deduplicated tile data has been
+     * freed. \p pixelSize is the pixel size of the freed data.
+     */
+    inline void notifyDeduplicatedTileDataFreed(qint32 pixelSize)
+    {
+        m_deduplicatedMemoryMetric.fetchAndAddOrdered(pixelSize);
+    }
+
     void registerTileData(KisTileData *td);
     void unregisterTileData(KisTileData *td);
 
@@ -148,6 +297,11 @@ private:
 
     inline void registerTileDataImp(KisTileData *td);
     inline void unregisterTileDataImp(KisTileData *td);
+    void forgetPrefetchedTileData(KisTileData *td);
+
+    bool tryAcquireIdentical(KisTileData *candidate, const quint8 *data, qint32 dataSize);
+    KisTileData* tryAcquireUniform(KisTileData *td);
+    void forgetDeduplicationHash(KisTileData *td);
     void freeRegisteredTiles();
 
     friend class DeadlockyThread;
@@ -178,6 +332,35 @@ private:
     QAtomicInt m_memoryMetric;
     QAtomicInt m_counter;
     QAtomicInt m_clockIndex;
+    QAtomicInt m_prefetchHits;
+    QAtomicInt m_swapInMisses;
+
+    /**
+     * The tile datas loaded by the prefetcher whose access has not been
+     * accounted yet. The pointers are not owned, unregisterTileDataImp()
+     * removes the tile data when it leaves the memory.
+     */
+    QMutex m_prefetchedTilesLock;
+    QSet<KisTileData*> m_prefetchedTiles;
+
+    /**
+     * Maps content hashes to tile datas. The pointers are not owned,
+     * freeTileData() removes the tile data from the index before
+     * deleting it.
+     */
+    QMutex m_deduplicationLock;
+    QHash<uint, KisTileData*> m_deduplicationIndex;
+    bool m_deduplicationEnabled;
+    QAtomicInt m_deduplicationHits;
+    QAtomicInt m_deduplicatedMemoryMetric;
+
+    /**
+     * Shared uniform tile datas keyed by their pixel value. Every
+     * tile data in the cache is acquired by the store once.
+     */
+    QMutex m_uniformTileDataLock;
+    QHash<QByteArray, KisTileData*> m_uniformTileData;
+    bool m_uniformTilesEnabled;
     ConcurrentMap<int, KisTileData*> m_tileDataMap;
     QReadWriteLock m_iteratorLock;
 };
@@ -24,6 +24,7 @@
 #include "3rdparty/lock_free_map/concurrent_map.h"
 #include "kis_tile.h"
 #include "kis_debug.h"
+#include "KisEpochDomain.h"
 
 #define SANITY_CHECK
 
@@ -135,6 +136,68 @@ private:
         TileType *d;
     };
 
+    struct TileDataReclaimer {
+        TileDataReclaimer(KisTileData *data) : d(data) {}
+
+        void destroy()
+        {
+            d->release();
+            delete this;
+        }
+
+    private:
+        KisTileData *d;
+    };
+
+    /**
+     * Iterators are not safe against concurrent insertions (they may
+     * cause the table migration), so the iterators and the inserters
+     * exclude each other. The inserters mark themselves only in their
+     * per-thread records of KisEpochDomain, so they don't contend with
+     * each other: the iterator raises the flag and waits until all the
+     * threads, which might have missed it, leave the insertion.
+     */
+    inline void lockForIteration() const
+    {
+        m_iteratorLock.lock();
+        m_iterationInProgress.fetchAndStoreOrdered(1);
+        KisEpochDomain::instance()->waitForObjectSection(this);
+    }
+
+    inline void unlockForIteration() const
+    {
+        m_iterationInProgress.storeRelease(0);
+        m_iteratorLock.unlock();
+    }
+
+    /**
+     * Guarantees that nobody is iterating the table until
+     * endInsertion() is called. The section between the two calls
+     * must be short and must not wait for anything.
+     */
+    inline void beginInsertion()
+    {
+        KisEpochDomain *domain = KisEpochDomain::instance();
+
+        while (1) {
+            domain->enterObjectSection(this);
+
+            if (!m_iterationInProgress.loadAcquire()) break;
+
+            domain->exitObjectSection();
+
+            // just wait for the iteration to complete
+            QMutexLocker locker(&m_iteratorLock);
+        }
+    }
+
+    inline void endInsertion()
+    {
+        KisEpochDomain::instance()->exitObjectSection();
+    }
+
+    inline TileTypeSP createDefaultTile(qint32 col, qint32 row);
+
     inline quint32 calculateHash(qint32 col, qint32 row)
     {
 #ifdef SANITY_CHECK
@@ -154,11 +217,10 @@ private:
         TileTypeSP::ref(&item, item.data());
         TileType *tile = 0;
 
-        {
-            QReadLocker locker(&m_iteratorLock);
-            m_map.getGC().lockRawPointerAccess();
-            tile = m_map.assign(idx, item.data());
-        }
+        beginInsertion();
+        m_map.getGC().lockRawPointerAccess();
+        tile = m_map.assign(idx, item.data());
+        endInsertion();
 
         if (tile) {
             tile->notifyDeadWithoutDetaching();
@@ -179,6 +241,14 @@ private:
         bool wasDeleted = false;
         TileType *tile = m_map.erase(idx);
 
+        m_map.getGC().unlockRawPointerAccess();
+
+        /**
+         * The tile is still referenced by the table until the reclaimer
+         * is run, so we can notify it without raw-pointer lock held.
+         * The notification may wait for the memento manager lock,
+         * which must never happen in a critical section.
+         */
         if (tile) {
             tile->notifyDetachedFromDataManager();
 
@@ -187,8 +257,6 @@ private:
             m_map.getGC().enqueue(&MemoryReclaimer::destroy, new MemoryReclaimer(tile));
         }
 
-        m_map.getGC().unlockRawPointerAccess();
-
         m_map.getGC().update();
         return wasDeleted;
     }
@@ -199,14 +267,19 @@ private:
     mutable LockFreeTileMap m_map;
 
     /**
-     * We still need something to guard changes in m_defaultTileData,
-     * otherwise there will be concurrent read/writes, resulting in broken memory.
+     * Serializes the iterators, see lockForIteration()
      */
-    QReadWriteLock m_defaultPixelDataLock;
-    mutable QReadWriteLock m_iteratorLock;
+    mutable QMutex m_iteratorLock;
+    mutable QAtomicInt m_iterationInProgress;
 
     QAtomicInt m_numTiles;
-    KisTileData *m_defaultTileData;
+
+    /**
+     * The default tile data is read with raw pointer access locked and
+     * the replaced one is released via the map's garbage collector,
+     * so the readers never take any lock.
+     */
+    QAtomicPointer<KisTileData> m_defaultTileData;
     KisMementoManager *m_mementoManager;
 };
 
@@ -220,13 +293,13 @@ public:
 
     KisTileHashTableIteratorTraits2(KisTileHashTableTraits2<T> *ht) : m_ht(ht)
     {
-        m_ht->m_iteratorLock.lockForWrite();
+        m_ht->lockForIteration();
         m_iter.setMap(m_ht->m_map);
     }
 
     ~KisTileHashTableIteratorTraits2()
     {
-        m_ht->m_iteratorLock.unlock();
+        m_ht->unlockForIteration();
     }
 
     void next()
@@ -275,9 +348,9 @@ template <class T>
 KisTileHashTableTraits2<T>::KisTileHashTableTraits2(const KisTileHashTableTraits2<T> &ht, KisMementoManager *mm)
     : KisTileHashTableTraits2(mm)
 {
-    setDefaultTileData(ht.m_defaultTileData);
+    setDefaultTileData(ht.m_defaultTileData.loadAcquire());
 
-    QWriteLocker locker(&ht.m_iteratorLock);
+    ht.lockForIteration();
     typename ConcurrentMap<quint32, TileType*>::Iterator iter(ht.m_map);
 
     while (iter.isValid()) {
@@ -285,6 +358,8 @@ KisTileHashTableTraits2<T>::KisTileHashTableTraits2(const KisTileHashTableTraits
         insert(iter.getKey(), tile);
         iter.next();
     }
+
+    ht.unlockForIteration();
 }
 
 template <class T>
@@ -330,19 +405,14 @@ typename KisTileHashTableTraits2<T>::TileTypeSP KisTileHashTableTraits2<T>::getT
         // raw-pointer lock held
         m_map.getGC().unlockRawPointerAccess();
 
-        {
-            QReadLocker locker(&m_defaultPixelDataLock);
-            tile = new TileType(col, row, m_defaultTileData, 0);
-        }
+        tile = createDefaultTile(col, row);
 
         TileTypeSP::ref(&tile, tile.data());
         TileType *discardedTile = 0;
 
-        // iterator lock should be taken **before**
-        // the pointers are locked
-        m_iteratorLock.lockForRead();
-
-        // and now lock raw-pointers again
+        // make sure nobody iterates the table
+        // and lock raw-pointers again
+        beginInsertion();
         m_map.getGC().lockRawPointerAccess();
 
         // mutator might have become invalidated when
@@ -354,7 +424,7 @@ typename KisTileHashTableTraits2<T>::TileTypeSP KisTileHashTableTraits2<T>::getT
             discardedTile = tile.data();
         }
 
-        m_iteratorLock.unlock();
+        endInsertion();
 
         if (discardedTile) {
             // we've got our tile back, it didn't manage to
@@ -371,12 +441,16 @@ typename KisTileHashTableTraits2<T>::TileTypeSP KisTileHashTableTraits2<T>::getT
         } else {
             newTile = true;
             m_numTiles.fetchAndAddRelaxed(1);
-
-            tile->notifyAttachedToDataManager(m_mementoManager);
         }
     }
     m_map.getGC().unlockRawPointerAccess();
 
+    if (newTile) {
+        // the notification may wait for the memento manager
+        // lock, so it is called with raw-pointers unlocked
+        tile->notifyAttachedToDataManager(m_mementoManager);
+    }
+
     m_map.getGC().update();
     return tile;
 }
@@ -393,8 +467,7 @@ typename KisTileHashTableTraits2<T>::TileTypeSP KisTileHashTableTraits2<T>::getR
     existingTile = tile;
 
     if (!existingTile) {
-        QReadLocker locker(&m_defaultPixelDataLock);
-        tile = new TileType(col, row, m_defaultTileData, 0);
+        tile = createDefaultTile(col, row);
     }
 
     m_map.getGC().update();
@@ -425,7 +498,7 @@ template<class T>
 void KisTileHashTableTraits2<T>::clear()
 {
     {
-        QWriteLocker locker(&m_iteratorLock);
+        lockForIteration();
 
         typename ConcurrentMap<quint32, TileType*>::Iterator iter(m_map);
         TileType *tile = 0;
@@ -433,17 +506,19 @@ void KisTileHashTableTraits2<T>::clear()
         while (iter.isValid()) {
             m_map.getGC().lockRawPointerAccess();
             tile = m_map.erase(iter.getKey());
+            m_map.getGC().unlockRawPointerAccess();
 
             if (tile) {
                 tile->notifyDetachedFromDataManager();
                 m_map.getGC().enqueue(&MemoryReclaimer::destroy, new MemoryReclaimer(tile));
             }
-            m_map.getGC().unlockRawPointerAccess();
 
             iter.next();
         }
 
         m_numTiles.store(0);
+
+        unlockForIteration();
     }
 
     // garbage collection must **not** be run with locks held
@@ -453,32 +528,45 @@ void KisTileHashTableTraits2<T>::clear()
 template <class T>
 inline void KisTileHashTableTraits2<T>::setDefaultTileData(KisTileData *defaultTileData)
 {
-    QWriteLocker locker(&m_defaultPixelDataLock);
-
-    if (m_defaultTileData) {
-        m_defaultTileData->release();
-        m_defaultTileData = 0;
-    }
-
     if (defaultTileData) {
         defaultTileData->acquire();
-        m_defaultTileData = defaultTileData;
     }
+
+    KisTileData *oldTileData = m_defaultTileData.fetchAndStoreOrdered(defaultTileData);
+
+    if (oldTileData) {
+        // someone might be creating a tile with it right now
+        m_map.getGC().enqueue(&TileDataReclaimer::destroy, new TileDataReclaimer(oldTileData));
+    }
+
+    m_map.getGC().update();
 }
 
 template <class T>
 inline KisTileData* KisTileHashTableTraits2<T>::defaultTileData()
 {
-    QReadLocker locker(&m_defaultPixelDataLock);
-    return m_defaultTileData;
+    return m_defaultTileData.loadAcquire();
 }
 
 template <class T>
 inline KisTileData* KisTileHashTableTraits2<T>::refAndFetchDefaultTileData()
 {
-    QReadLocker locker(&m_defaultPixelDataLock);
-    m_defaultTileData->ref();
-    return m_defaultTileData;
+    m_map.getGC().lockRawPointerAccess();
+    KisTileData *td = m_defaultTileData.loadAcquire();
+    td->ref();
+    m_map.getGC().unlockRawPointerAccess();
+
+    return td;
+}
+
+template <class T>
+inline typename KisTileHashTableTraits2<T>::TileTypeSP KisTileHashTableTraits2<T>::createDefaultTile(qint32 col, qint32 row)
+{
+    m_map.getGC().lockRawPointerAccess();
+    TileTypeSP tile = new TileType(col, row, m_defaultTileData.loadAcquire(), 0);
+    m_map.getGC().unlockRawPointerAccess();
+
+    return tile;
 }
 
 
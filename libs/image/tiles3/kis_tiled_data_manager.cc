@@ -21,6 +21,8 @@
 #include <QRect>
 #include <QVector>
 
+#include <algorithm>
+
 #include "kis_tile.h"
 #include "kis_tiled_data_manager.h"
 #include "kis_tile_data_wrapper.h"
@@ -47,6 +49,7 @@ KisTiledDataManager::KisTiledDataManager(quint32 pixelSize,
 {
     /* See comment in destructor for details */
     m_mementoManager = new KisMementoManager();
+    m_mementoManager->setDataManager(this);
     m_hashTable = new KisTileHashTable(m_mementoManager);
 
     m_pixelSize = pixelSize;
@@ -61,6 +64,7 @@ KisTiledDataManager::KisTiledDataManager(const KisTiledDataManager &dm)
 
     /* We do not clone the history of the device, there is no usecase for it */
     m_mementoManager = new KisMementoManager();
+    m_mementoManager->setDataManager(this);
 
     KisTileData *defaultTileData = dm.m_hashTable->refAndFetchDefaultTileData();
     m_mementoManager->setDefaultTileData(defaultTileData);
@@ -360,8 +364,14 @@ void KisTiledDataManager::clear(QRect clearRect, const quint8 *clearPixel)
         clearRect.width() >= KisTileData::WIDTH &&
         clearRect.height() >= KisTileData::HEIGHT) {
 
-        td = KisTileDataStore::instance()->createDefaultTileData(pixelSize, clearPixel);
-        td->acquire();
+        KisTileDataStore *store = KisTileDataStore::instance();
+
+        if (store->uniformTilesEnabled()) {
+            td = store->acquireUniformTileData(pixelSize, clearPixel);
+        } else {
+            td = store->createDefaultTileData(pixelSize, clearPixel);
+            td->acquire();
+        }
     }
 
     for (qint32 row = firstRow; row <= lastRow; ++row) {
@@ -505,9 +515,14 @@ void KisTiledDataManager::bitBltImpl(KisTiledDataManager *srcDM, const QRect &re
                 const quint8* srcTileIt = srcTile->data() + tw.offset();
                 quint8* dstTileIt = tw.data();
 
+                // all the rows of a uniform tile are the same, so
+                // we can read the first one only
+                const quint32 srcRowStride =
+                    srcTile->tileData()->isUniform() ? 0 : rowStride;
+
                 while (rowsRemaining > 0) {
                     memcpy(dstTileIt, srcTileIt, lineSize);
-                    srcTileIt += rowStride;
+                    srcTileIt += srcRowStride;
                     dstTileIt += rowStride;
                     rowsRemaining--;
                 }
@@ -792,3 +807,68 @@ void KisTiledDataManager::releaseInternalPools()
 {
     KisTileData::releaseInternalPools();
 }
+
+void KisTiledDataManager::deduplicateCommittedTiles()
+{
+    const KisMementoItemList candidates = m_mementoManager->takeDeduplicationCandidates();
+
+    Q_FOREACH (KisMementoItemSP mi, candidates) {
+        KisTileSP tile = m_hashTable->getExistingTile(mi->col(), mi->row());
+        if (tile) {
+            tile->deduplicate(mi.data());
+        }
+    }
+}
+
+void KisTiledDataManager::adviseNeighbourTiles(qint32 col, qint32 row) const
+{
+    for (qint32 neighbourRow = row - 1; neighbourRow <= row + 1; ++neighbourRow) {
+        for (qint32 neighbourColumn = col - 1; neighbourColumn <= col + 1; ++neighbourColumn) {
+            if (neighbourRow == row && neighbourColumn == col) continue;
+
+            KisTileSP tile = m_hashTable->getExistingTile(neighbourColumn, neighbourRow);
+            if (tile) {
+                tile->adviseDataNeeded();
+            }
+        }
+    }
+}
+
+void KisTiledDataManager::prefetchRect(const QRect &rect) const
+{
+    if (rect.isEmpty()) return;
+
+    QReadLocker locker(&m_lock);
+
+    const qint32 firstColumn = xToCol(rect.left());
+    const qint32 lastColumn = xToCol(rect.right());
+    const qint32 firstRow = yToRow(rect.top());
+    const qint32 lastRow = yToRow(rect.bottom());
+
+    const QPoint center = rect.center();
+    const qint32 centerColumn = xToCol(center.x());
+    const qint32 centerRow = yToRow(center.y());
+
+    QVector<KisTileSP> tiles;
+
+    for (qint32 row = firstRow; row <= lastRow; ++row) {
+        for (qint32 column = firstColumn; column <= lastColumn; ++column) {
+            KisTileSP tile = m_hashTable->getExistingTile(column, row);
+            if (tile) {
+                tiles.append(tile);
+            }
+        }
+    }
+
+    /**
+     * The tiles closer to the center of the area are
+     * more likely to be accessed first
+     */
+    std::sort(tiles.begin(), tiles.end(),
+              [centerColumn, centerRow] (const KisTileSP &lhs, const KisTileSP &rhs) {
+                  return qAbs(lhs->col() - centerColumn) + qAbs(lhs->row() - centerRow) <
+                      qAbs(rhs->col() - centerColumn) + qAbs(rhs->row() - centerRow);
+              });
+
+    KisTileDataStore::instance()->prefetchTiles(tiles);
+}
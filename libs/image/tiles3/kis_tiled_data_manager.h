@@ -147,6 +147,7 @@ public:
         QWriteLocker locker(&m_lock);
         KisMementoSP memento = m_mementoManager->getMemento();
         memento->saveOldDefaultPixel(m_defaultPixel, m_pixelSize);
+        deduplicateCommittedTiles();
         return memento;
     }
 
@@ -162,6 +163,7 @@ public:
         }
 
         m_mementoManager->commit();
+        deduplicateCommittedTiles();
     }
 
     void rollback(KisMementoSP memento) {
@@ -204,6 +206,13 @@ public:
 
     static void releaseInternalPools();
 
+    /**
+     * Asks the tile data store to load the swapped out tiles of \p rect
+     * in background. Call it when the area is about to be accessed,
+     * e.g. when it is going to appear in the viewport.
+     */
+    void prefetchRect(const QRect &rect) const;
+
 protected:
     /**
      * Reads and writes the tiles 
@@ -352,6 +361,25 @@ private:
 
     mutable QReadWriteLock m_lock;
 
+private:
+    /**
+     * Makes the tiles committed by the memento manager share tile
+     * data with the identical tiles of the store (if enabled).
+     * Should be called with m_lock held in write mode.
+     */
+    void deduplicateCommittedTiles();
+
+    /**
+     * Hints the swap backend that the tiles around (\p col, \p row)
+     * are going to be needed soon. Called by the memento manager when
+     * the data of the tile at this position has been swapped in,
+     * because the neighbours are usually read next. The tiles that
+     * are already in memory don't pay anything for it.
+     * Doesn't take m_lock, the callers of getTile() may hold it.
+     */
+    friend class KisMementoManager;
+    void adviseNeighbourTiles(qint32 col, qint32 row) const;
+
 private:
     // Allow compression routines to calculate (col,row) coordinates
     // and pixel size
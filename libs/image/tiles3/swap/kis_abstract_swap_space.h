@@ -0,0 +1,58 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_ABSTRACT_SWAP_SPACE_H
+#define __KIS_ABSTRACT_SWAP_SPACE_H
+
+#include "kis_chunk_allocator.h"
+
+/**
+ * Base class for the backends giving access to the chunks of
+ * the swap file allocated by KisChunkAllocator.
+ *
+ * The pointers returned by getReadChunkPtr() and getWriteChunkPtr()
+ * are guaranteed to be valid only until the next call to any of
+ * these methods.
+ */
+class KRITAIMAGE_EXPORT KisAbstractSwapSpace
+{
+public:
+    virtual ~KisAbstractSwapSpace();
+
+    inline quint8* getReadChunkPtr(KisChunk readChunk) {
+        return getReadChunkPtr(readChunk.data());
+    }
+
+    inline quint8* getWriteChunkPtr(KisChunk writeChunk) {
+        return getWriteChunkPtr(writeChunk.data());
+    }
+
+    inline void prefetch(KisChunk chunk) {
+        prefetch(chunk.data());
+    }
+
+    virtual quint8* getReadChunkPtr(const KisChunkData &readChunk) = 0;
+    virtual quint8* getWriteChunkPtr(const KisChunkData &writeChunk) = 0;
+
+    /**
+     * Hints the backend that \p chunk is going to be read soon,
+     * so it can start loading it from disk asynchronously.
+     * Default implementation does nothing.
+     */
+    virtual void prefetch(const KisChunkData &chunk);
+};
+
+#endif /* __KIS_ABSTRACT_SWAP_SPACE_H */
@@ -0,0 +1,119 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_compression_factory.h"
+
+#include <config-tile-compression.h>
+
+#include "kis_lzf_compression.h"
+
+#ifdef HAVE_LZ4
+#include "kis_lz4_compression.h"
+#endif
+
+#ifdef HAVE_ZSTD
+#include "kis_zstd_compression.h"
+#endif
+
+
+KisAbstractCompression* KisCompressionFactory::create(CodecId id)
+{
+    switch (id) {
+    case LZF:
+        return new KisLzfCompression();
+#ifdef HAVE_LZ4
+    case LZ4:
+        return new KisLz4Compression();
+#endif
+#ifdef HAVE_ZSTD
+    case ZSTD:
+        return new KisZstdCompression();
+#endif
+    default:
+        return 0;
+    }
+}
+
+bool KisCompressionFactory::isAvailable(CodecId id)
+{
+    switch (id) {
+    case LZF:
+        return true;
+    case LZ4:
+#ifdef HAVE_LZ4
+        return true;
+#else
+        return false;
+#endif
+    case ZSTD:
+#ifdef HAVE_ZSTD
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    return false;
+}
+
+QList<KisCompressionFactory::CodecId> KisCompressionFactory::availableCodecs()
+{
+    QList<CodecId> codecs;
+
+    codecs << LZF;
+
+    if (isAvailable(LZ4)) {
+        codecs << LZ4;
+    }
+
+    if (isAvailable(ZSTD)) {
+        codecs << ZSTD;
+    }
+
+    return codecs;
+}
+
+QString KisCompressionFactory::name(CodecId id)
+{
+    switch (id) {
+    case LZF:
+        return "LZF";
+    case LZ4:
+        return "LZ4";
+    case ZSTD:
+        return "ZSTD";
+    }
+
+    return QString();
+}
+
+KisCompressionFactory::CodecId KisCompressionFactory::fromName(const QString &name)
+{
+    const QString upperName = name.toUpper();
+
+    if (upperName == "LZ4" && isAvailable(LZ4)) {
+        return LZ4;
+    } else if (upperName == "ZSTD" && isAvailable(ZSTD)) {
+        return ZSTD;
+    }
+
+    return LZF;
+}
+
+bool KisCompressionFactory::isValidId(int value)
+{
+    return value >= LZF && value <= ZSTD;
+}
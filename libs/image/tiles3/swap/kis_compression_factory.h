@@ -0,0 +1,82 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_COMPRESSION_FACTORY_H
+#define __KIS_COMPRESSION_FACTORY_H
+
+#include "kritaimage_export.h"
+#include <QString>
+#include <QList>
+
+class KisAbstractCompression;
+
+/**
+ * A registry of the compression algorithms that can be used
+ * for compressing tile data.
+ *
+ * The numeric values of the codec ids are stored in the headers
+ * of the compressed tiles (see KisTileCompressor2), so they must
+ * never be changed. Only new ids can be added.
+ */
+class KRITAIMAGE_EXPORT KisCompressionFactory
+{
+public:
+    enum CodecId {
+        LZF = 1,
+        LZ4 = 2,
+        ZSTD = 3
+    };
+
+    /**
+     * Creates a compression object for codec \p id. If the codec
+     * was not available at compile time, returns null.
+     */
+    static KisAbstractCompression* create(CodecId id);
+
+    /**
+     * Returns true if the codec \p id has been compiled in
+     */
+    static bool isAvailable(CodecId id);
+
+    /**
+     * The list of all codecs available in this build
+     */
+    static QList<CodecId> availableCodecs();
+
+    /**
+     * The name of the codec as it is stored in the config
+     * and in the tile headers of .kra files
+     */
+    static QString name(CodecId id);
+
+    /**
+     * Returns codec id by its \p name. If the codec is unknown or
+     * not available in this build, LZF is returned, since it is
+     * always present.
+     */
+    static CodecId fromName(const QString &name);
+
+    /**
+     * Returns true if \p value is a valid codec id (used for
+     * checking the tile headers read from the swap)
+     */
+    static bool isValidId(int value);
+
+private:
+    KisCompressionFactory();
+};
+
+#endif /* __KIS_COMPRESSION_FACTORY_H */
@@ -0,0 +1,199 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_debug.h"
+#include "kis_mapped_swap_file.h"
+
+#include <QDir>
+
+#if defined(Q_OS_UNIX) && QT_POINTER_SIZE == 8
+#define HAVE_MAPPED_SWAP_FILE
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#define SWP_PREFIX "KRITA_SWAP_FILE_XXXXXX"
+
+
+namespace {
+
+inline quint64 alignUp(quint64 value, quint64 alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+inline quint64 pageSize() {
+#ifdef HAVE_MAPPED_SWAP_FILE
+    static const quint64 size = sysconf(_SC_PAGESIZE);
+    return size;
+#else
+    return 4096;
+#endif
+}
+
+}
+
+
+KisMappedSwapFile::KisMappedSwapFile(const QString &swapDir,
+                                     quint64 maxSwapSize,
+                                     quint64 extentSize)
+    : m_valid(false),
+      m_base(0),
+      m_reservedSize(0),
+      m_mappedSize(0),
+      m_extentSize(alignUp(qMax(extentSize, MiB), pageSize()))
+{
+#ifdef HAVE_MAPPED_SWAP_FILE
+    KIS_SAFE_ASSERT_RECOVER_NOOP(!swapDir.isEmpty());
+
+    QDir d(swapDir);
+    m_valid = d.exists() || d.mkpath(swapDir);
+
+    const QString swapFileTemplate = swapDir + '/' + SWP_PREFIX;
+
+    if (m_valid) {
+        m_file.setFileTemplate(swapFileTemplate);
+        bool res = m_file.open();
+        if (!res || m_file.fileName().isEmpty()) {
+            m_valid = false;
+        }
+    }
+
+    if (m_valid) {
+        /**
+         * Reserve the address range for the entire swap. The pages
+         * are not accessible and not backed by any memory until the
+         * file extents are mapped over them.
+         */
+        m_reservedSize = alignUp(maxSwapSize, m_extentSize);
+
+        void *base = mmap(0, m_reservedSize, PROT_NONE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+        if (base != MAP_FAILED) {
+            m_base = reinterpret_cast<quint8*>(base);
+        } else {
+            m_reservedSize = 0;
+            m_valid = false;
+        }
+    }
+
+    if (!m_valid) {
+        qWarning() << "Could not create or map the swapfile" << swapFileTemplate;
+    }
+#else
+    Q_UNUSED(swapDir);
+    Q_UNUSED(maxSwapSize);
+#endif
+}
+
+KisMappedSwapFile::~KisMappedSwapFile()
+{
+#ifdef HAVE_MAPPED_SWAP_FILE
+    if (m_base) {
+        munmap(m_base, m_reservedSize);
+    }
+#endif
+}
+
+bool KisMappedSwapFile::isSupported()
+{
+#ifdef HAVE_MAPPED_SWAP_FILE
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool KisMappedSwapFile::isValid() const
+{
+    return m_valid;
+}
+
+quint8* KisMappedSwapFile::getReadChunkPtr(const KisChunkData &readChunk)
+{
+    if (!ensureMapped(readChunk.m_end)) {
+        return nullptr;
+    }
+
+    return m_base + readChunk.m_begin;
+}
+
+quint8* KisMappedSwapFile::getWriteChunkPtr(const KisChunkData &writeChunk)
+{
+    if (!ensureMapped(writeChunk.m_end)) {
+        return nullptr;
+    }
+
+    return m_base + writeChunk.m_begin;
+}
+
+void KisMappedSwapFile::prefetch(const KisChunkData &chunk)
+{
+    adviseWillNeed(chunk.m_begin, chunk.size());
+}
+
+bool KisMappedSwapFile::ensureMapped(quint64 end)
+{
+    if (end < m_mappedSize) return true;
+    if (!m_valid) return false;
+
+#ifdef HAVE_MAPPED_SWAP_FILE
+    const quint64 newSize = alignUp(end + 1, m_extentSize);
+
+    if (newSize > m_reservedSize) {
+        warnKrita << "KisMappedSwapFile: the swap file is full!"
+                  << ppVar(newSize) << ppVar(m_reservedSize);
+        return false;
+    }
+
+    if (!m_file.resize(newSize)) {
+        return false;
+    }
+
+    /**
+     * Map the new extent over the reserved range. MAP_FIXED
+     * atomically replaces the reserved pages with the file
+     * mapping, so the already mapped extents stay untouched.
+     */
+    void *extent = mmap(m_base + m_mappedSize, newSize - m_mappedSize,
+                        PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED,
+                        m_file.handle(), m_mappedSize);
+
+    if (extent == MAP_FAILED) {
+        return false;
+    }
+
+    m_mappedSize = newSize;
+    return true;
+#else
+    return false;
+#endif
+}
+
+void KisMappedSwapFile::adviseWillNeed(quint64 begin, quint64 size)
+{
+#ifdef HAVE_MAPPED_SWAP_FILE
+    const quint64 alignedBegin = begin / pageSize() * pageSize();
+    const quint64 end = qMin(begin + size, m_mappedSize);
+
+    if (alignedBegin >= end) return;
+
+    madvise(m_base + alignedBegin, end - alignedBegin, MADV_WILLNEED);
+#else
+    Q_UNUSED(begin);
+    Q_UNUSED(size);
+#endif
+}
@@ -0,0 +1,94 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_MAPPED_SWAP_FILE_H
+#define __KIS_MAPPED_SWAP_FILE_H
+
+#include <QTemporaryFile>
+
+#include "kis_abstract_swap_space.h"
+
+
+#define DEFAULT_EXTENT_SIZE (256*MiB)
+
+/**
+ * A swap space backend that maps the entire swap file into the
+ * address space of the process.
+ *
+ * On construction the backend reserves a contiguous range of
+ * virtual addresses big enough to fit the maximum size of the swap.
+ * The file is grown in large extents and every extent is mapped
+ * into its place in the reserved range, so the mappings never move
+ * and are never unmapped until the backend is destroyed. Therefore,
+ * a swap-in of a random chunk costs not more than a page fault.
+ *
+ * prefetch() advises the kernel to read the chunk ahead. The data
+ * manager calls it for the neighbours of every tile that misses (see
+ * KisTiledDataManager::adviseNeighbourTiles()), since the tiles are
+ * usually read in spatial order, not in the order of the swap file.
+ *
+ * The backend needs a 64-bit address space and POSIX mmap(), so
+ * check isSupported() before using it. KisMemoryWindow should be
+ * used otherwise.
+ */
+class KRITAIMAGE_EXPORT KisMappedSwapFile : public KisAbstractSwapSpace
+{
+public:
+    /**
+     * @param swapDir the directory where the swap file will be created
+     * @param maxSwapSize the maximum size the file can grow to
+     * @param extentSize the step the file is grown with
+     */
+    KisMappedSwapFile(const QString &swapDir,
+                      quint64 maxSwapSize,
+                      quint64 extentSize = DEFAULT_EXTENT_SIZE);
+    ~KisMappedSwapFile() override;
+
+    /**
+     * Returns true if the backend can be used on this platform
+     */
+    static bool isSupported();
+
+    /**
+     * Returns false if the file could not be created or the
+     * address range could not be reserved
+     */
+    bool isValid() const;
+
+    using KisAbstractSwapSpace::getReadChunkPtr;
+    using KisAbstractSwapSpace::getWriteChunkPtr;
+    using KisAbstractSwapSpace::prefetch;
+
+    quint8* getReadChunkPtr(const KisChunkData &readChunk) override;
+    quint8* getWriteChunkPtr(const KisChunkData &writeChunk) override;
+
+    void prefetch(const KisChunkData &chunk) override;
+
+private:
+    bool ensureMapped(quint64 end);
+    void adviseWillNeed(quint64 begin, quint64 size);
+
+private:
+    QTemporaryFile m_file;
+
+    bool m_valid;
+    quint8 *m_base;
+    quint64 m_reservedSize;
+    quint64 m_mappedSize;
+    const quint64 m_extentSize;
+};
+
+#endif /* __KIS_MAPPED_SWAP_FILE_H */
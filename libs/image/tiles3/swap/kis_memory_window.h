@@ -21,12 +21,20 @@
 
 #include <QTemporaryFile>
 
-#include "kis_chunk_allocator.h"
+#include "kis_abstract_swap_space.h"
 
 
 #define DEFAULT_WINDOW_SIZE (16*MiB)
 
-class KRITAIMAGE_EXPORT KisMemoryWindow
+/**
+ * A swap space backend that maps only two small windows of the
+ * swap file (one for reading and one for writing) and remaps them
+ * on every access outside the current window. It is used when the
+ * address space is too small to map the entire swap file.
+ *
+ * \see KisMappedSwapFile
+ */
+class KRITAIMAGE_EXPORT KisMemoryWindow : public KisAbstractSwapSpace
 {
 public:
     /**
@@ -34,7 +42,7 @@ public:
      * @param writeWindowSize write window size.
      */
     KisMemoryWindow(const QString &swapDir, quint64 writeWindowSize = DEFAULT_WINDOW_SIZE);
-    ~KisMemoryWindow();
+    ~KisMemoryWindow() override;
 
     inline quint8* getReadChunkPtr(KisChunk readChunk) {
         return getReadChunkPtr(readChunk.data());
@@ -44,8 +52,8 @@ public:
         return getWriteChunkPtr(writeChunk.data());
     }
 
-    quint8* getReadChunkPtr(const KisChunkData &readChunk);
-    quint8* getWriteChunkPtr(const KisChunkData &writeChunk);
+    quint8* getReadChunkPtr(const KisChunkData &readChunk) override;
+    quint8* getWriteChunkPtr(const KisChunkData &writeChunk) override;
 
 private:
     struct MappingWindow {
@@ -0,0 +1,197 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_swap_out_pipeline.h"
+
+#include <QRunnable>
+#include <QThreadPool>
+
+#include "kis_assert.h"
+
+#include "tiles3/kis_tile_data.h"
+#include "tiles3/kis_tile_data_store.h"
+
+
+namespace {
+
+class CompressionJob : public QRunnable
+{
+public:
+    CompressionJob(KisTileDataStore *store,
+                   KisSwappedDataStore::CompressedTile *tiles, int numTiles,
+                   QSemaphore *doneSemaphore)
+        : m_store(store),
+          m_tiles(tiles),
+          m_numTiles(numTiles),
+          m_doneSemaphore(doneSemaphore)
+    {
+        setAutoDelete(true);
+    }
+
+    void run() override {
+        m_store->compressForSwapOut(m_tiles, m_numTiles);
+        m_doneSemaphore->release();
+    }
+
+private:
+    KisTileDataStore *m_store;
+    KisSwappedDataStore::CompressedTile *m_tiles;
+    int m_numTiles;
+    QSemaphore *m_doneSemaphore;
+};
+
+}
+
+
+KisSwapOutPipeline::KisSwapOutPipeline(KisTileDataStore *store, QThreadPool *pool, int batchSize)
+    : m_store(store),
+      m_pool(pool),
+      m_batchSize(qMax(1, batchSize)),
+      m_numRunningJobs(0),
+      m_freedMetric(0),
+      m_pendingMetric(0),
+      m_numSwappedOutTiles(0),
+      m_numBatches(0),
+      m_compressedSize(0),
+      m_numBackPressureStalls(0)
+{
+    m_selectedTiles.reserve(m_batchSize);
+    m_compressedTiles.reserve(m_batchSize);
+}
+
+KisSwapOutPipeline::~KisSwapOutPipeline()
+{
+    flush();
+}
+
+bool KisSwapOutPipeline::push(KisTileData *td)
+{
+    /**
+     * Unlocked check is fine here: the tile will be checked
+     * again under the lock before compression
+     */
+    if (!td->data()) return false;
+
+    KisSwappedDataStore::CompressedTile tile;
+    tile.td = td;
+    m_selectedTiles.append(tile);
+    m_pendingMetric += td->pixelSize();
+
+    if (m_selectedTiles.size() >= m_batchSize) {
+        finishCompression();
+        startCompression();
+    }
+
+    return true;
+}
+
+void KisSwapOutPipeline::flush()
+{
+    finishCompression();
+
+    if (!m_selectedTiles.isEmpty()) {
+        startCompression();
+        finishCompression();
+    }
+}
+
+void KisSwapOutPipeline::startCompression()
+{
+    KIS_ASSERT_RECOVER_RETURN(!m_numRunningJobs);
+    KIS_ASSERT_RECOVER_RETURN(m_compressedTiles.isEmpty());
+
+    m_compressedTiles.swap(m_selectedTiles);
+
+    const int numTiles = m_compressedTiles.size();
+    const int numJobs = qBound(1, m_pool->maxThreadCount(), numTiles);
+    const int tilesPerJob = (numTiles + numJobs - 1) / numJobs;
+
+    /**
+     * The vector is not touched by the swapper thread until
+     * finishCompression(), so the pointers into it stay valid
+     */
+    KisSwappedDataStore::CompressedTile *tiles = m_compressedTiles.data();
+
+    for (int start = 0; start < numTiles; start += tilesPerJob) {
+        m_pool->start(new CompressionJob(m_store,
+                                         tiles + start,
+                                         qMin(tilesPerJob, numTiles - start),
+                                         &m_jobsDone));
+        m_numRunningJobs++;
+    }
+}
+
+void KisSwapOutPipeline::finishCompression()
+{
+    if (!m_numRunningJobs) return;
+
+    if (!m_jobsDone.tryAcquire(m_numRunningJobs)) {
+        m_numBackPressureStalls++;
+        m_jobsDone.acquire(m_numRunningJobs);
+    }
+    m_numRunningJobs = 0;
+
+    qint64 batchMetric = 0;
+
+    for (auto it = m_compressedTiles.constBegin(); it != m_compressedTiles.constEnd(); ++it) {
+        batchMetric += it->td->pixelSize();
+    }
+
+    m_store->commitSwapOut(m_compressedTiles);
+
+    for (auto it = m_compressedTiles.constBegin(); it != m_compressedTiles.constEnd(); ++it) {
+        if (it->swappedOut) {
+            m_freedMetric += it->td->pixelSize();
+            m_compressedSize += it->bytesWritten;
+            m_numSwappedOutTiles++;
+        }
+    }
+
+    m_pendingMetric -= batchMetric;
+    m_numBatches++;
+
+    m_compressedTiles.clear();
+}
+
+qint64 KisSwapOutPipeline::freedMetric() const
+{
+    return m_freedMetric;
+}
+
+qint64 KisSwapOutPipeline::pendingMetric() const
+{
+    return m_pendingMetric;
+}
+
+qint64 KisSwapOutPipeline::numSwappedOutTiles() const
+{
+    return m_numSwappedOutTiles;
+}
+
+qint64 KisSwapOutPipeline::numBatches() const
+{
+    return m_numBatches;
+}
+
+qint64 KisSwapOutPipeline::compressedSize() const
+{
+    return m_compressedSize;
+}
+
+qint64 KisSwapOutPipeline::numBackPressureStalls() const
+{
+    return m_numBackPressureStalls;
+}
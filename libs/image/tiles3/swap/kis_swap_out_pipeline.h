@@ -0,0 +1,113 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_SWAP_OUT_PIPELINE_H
+#define __KIS_SWAP_OUT_PIPELINE_H
+
+#include <QVector>
+#include <QSemaphore>
+
+#include "kis_swapped_data_store.h"
+
+class QThreadPool;
+class KisTileDataStore;
+class KisTileData;
+
+/**
+ * Swaps out tile data in three stages:
+ *
+ * 1) The swapper thread selects victims (push())
+ *
+ * 2) When a batch of victims is collected, it is split between
+ *    the workers of the thread pool, which compress the tiles in
+ *    parallel. In the meantime the swapper thread continues
+ *    selecting the victims for the next batch.
+ *
+ * 3) When the next batch is ready, the previous one is re-validated
+ *    and written into the swap file in one go (under a single lock
+ *    of the swapped data store).
+ *
+ * The tiles are not locked while they are waiting in the queue.
+ * A worker locks a tile only while compressing it, and the swapper
+ * locks the batch only for the time of writing it, so the painting
+ * threads are never blocked by a tile just because it has been
+ * selected (see KisTileDataStore::compressForSwapOut()).
+ *
+ * Only one batch can be compressed at a time. If the swapper has
+ * selected the next batch before the workers have finished
+ * compressing the previous one, it blocks until they are done
+ * (back-pressure).
+ *
+ * The pipeline should be used while KisTileDataStore is being
+ * iterated, that is, with the iterator lock held.
+ */
+class KisSwapOutPipeline
+{
+public:
+    KisSwapOutPipeline(KisTileDataStore *store, QThreadPool *pool, int batchSize);
+    ~KisSwapOutPipeline();
+
+    /**
+     * Queues \p td for swapping out. Returns false if the tile
+     * data has already been swapped out.
+     */
+    bool push(KisTileData *td);
+
+    /**
+     * Waits until all the queued tiles are written into the swap
+     */
+    void flush();
+
+    /**
+     * The metric of the tiles that have been actually swapped out
+     */
+    qint64 freedMetric() const;
+
+    /**
+     * The metric of the tiles queued, but not yet written into the swap
+     */
+    qint64 pendingMetric() const;
+
+    qint64 numSwappedOutTiles() const;
+    qint64 numBatches() const;
+    qint64 compressedSize() const;
+    qint64 numBackPressureStalls() const;
+
+private:
+    void startCompression();
+    void finishCompression();
+
+private:
+    KisTileDataStore *m_store;
+    QThreadPool *m_pool;
+    int m_batchSize;
+
+    QVector<KisSwappedDataStore::CompressedTile> m_selectedTiles;
+    QVector<KisSwappedDataStore::CompressedTile> m_compressedTiles;
+
+    QSemaphore m_jobsDone;
+    int m_numRunningJobs;
+
+    qint64 m_freedMetric;
+    qint64 m_pendingMetric;
+
+    qint64 m_numSwappedOutTiles;
+    qint64 m_numBatches;
+    qint64 m_compressedSize;
+    qint64 m_numBackPressureStalls;
+};
+
+#endif /* __KIS_SWAP_OUT_PIPELINE_H */
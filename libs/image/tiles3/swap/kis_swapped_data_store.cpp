@@ -19,12 +19,26 @@
 //#include "kis_debug.h"
 #include "kis_swapped_data_store.h"
 #include "kis_memory_window.h"
+#include "kis_mapped_swap_file.h"
 #include "kis_image_config.h"
 
 #include "kis_tile_compressor_2.h"
 
 //#define COMPRESSOR_VERSION 2
 
+struct KisSwappedDataStore::CompressorsPair
+{
+    CompressorsPair(KisCompressionFactory::CodecId codec,
+                    KisCompressionFactory::CodecId coldCodec)
+        : compressor(codec),
+          coldCompressor(coldCodec)
+    {
+    }
+
+    KisTileCompressor2 compressor;
+    KisTileCompressor2 coldCompressor;
+};
+
 KisSwappedDataStore::KisSwappedDataStore()
     : m_memoryMetric(0)
 {
@@ -34,14 +48,40 @@ KisSwappedDataStore::KisSwappedDataStore()
     const quint64 swapWindowSize = config.swapWindowSize() * MiB;
 
     m_allocator = new KisChunkAllocator(swapSlabSize, maxSwapSize);
-    m_swapSpace = new KisMemoryWindow(config.swapDir(), swapWindowSize);
+    m_swapSpace = 0;
+
+    if (config.useMappedSwapFile() && KisMappedSwapFile::isSupported()) {
+        const quint64 swapExtentSize = config.swapExtentSize() * MiB;
+
+        KisMappedSwapFile *swapFile =
+            new KisMappedSwapFile(config.swapDir(), maxSwapSize, swapExtentSize);
+
+        if (swapFile->isValid()) {
+            m_swapSpace = swapFile;
+        } else {
+            delete swapFile;
+        }
+    }
+
+    if (!m_swapSpace) {
+        m_swapSpace = new KisMemoryWindow(config.swapDir(), swapWindowSize);
+    }
+
+    m_codec = KisCompressionFactory::fromName(config.swapCompression());
+    m_coldCodec = KisCompressionFactory::fromName(config.swapColdCompression());
 
-    // FIXME: use a factory after the patch is committed
-    m_compressor = new KisTileCompressor2();
+    m_compressor = new KisTileCompressor2(m_codec);
+    m_coldCompressor = new KisTileCompressor2(m_coldCodec);
 }
 
 KisSwappedDataStore::~KisSwappedDataStore()
 {
+    CompressorsPair *compressors = 0;
+    while (m_freeCompressors.pop(compressors)) {
+        delete compressors;
+    }
+
+    delete m_coldCompressor;
     delete m_compressor;
     delete m_swapSpace;
     delete m_allocator;
@@ -66,12 +106,15 @@ bool KisSwappedDataStore::trySwapOutTileData(KisTileData *td)
      * So we can modify the tile data freely.
      */
 
-    const qint32 expectedBufferSize = m_compressor->tileDataBufferSize(td);
+    KisAbstractTileCompressor *compressor =
+        td->historical() ? m_coldCompressor : m_compressor;
+
+    const qint32 expectedBufferSize = compressor->tileDataBufferSize(td);
     if(m_buffer.size() < expectedBufferSize)
         m_buffer.resize(expectedBufferSize);
 
     qint32 bytesWritten;
-    m_compressor->compressTileData(td, (quint8*) m_buffer.data(), m_buffer.size(), bytesWritten);
+    compressor->compressTileData(td, (quint8*) m_buffer.data(), m_buffer.size(), bytesWritten);
 
     KisChunk chunk = m_allocator->getChunk(bytesWritten);
     quint8 *ptr = m_swapSpace->getWriteChunkPtr(chunk);
@@ -89,6 +132,77 @@ bool KisSwappedDataStore::trySwapOutTileData(KisTileData *td)
     return true;
 }
 
+KisSwappedDataStore::CompressorsPair* KisSwappedDataStore::acquireCompressors()
+{
+    CompressorsPair *compressors = 0;
+
+    if (!m_freeCompressors.pop(compressors)) {
+        compressors = new CompressorsPair(m_codec, m_coldCodec);
+    }
+
+    return compressors;
+}
+
+void KisSwappedDataStore::releaseCompressors(CompressorsPair *compressors)
+{
+    m_freeCompressors.push(compressors);
+}
+
+void KisSwappedDataStore::compressTileData(CompressedTile *tiles, int numTiles)
+{
+    CompressorsPair *compressors = acquireCompressors();
+
+    for (int i = 0; i < numTiles; i++) {
+        CompressedTile &tile = tiles[i];
+        Q_ASSERT(tile.td->data());
+
+        KisAbstractTileCompressor *compressor =
+            tile.td->historical() ? &compressors->coldCompressor : &compressors->compressor;
+
+        const qint32 expectedBufferSize = compressor->tileDataBufferSize(tile.td);
+        if (tile.buffer.size() < expectedBufferSize) {
+            tile.buffer.resize(expectedBufferSize);
+        }
+
+        compressor->compressTileData(tile.td, (quint8*) tile.buffer.data(),
+                                     tile.buffer.size(), tile.bytesWritten);
+        tile.compressed = true;
+    }
+
+    releaseCompressors(compressors);
+}
+
+void KisSwappedDataStore::writeCompressedTiles(QVector<CompressedTile> &tiles)
+{
+    QMutexLocker locker(&m_lock);
+
+    for (auto it = tiles.begin(); it != tiles.end(); ++it) {
+        if (!it->compressed) {
+            it->swappedOut = false;
+            continue;
+        }
+
+        KisTileData *td = it->td;
+        Q_ASSERT(td->data());
+
+        KisChunk chunk = m_allocator->getChunk(it->bytesWritten);
+        quint8 *ptr = m_swapSpace->getWriteChunkPtr(chunk);
+        if (!ptr) {
+            qWarning() << "swap out of tile failed";
+            m_allocator->freeChunk(chunk);
+            it->swappedOut = false;
+            continue;
+        }
+        memcpy(ptr, it->buffer.constData(), it->bytesWritten);
+
+        td->releaseMemory();
+        td->setSwapChunk(chunk);
+
+        m_memoryMetric += td->pixelSize();
+        it->swappedOut = true;
+    }
+}
+
 void KisSwappedDataStore::swapInTileData(KisTileData *td)
 {
     Q_ASSERT(!td->data());
@@ -109,6 +223,15 @@ void KisSwappedDataStore::swapInTileData(KisTileData *td)
     m_memoryMetric -= td->pixelSize();
 }
 
+void KisSwappedDataStore::prefetchTileData(KisTileData *td)
+{
+    QMutexLocker locker(&m_lock);
+
+    if (td->data()) return;
+
+    m_swapSpace->prefetch(td->swapChunk());
+}
+
 void KisSwappedDataStore::forgetTileData(KisTileData *td)
 {
     QMutexLocker locker(&m_lock);
@@ -23,13 +23,17 @@
 
 #include <QMutex>
 #include <QByteArray>
+#include <QVector>
+
+#include "kis_lockless_stack.h"
+#include "tiles3/swap/kis_compression_factory.h"
 
 
 class QMutex;
 class KisTileData;
 class KisAbstractTileCompressor;
 class KisChunkAllocator;
-class KisMemoryWindow;
+class KisAbstractSwapSpace;
 
 class KRITAIMAGE_EXPORT KisSwappedDataStore
 {
@@ -50,6 +54,43 @@ public:
      */
     bool trySwapOutTileData(KisTileData *td);
 
+    /**
+     * A tile data compressed by a worker thread of the swap-out
+     * pipeline, but not yet written into the swap file
+     */
+    struct CompressedTile {
+        CompressedTile() : td(0), bytesWritten(0), compressed(false), swappedOut(false) {}
+
+        KisTileData *td;
+        QByteArray buffer;
+        qint32 bytesWritten;
+        bool compressed;
+        bool swappedOut;
+    };
+
+    /**
+     * Compresses \p numTiles tiles starting from \p tiles without
+     * writing them into the swap file and sets their
+     * CompressedTile::compressed flag. This function does *not*
+     * take the store lock, so it can be called from several
+     * threads simultaneously.
+     * LOCKING: the locks on the tile data objects should be taken
+     *          by the caller before making a call.
+     */
+    void compressTileData(CompressedTile *tiles, int numTiles);
+
+    /**
+     * Writes a batch of tiles compressed with compressTileData()
+     * into the swap file and frees memory occupied by their data.
+     * The tiles with CompressedTile::compressed unset are skipped.
+     * The store lock is taken only once for the whole batch.
+     * CompressedTile::swappedOut is set for every successfully
+     * written tile.
+     * LOCKING: the locks on the tile data objects should be taken
+     *          by the caller before making a call.
+     */
+    void writeCompressedTiles(QVector<CompressedTile> &tiles);
+
     /**
      * Restore the data of a \a td basing on information
      * stored in the swap file.
@@ -58,6 +99,15 @@ public:
      */
     void swapInTileData(KisTileData *td);
 
+    /**
+     * Hints the swap backend that the data of \a td is going to
+     * be swapped-in soon, so it may start reading it from disk
+     * asynchronously. Does nothing if \a td is not swapped out.
+     * LOCKING: the lock on the tile data should be taken
+     *          by the caller before making a call.
+     */
+    void prefetchTileData(KisTileData *td);
+
     /**
      * Forget all the information linked with the tile data.
      * This should be done before deleting of the tile data,
@@ -78,10 +128,32 @@ public:
 
 private:
     QByteArray m_buffer;
+
+    /**
+     * Working tiles are compressed with a fast codec, because
+     * they are likely to be swapped-in soon. Historical (undo)
+     * tiles are rarely requested, so they are compressed with a
+     * slower codec giving better ratio. Both compressors can read
+     * the data written by any of them.
+     */
     KisAbstractTileCompressor *m_compressor;
+    KisAbstractTileCompressor *m_coldCompressor;
+
+    /**
+     * Compressors used by the workers of the swap-out pipeline.
+     * A worker takes a pair of compressors on the beginning of a
+     * job and returns it back on completion.
+     */
+    struct CompressorsPair;
+    CompressorsPair* acquireCompressors();
+    void releaseCompressors(CompressorsPair *compressors);
+
+    KisCompressionFactory::CodecId m_codec;
+    KisCompressionFactory::CodecId m_coldCodec;
+    KisLocklessStack<CompressorsPair*> m_freeCompressors;
 
     KisChunkAllocator *m_allocator;
-    KisMemoryWindow *m_swapSpace;
+    KisAbstractSwapSpace *m_swapSpace;
 
     QMutex m_lock;
 
@@ -17,22 +17,44 @@
  */
 
 #include "kis_tile_compressor_2.h"
-#include "kis_lzf_compression.h"
+#include "kis_abstract_compression.h"
 #include <QIODevice>
 #include "kis_paint_device_writer.h"
 #define TILE_DATA_SIZE(pixelSize) ((pixelSize) * KisTileData::WIDTH * KisTileData::HEIGHT)
 
-const QString KisTileCompressor2::m_compressionName = "LZF";
 
-
-KisTileCompressor2::KisTileCompressor2()
+KisTileCompressor2::KisTileCompressor2(KisCompressionFactory::CodecId codec)
 {
-    m_compression = new KisLzfCompression();
+    setCodec(codec);
 }
 
 KisTileCompressor2::~KisTileCompressor2()
 {
-    delete m_compression;
+    qDeleteAll(m_compressions);
+}
+
+void KisTileCompressor2::setCodec(KisCompressionFactory::CodecId codec)
+{
+    m_codec = KisCompressionFactory::isAvailable(codec) ? codec : KisCompressionFactory::LZF;
+}
+
+KisCompressionFactory::CodecId KisTileCompressor2::codec() const
+{
+    return m_codec;
+}
+
+KisAbstractCompression* KisTileCompressor2::compression(KisCompressionFactory::CodecId codec)
+{
+    KisAbstractCompression *compression = m_compressions.value(codec, 0);
+
+    if (!compression) {
+        compression = KisCompressionFactory::create(codec);
+        if (compression) {
+            m_compressions.insert(codec, compression);
+        }
+    }
+
+    return compression;
 }
 
 bool KisTileCompressor2::writeTile(KisTileSP tile, KisPaintDeviceWriter &store)
@@ -75,7 +97,18 @@ bool KisTileCompressor2::readTile(QIODevice *stream, KisTiledDataManager *dm)
         qint32 dataSize = headerItems.takeFirst().toInt();
 
         Q_ASSERT(headerItems.isEmpty());
-        Q_ASSERT(compressionName == m_compressionName);
+
+        /**
+         * The actual codec is stored in the first byte of the
+         * tile data, so we only check that we support it
+         */
+        const KisCompressionFactory::CodecId codec =
+            KisCompressionFactory::fromName(compressionName);
+
+        if (KisCompressionFactory::name(codec) != compressionName) {
+            warnFile << "Unsupported tile compression" << compressionName;
+            return false;
+        }
 
         qint32 row = yToRow(dm, y);
         qint32 col = xToCol(dm, x);
@@ -101,9 +134,9 @@ void KisTileCompressor2::prepareStreamingBuffer(qint32 tileDataSize)
     m_streamingBuffer.resize(tileDataSize + 1);
 }
 
-void KisTileCompressor2::prepareWorkBuffers(qint32 tileDataSize)
+void KisTileCompressor2::prepareWorkBuffers(KisAbstractCompression *compression, qint32 tileDataSize)
 {
-    const qint32 bufferSize = m_compression->outputBufferSize(tileDataSize);
+    const qint32 bufferSize = compression->outputBufferSize(tileDataSize);
 
     m_linearizationBuffer.resize(tileDataSize);
     m_compressionBuffer.resize(bufferSize);
@@ -121,16 +154,17 @@ void KisTileCompressor2::compressTileData(KisTileData *tileData,
     Q_UNUSED(bufferSize);
     Q_ASSERT(bufferSize >= tileDataSize + 1);
 
-    prepareWorkBuffers(tileDataSize);
+    KisAbstractCompression *codec = compression(m_codec);
+    prepareWorkBuffers(codec, tileDataSize);
 
     KisAbstractCompression::linearizeColors(tileData->data(), (quint8*)m_linearizationBuffer.data(),
                                             tileDataSize, pixelSize);
 
-    compressedBytes = m_compression->compress((quint8*)m_linearizationBuffer.data(), tileDataSize,
-                                              (quint8*)m_compressionBuffer.data(), m_compressionBuffer.size());
+    compressedBytes = codec->compress((quint8*)m_linearizationBuffer.data(), tileDataSize,
+                                      (quint8*)m_compressionBuffer.data(), m_compressionBuffer.size());
 
-    if(compressedBytes < tileDataSize) {
-        buffer[0] = COMPRESSED_DATA_FLAG;
+    if(compressedBytes > 0 && compressedBytes < tileDataSize) {
+        buffer[0] = qint8(m_codec);
         memcpy(buffer + 1, m_compressionBuffer.data(), compressedBytes);
         bytesWritten = compressedBytes + 1;
     }
@@ -148,12 +182,22 @@ bool KisTileCompressor2::decompressTileData(quint8 *buffer,
     const qint32 pixelSize = tileData->pixelSize();
     const qint32 tileDataSize = TILE_DATA_SIZE(pixelSize);
 
-    if(buffer[0] == COMPRESSED_DATA_FLAG) {
-        prepareWorkBuffers(tileDataSize);
+    if(buffer[0] != RAW_DATA_FLAG) {
+        if (!KisCompressionFactory::isValidId(buffer[0])) return false;
+
+        KisAbstractCompression *codec =
+            compression(KisCompressionFactory::CodecId(buffer[0]));
+
+        if (!codec) {
+            warnTiles << "Tile data was compressed with unsupported codec" << buffer[0];
+            return false;
+        }
+
+        prepareWorkBuffers(codec, tileDataSize);
 
         qint32 bytesWritten;
-        bytesWritten = m_compression->decompress(buffer + 1, bufferSize - 1,
-                                                 (quint8*)m_linearizationBuffer.data(), tileDataSize);
+        bytesWritten = codec->decompress(buffer + 1, bufferSize - 1,
+                                         (quint8*)m_linearizationBuffer.data(), tileDataSize);
         if (bytesWritten == tileDataSize) {
             KisAbstractCompression::delinearizeColors((quint8*)m_linearizationBuffer.data(),
                                                       tileData->data(),
@@ -191,5 +235,5 @@ inline QString KisTileCompressor2::getHeader(KisTileSP tile,
     qint32 width, height;
     tile->extent().getRect(&x, &y, &width, &height);
 
-    return QString("%1,%2,%3,%4\n").arg(x).arg(y).arg(m_compressionName).arg(compressedSize);
+    return QString("%1,%2,%3,%4\n").arg(x).arg(y).arg(KisCompressionFactory::name(m_codec)).arg(compressedSize);
 }
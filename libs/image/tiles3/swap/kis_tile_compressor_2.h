@@ -20,15 +20,32 @@
 #define __KIS_TILE_COMPRESSOR_2_H
 
 #include "kis_abstract_tile_compressor.h"
+#include "kis_compression_factory.h"
+
+#include <QHash>
 
 class KisAbstractCompression;
 
+/**
+ * The first byte of every compressed tile stores the id of the codec
+ * used for compression (see KisCompressionFactory::CodecId) or
+ * RAW_DATA_FLAG if the data was stored uncompressed. Therefore, the
+ * compressor can decompress the data compressed by any codec, which
+ * makes the swap file readable even if the codecs were mixed.
+ */
 class KRITAIMAGE_EXPORT KisTileCompressor2 : public KisAbstractTileCompressor
 {
 public:
-    KisTileCompressor2();
+    KisTileCompressor2(KisCompressionFactory::CodecId codec = KisCompressionFactory::LZF);
     ~KisTileCompressor2() override;
 
+    /**
+     * The codec that will be used for compressing the data. If the
+     * codec is not available in the current build, LZF is used.
+     */
+    void setCodec(KisCompressionFactory::CodecId codec);
+    KisCompressionFactory::CodecId codec() const;
+
     bool writeTile(KisTileSP tile, KisPaintDeviceWriter &store) override;
     bool readTile(QIODevice *io, KisTiledDataManager *dm) override;
 
@@ -46,19 +63,21 @@ private:
 
     QString getHeader(KisTileSP tile, qint32 compressedSize);
 
-    void prepareWorkBuffers(qint32 tileDataSize);
+    void prepareWorkBuffers(KisAbstractCompression *compression, qint32 tileDataSize);
     void prepareStreamingBuffer(qint32 tileDataSize);
 
+    KisAbstractCompression* compression(KisCompressionFactory::CodecId codec);
+
 private:
     static const qint8 RAW_DATA_FLAG = 0;
-    static const qint8 COMPRESSED_DATA_FLAG = 1;
 
 private:
     QByteArray m_linearizationBuffer;
     QByteArray m_compressionBuffer;
     QByteArray m_streamingBuffer;
-    KisAbstractCompression *m_compression;
-    static const QString m_compressionName;
+
+    KisCompressionFactory::CodecId m_codec;
+    QHash<int, KisAbstractCompression*> m_compressions;
 };
 
 #endif /* __KIS_TILE_COMPRESSOR_2_H */
@@ -17,9 +17,13 @@
  */
 
 #include <QSemaphore>
+#include <QThreadPool>
+#include <QRunnable>
 
 #include "tiles3/swap/kis_tile_data_swapper.h"
 #include "tiles3/swap/kis_tile_data_swapper_p.h"
+#include "tiles3/swap/kis_swap_out_pipeline.h"
+#include "tiles3/kis_tile.h"
 #include "tiles3/kis_tile_data.h"
 #include "tiles3/kis_tile_data_store.h"
 #include "tiles3/kis_tile_data_store_iterators.h"
@@ -30,6 +34,18 @@
 const qint32 KisTileDataSwapper::TIMEOUT = -1;
 const qint32 KisTileDataSwapper::DELAY = 0.7 * SEC;
 
+/**
+ * The prefetcher never loads more tiles than that per request. It
+ * is about 256 MiB of RGBA8 data.
+ */
+const qint32 KisTileDataSwapper::MAX_PREFETCH_TILES = 16384;
+
+/**
+ * The number of tiles compressed by every worker of the
+ * swap-out pipeline in one batch
+ */
+const qint32 TILES_PER_WORKER = 32;
+
 //#define DEBUG_SWAPPER
 
 #ifdef DEBUG_SWAPPER
@@ -52,6 +68,44 @@ public:
     KisTileDataStore *store;
     KisStoreLimits limits;
     QMutex cycleLock;
+
+    /**
+     * Workers compressing the tiles for the swap-out pipeline
+     */
+    QThreadPool compressionPool;
+
+    QAtomicInteger<qint64> swapOutTiles;
+    QAtomicInteger<qint64> swapOutBatches;
+    QAtomicInteger<qint64> swapOutCompressedSize;
+    QAtomicInteger<qint64> swapOutBackPressureStalls;
+
+    /**
+     * The prefetcher has its own single-threaded pool. It takes
+     * m_iteratorLock for writing, so it must never occupy a worker
+     * the swap-out pipeline is waiting for.
+     */
+    QThreadPool prefetchPool;
+    QMutex prefetchLock;
+    QVector<KisTileSP> prefetchQueue; // stored in reverse order
+    bool prefetchJobRunning;
+
+    QAtomicInteger<qint64> prefetchRequests;
+    QAtomicInteger<qint64> prefetchSwapIns;
+};
+
+struct KisTileDataSwapper::PrefetchJob : public QRunnable
+{
+    PrefetchJob(KisTileDataSwapper *swapper)
+        : m_swapper(swapper)
+    {
+    }
+
+    void run() override {
+        m_swapper->processPrefetchQueue();
+    }
+
+private:
+    KisTileDataSwapper *m_swapper;
 };
 
 KisTileDataSwapper::KisTileDataSwapper(KisTileDataStore *store)
@@ -60,10 +114,19 @@ KisTileDataSwapper::KisTileDataSwapper(KisTileDataStore *store)
 {
     m_d->shouldExitFlag = 0;
     m_d->store = store;
+    m_d->compressionPool.setMaxThreadCount(QThread::idealThreadCount());
+    m_d->prefetchPool.setMaxThreadCount(1);
+    m_d->prefetchJobRunning = false;
 }
 
 KisTileDataSwapper::~KisTileDataSwapper()
 {
+    {
+        QMutexLocker locker(&m_d->prefetchLock);
+        m_d->prefetchQueue.clear();
+    }
+    m_d->prefetchPool.waitForDone();
+    m_d->compressionPool.waitForDone();
     delete m_d;
 }
 
@@ -107,6 +170,60 @@ void KisTileDataSwapper::checkFreeMemory()
         doJob();
 }
 
+void KisTileDataSwapper::prefetchTiles(const QVector<KisTileSP> &tiles)
+{
+    if (tiles.isEmpty()) return;
+
+    m_d->prefetchRequests.ref();
+
+    QMutexLocker locker(&m_d->prefetchLock);
+
+    const int numTiles = qMin(tiles.size(), MAX_PREFETCH_TILES);
+
+    m_d->prefetchQueue.resize(numTiles);
+    for (int i = 0; i < numTiles; i++) {
+        m_d->prefetchQueue[numTiles - i - 1] = tiles[i];
+    }
+
+    if (!m_d->prefetchJobRunning) {
+        m_d->prefetchJobRunning = true;
+        m_d->prefetchPool.start(new PrefetchJob(this));
+    }
+}
+
+void KisTileDataSwapper::processPrefetchQueue()
+{
+    while (1) {
+        KisTileSP tile;
+
+        {
+            QMutexLocker locker(&m_d->prefetchLock);
+
+            /**
+             * Loading more tiles when we are about to swap out the
+             * working set will just make the swapper throw them away
+             */
+            if (m_d->shouldExitFlag ||
+                m_d->store->memoryMetric() > m_d->limits.hardLimitThreshold()) {
+
+                m_d->prefetchQueue.clear();
+            }
+
+            if (m_d->prefetchQueue.isEmpty()) {
+                m_d->prefetchJobRunning = false;
+                break;
+            }
+
+            tile = m_d->prefetchQueue.last();
+            m_d->prefetchQueue.removeLast();
+        }
+
+        if (tile->prefetchData()) {
+            m_d->prefetchSwapIns.ref();
+        }
+    }
+}
+
 void KisTileDataSwapper::doJob()
 {
     /**
@@ -195,25 +312,40 @@ public:
 template<class strategy>
 qint64 KisTileDataSwapper::pass(qint64 needToFreeMetric)
 {
-    qint64 freedMetric = 0;
     QList<KisTileData*> additionalCandidates;
 
+    /**
+     * Account the accesses to the prefetched tiles, so that the set
+     * of the tracked ones doesn't grow while the swapper is idle
+     */
+    m_d->store->collectPrefetchHits();
+
     typename strategy::iterator *iter =
         strategy::beginIteration(m_d->store);
 
+    KisSwapOutPipeline pipeline(m_d->store, &m_d->compressionPool,
+                                TILES_PER_WORKER * m_d->compressionPool.maxThreadCount());
+
+    /**
+     * The tiles that are still being compressed are considered
+     * to be freed already, otherwise we would select too many
+     * victims while the pipeline is full
+     */
+    auto enoughFreed = [&pipeline, needToFreeMetric] () {
+        return pipeline.freedMetric() + pipeline.pendingMetric() >= needToFreeMetric;
+    };
+
     KisTileData *item = 0;
 
     while (iter->hasNext()) {
         item = iter->next();
 
-        if (freedMetric >= needToFreeMetric) break;
+        if (enoughFreed()) break;
 
         if (!strategy::isInteresting(item)) continue;
 
         if (strategy::swapOutFirst(item)) {
-            if (iter->trySwapOut(item)) {
-                freedMetric += item->pixelSize();
-            }
+            pipeline.push(item);
         }
         else {
             item->markOld();
@@ -223,16 +355,36 @@ qint64 KisTileDataSwapper::pass(qint64 needToFreeMetric)
     }
 
     Q_FOREACH (item, additionalCandidates) {
-        if (freedMetric >= needToFreeMetric) break;
+        if (enoughFreed()) break;
 
-        if (iter->trySwapOut(item)) {
-            freedMetric += item->pixelSize();
-        }
+        pipeline.push(item);
     }
 
+    pipeline.flush();
+
     strategy::endIteration(m_d->store, iter);
 
-    return freedMetric;
+    m_d->swapOutTiles.fetchAndAddRelaxed(pipeline.numSwappedOutTiles());
+    m_d->swapOutBatches.fetchAndAddRelaxed(pipeline.numBatches());
+    m_d->swapOutCompressedSize.fetchAndAddRelaxed(pipeline.compressedSize());
+    m_d->swapOutBackPressureStalls.fetchAndAddRelaxed(pipeline.numBackPressureStalls());
+
+    return pipeline.freedMetric();
+}
+
+KisTileDataSwapper::Statistics KisTileDataSwapper::statistics() const
+{
+    Statistics stats;
+
+    stats.swapOutTiles = m_d->swapOutTiles.loadAcquire();
+    stats.swapOutBatches = m_d->swapOutBatches.loadAcquire();
+    stats.swapOutCompressedSize = m_d->swapOutCompressedSize.loadAcquire();
+    stats.swapOutBackPressureStalls = m_d->swapOutBackPressureStalls.loadAcquire();
+
+    stats.prefetchRequests = m_d->prefetchRequests.loadAcquire();
+    stats.prefetchSwapIns = m_d->prefetchSwapIns.loadAcquire();
+
+    return stats;
 }
 
 void KisTileDataSwapper::testingRereadConfig()
@@ -20,12 +20,16 @@
 
 #include <QObject>
 #include <QThread>
+#include <QVector>
 
 #include "kritaimage_export.h"
+#include <kis_shared_ptr.h>
 
 
 class KisTileDataStore;
 class KisTileData;
+class KisTile;
+typedef KisSharedPtr<KisTile> KisTileSP;
 
 class KRITAIMAGE_EXPORT KisTileDataSwapper : public QThread
 {
@@ -40,8 +44,41 @@ public:
     void terminateSwapper();
     void checkFreeMemory();
 
+    /**
+     * Queues the tiles for loading from the swap file in a background
+     * thread. The tiles that are still in the queue after the previous
+     * call are dropped, because the new prediction is more accurate.
+     */
+    void prefetchTiles(const QVector<KisTileSP> &tiles);
+
     void testingRereadConfig();
 
+    struct Statistics {
+        Statistics()
+            : swapOutTiles(0),
+              swapOutBatches(0),
+              swapOutCompressedSize(0),
+              swapOutBackPressureStalls(0),
+              prefetchRequests(0),
+              prefetchSwapIns(0)
+        {
+        }
+
+        qint64 swapOutTiles;
+        qint64 swapOutBatches;
+        qint64 swapOutCompressedSize;
+        qint64 swapOutBackPressureStalls;
+
+        qint64 prefetchRequests;
+        qint64 prefetchSwapIns;
+    };
+
+    /**
+     * Returns cumulative counters of the swap-out pipeline
+     * and the prefetcher
+     */
+    Statistics statistics() const;
+
 private:
     void waitForWork();
     void run() override;
@@ -49,9 +86,13 @@ private:
     void doJob();
     template<class strategy> qint64 pass(qint64 needToFreeMetric);
 
+    struct PrefetchJob;
+    void processPrefetchQueue();
+
 private:
     static const qint32 TIMEOUT;
     static const qint32 DELAY;
+    static const qint32 MAX_PREFETCH_TILES;
 
 private:
     struct Private;
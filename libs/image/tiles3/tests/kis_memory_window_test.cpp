@@ -23,6 +23,7 @@
 #include <QTemporaryDir>
 
 #include "../swap/kis_memory_window.h"
+#include "../swap/kis_mapped_swap_file.h"
 
 void KisMemoryWindowTest::testWindow()
 {
@@ -54,6 +55,42 @@ void KisMemoryWindowTest::testWindow()
     QVERIFY(!memcmp(ptr, oddBuf, chunkLength));
 }
 
+void KisMemoryWindowTest::testMappedSwapFile()
+{
+    if (!KisMappedSwapFile::isSupported()) {
+        QSKIP("Mapped swap file is not supported on this platform");
+    }
+
+    QTemporaryDir swapDir;
+    KisMappedSwapFile memory(swapDir.path(), 16 * MiB, 1 * MiB);
+    QVERIFY(memory.isValid());
+
+    quint8 oddValue = 0xee;
+    const quint8 chunkLength = 10;
+
+    quint8 oddBuf[chunkLength];
+    memset(oddBuf, oddValue, chunkLength);
+
+    KisChunkData chunk1(0, chunkLength);
+    KisChunkData chunk2(3 * MiB + 1025, chunkLength);
+    KisChunkData tooFarChunk(16 * MiB, chunkLength);
+
+    quint8 *ptr1 = memory.getWriteChunkPtr(chunk1);
+    memcpy(ptr1, oddBuf, chunkLength);
+
+    quint8 *ptr2 = memory.getWriteChunkPtr(chunk2);
+    memcpy(ptr2, oddBuf, chunkLength);
+
+    // the mapping is never moved when the file grows
+    QCOMPARE(memory.getReadChunkPtr(chunk1), ptr1);
+    QVERIFY(!memcmp(memory.getReadChunkPtr(chunk2), oddBuf, chunkLength));
+    QVERIFY(!memcmp(memory.getReadChunkPtr(chunk1), oddBuf, chunkLength));
+
+    memory.prefetch(chunk2);
+
+    QVERIFY(!memory.getWriteChunkPtr(tooFarChunk));
+}
+
 void KisMemoryWindowTest::testTopReports()
 {
 
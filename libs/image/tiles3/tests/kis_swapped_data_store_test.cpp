@@ -131,5 +131,48 @@ void KisSwappedDataStoreTest::testRandomAccess()
         delete tileDataList[i];
 }
 
+void KisSwappedDataStoreTest::testBatchRoundTrip()
+{
+    const qint32 pixelSize = 1;
+    const quint8 defaultPixel = 128;
+    const qint32 NUM_TILES = 1000;
+    const qint32 NUM_CHUNKS = 4;
+
+    KisImageConfig config(false);
+    config.setMaxSwapSize(4);
+    config.setSwapSlabSize(1);
+    config.setSwapWindowSize(1);
+
+
+    KisSwappedDataStore store;
+
+    QVector<KisSwappedDataStore::CompressedTile> tiles(NUM_TILES);
+    for(qint32 i = 0; i < NUM_TILES; i++) {
+        KisTileData *td = new KisTileData(pixelSize, &defaultPixel, KisTileDataStore::instance());
+        memset(td->data(), COLUMN2COLOR(i), TILESIZE);
+        tiles[i].td = td;
+    }
+
+    // compress in several chunks, like the swap-out pipeline does
+    const qint32 chunkSize = NUM_TILES / NUM_CHUNKS;
+    for(qint32 i = 0; i < NUM_TILES; i += chunkSize) {
+        store.compressTileData(tiles.data() + i, qMin(chunkSize, NUM_TILES - i));
+    }
+
+    store.writeCompressedTiles(tiles);
+
+    for(qint32 i = 0; i < NUM_TILES; i++) {
+        KisTileData *td = tiles[i].td;
+        QVERIFY(tiles[i].swappedOut);
+        QVERIFY(!td->data());
+
+        store.swapInTileData(td);
+        QVERIFY(memoryIsFilled(COLUMN2COLOR(i), td->data(), TILESIZE));
+    }
+
+    for(qint32 i = 0; i < NUM_TILES; i++)
+        delete tiles[i].td;
+}
+
 QTEST_MAIN(KisSwappedDataStoreTest)
 
@@ -179,6 +179,58 @@ void KisTileCompressorsTest::testLowLevelRoundTripIncompressible2()
     delete compressor;
 }
 
+void KisTileCompressorsTest::testLowLevelRoundTripCodecs_data()
+{
+    QTest::addColumn<int>("codec");
+
+    Q_FOREACH (KisCompressionFactory::CodecId codec, KisCompressionFactory::availableCodecs()) {
+        QTest::newRow(KisCompressionFactory::name(codec).toLatin1()) << int(codec);
+    }
+}
+
+void KisTileCompressorsTest::testLowLevelRoundTripCodecs()
+{
+    QFETCH(int, codec);
+
+    KisTileCompressor2 compressor(KisCompressionFactory::CodecId(codec));
+    QCOMPARE(int(compressor.codec()), codec);
+
+    doLowLevelRoundTrip(&compressor);
+    doLowLevelRoundTripIncompressible(&compressor);
+}
+
+void KisTileCompressorsTest::testMixedCodecs()
+{
+    const qint32 pixelSize = 1;
+    quint8 oddPixel1 = 128;
+    quint8 oddPixel2 = 129;
+
+    KisTiledDataManager dm(pixelSize, &oddPixel1);
+    KisTileSP tile = dm.getTile(0, 0, true);
+    tile->lockForWrite();
+
+    KisTileData *td = tile->tileData();
+
+    KisTileCompressor2 writer(KisCompressionFactory::ZSTD);
+    KisTileCompressor2 reader(KisCompressionFactory::LZ4);
+
+    qint32 bufferSize = writer.tileDataBufferSize(td);
+    quint8 *buffer = new quint8[bufferSize];
+    qint32 bytesWritten;
+    writer.compressTileData(td, buffer, bufferSize, bytesWritten);
+
+    memset(td->data(), oddPixel2, TILESIZE);
+
+    /**
+     * The data compressed by one codec must be readable by
+     * the compressor configured to use another one
+     */
+    QVERIFY(reader.decompressTileData(buffer, bytesWritten, td));
+    QVERIFY(memoryIsFilled(oddPixel1, td->data(), TILESIZE));
+
+    delete[] buffer;
+    tile->unlock();
+}
 
 QTEST_MAIN(KisTileCompressorsTest)
 
@@ -38,6 +38,10 @@ private Q_SLOTS:
     void testRoundTrip2();
     void testLowLevelRoundTrip2();
     void testLowLevelRoundTripIncompressible2();
+
+    void testLowLevelRoundTripCodecs_data();
+    void testLowLevelRoundTripCodecs();
+    void testMixedCodecs();
 };
 
 #endif /* KIS_TILE_COMPRESSORS_TEST_H */
@@ -111,4 +111,38 @@ void KisTileDataPoolerTest::testCycles()
     KisTileDataStore::instance()->debugClear();
 }
 
+void KisTileDataPoolerTest::testSharedUniformClones()
+{
+    const qint32 pixelSize = 1;
+    const quint8 pixel = 77;
+    const int numUsers = 100;
+
+    KisTileDataStore::instance()->debugClear();
+
+    KisTileData *td = 0;
+
+    for (int i = 0; i < numUsers; i++) {
+        td = KisTileDataStore::instance()->acquireUniformTileData(pixelSize, &pixel);
+    }
+
+    QVERIFY(td->m_sharedUniform);
+    QCOMPARE(td->numUsers(), numUsers + 1);
+
+    {
+        KisTileDataPooler pooler(KisTileDataStore::instance(), 5);
+        pooler.start();
+        pooler.kick();
+        pooler.kick();
+
+        QTest::qSleep(500);
+
+        pooler.terminatePooler();
+    }
+
+    // the shared uniform tile data is prepared for one write only
+    QVERIFY(td->m_clonesStack.size() <= 1);
+
+    KisTileDataStore::instance()->debugClear();
+}
+
 QTEST_MAIN(KisTileDataPoolerTest)
@@ -27,6 +27,7 @@ class KisTileDataPoolerTest : public QObject
 
 private Q_SLOTS:
     void testCycles();
+    void testSharedUniformClones();
 };
 
 #endif /* __KIS_TILE_DATA_POOLER_TEST_H */
@@ -28,6 +28,7 @@
 
 #include "tiles3/kis_tile_data_store.h"
 #include "tiles3/kis_tile_data_store_iterators.h"
+#include "tiles3/kis_tile_data_allocator.h"
 
 
 void KisTileDataStoreTest::testClockIterator()
@@ -188,5 +189,91 @@ void KisTileDataStoreTest::testSwapping()
     }
 }
 
+void KisTileDataStoreTest::testPrefetch()
+{
+    KisTileDataStore *store = KisTileDataStore::instance();
+    store->debugClear();
+
+    const qint32 pixelSize = 1;
+    quint8 defaultPixel = 128;
+    KisTiledDataManager dm(pixelSize, &defaultPixel);
+
+    KisTileSP tile = dm.getTile(0, 0, true);
+    tile->lockForWrite();
+    memset(tile->data(), 42, TILESIZE);
+    tile->unlockForWrite();
+
+    store->debugSwapAll();
+    QVERIFY(!tile->tileData()->data());
+
+    const KisTileDataStore::MemoryStatistics statsBefore = store->memoryStatistics();
+
+    QVERIFY(tile->prefetchData());
+    QVERIFY(tile->tileData()->data());
+
+    // the prefetched data must not be the first candidate for swapping
+    QCOMPARE(tile->tileData()->age(), 0);
+
+    // the data is already in memory
+    QVERIFY(!tile->prefetchData());
+
+    tile->lockForRead();
+    QVERIFY(memoryIsFilled(42, tile->data(), TILESIZE));
+    tile->unlockForRead();
+
+    // the flag is reset on the first access
+    tile->lockForRead();
+    tile->unlockForRead();
+
+    const KisTileDataStore::MemoryStatistics statsAfter = store->memoryStatistics();
+
+    QCOMPARE(statsAfter.prefetchHits - statsBefore.prefetchHits, qint64(1));
+    QCOMPARE(statsAfter.swapInMisses, statsBefore.swapInMisses);
+}
+
+void KisTileDataStoreTest::testAllocatorThreadCache()
+{
+    KisTileDataAllocator *allocator = KisTileDataAllocator::instance();
+
+    const qint32 pixelSize = 16;
+    const int numBuffers = 100;
+
+    QVector<quint8*> buffers;
+
+    for (int i = 0; i < numBuffers; i++) {
+        buffers << allocator->allocate(pixelSize);
+    }
+
+    const KisTileDataAllocator::Statistics statsBefore = allocator->statistics();
+
+    // the overflowing buffers are moved into the arena in batches
+    Q_FOREACH (quint8 *ptr, buffers) {
+        allocator->deallocate(ptr, pixelSize);
+    }
+
+    const KisTileDataAllocator::Statistics statsReleased = allocator->statistics();
+
+    QVERIFY(statsReleased.arenaTransfers > statsBefore.arenaTransfers);
+    QCOMPARE(statsReleased.cachedMemorySize - statsBefore.cachedMemorySize,
+             qint64(numBuffers) * pixelSize * KisTileData::WIDTH * KisTileData::HEIGHT);
+
+    // all the buffers are reused without asking the system
+    QVector<quint8*> reusedBuffers;
+
+    for (int i = 0; i < numBuffers; i++) {
+        reusedBuffers << allocator->allocate(pixelSize);
+    }
+
+    const KisTileDataAllocator::Statistics statsAfter = allocator->statistics();
+
+    QCOMPARE(statsAfter.systemAllocations, statsReleased.systemAllocations);
+    QVERIFY(statsAfter.threadCacheHits > statsReleased.threadCacheHits);
+    QCOMPARE(statsAfter.cachedMemorySize, statsBefore.cachedMemorySize);
+
+    Q_FOREACH (quint8 *ptr, reusedBuffers) {
+        allocator->deallocate(ptr, pixelSize);
+    }
+}
+
 QTEST_MAIN(KisTileDataStoreTest)
 
@@ -0,0 +1,118 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_tile_hash_table_benchmark.h"
+#include <QTest>
+#include <QThreadPool>
+#include <QElapsedTimer>
+
+// picks the hash table implementation in use
+#include "tiles3/kis_tiled_data_manager.h"
+#include "tiles3/kis_tile_data_store.h"
+
+#include "config-limit-long-tests.h"
+
+#ifdef LIMIT_LONG_TESTS
+const int NUM_LOOKUPS_PER_THREAD = 100000;
+#else
+const int NUM_LOOKUPS_PER_THREAD = 1000000;
+#endif
+
+/**
+ * The existing tiles occupy the area of EXISTING_SIZE x EXISTING_SIZE
+ * tiles, the lookups cover twice larger area, so 3/4 of them go
+ * through the default tile path
+ */
+const int EXISTING_SIZE = 32;
+
+class KisTileLookupJob : public QRunnable
+{
+public:
+    KisTileLookupJob(KisTileHashTable &table, int seed)
+        : m_table(table),
+          m_seed(seed)
+    {
+    }
+
+    void run() override {
+        quint32 random = m_seed;
+        bool existingTile = false;
+
+        for (int i = 0; i < NUM_LOOKUPS_PER_THREAD; i++) {
+            // a simple LCG, we don't want to benchmark qrand()
+            random = random * 1103515245 + 12345;
+
+            const int col = (random >> 8) % (2 * EXISTING_SIZE);
+            const int row = (random >> 20) % (2 * EXISTING_SIZE);
+
+            KisTileSP tile = (i & 0x1) ?
+                m_table.getExistingTile(col, row) :
+                m_table.getReadOnlyTileLazy(col, row, existingTile);
+        }
+    }
+
+private:
+    KisTileHashTable &m_table;
+    int m_seed;
+};
+
+void KisTileHashTableBenchmark::benchmarkLookupScaling_data()
+{
+    QTest::addColumn<int>("numThreads");
+
+    for (int numThreads = 1; numThreads <= 64; numThreads *= 2) {
+        QTest::newRow(QString("%1 threads").arg(numThreads).toLatin1()) << numThreads;
+    }
+}
+
+void KisTileHashTableBenchmark::benchmarkLookupScaling()
+{
+    QFETCH(int, numThreads);
+
+    quint8 defaultPixel = 0;
+    KisTileHashTable table(0);
+    table.setDefaultTileData(
+        KisTileDataStore::instance()->createDefaultTileData(1, &defaultPixel));
+
+    bool newTile = false;
+    for (int row = 0; row < EXISTING_SIZE; row++) {
+        for (int col = 0; col < EXISTING_SIZE; col++) {
+            table.getTileLazy(col, row, newTile);
+        }
+    }
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(numThreads);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QBENCHMARK_ONCE {
+        for (int i = 0; i < numThreads; i++) {
+            pool.start(new KisTileLookupJob(table, i + 1));
+        }
+        pool.waitForDone();
+    }
+
+    const qreal seconds = qMax(qint64(1), timer.nsecsElapsed()) / 1e9;
+    const qreal lookupsPerSecond = qreal(numThreads) * NUM_LOOKUPS_PER_THREAD / seconds;
+
+    qDebug() << "Threads:" << numThreads
+             << "Lookups per second:" << qRound64(lookupsPerSecond)
+             << "per thread:" << qRound64(lookupsPerSecond / numThreads);
+}
+
+QTEST_MAIN(KisTileHashTableBenchmark)
@@ -20,6 +20,8 @@
 #include <QTest>
 
 #include "tiles3/kis_tiled_data_manager.h"
+#include "tiles3/kis_tile_data_store.h"
+#include "kis_image_config.h"
 
 #include "tiles_test_utils.h"
 #include "config-limit-long-tests.h"
@@ -539,6 +541,108 @@ void KisTiledDataManagerTest::testUndoSetDefaultPixel()
     QVERIFY(memoryIsFilled(oddPixel2, tile10->data(), TILESIZE));
 }
 
+static void fillTile(KisTiledDataManager &dm, qint32 col, qint32 row, quint8 value)
+{
+    KisTileSP tile = dm.getTile(col, row, true);
+    tile->lockForWrite();
+    memset(tile->data(), value, TILESIZE);
+    tile->unlockForWrite();
+}
+
+void KisTiledDataManagerTest::testDeduplication()
+{
+    KisImageConfig config(false);
+    config.setEnableTileDeduplication(true);
+    KisTileDataStore::instance()->testingRereadConfig();
+
+    quint8 defaultPixel = 0;
+    KisTiledDataManager dm1(1, &defaultPixel);
+    KisTiledDataManager dm2(1, &defaultPixel);
+
+    fillTile(dm1, 0, 0, 42);
+    dm1.commit();
+
+    fillTile(dm2, 3, 5, 42);
+    fillTile(dm2, 4, 5, 43);
+    dm2.commit();
+
+    KisTileSP tile1 = dm1.getTile(0, 0, false);
+    KisTileSP tile2 = dm2.getTile(3, 5, false);
+    KisTileSP tile3 = dm2.getTile(4, 5, false);
+
+    QCOMPARE(tile1->tileData(), tile2->tileData());
+    QVERIFY(tile1->tileData() != tile3->tileData());
+
+    // changing the shared tile should not affect the other one
+    KisMementoSP memento = dm2.getMemento();
+    fillTile(dm2, 3, 5, 44);
+    dm2.commit();
+
+    tile2 = dm2.getTile(3, 5, false);
+    QVERIFY(tile1->tileData() != tile2->tileData());
+
+    tile1->lockForRead();
+    QVERIFY(memoryIsFilled(42, tile1->data(), TILESIZE));
+    tile1->unlockForRead();
+
+    // the undo data still references the deduplicated content
+    dm2.rollback(memento);
+
+    tile2 = dm2.getTile(3, 5, false);
+    tile2->lockForRead();
+    QVERIFY(memoryIsFilled(42, tile2->data(), TILESIZE));
+    tile2->unlockForRead();
+
+    config.setEnableTileDeduplication(false);
+    KisTileDataStore::instance()->testingRereadConfig();
+}
+
+void KisTiledDataManagerTest::testUniformTiles()
+{
+    KisImageConfig config(false);
+    config.setEnableUniformTiles(true);
+    KisTileDataStore::instance()->testingRereadConfig();
+
+    quint8 defaultPixel = 0;
+    KisTiledDataManager dm1(1, &defaultPixel);
+    KisTiledDataManager dm2(1, &defaultPixel);
+
+    quint8 oddPixel1 = 128;
+    QRect rect(0,0,128,128);
+
+    dm1.clear(rect, &oddPixel1);
+    dm2.clear(rect, &oddPixel1);
+
+    // solid color tiles of all the devices share the same data
+    KisTileSP tile1 = dm1.getTile(0, 0, false);
+    KisTileSP tile2 = dm2.getTile(1, 1, false);
+
+    QCOMPARE(tile1->tileData(), tile2->tileData());
+    QVERIFY(tile1->tileData()->isUniform());
+
+    // the first write expands the tile
+    tile2->lockForWrite();
+    QVERIFY(tile1->tileData() != tile2->tileData());
+    QVERIFY(!tile2->tileData()->isUniform());
+    tile2->data()[0] = 129;
+    tile2->unlockForWrite();
+
+    tile1->lockForRead();
+    QVERIFY(memoryIsFilled(oddPixel1, tile1->data(), TILESIZE));
+    tile1->unlockForRead();
+
+    // the tile, which became solid again, is shared on commit
+    KisMementoSP memento = dm2.getMemento();
+    fillTile(dm2, 1, 1, oddPixel1);
+    dm2.commit();
+
+    tile2 = dm2.getTile(1, 1, false);
+    QCOMPARE(tile1->tileData(), tile2->tileData());
+
+    config.setEnableUniformTiles(false);
+    KisTileDataStore::instance()->testingRereadConfig();
+}
+
 //#include <valgrind/callgrind.h>
 
 void KisTiledDataManagerTest::benchmarkReadOnlyTileLazy()
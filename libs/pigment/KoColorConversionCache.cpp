@@ -19,9 +19,12 @@
 
 #include "KoColorConversionCache.h"
 
+#include <QAtomicInt>
 #include <QHash>
 #include <QList>
 #include <QMutex>
+#include <QMutexLocker>
+#include <QSharedPointer>
 #include <QThreadStorage>
 
 #include <KoColorSpace.h>
@@ -40,7 +43,8 @@ struct KoColorConversionCacheKey {
     }
 
     bool operator==(const KoColorConversionCacheKey& rhs) const {
-        return (*src == *(rhs.src)) && (*dst == *(rhs.dst))
+        return (src == rhs.src || *src == *(rhs.src)) &&
+               (dst == rhs.dst || *dst == *(rhs.dst))
                 && (renderingIntent == rhs.renderingIntent)
                 && (conversionFlags == rhs.conversionFlags);
     }
@@ -67,32 +71,162 @@ struct KoColorConversionCache::CachedTransformation {
     }
 
     bool available() {
-        return use == 0;
+        return use.load() == 0;
     }
 
     KoColorConversionTransformation* transfo;
-    int use;
+
+    /**
+     * The transformation is taken and released by the owning thread
+     * only, but the handles of KoCachedColorConversionTransformation
+     * can be copied and destroyed in any thread
+     */
+    QAtomicInt use;
 };
 
-typedef QPair<KoColorConversionCacheKey, KoCachedColorConversionTransformation> FastPathCacheItem;
+typedef QMultiHash<KoColorConversionCacheKey, KoColorConversionCache::CachedTransformation*> TransformationsHash;
 
-struct KoColorConversionCache::Private {
-    QMultiHash< KoColorConversionCacheKey, CachedTransformation*> cache;
-    QMutex cacheMutex;
+/**
+ * A pool of the transformations created by one thread. Only the owning
+ * thread looks up and inserts the transformations, and a transformation
+ * is returned to the pool by decrementing its use counter.
+ *
+ * The mutex of the pool is uncontended on lookup. It is only needed
+ * because the thread that destroys a color space purges the pools of
+ * all the threads at once.
+ */
+struct KoColorConversionCache::ThreadCache {
+    ~ThreadCache();
+
+    void purgeColorSpace(const KoColorSpace *cs);
+
+    QMutex mutex;
+    TransformationsHash cache;
+};
+
+/**
+ * The list of all the pools. It is the only owner of the pools and is
+ * shared between the cache and the thread-local handles, so that the
+ * pool is deleted once, either at the exit of the thread or in the
+ * destructor of the cache, whichever comes first.
+ */
+struct KoColorConversionCache::ThreadCacheList {
+    ~ThreadCacheList() {
+        qDeleteAll(orphanedTransformations);
+    }
+
+    void destroyCache(ThreadCache *threadCache);
 
-    QThreadStorage<FastPathCacheItem*> fastStorage;
+    QMutex mutex; // guards all the members below
+    QList<ThreadCache*> threadCaches;
+
+    /**
+     * The transformations still used by the handles in other threads,
+     * when their pool has already been destroyed
+     */
+    QList<CachedTransformation*> orphanedTransformations;
 };
 
+namespace {
+
+/**
+ * The data stored in QThreadStorage. The pool itself is owned by the
+ * list, the handle only unregisters it at the exit of the thread.
+ */
+struct ThreadCacheHandle {
+    ThreadCacheHandle(QSharedPointer<KoColorConversionCache::ThreadCacheList> _list,
+                      KoColorConversionCache::ThreadCache *_threadCache)
+        : list(_list),
+          threadCache(_threadCache)
+    {
+    }
+
+    ~ThreadCacheHandle() {
+        QMutexLocker l(&list->mutex);
+
+        if (list->threadCaches.removeOne(threadCache)) {
+            list->destroyCache(threadCache);
+        }
+    }
+
+    QSharedPointer<KoColorConversionCache::ThreadCacheList> list;
+    KoColorConversionCache::ThreadCache *threadCache;
+};
+
+}
+
+struct KoColorConversionCache::Private {
+    QThreadStorage<ThreadCacheHandle*> threadCaches;
+    QSharedPointer<ThreadCacheList> list;
+};
+
+KoColorConversionCache::ThreadCache::~ThreadCache()
+{
+    qDeleteAll(cache);
+}
+
+void KoColorConversionCache::ThreadCache::purgeColorSpace(const KoColorSpace *cs)
+{
+    QMutexLocker l(&mutex);
+
+    for (TransformationsHash::iterator it = cache.begin(); it != cache.end();) {
+        if (it.key().src == cs || it.key().dst == cs) {
+            Q_ASSERT(it.value()->available()); // That's terribely evil, if that assert fails, that means that someone is using a color transformation with a color space which is currently being deleted
+            delete it.value();
+            it = cache.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void KoColorConversionCache::ThreadCacheList::destroyCache(ThreadCache *threadCache)
+{
+    /**
+     * The handle of a transformation might still be alive in another
+     * thread, so such transformations are kept alive until the list
+     * itself is destroyed
+     */
+    for (TransformationsHash::iterator it = threadCache->cache.begin(); it != threadCache->cache.end();) {
+        if (!it.value()->available()) {
+            orphanedTransformations.append(it.value());
+            it = threadCache->cache.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    delete threadCache;
+}
+
 
 KoColorConversionCache::KoColorConversionCache() : d(new Private)
 {
+    d->list.reset(new ThreadCacheList());
 }
 
 KoColorConversionCache::~KoColorConversionCache()
 {
-    Q_FOREACH (CachedTransformation* transfo, d->cache) {
-        delete transfo;
+    d->threadCaches.setLocalData(0);
+
+    /**
+     * QThreadStorage doesn't delete the data of the other threads, and
+     * they may exit concurrently with us, so all the pools are taken
+     * from the list here. The handles of the exiting threads will not
+     * find their pools in the list anymore.
+     */
+    {
+        QMutexLocker l(&d->list->mutex);
+
+        Q_FOREACH (ThreadCache *threadCache, d->list->threadCaches) {
+            d->list->destroyCache(threadCache);
+        }
+        d->list->threadCaches.clear();
+
+        qDeleteAll(d->list->orphanedTransformations);
+        d->list->orphanedTransformations.clear();
     }
+
     delete d;
 }
 
@@ -103,55 +237,64 @@ KoCachedColorConversionTransformation KoColorConversionCache::cachedConverter(co
 {
     KoColorConversionCacheKey key(src, dst, _renderingIntent, _conversionFlags);
 
-    FastPathCacheItem *cacheItem =
-        d->fastStorage.localData();
+    ThreadCacheHandle *handle = d->threadCaches.localData();
 
-    if (cacheItem) {
-        if (cacheItem->first == key) {
-            return cacheItem->second;
+    if (!handle) {
+        handle = new ThreadCacheHandle(d->list, new ThreadCache());
+
+        {
+            QMutexLocker l(&d->list->mutex);
+            d->list->threadCaches.append(handle->threadCache);
         }
+
+        d->threadCaches.setLocalData(handle);
     }
 
-    cacheItem = 0;
+    ThreadCache *threadCache = handle->threadCache;
+
+    {
+        QMutexLocker l(&threadCache->mutex);
+
+        for (TransformationsHash::iterator it = threadCache->cache.find(key);
+             it != threadCache->cache.end() && it.key() == key; ++it) {
+
+            CachedTransformation* ct = it.value();
 
-    QMutexLocker lock(&d->cacheMutex);
-    QList< CachedTransformation* > cachedTransfos = d->cache.values(key);
-    if (cachedTransfos.size() != 0) {
-        Q_FOREACH (CachedTransformation* ct, cachedTransfos) {
             if (ct->available()) {
                 ct->transfo->setSrcColorSpace(src);
                 ct->transfo->setDstColorSpace(dst);
 
-                cacheItem = new FastPathCacheItem(key, KoCachedColorConversionTransformation(this, ct));
-                break;
+                return KoCachedColorConversionTransformation(this, ct);
             }
         }
     }
-    if (!cacheItem) {
-        KoColorConversionTransformation* transfo = src->createColorConverter(dst, _renderingIntent, _conversionFlags);
-        CachedTransformation* ct = new CachedTransformation(transfo);
-        d->cache.insert(key, ct);
-        cacheItem = new FastPathCacheItem(key, KoCachedColorConversionTransformation(this, ct));
-    }
 
-    d->fastStorage.setLocalData(cacheItem);
-    return cacheItem->second;
+    /**
+     * The transformation is created without holding the lock, because
+     * its creation may destroy temporary color spaces, which purges
+     * the pools
+     */
+    KoColorConversionTransformation* transfo = src->createColorConverter(dst, _renderingIntent, _conversionFlags);
+    CachedTransformation* ct = new CachedTransformation(transfo);
+
+    QMutexLocker l(&threadCache->mutex);
+    threadCache->cache.insert(key, ct);
+
+    return KoCachedColorConversionTransformation(this, ct);
 }
 
 void KoColorConversionCache::colorSpaceIsDestroyed(const KoColorSpace* cs)
 {
-    d->fastStorage.setLocalData(0);
-
-    QMutexLocker lock(&d->cacheMutex);
-    QMultiHash< KoColorConversionCacheKey, CachedTransformation*>::iterator endIt = d->cache.end();
-    for (QMultiHash< KoColorConversionCacheKey, CachedTransformation*>::iterator it = d->cache.begin(); it != endIt;) {
-        if (it.key().src == cs || it.key().dst == cs) {
-            Q_ASSERT(it.value()->available()); // That's terribely evil, if that assert fails, that means that someone is using a color transformation with a color space which is currently being deleted
-            delete it.value();
-            it = d->cache.erase(it);
-        } else {
-            ++it;
-        }
+    /**
+     * The lookups in the pools are short, so the pools of all the
+     * threads are purged right here, otherwise the transformations
+     * would stay alive in the threads that don't convert anything
+     * anymore
+     */
+    QMutexLocker l(&d->list->mutex);
+
+    Q_FOREACH (ThreadCache *threadCache, d->list->threadCaches) {
+        threadCache->purgeColorSpace(cs);
     }
 }
 
@@ -168,18 +311,18 @@ KoCachedColorConversionTransformation::KoCachedColorConversionTransformation(KoC
     Q_ASSERT(transfo->available());
     d->cache = cache;
     d->transfo = transfo;
-    d->transfo->use++;
+    d->transfo->use.ref();
 }
 
 KoCachedColorConversionTransformation::KoCachedColorConversionTransformation(const KoCachedColorConversionTransformation& rhs) : d(new Private(*rhs.d))
 {
-    d->transfo->use++;
+    d->transfo->use.ref();
 }
 
 KoCachedColorConversionTransformation::~KoCachedColorConversionTransformation()
 {
-    d->transfo->use--;
-    Q_ASSERT(d->transfo->use >= 0);
+    d->transfo->use.deref();
+    Q_ASSERT(d->transfo->use.load() >= 0);
     delete d;
 }
 
@@ -187,4 +330,3 @@ const KoColorConversionTransformation* KoCachedColorConversionTransformation::tr
 {
     return d->transfo->transfo;
 }
-
@@ -28,12 +28,18 @@ class KoColorSpace;
 /**
  * This class holds a cache of KoColorConversionTransformations.
  *
+ * Every thread has its own pool of the transformations, so the
+ * transformations are taken from the cache and returned to it without
+ * any global locking.
+ *
  * This class is not part of public API, and can be changed without notice.
  */
 class KoColorConversionCache
 {
 public:
     struct CachedTransformation;
+    struct ThreadCache;
+    struct ThreadCacheList;
 public:
     KoColorConversionCache();
     ~KoColorConversionCache();
@@ -40,6 +40,9 @@ KoColorConversionSystem::~KoColorConversionSystem()
 {
     qDeleteAll(d->graph);
     qDeleteAll(d->vertexes);
+    Q_FOREACH (const QList<KoColorConversionTransformationFactory*> &links, d->profileIndependentLinks) {
+        qDeleteAll(links);
+    }
     delete d;
 }
 
@@ -107,6 +110,10 @@ void KoColorConversionSystem::insertColorSpace(const KoColorSpaceFactory* csf)
     // Construct a link for "custom" transformation
     const QList<KoColorConversionTransformationFactory*> cctfs = csf->colorConversionLinks();
     Q_FOREACH (KoColorConversionTransformationFactory* cctf, cctfs) {
+        if (cctf->srcProfile().isEmpty() && cctf->dstProfile().isEmpty()) {
+            d->profileIndependentLinks[csf->id()].append(cctf);
+            continue;
+        }
         Node* srcNode = nodeFor(cctf->srcColorModelId(), cctf->srcColorDepthId(), cctf->srcProfile());
         Q_ASSERT(srcNode);
         Node* dstNode = nodeFor(cctf->dstColorModelId(), cctf->dstColorDepthId(), cctf->dstProfile());
@@ -125,6 +132,24 @@ void KoColorConversionSystem::insertColorSpace(const KoColorSpaceFactory* csf)
             v->setFactoryFromSrc(cctf);
         }
     }
+    Q_FOREACH (const KoColorProfile* profile, profiles) {
+        connectProfileIndependentLinks(csf, profile->name());
+    }
+}
+
+void KoColorConversionSystem::connectProfileIndependentLinks(const KoColorSpaceFactory* csf, const QString& profileName)
+{
+    // The links without profile names connect the nodes of the same
+    // profile, the vertexes share the factory owned by the system
+    Q_FOREACH (KoColorConversionTransformationFactory* cctf, d->profileIndependentLinks.value(csf->id())) {
+        Node* srcNode = nodeFor(cctf->srcColorModelId(), cctf->srcColorDepthId(), profileName);
+        Node* dstNode = nodeFor(cctf->dstColorModelId(), cctf->dstColorDepthId(), profileName);
+        Vertex* v = vertexBetween(srcNode, dstNode);
+        if (!v) {
+            v = createVertex(srcNode, dstNode);
+        }
+        v->setSharedFactory(cctf);
+    }
 }
 
 void KoColorConversionSystem::insertColorProfile(const KoColorProfile* _profile)
@@ -148,6 +173,11 @@ void KoColorConversionSystem::insertColorProfile(const KoColorProfile* _profile)
         }
         const QList<KoColorConversionTransformationFactory*> cctfs = factory->colorConversionLinks();
         Q_FOREACH (KoColorConversionTransformationFactory* cctf, cctfs) {
+            if (cctf->srcProfile().isEmpty() && cctf->dstProfile().isEmpty()) {
+                // already registered in insertColorSpace()
+                delete cctf;
+                continue;
+            }
             Node* srcNode = nodeFor(cctf->srcColorModelId(), cctf->srcColorDepthId(), cctf->srcProfile());
             Q_ASSERT(srcNode);
             Node* dstNode = nodeFor(cctf->dstColorModelId(), cctf->dstColorDepthId(), cctf->dstProfile());
@@ -168,6 +198,7 @@ void KoColorConversionSystem::insertColorProfile(const KoColorProfile* _profile)
                 }
             }
         }
+        connectProfileIndependentLinks(factory, _profile->name());
     }
 }
 
@@ -140,6 +140,11 @@ private:
      * Initialise a node for ICC color spaces
      */
     void connectToEngine(Node* _node, Node* _engine);
+    /**
+     * Connect the nodes of \p profileName with the profile-independent
+     * links provided by the color space factory \p csf
+     */
+    void connectProfileIndependentLinks(const KoColorSpaceFactory* csf, const QString& profileName);
     const Node* nodeFor(const KoColorSpace*) const;
     /**
      * @return the node corresponding to that key, or create it if needed
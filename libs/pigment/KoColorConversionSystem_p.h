@@ -91,7 +91,8 @@ struct KoColorConversionSystem::Vertex {
         : srcNode(_srcNode)
         , dstNode(_dstNode)
         , factoryFromSrc(0)
-        , factoryFromDst(0) {
+        , factoryFromDst(0)
+        , sharedFactory(0) {
     }
 
     ~Vertex() {
@@ -113,6 +114,15 @@ struct KoColorConversionSystem::Vertex {
         if (!factoryFromSrc) initParameter(factoryFromDst);
     }
 
+    /**
+     * Set a factory that is not owned by the vertex, it is used only
+     * when neither of the nodes provides its own factory
+     */
+    void setSharedFactory(KoColorConversionTransformationFactory* factory) {
+        sharedFactory = factory;
+        if (!factoryFromSrc && !factoryFromDst) initParameter(sharedFactory);
+    }
+
     void initParameter(KoColorConversionTransformationFactory* transfo) {
         conserveColorInformation = transfo->conserveColorInformation();
         conserveDynamicRange = transfo->conserveDynamicRange();
@@ -120,7 +130,8 @@ struct KoColorConversionSystem::Vertex {
 
     KoColorConversionTransformationFactory* factory() {
         if (factoryFromSrc) return factoryFromSrc;
-        return factoryFromDst;
+        if (factoryFromDst) return factoryFromDst;
+        return sharedFactory;
     }
 
     Node* srcNode;
@@ -133,6 +144,7 @@ private:
 
     KoColorConversionTransformationFactory* factoryFromSrc; // Factory provided by the destination node
     KoColorConversionTransformationFactory* factoryFromDst; // Factory provided by the destination node
+    KoColorConversionTransformationFactory* sharedFactory; // Profile-independent factory, owned by the system
 
 };
 
@@ -280,6 +292,7 @@ struct Q_DECL_HIDDEN KoColorConversionSystem::Private {
 
     QHash<NodeKey, Node*> graph;
     QList<Vertex*> vertexes;
+    QHash<QString, QList<KoColorConversionTransformationFactory*>> profileIndependentLinks;
     RegistryInterface *registryInterface;
 };
 
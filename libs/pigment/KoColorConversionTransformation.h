@@ -59,7 +59,8 @@ public:
         NoWhiteOnWhiteFixup     = 0x0004,    // Don't fix scum dot
         HighQuality             = 0x0400,    // Use more memory to give better accuracy
         LowQuality              = 0x0800,    // Use less memory to minimize resources
-        CopyAlpha               = 0x04000000 //Let LCMS handle the alpha. Should always be on.
+        CopyAlpha               = 0x04000000, //Let LCMS handle the alpha. Should always be on.
+        UseLut3D                = 0x08000000  // Bake the transformation into a 3D LUT if the engine supports that. Not passed to LCMS.
     };
     Q_DECLARE_FLAGS(ConversionFlags, ConversionFlag)
 
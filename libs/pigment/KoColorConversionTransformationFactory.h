@@ -43,6 +43,9 @@ public:
      * @param _dstDepthId id for the destination depth
      * @param _srcProfile name of the source profile, or empty if any profile
      * @param _dstProfile name of the destination profile, or empty if any profile
+     *
+     * If both profile names are empty, the conversion system uses the
+     * factory to connect the colorspaces that share the same profile.
      */
     KoColorConversionTransformationFactory(const QString &_srcModelId, const QString &_srcDepthId, const QString &_srcProfile, const QString &_dstModelId, const QString &_dstDepthId, const QString &_dstProfile);
     ~KoColorConversionTransformationFactory() override;
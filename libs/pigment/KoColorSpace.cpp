@@ -512,6 +512,26 @@ void KoColorSpace::bitBlt(const KoColorSpace* srcSpace, const KoCompositeOp::Par
     }
 }
 
+void KoColorSpace::bitBlt(const KoColorSpace* srcSpace, const KoCompositeOp::ParameterInfo& params,
+                          const QVector<KoCompositeOp::Span> &spans, const KoCompositeOp* op,
+                          KoColorConversionTransformation::Intent renderingIntent,
+                          KoColorConversionTransformation::ConversionFlags conversionFlags) const
+{
+    Q_ASSERT_X(*op->colorSpace() == *this, "KoColorSpace::bitBlt", QString("Composite op is for color space %1 (%2) while this is %3 (%4)").arg(op->colorSpace()->id()).arg(op->colorSpace()->profile()->name()).arg(id()).arg(profile()->name()).toLatin1());
+
+    if (spans.isEmpty()) return;
+
+    if (*this == *srcSpace) {
+        op->compositeSpans(params, spans);
+    } else {
+        KoCompositeOp::ParameterInfo spanParams(params);
+
+        for (auto it = spans.constBegin(); it != spans.constEnd(); ++it) {
+            spanParams.setSpan(*it);
+            bitBlt(srcSpace, spanParams, op, renderingIntent, conversionFlags);
+        }
+    }
+}
 
 QVector<quint8> * KoColorSpace::threadLocalConversionCache(quint32 size) const
 {
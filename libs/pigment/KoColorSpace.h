@@ -625,6 +625,18 @@ public:
                         KoColorConversionTransformation::Intent renderingIntent,
                         KoColorConversionTransformation::ConversionFlags conversionFlags) const;
 
+    /**
+     * The same as above, but composites a batch of \p spans in one call.
+     * The pixel data of \p params is ignored, all the spans share the
+     * rest of its parameters. When the source and destination color
+     * spaces are the same, the whole batch is passed to
+     * KoCompositeOp::compositeSpans().
+     */
+    virtual void bitBlt(const KoColorSpace* srcSpace, const KoCompositeOp::ParameterInfo& params,
+                        const QVector<KoCompositeOp::Span> &spans, const KoCompositeOp* op,
+                        KoColorConversionTransformation::Intent renderingIntent,
+                        KoColorConversionTransformation::ConversionFlags conversionFlags) const;
+
     /**
      * Serialize this color following Create's swatch color specification available
      * at https://web.archive.org/web/20110826002520/http://create.freedesktop.org/wiki/Swatches_-_colour_file_format/Draft
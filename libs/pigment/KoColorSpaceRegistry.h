@@ -388,6 +388,7 @@ private:
     friend class KoColorSpacesBenchmark;
     friend class TestKoColorSpaceSanity;
     friend class TestColorConversionSystem;
+    friend class TestLcmsRGBP2020PQColorSpace;
     friend struct FriendOfColorSpaceRegistry;
 
     /**
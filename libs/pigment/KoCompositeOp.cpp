@@ -169,6 +169,15 @@ void KoCompositeOp::composite(const KoCompositeOp::ParameterInfo& params) const
               scale<quint8>(params.opacity), params.channelFlags );
 }
 
+void KoCompositeOp::compositeSpans(const ParameterInfo& params, const QVector<Span> &spans) const
+{
+    ParameterInfo spanParams(params);
+
+    for (auto it = spans.constBegin(); it != spans.constEnd(); ++it) {
+        spanParams.setSpan(*it);
+        composite(spanParams);
+    }
+}
 
 QString KoCompositeOp::category() const
 {
@@ -24,6 +24,7 @@
 #include <QList>
 #include <QMultiMap>
 #include <QBitArray>
+#include <QVector>
 
 #include <boost/optional.hpp>
 
@@ -55,6 +56,23 @@ public:
     static QString categoryMisc();    
     static QString categoryQuadratic();
 
+    /**
+     * A rectangular chunk of pixels passed to compositeSpans(). The
+     * fields have the same meaning as the corresponding fields of
+     * ParameterInfo.
+     */
+    struct Span
+    {
+        quint8*       dstRowStart {0};
+        qint32        dstRowStride {0};
+        const quint8* srcRowStart {0};
+        qint32        srcRowStride {0};
+        const quint8* maskRowStart {0};
+        qint32        maskRowStride {0};
+        qint32        rows {0};
+        qint32        cols {0};
+    };
+
     struct KRITAPIGMENT_EXPORT ParameterInfo
     {
         ParameterInfo();
@@ -78,6 +96,21 @@ public:
         void setOpacityAndAverage(float _opacity, float _averageOpacity);
 
         void updateOpacityAndAverage(float value);
+
+        /**
+         * Sets the pixel data pointers, strides and size of the
+         * parameters to the ones of \p span
+         */
+        inline void setSpan(const Span &span) {
+            dstRowStart = span.dstRowStart;
+            dstRowStride = span.dstRowStride;
+            srcRowStart = span.srcRowStart;
+            srcRowStride = span.srcRowStride;
+            maskRowStart = span.maskRowStart;
+            maskRowStride = span.maskRowStride;
+            rows = span.rows;
+            cols = span.cols;
+        }
     private:
         inline void copy(const ParameterInfo &rhs);
     };
@@ -142,6 +175,18 @@ public:
     */
     virtual void composite(const ParameterInfo& params) const;
 
+    /**
+     * Composites a batch of pixel chunks (e.g. the parts of the tiles
+     * covered by a dab) in one call. The pixel data of \p params is
+     * ignored, all the other parameters (opacity, flow, channel
+     * flags) are shared by all the \p spans.
+     *
+     * The default implementation calls composite() for every span.
+     * The ops reimplement it to do their per-call checks only once
+     * per batch.
+     */
+    virtual void compositeSpans(const ParameterInfo& params, const QVector<Span> &spans) const;
+
 private:
     KoCompositeOp();
     struct Private;
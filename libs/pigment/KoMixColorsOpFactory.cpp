@@ -0,0 +1,50 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KoMixColorsOpFactory.h"
+
+#include <KoColorModelStandardIdsUtils.h>
+
+#include "KoMixColorsOpFactoryImpl.h"
+
+template <typename channels_type>
+struct CreateMixColorsOp
+{
+    KoMixColorsOp *operator() (int numChannels, int alphaPos) {
+        if (numChannels == 4 && alphaPos == 3) {
+            return createOptimizedClass<
+                    KoMixColorsOpFactoryImpl<
+                        channels_type, 4, 3>>(0);
+        }
+
+        return 0;
+    }
+};
+
+#ifdef HAVE_OPENEXR
+template <>
+struct CreateMixColorsOp<half>
+{
+    KoMixColorsOp *operator() (int, int) {
+        return 0;
+    }
+};
+#endif
+
+KoMixColorsOp *KoMixColorsOpFactory::createOptimized(KoID depthId, int numChannels, int alphaPos)
+{
+    return channelTypeForColorDepthId<CreateMixColorsOp>(depthId, numChannels, alphaPos);
+}
@@ -0,0 +1,36 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KOMIXCOLORSOPFACTORY_H
+#define KOMIXCOLORSOPFACTORY_H
+
+#include "kritapigment_export.h"
+
+#include <KoID.h>
+
+class KoMixColorsOp;
+
+class KRITAPIGMENT_EXPORT KoMixColorsOpFactory
+{
+public:
+    /**
+     * \return a vectorized mix colors op for the pixel layout or null if
+     * there is no optimized version for it
+     */
+    static KoMixColorsOp* createOptimized(KoID depthId, int numChannels, int alphaPos);
+};
+
+#endif // KOMIXCOLORSOPFACTORY_H
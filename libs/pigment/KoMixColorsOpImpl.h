@@ -63,7 +63,7 @@ public:
         mixColorsImpl(PointerToArray(colors, _CSTrait::pixelSize), NoWeightsSurrogate(nColors), nColors, dst);
     }
 
-private:
+protected:
     struct ArrayOfPointers {
         ArrayOfPointers(const quint8 * const* colors)
             : m_colors(colors)
@@ -184,9 +184,20 @@ private:
             weightsWrapper.nextPixel();
         }
 
-        // set totalAlpha to the minimum between its value and the unit value of the channels
-        const typename KoColorSpaceMathsTraits<typename _CSTrait::channels_type>::compositetype sumOfWeights = weightsWrapper.normalizeFactor();
+        writeMixedColor(totals, totalAlpha, weightsWrapper.normalizeFactor(), dst);
+    }
 
+    /**
+     * Divides the accumulated channels by the accumulated alpha and
+     * writes the result into \p dst. The value of the alpha channel
+     * in \p totals is ignored.
+     */
+    static void writeMixedColor(const typename KoColorSpaceMathsTraits<typename _CSTrait::channels_type>::compositetype *totals,
+                                typename KoColorSpaceMathsTraits<typename _CSTrait::channels_type>::compositetype totalAlpha,
+                                const typename KoColorSpaceMathsTraits<typename _CSTrait::channels_type>::compositetype sumOfWeights,
+                                quint8 *dst) {
+
+        // set totalAlpha to the minimum between its value and the unit value of the channels
         if (totalAlpha > KoColorSpaceMathsTraits<typename _CSTrait::channels_type>::unitValue * sumOfWeights) {
             totalAlpha = KoColorSpaceMathsTraits<typename _CSTrait::channels_type>::unitValue * sumOfWeights;
         }
@@ -0,0 +1,201 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KOOPTIMIZEDMIXCOLORSOP_H
+#define KOOPTIMIZEDMIXCOLORSOP_H
+
+#include "KoMixColorsOpImpl.h"
+#include "KoColorSpaceTraits.h"
+#include "KoVcMultiArchBuildSupport.h"
+
+#include <algorithm>
+
+
+template<typename _channels_type_,
+         int _channels_nb_,
+         int _alpha_pos_,
+         Vc::Implementation _impl,
+         typename EnableDummyType = void>
+struct KoOptimizedMixColorsOp
+    : public KoMixColorsOpImpl<KoColorSpaceTrait<_channels_type_, _channels_nb_, _alpha_pos_>>
+{
+};
+
+#ifdef HAVE_VC
+
+/**
+ * A vectorized version of KoMixColorsOpImpl for pixels with four
+ * channels and the alpha channel placed last. The math of the mixing
+ * doesn't depend on the meaning of the color channels, so the op is
+ * used for all such colorspaces: RGBA, Lab, XYZ and so on.
+ *
+ * Every pixel occupies four lanes of a vector, so the whole vector
+ * accumulates Vc::float_v::size() / 4 pixels per instruction. The
+ * channels of a run of pixels are fetched with one converting load
+ * straight from the source array, only the weights are prepared per
+ * pixel. The alpha lane accumulates the sum of the weights.
+ *
+ * The products are accumulated in int32 for 8-bit pixels, exactly as
+ * KoMixColorsOpImpl does, and in double for 16-bit and float ones.
+ * Double keeps the products of 16-bit values exact, so the result of
+ * the integer colorspaces is identical to the scalar version.
+ */
+template<typename _channels_type_, Vc::Implementation _impl>
+struct KoOptimizedMixColorsOp<
+        _channels_type_, 4, 3, _impl,
+        typename std::enable_if<_impl != Vc::ScalarImpl>::type>
+    : public KoMixColorsOpImpl<KoColorSpaceTrait<_channels_type_, 4, 3>>
+{
+    typedef KoColorSpaceTrait<_channels_type_, 4, 3> Trait;
+    typedef KoMixColorsOpImpl<Trait> BaseClass;
+    typedef typename KoColorSpaceMathsTraits<_channels_type_>::compositetype compositetype;
+
+    typedef typename std::conditional<std::is_same<_channels_type_, quint8>::value,
+                                      qint32, double>::type accumulator_type;
+
+    static constexpr int numLanes = Vc::float_v::size();
+    static constexpr int pixelsPerVector = numLanes / 4;
+
+    using accumulator_v = Vc::SimdArray<accumulator_type, numLanes>;
+
+    static_assert(numLanes % 4 == 0, "a vector should fit a whole number of pixels");
+
+    void mixColors(const quint8 * const* colors, const qint16 *weights, quint32 nColors, quint8 *dst, int weightSum = 255) const override {
+        mixColorsVectorImpl(typename BaseClass::ArrayOfPointers(colors),
+                            typename BaseClass::WeightsWrapper(weights, weightSum),
+                            nColors, dst);
+    }
+
+    void mixColors(const quint8 *colors, const qint16 *weights, quint32 nColors, quint8 *dst, int weightSum = 255) const override {
+        mixColorsVectorImpl(typename BaseClass::PointerToArray(colors, Trait::pixelSize),
+                            typename BaseClass::WeightsWrapper(weights, weightSum),
+                            nColors, dst);
+    }
+
+    void mixColors(const quint8 * const* colors, quint32 nColors, quint8 *dst) const override {
+        mixColorsVectorImpl(typename BaseClass::ArrayOfPointers(colors),
+                            typename BaseClass::NoWeightsSurrogate(nColors),
+                            nColors, dst);
+    }
+
+    void mixColors(const quint8 *colors, quint32 nColors, quint8 *dst) const override {
+        mixColorsVectorImpl(typename BaseClass::PointerToArray(colors, Trait::pixelSize),
+                            typename BaseClass::NoWeightsSurrogate(nColors),
+                            nColors, dst);
+    }
+
+private:
+    /**
+     * Returns the channels of the next \p numPixels pixels of \p source
+     * as one contiguous array of numLanes values. The pixels of an array
+     * source are used in place when they fill the whole vector.
+     */
+    static inline const _channels_type_* fetchPixels(typename BaseClass::PointerToArray &source,
+                                                     quint32 numPixels,
+                                                     _channels_type_ *buffer) {
+
+        const _channels_type_ *pixels = Trait::nativeArray(source.getPixel());
+
+        if (numPixels < quint32(pixelsPerVector)) {
+            std::fill(buffer, buffer + numLanes, _channels_type_(0));
+            std::copy(pixels, pixels + 4 * numPixels, buffer);
+            pixels = buffer;
+        }
+
+        for (quint32 i = 0; i < numPixels; i++) {
+            source.nextPixel();
+        }
+
+        return pixels;
+    }
+
+    template<class AbstractSource>
+    static inline const _channels_type_* fetchPixels(AbstractSource &source,
+                                                     quint32 numPixels,
+                                                     _channels_type_ *buffer) {
+
+        if (numPixels < quint32(pixelsPerVector)) {
+            std::fill(buffer, buffer + numLanes, _channels_type_(0));
+        }
+
+        for (quint32 i = 0; i < numPixels; i++) {
+            memcpy(buffer + 4 * i, source.getPixel(), Trait::pixelSize);
+            source.nextPixel();
+        }
+
+        return buffer;
+    }
+
+    template<class AbstractSource, class AbstractWeights>
+    void mixColorsVectorImpl(AbstractSource source, AbstractWeights weightsWrapper, quint32 nColors, quint8 *dst) const {
+        /**
+         * The color channels are multiplied by the weight, the alpha
+         * lanes are replaced with 1 to accumulate the sum of the weights
+         */
+        accumulator_type colorLanesData[numLanes];
+        accumulator_type alphaLanesData[numLanes];
+
+        for (int i = 0; i < numLanes; i++) {
+            colorLanesData[i] = i % 4 != 3;
+            alphaLanesData[i] = i % 4 == 3;
+        }
+
+        const accumulator_v colorLanes(colorLanesData, Vc::Unaligned);
+        const accumulator_v alphaLanes(alphaLanesData, Vc::Unaligned);
+
+        accumulator_v totals(Vc::Zero);
+
+        _channels_type_ buffer[numLanes];
+        accumulator_type weights[numLanes];
+
+        while (nColors) {
+            const quint32 numPixels = qMin(quint32(pixelsPerVector), nColors);
+            const _channels_type_ *pixels = fetchPixels(source, numPixels, buffer);
+
+            for (int i = 0; i < pixelsPerVector; i++) {
+                accumulator_type *w = weights + 4 * i;
+
+                if (quint32(i) < numPixels) {
+                    compositetype alphaTimesWeight = pixels[4 * i + 3];
+                    weightsWrapper.premultiplyAlphaWithWeight(alphaTimesWeight);
+                    weightsWrapper.nextPixel();
+
+                    w[0] = w[1] = w[2] = w[3] = alphaTimesWeight;
+                } else {
+                    w[0] = w[1] = w[2] = w[3] = 0;
+                }
+            }
+
+            // the channels are converted into the accumulator type by the load itself
+            const accumulator_v colors(pixels, Vc::Unaligned);
+
+            totals += (colors * colorLanes + alphaLanes) * accumulator_v(weights, Vc::Unaligned);
+            nColors -= numPixels;
+        }
+
+        compositetype channelTotals[4] = {0, 0, 0, 0};
+
+        for (int i = 0; i < numLanes; i++) {
+            channelTotals[i % 4] += compositetype(totals[i]);
+        }
+
+        BaseClass::writeMixedColor(channelTotals, channelTotals[3], weightsWrapper.normalizeFactor(), dst);
+    }
+};
+
+#endif /* HAVE_VC */
+
+#endif // KOOPTIMIZEDMIXCOLORSOP_H
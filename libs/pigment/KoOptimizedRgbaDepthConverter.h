@@ -0,0 +1,200 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KOOPTIMIZEDRGBADEPTHCONVERTER_H
+#define KOOPTIMIZEDRGBADEPTHCONVERTER_H
+
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+#include <KoConfig.h>
+#include "KoRgbaDepthConverter.h"
+#include "KoColorSpaceMaths.h"
+#include "KoVcMultiArchBuildSupport.h"
+
+#ifdef HAVE_OPENEXR
+#include "KoF16Conversion.h"
+#endif
+
+/**
+ * Loads the channel values into normalized floats and stores them
+ * back. The generic version uses the scalar math of KoColorSpaceMaths,
+ * the vectorized ones give the same results.
+ */
+template<typename channel_type,
+         Vc::Implementation _impl,
+         typename EnableDummyType = void>
+struct KoRgbaDepthConverterChannels
+{
+    static inline void toFloat(const channel_type *src, float *dst, int numValues) {
+        for (int i = 0; i < numValues; i++) {
+            dst[i] = KoColorSpaceMaths<channel_type, float>::scaleToA(src[i]);
+        }
+    }
+
+    static inline void fromFloat(const float *src, channel_type *dst, int numValues) {
+        for (int i = 0; i < numValues; i++) {
+            dst[i] = KoColorSpaceMaths<float, channel_type>::scaleToA(src[i]);
+        }
+    }
+};
+
+#ifdef HAVE_VC
+
+/**
+ * 8- and 16-bit integer channels are converted with the clamping and
+ * rounding of KoColorSpaceMaths<float, channel_type>
+ */
+template<typename channel_type, Vc::Implementation _impl>
+struct KoRgbaDepthConverterChannels<
+        channel_type, _impl,
+        typename std::enable_if<_impl != Vc::ScalarImpl &&
+                                std::is_integral<channel_type>::value>::type>
+{
+    using int_v = Vc::SimdArray<int, Vc::float_v::size()>;
+    using ScalarChannels = KoRgbaDepthConverterChannels<channel_type, Vc::ScalarImpl>;
+
+    static inline void toFloat(const channel_type *src, float *dst, int numValues) {
+        const Vc::float_v unitValue(float(KoColorSpaceMathsTraits<channel_type>::unitValue));
+
+        int i = 0;
+        for (; i + int(Vc::float_v::size()) <= numValues; i += Vc::float_v::size()) {
+            const int_v values(src + i, Vc::Unaligned);
+            const Vc::float_v result = Vc::simd_cast<Vc::float_v>(values) / unitValue;
+            result.store(dst + i, Vc::Unaligned);
+        }
+
+        ScalarChannels::toFloat(src + i, dst + i, numValues - i);
+    }
+
+    static inline void fromFloat(const float *src, channel_type *dst, int numValues) {
+        const Vc::float_v unitValue(float(KoColorSpaceMathsTraits<channel_type>::unitValue));
+        const Vc::float_v zeroValue(Vc::Zero);
+
+        int i = 0;
+        for (; i + int(Vc::float_v::size()) <= numValues; i += Vc::float_v::size()) {
+            Vc::float_v value(src + i, Vc::Unaligned);
+            value = Vc::min(Vc::max(value * unitValue, zeroValue), unitValue);
+
+            const int_v result(Vc::round(value));
+            result.store(dst + i, Vc::Unaligned);
+        }
+
+        ScalarChannels::fromFloat(src + i, dst + i, numValues - i);
+    }
+};
+
+template<Vc::Implementation _impl>
+struct KoRgbaDepthConverterChannels<
+        float, _impl,
+        typename std::enable_if<_impl != Vc::ScalarImpl>::type>
+{
+    static inline void toFloat(const float *src, float *dst, int numValues) {
+        memcpy(dst, src, numValues * sizeof(float));
+    }
+
+    static inline void fromFloat(const float *src, float *dst, int numValues) {
+        memcpy(dst, src, numValues * sizeof(float));
+    }
+};
+
+#ifdef HAVE_OPENEXR
+
+/**
+ * Half-float channels use F16C instructions when the converter is
+ * built for AVX and the CPU supports them, \see KoOptimizedCompositeOpF16Wrapper
+ */
+template<Vc::Implementation _impl>
+struct KoRgbaDepthConverterChannels<
+        half, _impl,
+        typename std::enable_if<_impl != Vc::ScalarImpl>::type>
+{
+    static inline bool useF16C() {
+        return (_impl == Vc::AVXImpl || _impl == Vc::AVX2Impl) &&
+            KoF16Conversion::isF16CSupported();
+    }
+
+    static inline void toFloat(const half *src, float *dst, int numValues) {
+        if (useF16C()) {
+            KoF16Conversion::halfToFloatF16C(src, dst, numValues);
+        } else {
+            KoF16Conversion::halfToFloatScalar(src, dst, numValues);
+        }
+    }
+
+    static inline void fromFloat(const float *src, half *dst, int numValues) {
+        if (useF16C()) {
+            KoF16Conversion::floatToHalfF16C(src, dst, numValues);
+        } else {
+            KoF16Conversion::floatToHalfScalar(src, dst, numValues);
+        }
+    }
+};
+
+#endif /* HAVE_OPENEXR */
+
+#endif /* HAVE_VC */
+
+/**
+ * Converts RGBA pixels in chunks: the source channels are loaded into
+ * a buffer of normalized floats, the red and blue channels are swapped
+ * if the pixel orders differ and then the buffer is stored into the
+ * destination channel type.
+ */
+template<typename src_channel_type,
+         typename dst_channel_type,
+         Vc::Implementation _impl>
+class KoOptimizedRgbaDepthConverter : public KoRgbaDepthConverter
+{
+    static const int numChannels = 4;
+    static const int chunkSize = 256;
+
+    // integer colorspaces are BGRA, floating point ones are RGBA
+    static const bool swapRedBlue =
+        std::is_integral<src_channel_type>::value !=
+        std::is_integral<dst_channel_type>::value;
+
+    typedef KoRgbaDepthConverterChannels<src_channel_type, _impl> SrcChannels;
+    typedef KoRgbaDepthConverterChannels<dst_channel_type, _impl> DstChannels;
+
+public:
+    void convert(const quint8 *src, quint8 *dst, int numPixels) const override {
+        alignas(64) float buffer[chunkSize * numChannels];
+
+        const src_channel_type *srcChannels = reinterpret_cast<const src_channel_type*>(src);
+        dst_channel_type *dstChannels = reinterpret_cast<dst_channel_type*>(dst);
+
+        for (int i = 0; i < numPixels; i += chunkSize) {
+            const int numValues = qMin(chunkSize, numPixels - i) * numChannels;
+
+            SrcChannels::toFloat(srcChannels, buffer, numValues);
+
+            if (swapRedBlue) {
+                for (int j = 0; j < numValues; j += numChannels) {
+                    std::swap(buffer[j], buffer[j + 2]);
+                }
+            }
+
+            DstChannels::fromFloat(buffer, dstChannels, numValues);
+
+            srcChannels += numValues;
+            dstChannels += numValues;
+        }
+    }
+};
+
+#endif // KOOPTIMIZEDRGBADEPTHCONVERTER_H
@@ -0,0 +1,104 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KoRgbaDepthConversionTransformation.h"
+
+#include <QScopedPointer>
+
+#include <KoConfig.h>
+#include <KoColorSpace.h>
+#include <KoColorProfile.h>
+#include <KoColorModelStandardIds.h>
+
+#include "KoRgbaDepthConverter.h"
+#include "KoRgbaDepthConverterFactoryImpl.h"
+
+namespace {
+
+bool isFloatDepth(const QString &depthId)
+{
+    return depthId == Float16BitsColorDepthID.id() ||
+        depthId == Float32BitsColorDepthID.id();
+}
+
+class KoRgbaDepthConversionTransformation : public KoColorConversionTransformation
+{
+public:
+    KoRgbaDepthConversionTransformation(const KoColorSpace* srcCs,
+                                        const KoColorSpace* dstCs,
+                                        Intent renderingIntent,
+                                        ConversionFlags conversionFlags)
+        : KoColorConversionTransformation(srcCs, dstCs, renderingIntent, conversionFlags),
+          m_converter(createOptimizedClass<KoRgbaDepthConverterFactoryImpl>(
+                          qMakePair(srcCs->colorDepthId(), dstCs->colorDepthId())))
+    {
+        Q_ASSERT(m_converter);
+    }
+
+    void transform(const quint8 *src, quint8 *dst, qint32 nPixels) const override {
+        m_converter->convert(src, dst, nPixels);
+    }
+
+private:
+    QScopedPointer<KoRgbaDepthConverter> m_converter;
+};
+
+}
+
+KoRgbaDepthConversionTransformationFactory::KoRgbaDepthConversionTransformationFactory(const KoID &srcDepthId, const KoID &dstDepthId)
+    : KoColorConversionTransformationFactory(RGBAColorModelID.id(), srcDepthId.id(), "",
+                                             RGBAColorModelID.id(), dstDepthId.id(), "")
+{
+}
+
+KoColorConversionTransformation* KoRgbaDepthConversionTransformationFactory::createColorTransformation(const KoColorSpace* srcColorSpace, const KoColorSpace* dstColorSpace, KoColorConversionTransformation::Intent renderingIntent, KoColorConversionTransformation::ConversionFlags conversionFlags) const
+{
+    Q_ASSERT(canBeSource(srcColorSpace));
+    Q_ASSERT(canBeDestination(dstColorSpace));
+    Q_ASSERT(*srcColorSpace->profile() == *dstColorSpace->profile());
+
+    return new KoRgbaDepthConversionTransformation(srcColorSpace, dstColorSpace, renderingIntent, conversionFlags);
+}
+
+bool KoRgbaDepthConversionTransformationFactory::conserveColorInformation() const
+{
+    return true;
+}
+
+bool KoRgbaDepthConversionTransformationFactory::conserveDynamicRange() const
+{
+    return !isFloatDepth(srcColorDepthId()) || isFloatDepth(dstColorDepthId());
+}
+
+QList<KoColorConversionTransformationFactory*> KoRgbaDepthConversionTransformationFactory::createOutgoingLinks(const KoID &srcDepthId)
+{
+    QList<KoID> depthIds;
+    depthIds << Integer8BitsColorDepthID << Integer16BitsColorDepthID;
+#ifdef HAVE_OPENEXR
+    depthIds << Float16BitsColorDepthID;
+#endif
+    depthIds << Float32BitsColorDepthID;
+
+    QList<KoColorConversionTransformationFactory*> list;
+
+    Q_FOREACH (const KoID &dstDepthId, depthIds) {
+        if (dstDepthId != srcDepthId) {
+            list << new KoRgbaDepthConversionTransformationFactory(srcDepthId, dstDepthId);
+        }
+    }
+
+    return list;
+}
@@ -0,0 +1,55 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KORGBADEPTHCONVERSIONTRANSFORMATION_H
+#define KORGBADEPTHCONVERSIONTRANSFORMATION_H
+
+#include "kritapigment_export.h"
+
+#include <QList>
+#include <KoID.h>
+#include "KoColorConversionTransformationFactory.h"
+
+/**
+ * A factory of the vectorized conversions between the RGBA colorspaces
+ * of different depths that use the same profile. The conversion only
+ * scales the channels (and swaps the red and blue channels between BGRA
+ * integer and RGBA floating point pixels), so it is much faster than
+ * going through the color engine.
+ *
+ * The factory has no profile names, so the conversion system links
+ * the nodes of every profile available in both depths with it.
+ */
+class KRITAPIGMENT_EXPORT KoRgbaDepthConversionTransformationFactory : public KoColorConversionTransformationFactory
+{
+public:
+    KoRgbaDepthConversionTransformationFactory(const KoID &srcDepthId, const KoID &dstDepthId);
+
+    KoColorConversionTransformation* createColorTransformation(const KoColorSpace* srcColorSpace,
+                                                               const KoColorSpace* dstColorSpace,
+                                                               KoColorConversionTransformation::Intent renderingIntent,
+                                                               KoColorConversionTransformation::ConversionFlags conversionFlags) const override;
+    bool conserveColorInformation() const override;
+    bool conserveDynamicRange() const override;
+
+    /**
+     * @return the links from the RGBA colorspace of \p srcDepthId into
+     * the RGBA colorspaces of all the other supported depths
+     */
+    static QList<KoColorConversionTransformationFactory*> createOutgoingLinks(const KoID &srcDepthId);
+};
+
+#endif // KORGBADEPTHCONVERSIONTRANSFORMATION_H
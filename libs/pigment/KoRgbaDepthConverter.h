@@ -0,0 +1,39 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KORGBADEPTHCONVERTER_H
+#define KORGBADEPTHCONVERTER_H
+
+#include <QtGlobal>
+
+/**
+ * Converts the RGBA pixels from one channel type into another one
+ * without changing the color values, that is, the source and the
+ * destination are expected to use the same profile.
+ *
+ * Integer RGBA colorspaces keep the pixels in BGRA order, while
+ * the floating point ones use RGBA order, the converter swaps the
+ * red and blue channels when needed.
+ */
+class KoRgbaDepthConverter
+{
+public:
+    virtual ~KoRgbaDepthConverter() {}
+
+    virtual void convert(const quint8 *src, quint8 *dst, int numPixels) const = 0;
+};
+
+#endif // KORGBADEPTHCONVERTER_H
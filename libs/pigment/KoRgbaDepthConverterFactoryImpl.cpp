@@ -0,0 +1,69 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KoRgbaDepthConverterFactoryImpl.h"
+#include "KoOptimizedRgbaDepthConverter.h"
+
+#include <KoColorModelStandardIds.h>
+
+namespace {
+
+template<Vc::Implementation _impl, typename src_channel_type>
+KoRgbaDepthConverter* createForDstDepth(const KoID &dstDepthId)
+{
+    if (dstDepthId == Integer8BitsColorDepthID) {
+        return new KoOptimizedRgbaDepthConverter<src_channel_type, quint8, _impl>();
+    } else if (dstDepthId == Integer16BitsColorDepthID) {
+        return new KoOptimizedRgbaDepthConverter<src_channel_type, quint16, _impl>();
+#ifdef HAVE_OPENEXR
+    } else if (dstDepthId == Float16BitsColorDepthID) {
+        return new KoOptimizedRgbaDepthConverter<src_channel_type, half, _impl>();
+#endif
+    } else if (dstDepthId == Float32BitsColorDepthID) {
+        return new KoOptimizedRgbaDepthConverter<src_channel_type, float, _impl>();
+    }
+
+    return 0;
+}
+
+}
+
+template<Vc::Implementation _impl>
+KoRgbaDepthConverter* KoRgbaDepthConverterFactoryImpl::create(ParamType depthIds)
+{
+    const KoID &srcDepthId = depthIds.first;
+    const KoID &dstDepthId = depthIds.second;
+
+    if (srcDepthId == dstDepthId) {
+        return 0;
+    }
+
+    if (srcDepthId == Integer8BitsColorDepthID) {
+        return createForDstDepth<_impl, quint8>(dstDepthId);
+    } else if (srcDepthId == Integer16BitsColorDepthID) {
+        return createForDstDepth<_impl, quint16>(dstDepthId);
+#ifdef HAVE_OPENEXR
+    } else if (srcDepthId == Float16BitsColorDepthID) {
+        return createForDstDepth<_impl, half>(dstDepthId);
+#endif
+    } else if (srcDepthId == Float32BitsColorDepthID) {
+        return createForDstDepth<_impl, float>(dstDepthId);
+    }
+
+    return 0;
+}
+
+template KoRgbaDepthConverter* KoRgbaDepthConverterFactoryImpl::create<Vc::CurrentImplementation::current()>(ParamType);
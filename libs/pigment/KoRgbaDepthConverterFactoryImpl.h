@@ -0,0 +1,38 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KORGBADEPTHCONVERTERFACTORYIMPL_H
+#define KORGBADEPTHCONVERTERFACTORYIMPL_H
+
+#include "kritapigment_export.h"
+#include <KoVcMultiArchBuildSupport.h>
+#include <KoID.h>
+#include <QPair>
+
+class KoRgbaDepthConverter;
+
+class KRITAPIGMENT_EXPORT KoRgbaDepthConverterFactoryImpl
+{
+public:
+    /// the source and the destination depth ids
+    typedef QPair<KoID, KoID> ParamType;
+    typedef KoRgbaDepthConverter* ReturnType;
+
+    template<Vc::Implementation _impl>
+    static KoRgbaDepthConverter* create(ParamType depthIds);
+};
+
+#endif // KORGBADEPTHCONVERTERFACTORYIMPL_H
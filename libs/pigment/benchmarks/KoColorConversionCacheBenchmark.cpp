@@ -0,0 +1,89 @@
+/*
+ *  This library is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation; either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KoColorConversionCacheBenchmark.h"
+
+#include <QTest>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QVector>
+
+#include <KoColorSpaceRegistry.h>
+#include <KoColorSpace.h>
+
+#define NUM_CONVERSIONS 20000
+#define NUM_PIXELS 16
+
+/**
+ * Converts small chunks of pixels many times in a row, so the time is
+ * dominated by fetching the transformation from the conversion cache
+ * rather than by the conversion itself.
+ */
+class ConversionRunnable : public QRunnable
+{
+public:
+    ConversionRunnable(const KoColorSpace *srcCs, const KoColorSpace *dstCs)
+        : m_srcCs(srcCs),
+          m_dstCs(dstCs)
+    {
+    }
+
+    void run() {
+        QVector<quint8> src(NUM_PIXELS * m_srcCs->pixelSize());
+        QVector<quint8> dst(NUM_PIXELS * m_dstCs->pixelSize());
+
+        for (int i = 0; i < NUM_CONVERSIONS; i++) {
+            m_srcCs->convertPixelsTo(src.constData(), dst.data(), m_dstCs, NUM_PIXELS,
+                                     KoColorConversionTransformation::internalRenderingIntent(),
+                                     KoColorConversionTransformation::internalConversionFlags());
+        }
+    }
+
+private:
+    const KoColorSpace *m_srcCs;
+    const KoColorSpace *m_dstCs;
+};
+
+void KoColorConversionCacheBenchmark::benchmarkConversionContention_data()
+{
+    QTest::addColumn<int>("numThreads");
+
+    QTest::newRow("1 thread") << 1;
+    QTest::newRow("2 threads") << 2;
+    QTest::newRow("4 threads") << 4;
+    QTest::newRow("8 threads") << 8;
+    QTest::newRow("16 threads") << 16;
+}
+
+void KoColorConversionCacheBenchmark::benchmarkConversionContention()
+{
+    QFETCH(int, numThreads);
+
+    const KoColorSpace *srcCs = KoColorSpaceRegistry::instance()->rgb8();
+    const KoColorSpace *dstCs = KoColorSpaceRegistry::instance()->lab16();
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(numThreads);
+
+    QBENCHMARK {
+        for (int i = 0; i < numThreads; i++) {
+            pool.start(new ConversionRunnable(srcCs, dstCs));
+        }
+        pool.waitForDone();
+    }
+}
+
+QTEST_GUILESS_MAIN(KoColorConversionCacheBenchmark)
@@ -24,6 +24,7 @@
 
 #include <KoColorSpaceTraits.h>
 #include <KoColorSpaceRegistry.h>
+#include <KoCompositeOpRegistry.h>
 
 #include <QTest>
 
@@ -39,11 +40,11 @@ const int TILES_IN_WIDTH = IMG_WIDTH / TILE_WIDTH;
 const int TILES_IN_HEIGHT = IMG_HEIGHT / TILE_HEIGHT;
 
 
-#define COMPOSITE_BENCHMARK \
+#define COMPOSITE_BENCHMARK_PIXEL_SIZE(pixelSize) \
         for (int y = 0; y < TILES_IN_HEIGHT; y++){                                              \
             for (int x = 0; x < TILES_IN_WIDTH; x++) {                                           \
-                const int rowStride = IMG_WIDTH * KoBgrU8Traits::pixelSize;  \
-                const int bufOffset = y * rowStride + x * TILE_WIDTH * KoBgrU8Traits::pixelSize;  \
+                const int rowStride = IMG_WIDTH * pixelSize;  \
+                const int bufOffset = y * rowStride + x * TILE_WIDTH * pixelSize;  \
                 compositeOp->composite(m_dstBuffer + bufOffset, rowStride,      \
                                       m_srcBuffer + bufOffset, rowStride,      \
                                       m_mskBuffer + bufOffset, rowStride,                                                            \
@@ -52,9 +53,14 @@ const int TILES_IN_HEIGHT = IMG_HEIGHT / TILE_HEIGHT;
             }                                                                                   \
         }
 
+#define COMPOSITE_BENCHMARK COMPOSITE_BENCHMARK_PIXEL_SIZE(KoBgrU8Traits::pixelSize)
+
+// the buffers are big enough for the biggest pixel we benchmark
+const int MAX_PIXEL_SIZE = KoBgrU16Traits::pixelSize;
+
 void KoCompositeOpsBenchmark::initTestCase()
 {
-    const int bufLen = IMG_HEIGHT * IMG_WIDTH * KoBgrU8Traits::pixelSize;
+    const int bufLen = IMG_HEIGHT * IMG_WIDTH * MAX_PIXEL_SIZE;
 
     m_dstBuffer = new quint8[bufLen];
     m_srcBuffer = new quint8[bufLen];
@@ -66,7 +72,7 @@ void KoCompositeOpsBenchmark::init()
 {
     qsrand(42);
 
-    for (int i = 0; i < int(IMG_WIDTH * IMG_HEIGHT * KoBgrU8Traits::pixelSize); i++) {
+    for (int i = 0; i < int(IMG_WIDTH * IMG_HEIGHT * MAX_PIXEL_SIZE); i++) {
         const int randVal = qrand();
 
         m_srcBuffer[i] = randVal & 0x0000FF;
@@ -108,5 +114,75 @@ void KoCompositeOpsBenchmark::benchmarkCompositeAlphaDarkenCreamy()
     }
 }
 
+void KoCompositeOpsBenchmark::benchmarkCompositeMultiply()
+{
+    KoCompositeOp *compositeOp = KoOptimizedCompositeOpFactory::createGenericSCOp32(KoColorSpaceRegistry::instance()->rgb8(), COMPOSITE_MULT, "Multiply", KoCompositeOp::categoryArithmetic());
+    if (!compositeOp) {
+        QSKIP("Vector instructions are not available");
+    }
+    QBENCHMARK{
+        COMPOSITE_BENCHMARK
+    }
+}
+
+void KoCompositeOpsBenchmark::benchmarkCompositeOverlay()
+{
+    KoCompositeOp *compositeOp = KoOptimizedCompositeOpFactory::createGenericSCOp32(KoColorSpaceRegistry::instance()->rgb8(), COMPOSITE_OVERLAY, "Overlay", KoCompositeOp::categoryMix());
+    if (!compositeOp) {
+        QSKIP("Vector instructions are not available");
+    }
+    QBENCHMARK{
+        COMPOSITE_BENCHMARK
+    }
+}
+
+void KoCompositeOpsBenchmark::benchmarkCompositeOverU16()
+{
+    KoCompositeOp *compositeOp = KoOptimizedCompositeOpFactory::createOverOpU16(KoColorSpaceRegistry::instance()->rgb16());
+    QBENCHMARK{
+        COMPOSITE_BENCHMARK_PIXEL_SIZE(KoBgrU16Traits::pixelSize)
+    }
+}
+
+void KoCompositeOpsBenchmark::benchmarkCompositeAlphaDarkenHardU16()
+{
+    KoCompositeOp *compositeOp = KoOptimizedCompositeOpFactory::createAlphaDarkenOpHardU16(KoColorSpaceRegistry::instance()->rgb16());
+    QBENCHMARK{
+        COMPOSITE_BENCHMARK_PIXEL_SIZE(KoBgrU16Traits::pixelSize)
+    }
+}
+
+void KoCompositeOpsBenchmark::benchmarkCompositeAlphaDarkenCreamyU16()
+{
+    KoCompositeOp *compositeOp = KoOptimizedCompositeOpFactory::createAlphaDarkenOpCreamyU16(KoColorSpaceRegistry::instance()->rgb16());
+    QBENCHMARK{
+        COMPOSITE_BENCHMARK_PIXEL_SIZE(KoBgrU16Traits::pixelSize)
+    }
+}
+
+void KoCompositeOpsBenchmark::benchmarkCompositeCopyU16()
+{
+    KoCompositeOp *compositeOp = KoOptimizedCompositeOpFactory::createCopyOpU16(KoColorSpaceRegistry::instance()->rgb16());
+    QBENCHMARK{
+        COMPOSITE_BENCHMARK_PIXEL_SIZE(KoBgrU16Traits::pixelSize)
+    }
+}
+
+void KoCompositeOpsBenchmark::benchmarkCompositeOverGrayU16()
+{
+    KoCompositeOp *compositeOp = KoOptimizedCompositeOpFactory::createOverOpGrayU16(KoColorSpaceRegistry::instance()->graya16());
+    QBENCHMARK{
+        COMPOSITE_BENCHMARK_PIXEL_SIZE(KoGrayU16Traits::pixelSize)
+    }
+}
+
+void KoCompositeOpsBenchmark::benchmarkCompositeAlphaDarkenCreamyGrayU16()
+{
+    KoCompositeOp *compositeOp = KoOptimizedCompositeOpFactory::createAlphaDarkenOpCreamyGrayU16(KoColorSpaceRegistry::instance()->graya16());
+    QBENCHMARK{
+        COMPOSITE_BENCHMARK_PIXEL_SIZE(KoGrayU16Traits::pixelSize)
+    }
+}
+
 
 QTEST_GUILESS_MAIN(KoCompositeOpsBenchmark)
@@ -33,6 +33,15 @@ private Q_SLOTS:
     void benchmarkCompositeOver();
     void benchmarkCompositeAlphaDarkenHard();
     void benchmarkCompositeAlphaDarkenCreamy();
+    void benchmarkCompositeMultiply();
+    void benchmarkCompositeOverlay();
+
+    void benchmarkCompositeOverU16();
+    void benchmarkCompositeAlphaDarkenHardU16();
+    void benchmarkCompositeAlphaDarkenCreamyU16();
+    void benchmarkCompositeCopyU16();
+    void benchmarkCompositeOverGrayU16();
+    void benchmarkCompositeAlphaDarkenCreamyGrayU16();
 
 private:
     quint8 * m_dstBuffer;
@@ -0,0 +1,375 @@
+/*
+ *  This library is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation; either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KoCompositeOpsMatrixBenchmark.h"
+
+#include <QTest>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+#include <KoCompositeOp.h>
+#include <KoVcMultiArchBuildSupport.h>
+
+namespace {
+
+const int TILE_SIZE = 64;
+const int TILES_IN_ROW = 8;
+const int IMG_SIZE = TILE_SIZE * TILES_IN_ROW;
+const int NUM_PIXELS = IMG_SIZE * IMG_SIZE;
+
+// the alignment of the "aligned" rows, enough for AVX
+const int BUFFER_ALIGNMENT = 64;
+
+/**
+ * The name of the instruction set createOptimizedClass() picks, the
+ * results of different instruction sets are not comparable
+ */
+QString vectorizationName()
+{
+#ifdef HAVE_VC
+    if (Vc::isImplementationSupported(Vc::AVX2Impl)) {
+        return "AVX2";
+    } else if (Vc::isImplementationSupported(Vc::AVXImpl)) {
+        return "AVX";
+    } else if (Vc::isImplementationSupported(Vc::SSE41Impl)) {
+        return "SSE4.1";
+    } else if (Vc::isImplementationSupported(Vc::SSSE3Impl)) {
+        return "SSSE3";
+    } else if (Vc::isImplementationSupported(Vc::SSE2Impl)) {
+        return "SSE2";
+    }
+#endif
+    return "Scalar";
+}
+
+/**
+ * A pixel buffer with the first pixel placed at a 64-byte boundary
+ * (or \p offset bytes after it for unaligned rows)
+ */
+struct PixelBuffer
+{
+    PixelBuffer(int size, int offset)
+        : data(size + BUFFER_ALIGNMENT + offset)
+    {
+        const quintptr ptr = reinterpret_cast<quintptr>(data.data());
+        start = reinterpret_cast<quint8*>((ptr + BUFFER_ALIGNMENT - 1) & ~quintptr(BUFFER_ALIGNMENT - 1)) + offset;
+    }
+
+    QVector<quint8> data;
+    quint8 *start;
+};
+
+void fillRandomPixels(const KoColorSpace *cs, quint8 *pixels, int numPixels)
+{
+    QVector<float> channels(cs->channelCount());
+
+    for (int i = 0; i < numPixels; i++) {
+        for (int ch = 0; ch < channels.size(); ch++) {
+            channels[ch] = float(qrand() % 256) / 255;
+        }
+
+        cs->fromNormalisedChannelsValue(pixels, channels);
+        pixels += cs->pixelSize();
+    }
+}
+
+void compositeImage(const KoCompositeOp *op, const KoCompositeOp::ParameterInfo &imageParams, int pixelSize)
+{
+    KoCompositeOp::ParameterInfo params(imageParams);
+    params.rows = TILE_SIZE;
+    params.cols = TILE_SIZE;
+
+    for (int y = 0; y < TILES_IN_ROW; y++) {
+        for (int x = 0; x < TILES_IN_ROW; x++) {
+            params.dstRowStart = imageParams.dstRowStart + y * TILE_SIZE * imageParams.dstRowStride + x * TILE_SIZE * pixelSize;
+            params.srcRowStart = imageParams.srcRowStart + y * TILE_SIZE * imageParams.srcRowStride + x * TILE_SIZE * pixelSize;
+
+            if (imageParams.maskRowStart) {
+                params.maskRowStart = imageParams.maskRowStart + y * TILE_SIZE * imageParams.maskRowStride + x * TILE_SIZE;
+            }
+
+            op->composite(params);
+        }
+    }
+}
+
+}
+
+void KoCompositeOpsMatrixBenchmark::initTestCase()
+{
+    const QString filter = QString::fromLocal8Bit(qgetenv("KRITA_COMPOSITEOPS_BENCHMARK_FILTER"));
+    if (!filter.isEmpty()) {
+        m_filter = QRegExp(filter);
+        QVERIFY2(m_filter.isValid(), "KRITA_COMPOSITEOPS_BENCHMARK_FILTER is not a valid regular expression");
+    }
+
+    m_outputPath = QString::fromLocal8Bit(qgetenv("KRITA_COMPOSITEOPS_BENCHMARK_OUTPUT"));
+    if (m_outputPath.isEmpty()) {
+        m_outputPath = "KoCompositeOpsMatrixBenchmark";
+    }
+
+    m_baselinePath = QString::fromLocal8Bit(qgetenv("KRITA_COMPOSITEOPS_BENCHMARK_BASELINE"));
+
+    bool ok = false;
+    const qreal threshold = qgetenv("KRITA_COMPOSITEOPS_BENCHMARK_THRESHOLD").toDouble(&ok);
+    if (ok && threshold > 1.0) {
+        m_threshold = threshold;
+    }
+
+    const int minTimeMs = qgetenv("KRITA_COMPOSITEOPS_BENCHMARK_MIN_TIME").toInt(&ok);
+    m_minTimeNs = qint64(ok && minTimeMs > 0 ? minTimeMs : 20) * 1000000;
+}
+
+void KoCompositeOpsMatrixBenchmark::cleanupTestCase()
+{
+    writeResults();
+
+    if (!m_baselinePath.isEmpty()) {
+        compareWithBaseline();
+    }
+}
+
+void KoCompositeOpsMatrixBenchmark::benchmarkCompositeOps_data()
+{
+    QTest::addColumn<QString>("modelId");
+    QTest::addColumn<QString>("depthId");
+    QTest::addColumn<QString>("compositeOpId");
+    QTest::addColumn<qreal>("opacity");
+    QTest::addColumn<bool>("useMask");
+    QTest::addColumn<bool>("aligned");
+
+    QList<qreal> opacities;
+    opacities << 1.0 << 0.5;
+
+    const QList<const KoColorSpace*> colorSpaces =
+        KoColorSpaceRegistry::instance()->allColorSpaces(KoColorSpaceRegistry::AllColorSpaces,
+                                                         KoColorSpaceRegistry::OnlyDefaultProfile);
+
+    Q_FOREACH (const KoColorSpace *cs, colorSpaces) {
+        Q_FOREACH (const KoCompositeOp *op, cs->compositeOps()) {
+            Q_FOREACH (qreal opacity, opacities) {
+                for (int useMask = 0; useMask <= 1; useMask++) {
+                    for (int aligned = 1; aligned >= 0; aligned--) {
+                        const QString tag =
+                            QString("%1/%2/opacity-%3/%4/%5")
+                                .arg(cs->id())
+                                .arg(op->id())
+                                .arg(opacity, 0, 'f', 1)
+                                .arg(useMask ? "mask" : "nomask")
+                                .arg(aligned ? "aligned" : "unaligned");
+
+                        if (!m_filter.isEmpty() && m_filter.indexIn(tag) < 0) continue;
+
+                        QTest::newRow(tag.toLatin1())
+                            << cs->colorModelId().id()
+                            << cs->colorDepthId().id()
+                            << op->id()
+                            << opacity
+                            << bool(useMask)
+                            << bool(aligned);
+                    }
+                }
+            }
+        }
+    }
+}
+
+void KoCompositeOpsMatrixBenchmark::benchmarkCompositeOps()
+{
+    QFETCH(QString, modelId);
+    QFETCH(QString, depthId);
+    QFETCH(QString, compositeOpId);
+    QFETCH(qreal, opacity);
+    QFETCH(bool, useMask);
+    QFETCH(bool, aligned);
+
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->colorSpace(modelId, depthId);
+    QVERIFY(cs);
+
+    const KoCompositeOp *op = cs->compositeOp(compositeOpId);
+    QVERIFY(op);
+
+    const int pixelSize = cs->pixelSize();
+    const int rowStride = IMG_SIZE * pixelSize;
+
+    /**
+     * Offsetting by a whole pixel would keep 16-byte pixels (RGBA F32)
+     * vector-aligned, so shift the rows by half a pixel instead. It
+     * breaks the vector alignment for every pixel size, but keeps the
+     * channels themselves aligned.
+     */
+    const int unalignedOffset = qMax(1, pixelSize / 2);
+
+    PixelBuffer src(NUM_PIXELS * pixelSize, aligned ? 0 : unalignedOffset);
+    PixelBuffer dst(NUM_PIXELS * pixelSize, aligned ? 0 : unalignedOffset);
+    PixelBuffer mask(NUM_PIXELS, aligned ? 0 : 1);
+
+    qsrand(42);
+    fillRandomPixels(cs, src.start, NUM_PIXELS);
+    fillRandomPixels(cs, dst.start, NUM_PIXELS);
+
+    for (int i = 0; i < NUM_PIXELS; i++) {
+        mask.start[i] = qrand() % 256;
+    }
+
+    KoCompositeOp::ParameterInfo params;
+    params.dstRowStart = dst.start;
+    params.dstRowStride = rowStride;
+    params.srcRowStart = src.start;
+    params.srcRowStride = rowStride;
+    params.maskRowStart = useMask ? mask.start : 0;
+    params.maskRowStride = useMask ? IMG_SIZE : 0;
+    params.opacity = opacity;
+    params.flow = 1.0;
+
+    // warm up the caches and the lazily initialized tables of the op
+    compositeImage(op, params, pixelSize);
+
+    qreal megapixelsPerSecond = 0;
+
+    QBENCHMARK_ONCE {
+        QElapsedTimer timer;
+        timer.start();
+
+        int numIterations = 0;
+        qint64 elapsed = 0;
+
+        do {
+            compositeImage(op, params, pixelSize);
+            numIterations++;
+            elapsed = timer.nsecsElapsed();
+        } while (elapsed < m_minTimeNs);
+
+        megapixelsPerSecond = qreal(numIterations) * NUM_PIXELS * 1e3 / qMax(qint64(1), elapsed);
+    }
+
+    Result result;
+    result.tag = QString::fromLatin1(QTest::currentDataTag());
+    result.colorModelId = modelId;
+    result.colorDepthId = depthId;
+    result.compositeOpId = compositeOpId;
+    result.opacity = opacity;
+    result.useMask = useMask;
+    result.aligned = aligned;
+    result.megapixelsPerSecond = megapixelsPerSecond;
+
+    m_results.append(result);
+}
+
+void KoCompositeOpsMatrixBenchmark::writeResults() const
+{
+    QJsonArray rows;
+
+    Q_FOREACH (const Result &result, m_results) {
+        QJsonObject row;
+        row["tag"] = result.tag;
+        row["colorModel"] = result.colorModelId;
+        row["colorDepth"] = result.colorDepthId;
+        row["compositeOp"] = result.compositeOpId;
+        row["opacity"] = result.opacity;
+        row["mask"] = result.useMask;
+        row["aligned"] = result.aligned;
+        row["megapixelsPerSecond"] = result.megapixelsPerSecond;
+        rows.append(row);
+    }
+
+    QJsonObject root;
+    root["benchmark"] = "KoCompositeOpsMatrixBenchmark";
+    root["vectorization"] = vectorizationName();
+    root["imageSize"] = IMG_SIZE;
+    root["tileSize"] = TILE_SIZE;
+    root["results"] = rows;
+
+    QFile jsonFile(m_outputPath + ".json");
+    if (jsonFile.open(QIODevice::WriteOnly)) {
+        jsonFile.write(QJsonDocument(root).toJson());
+    } else {
+        qWarning() << "Failed to write" << jsonFile.fileName();
+    }
+
+    QFile csvFile(m_outputPath + ".csv");
+    if (csvFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        QTextStream stream(&csvFile);
+        stream << "tag,colorModel,colorDepth,compositeOp,opacity,mask,aligned,megapixelsPerSecond\n";
+
+        Q_FOREACH (const Result &result, m_results) {
+            stream << result.tag << ','
+                   << result.colorModelId << ','
+                   << result.colorDepthId << ','
+                   << result.compositeOpId << ','
+                   << result.opacity << ','
+                   << int(result.useMask) << ','
+                   << int(result.aligned) << ','
+                   << result.megapixelsPerSecond << '\n';
+        }
+    } else {
+        qWarning() << "Failed to write" << csvFile.fileName();
+    }
+}
+
+void KoCompositeOpsMatrixBenchmark::compareWithBaseline()
+{
+    QFile file(m_baselinePath);
+    QVERIFY2(file.open(QIODevice::ReadOnly), qPrintable("Failed to open the baseline: " + m_baselinePath));
+
+    const QJsonObject baseline = QJsonDocument::fromJson(file.readAll()).object();
+
+    if (baseline["vectorization"].toString() != vectorizationName()) {
+        qWarning() << "The baseline was recorded for" << baseline["vectorization"].toString()
+                   << "instructions, the current CPU uses" << vectorizationName()
+                   << ", skipping the comparison";
+        return;
+    }
+
+    QHash<QString, qreal> baselineSpeed;
+    Q_FOREACH (const QJsonValue &value, baseline["results"].toArray()) {
+        const QJsonObject row = value.toObject();
+        baselineSpeed.insert(row["tag"].toString(), row["megapixelsPerSecond"].toDouble());
+    }
+
+    QStringList regressions;
+
+    Q_FOREACH (const Result &result, m_results) {
+        const qreal oldSpeed = baselineSpeed.value(result.tag, 0.0);
+        if (oldSpeed <= 0.0) continue;
+
+        const qreal slowdown = oldSpeed / qMax(result.megapixelsPerSecond, 1e-6);
+
+        if (slowdown > m_threshold) {
+            regressions << QString("%1: %2 -> %3 Mpx/s (%4x slower)")
+                           .arg(result.tag)
+                           .arg(oldSpeed, 0, 'f', 1)
+                           .arg(result.megapixelsPerSecond, 0, 'f', 1)
+                           .arg(slowdown, 0, 'f', 2);
+        }
+    }
+
+    Q_FOREACH (const QString &regression, regressions) {
+        qWarning().noquote() << "REGRESSION:" << regression;
+    }
+
+    QVERIFY2(regressions.isEmpty(),
+             qPrintable(QString("%1 composite ops got slower than the baseline").arg(regressions.size())));
+}
+
+QTEST_GUILESS_MAIN(KoCompositeOpsMatrixBenchmark)
@@ -0,0 +1,81 @@
+/*
+ *  This library is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation; either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _KO_COMPOSITEOPS_MATRIX_BENCHMARK_H_
+#define _KO_COMPOSITEOPS_MATRIX_BENCHMARK_H_
+
+#include <QObject>
+#include <QRegExp>
+#include <QVector>
+
+/**
+ * Benchmarks every composite op of every colorspace (with the default
+ * profile) with full and half opacity, with and without a mask, on
+ * aligned and unaligned rows.
+ *
+ * The results are written into \<output\>.json and \<output\>.csv, so CI
+ * can keep them as a baseline. If a baseline is given, the rows that got
+ * slower than the threshold are reported and the benchmark fails.
+ *
+ * The benchmark is configured with the environment variables:
+ *
+ *  - KRITA_COMPOSITEOPS_BENCHMARK_FILTER: a regular expression, only the
+ *    rows with matching tags are run (e.g. "^RGBA/normal/")
+ *  - KRITA_COMPOSITEOPS_BENCHMARK_OUTPUT: base path of the output files,
+ *    "KoCompositeOpsMatrixBenchmark" by default
+ *  - KRITA_COMPOSITEOPS_BENCHMARK_BASELINE: path to a json file written
+ *    by a previous run
+ *  - KRITA_COMPOSITEOPS_BENCHMARK_THRESHOLD: the allowed slowdown factor,
+ *    1.2 by default
+ *  - KRITA_COMPOSITEOPS_BENCHMARK_MIN_TIME: minimal time of every row in
+ *    milliseconds, 20 by default
+ */
+class KoCompositeOpsMatrixBenchmark : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void benchmarkCompositeOps_data();
+    void benchmarkCompositeOps();
+
+private:
+    struct Result {
+        QString tag;
+        QString colorModelId;
+        QString colorDepthId;
+        QString compositeOpId;
+        qreal opacity;
+        bool useMask;
+        bool aligned;
+        qreal megapixelsPerSecond;
+    };
+
+    void writeResults() const;
+    void compareWithBaseline();
+
+private:
+    QRegExp m_filter;
+    QString m_outputPath;
+    QString m_baselinePath;
+    qreal m_threshold {1.2};
+    qint64 m_minTimeNs {0};
+
+    QVector<Result> m_results;
+};
+
+#endif
@@ -0,0 +1,124 @@
+/*
+ *  This library is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation; either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KoMixColorsOpBenchmark.h"
+
+#include <QTest>
+#include <QElapsedTimer>
+#include <QScopedPointer>
+
+#include <KoColorSpaceTraits.h>
+#include <KoColorModelStandardIds.h>
+#include <KoColorModelStandardIdsUtils.h>
+#include <KoMixColorsOpImpl.h>
+#include <KoMixColorsOpFactory.h>
+
+#define NUM_MIXES 200000
+
+template <typename channels_type>
+KoMixColorsOp* createMixColorsOp(bool optimized)
+{
+    typedef KoColorSpaceTrait<channels_type, 4, 3> Trait;
+
+    KoMixColorsOp *op = 0;
+
+    if (optimized) {
+        op = KoMixColorsOpFactory::createOptimized(colorDepthIdForChannelType<channels_type>(), 4, 3);
+    }
+
+    return op ? op : new KoMixColorsOpImpl<Trait>();
+}
+
+void KoMixColorsOpBenchmark::benchmarkWeightedMix_data()
+{
+    QTest::addColumn<QString>("depthId");
+    QTest::addColumn<int>("numColors");
+    QTest::addColumn<bool>("optimized");
+
+    QList<KoID> depths;
+    depths << Integer8BitsColorDepthID << Integer16BitsColorDepthID << Float32BitsColorDepthID;
+
+    QList<int> numColorsList;
+    numColorsList << 2 << 4 << 16 << 64;
+
+    Q_FOREACH (const KoID &depth, depths) {
+        Q_FOREACH (int numColors, numColorsList) {
+            QTest::newRow(QString("%1-%2-legacy").arg(depth.id()).arg(numColors).toLatin1())
+                << depth.id() << numColors << false;
+            QTest::newRow(QString("%1-%2-optimized").arg(depth.id()).arg(numColors).toLatin1())
+                << depth.id() << numColors << true;
+        }
+    }
+}
+
+void KoMixColorsOpBenchmark::benchmarkWeightedMix()
+{
+    QFETCH(QString, depthId);
+    QFETCH(int, numColors);
+    QFETCH(bool, optimized);
+
+    QScopedPointer<KoMixColorsOp> op;
+    int pixelSize = 0;
+
+    if (depthId == Integer8BitsColorDepthID.id()) {
+        op.reset(createMixColorsOp<quint8>(optimized));
+        pixelSize = 4 * sizeof(quint8);
+    } else if (depthId == Integer16BitsColorDepthID.id()) {
+        op.reset(createMixColorsOp<quint16>(optimized));
+        pixelSize = 4 * sizeof(quint16);
+    } else {
+        op.reset(createMixColorsOp<float>(optimized));
+        pixelSize = 4 * sizeof(float);
+    }
+
+    QVector<quint8> pixels(numColors * pixelSize);
+    QVector<const quint8*> pixelPointers(numColors);
+    QVector<qint16> weights(numColors);
+    QVector<quint8> result(pixelSize);
+
+    for (int i = 0; i < pixels.size(); i++) {
+        pixels[i] = i * 73 + 17;
+    }
+
+    // keep the float values in a sane range
+    if (depthId == Float32BitsColorDepthID.id()) {
+        float *ptr = reinterpret_cast<float*>(pixels.data());
+        for (int i = 0; i < 4 * numColors; i++) {
+            ptr[i] = float((i * 73 + 17) % 256) / 255.0f;
+        }
+    }
+
+    int weightSum = 0;
+    for (int i = 0; i < numColors; i++) {
+        pixelPointers[i] = pixels.constData() + i * pixelSize;
+        weights[i] = 255 / numColors;
+        weightSum += weights[i];
+    }
+
+    QBENCHMARK_ONCE {
+        QElapsedTimer timer;
+        timer.start();
+
+        for (int i = 0; i < NUM_MIXES; i++) {
+            op->mixColors(pixelPointers.constData(), weights.constData(), numColors, result.data(), weightSum);
+        }
+
+        const qint64 elapsed = qMax(qint64(1), timer.nsecsElapsed());
+        qDebug() << "mixes per second:" << qint64(qreal(NUM_MIXES) * 1e9 / elapsed);
+    }
+}
+
+QTEST_GUILESS_MAIN(KoMixColorsOpBenchmark)
@@ -84,7 +84,35 @@ public:
         }
     }
 
+    void compositeSpans(const KoCompositeOp::ParameterInfo& params, const QVector<KoCompositeOp::Span> &spans) const override {
+
+        const QBitArray& flags           = params.channelFlags.isEmpty() ? QBitArray(channels_nb,true) : params.channelFlags;
+        bool             allChannelFlags = params.channelFlags.isEmpty() || params.channelFlags == QBitArray(channels_nb,true);
+        bool             alphaLocked     = (alpha_pos != -1) && !flags.testBit(alpha_pos);
+
+        if(alphaLocked) {
+            if(allChannelFlags) { genericCompositeSpans<true,true> (params, spans, flags); }
+            else                { genericCompositeSpans<true,false>(params, spans, flags); }
+        }
+        else {
+            if(allChannelFlags) { genericCompositeSpans<false,true> (params, spans, flags); }
+            else                { genericCompositeSpans<false,false>(params, spans, flags); }
+        }
+    }
+
 private:
+    template<bool alphaLocked, bool allChannelFlags>
+    void genericCompositeSpans(const KoCompositeOp::ParameterInfo& params, const QVector<KoCompositeOp::Span> &spans, const QBitArray& channelFlags) const {
+        KoCompositeOp::ParameterInfo spanParams(params);
+
+        for (auto it = spans.constBegin(); it != spans.constEnd(); ++it) {
+            spanParams.setSpan(*it);
+
+            if(spanParams.maskRowStart) { genericComposite<true,alphaLocked,allChannelFlags> (spanParams, channelFlags); }
+            else                        { genericComposite<false,alphaLocked,allChannelFlags>(spanParams, channelFlags); }
+        }
+    }
+
     template<bool useMask, bool alphaLocked, bool allChannelFlags>
     void genericComposite(const KoCompositeOp::ParameterInfo& params, const QBitArray& channelFlags) const {
 
@@ -62,6 +62,9 @@ struct OptimizedOpsSelector
     static KoCompositeOp* createOverOp(const KoColorSpace *cs) {
         return new KoCompositeOpOver<Traits>(cs);
     }
+    static KoCompositeOp* createCopyOp(const KoColorSpace *cs) {
+        return new KoCompositeOpCopy2<Traits>(cs);
+    }
 };
 
 template<>
@@ -75,6 +78,9 @@ struct OptimizedOpsSelector<KoBgrU8Traits>
     static KoCompositeOp* createOverOp(const KoColorSpace *cs) {
         return KoOptimizedCompositeOpFactory::createOverOp32(cs);
     }
+    static KoCompositeOp* createCopyOp(const KoColorSpace *cs) {
+        return new KoCompositeOpCopy2<KoBgrU8Traits>(cs);
+    }
 };
 
 template<>
@@ -88,6 +94,9 @@ struct OptimizedOpsSelector<KoLabU8Traits>
     static KoCompositeOp* createOverOp(const KoColorSpace *cs) {
         return KoOptimizedCompositeOpFactory::createOverOp32(cs);
     }
+    static KoCompositeOp* createCopyOp(const KoColorSpace *cs) {
+        return new KoCompositeOpCopy2<KoLabU8Traits>(cs);
+    }
 };
 
 template<>
@@ -112,8 +121,106 @@ struct OptimizedOpsSelector<KoRgbF32Traits>
     static KoCompositeOp* createOverOp(const KoColorSpace *cs) {
         return KoOptimizedCompositeOpFactory::createOverOp128(cs);
     }
+    static KoCompositeOp* createCopyOp(const KoColorSpace *cs) {
+        return new KoCompositeOpCopy2<KoRgbF32Traits>(cs);
+    }
+};
+
+template<>
+struct OptimizedOpsSelector<KoBgrU16Traits>
+{
+    static KoCompositeOp* createAlphaDarkenOp(const KoColorSpace *cs) {
+        return useCreamyAlphaDarken() ?
+            KoOptimizedCompositeOpFactory::createAlphaDarkenOpCreamyU16(cs) :
+            KoOptimizedCompositeOpFactory::createAlphaDarkenOpHardU16(cs);
+    }
+    static KoCompositeOp* createOverOp(const KoColorSpace *cs) {
+        return KoOptimizedCompositeOpFactory::createOverOpU16(cs);
+    }
+    static KoCompositeOp* createCopyOp(const KoColorSpace *cs) {
+        return KoOptimizedCompositeOpFactory::createCopyOpU16(cs);
+    }
+};
+
+/**
+ * The traits used by the 16-bit grayscale colorspace (GrayAU16Traits)
+ */
+template<>
+struct OptimizedOpsSelector<KoColorSpaceTrait<quint16, 2, 1>>
+{
+    static KoCompositeOp* createAlphaDarkenOp(const KoColorSpace *cs) {
+        return useCreamyAlphaDarken() ?
+            KoOptimizedCompositeOpFactory::createAlphaDarkenOpCreamyGrayU16(cs) :
+            KoOptimizedCompositeOpFactory::createAlphaDarkenOpHardGrayU16(cs);
+    }
+    static KoCompositeOp* createOverOp(const KoColorSpace *cs) {
+        return KoOptimizedCompositeOpFactory::createOverOpGrayU16(cs);
+    }
+    static KoCompositeOp* createCopyOp(const KoColorSpace *cs) {
+        return KoOptimizedCompositeOpFactory::createCopyOpGrayU16(cs);
+    }
+};
+
+#ifdef HAVE_OPENEXR
+
+/**
+ * The colorspaces with half-float C1_C2_C3_A pixels composite through
+ * the 32-bit float code, see KoOptimizedCompositeOpF16Wrapper
+ */
+template<class Traits>
+struct OptimizedOpsSelectorF16
+{
+    static KoCompositeOp* createAlphaDarkenOp(const KoColorSpace *cs) {
+        return useCreamyAlphaDarken() ?
+            KoOptimizedCompositeOpFactory::createAlphaDarkenOpCreamyF16(cs) :
+            KoOptimizedCompositeOpFactory::createAlphaDarkenOpHardF16(cs);
+    }
+    static KoCompositeOp* createOverOp(const KoColorSpace *cs) {
+        return KoOptimizedCompositeOpFactory::createOverOpF16(cs);
+    }
+    static KoCompositeOp* createCopyOp(const KoColorSpace *cs) {
+        return new KoCompositeOpCopy2<Traits>(cs);
+    }
+};
+
+template<>
+struct OptimizedOpsSelector<KoRgbF16Traits> : OptimizedOpsSelectorF16<KoRgbF16Traits> {};
+
+template<>
+struct OptimizedOpsSelector<KoXyzF16Traits> : OptimizedOpsSelectorF16<KoXyzF16Traits> {};
+
+#endif /* HAVE_OPENEXR */
+
+/**
+ * Selects the implementation of the separable composite ops. The
+ * colorspaces with 8-bit C1_C2_C3_A pixels get the vectorized versions
+ * of the blending functions that have one.
+ */
+template<class Traits>
+struct OptimizedGenericSCSelector
+{
+    template<typename Traits::channels_type compositeFunc(typename Traits::channels_type, typename Traits::channels_type)>
+    static KoCompositeOp* create(const KoColorSpace *cs, const QString& id, const QString& description, const QString& category) {
+        return new KoCompositeOpGenericSC<Traits, compositeFunc>(cs, id, description, category);
+    }
 };
 
+template<class Traits>
+struct OptimizedGenericSCSelector32
+{
+    template<quint8 compositeFunc(quint8, quint8)>
+    static KoCompositeOp* create(const KoColorSpace *cs, const QString& id, const QString& description, const QString& category) {
+        KoCompositeOp *op = KoOptimizedCompositeOpFactory::createGenericSCOp32(cs, id, description, category);
+        return op ? op : new KoCompositeOpGenericSC<Traits, compositeFunc>(cs, id, description, category);
+    }
+};
+
+template<>
+struct OptimizedGenericSCSelector<KoBgrU8Traits> : OptimizedGenericSCSelector32<KoBgrU8Traits> {};
+
+template<>
+struct OptimizedGenericSCSelector<KoLabU8Traits> : OptimizedGenericSCSelector32<KoLabU8Traits> {};
+
 template<class Traits>
 struct AddGeneralOps<Traits, true>
 {
@@ -123,13 +230,13 @@ struct AddGeneralOps<Traits, true>
 
      template<CompositeFunc func>
      static void add(KoColorSpace* cs, const QString& id, const QString& description, const QString& category) {
-         cs->addCompositeOp(new KoCompositeOpGenericSC<Traits, func>(cs, id, description, category));
+         cs->addCompositeOp(OptimizedGenericSCSelector<Traits>::template create<func>(cs, id, description, category));
      }
 
      static void add(KoColorSpace* cs) {
          cs->addCompositeOp(OptimizedOpsSelector<Traits>::createOverOp(cs));
          cs->addCompositeOp(OptimizedOpsSelector<Traits>::createAlphaDarkenOp(cs));
-         cs->addCompositeOp(new KoCompositeOpCopy2<Traits>(cs));
+         cs->addCompositeOp(OptimizedOpsSelector<Traits>::createCopyOp(cs));
          cs->addCompositeOp(new KoCompositeOpErase<Traits>(cs));
          cs->addCompositeOp(new KoCompositeOpBehind<Traits>(cs));
          cs->addCompositeOp(new KoCompositeOpDestinationIn<Traits>(cs));
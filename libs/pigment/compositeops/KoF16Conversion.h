@@ -0,0 +1,131 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KOF16CONVERSION_H
+#define KOF16CONVERSION_H
+
+#include <KoConfig.h>
+
+#ifdef HAVE_OPENEXR
+
+#include <half.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define KO_HAVE_F16C_CONVERSION
+#include <immintrin.h>
+#if defined _MSC_VER
+#include <intrin.h>
+#define KO_F16C_TARGET
+#else
+#include <cpuid.h>
+/**
+ * The per-arch objects are not built with -mf16c, so the conversion
+ * functions enable the instructions locally and are called only when
+ * the CPU reports the support in runtime.
+ */
+#define KO_F16C_TARGET __attribute__((target("avx,f16c")))
+#endif
+#endif
+
+/**
+ * Conversion of the arrays of half-float values into 32-bit floats and
+ * back. The F16C versions convert 8 values per instruction.
+ */
+namespace KoF16Conversion {
+
+inline void halfToFloatScalar(const half *src, float *dst, int numValues)
+{
+    for (int i = 0; i < numValues; i++) {
+        dst[i] = src[i];
+    }
+}
+
+inline void floatToHalfScalar(const float *src, half *dst, int numValues)
+{
+    for (int i = 0; i < numValues; i++) {
+        dst[i] = src[i];
+    }
+}
+
+#ifdef KO_HAVE_F16C_CONVERSION
+
+inline bool isF16CSupported()
+{
+    static const bool isSupported = [] () {
+#if defined _MSC_VER
+        int info[4];
+        __cpuid(info, 1);
+        return bool(info[2] & (1 << 29));
+#else
+        unsigned int eax, ebx, ecx, edx;
+        return __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_F16C);
+#endif
+    }();
+
+    return isSupported;
+}
+
+KO_F16C_TARGET
+inline void halfToFloatF16C(const half *src, float *dst, int numValues)
+{
+    int i = 0;
+
+    for (; i + 8 <= numValues; i += 8) {
+        const __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(h));
+    }
+
+    halfToFloatScalar(src + i, dst + i, numValues - i);
+}
+
+KO_F16C_TARGET
+inline void floatToHalfF16C(const float *src, half *dst, int numValues)
+{
+    int i = 0;
+
+    for (; i + 8 <= numValues; i += 8) {
+        const __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), h);
+    }
+
+    floatToHalfScalar(src + i, dst + i, numValues - i);
+}
+
+#else /* KO_HAVE_F16C_CONVERSION */
+
+inline bool isF16CSupported()
+{
+    return false;
+}
+
+inline void halfToFloatF16C(const half *src, float *dst, int numValues)
+{
+    halfToFloatScalar(src, dst, numValues);
+}
+
+inline void floatToHalfF16C(const float *src, half *dst, int numValues)
+{
+    floatToHalfScalar(src, dst, numValues);
+}
+
+#endif /* KO_HAVE_F16C_CONVERSION */
+
+}
+
+#endif /* HAVE_OPENEXR */
+
+#endif // KOF16CONVERSION_H
@@ -254,6 +254,21 @@ public:
             KoStreamedMath<_impl>::template genericComposite32<false, true, AlphaDarkenCompositor32<quint8, quint32, ParamsWrapper> >(params);
         }
     }
+
+    virtual void compositeSpans(const KoCompositeOp::ParameterInfo& params, const QVector<KoCompositeOp::Span> &spans) const override
+    {
+        KoCompositeOp::ParameterInfo spanParams(params);
+
+        for (auto it = spans.constBegin(); it != spans.constEnd(); ++it) {
+            spanParams.setSpan(*it);
+
+            if(spanParams.maskRowStart) {
+                KoStreamedMath<_impl>::template genericComposite32<true, true, AlphaDarkenCompositor32<quint8, quint32, ParamsWrapper> >(spanParams);
+            } else {
+                KoStreamedMath<_impl>::template genericComposite32<false, true, AlphaDarkenCompositor32<quint8, quint32, ParamsWrapper> >(spanParams);
+            }
+        }
+    }
 };
 
 template<Vc::Implementation _impl>
@@ -0,0 +1,278 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KOOPTIMIZEDCOMPOSITEOPALPHADARKENU16_H_
+#define KOOPTIMIZEDCOMPOSITEOPALPHADARKENU16_H_
+
+#include "KoCompositeOpBase.h"
+#include "KoCompositeOpRegistry.h"
+#include "KoStreamedMath.h"
+#include <KoAlphaDarkenParamsWrapper.h>
+
+/**
+ * Alpha darken compositor for the pixels with 16-bit channels.
+ * \p pixelSize is either 8 (C1_C2_C3_A) or 4 (C1_A).
+ */
+template<int pixelSize, typename _ParamsWrapper>
+struct AlphaDarkenCompositorU16 {
+    using ParamsWrapper = _ParamsWrapper;
+
+    static const int numColorChannels = pixelSize / 2 - 1;
+    static const int alpha_pos = numColorChannels;
+
+    // \see docs in AlphaDarkenCompositor32
+    template<bool haveMask, bool src_aligned, Vc::Implementation _impl>
+    static ALWAYS_INLINE void compositeVector(const quint8 *src, quint8 *dst, const quint8 *mask, float opacity, const ParamsWrapper &oparams)
+    {
+        Vc::float_v src_alpha;
+        Vc::float_v dst_alpha;
+
+        // we don't use directly passed value
+        Q_UNUSED(opacity);
+
+        // instead we use value calculated by ParamsWrapper
+        opacity = oparams.opacity;
+        Vc::float_v opacity_vec(65535.0 * opacity);
+
+        Vc::float_v average_opacity_vec(65535.0 * oparams.averageOpacity);
+        Vc::float_v flow_norm_vec(oparams.flow);
+
+        Vc::float_v maskNormCoeff((float)1.0 / (255.0 * 65535.0));
+        Vc::float_v uint16MaxRec1((float)1.0 / 65535.0);
+        Vc::float_v uint16Max((float)65535.0);
+        Vc::float_v zeroValue(Vc::Zero);
+
+        Vc::float_v src_c[3];
+        Vc::float_v dst_c[3];
+
+        KoStreamedMath<_impl>::template fetch_channels_u16<pixelSize, src_aligned>(src, src_c, src_alpha);
+
+        Vc::float_v msk_norm_alpha;
+
+        if (haveMask) {
+            Vc::float_v mask_vec = KoStreamedMath<_impl>::fetch_mask_8(mask);
+            msk_norm_alpha = src_alpha * mask_vec * maskNormCoeff;
+        } else {
+            msk_norm_alpha = src_alpha * uint16MaxRec1;
+        }
+
+        src_alpha = msk_norm_alpha * opacity_vec;
+
+        bool srcAlphaIsZero = (src_alpha == zeroValue).isFull();
+        if (srcAlphaIsZero) return;
+
+        KoStreamedMath<_impl>::template fetch_channels_u16<pixelSize, true>(dst, dst_c, dst_alpha);
+
+        Vc::float_m empty_dst_pixels_mask = dst_alpha == zeroValue;
+
+        bool dstAlphaIsZero = empty_dst_pixels_mask.isFull();
+
+        Vc::float_v dst_blend = src_alpha * uint16MaxRec1;
+
+        bool srcAlphaIsUnit = (src_alpha == uint16Max).isFull();
+
+        if (dstAlphaIsZero) {
+            for (int i = 0; i < numColorChannels; i++) {
+                dst_c[i] = src_c[i];
+            }
+        } else if (srcAlphaIsUnit) {
+            bool dstAlphaIsUnit = (dst_alpha == uint16Max).isFull();
+            if (dstAlphaIsUnit) {
+                memcpy(dst, src, pixelSize * Vc::float_v::size());
+                return;
+            } else {
+                for (int i = 0; i < numColorChannels; i++) {
+                    dst_c[i] = src_c[i];
+                }
+            }
+        } else if (empty_dst_pixels_mask.isEmpty()) {
+            for (int i = 0; i < numColorChannels; i++) {
+                dst_c[i] = dst_blend * (src_c[i] - dst_c[i]) + dst_c[i];
+            }
+        } else {
+            Vc::float_m not_empty_dst_pixels_mask = !empty_dst_pixels_mask;
+
+            for (int i = 0; i < numColorChannels; i++) {
+                dst_c[i](not_empty_dst_pixels_mask) = dst_blend * (src_c[i] - dst_c[i]) + dst_c[i];
+                dst_c[i](empty_dst_pixels_mask) = src_c[i];
+            }
+        }
+
+        Vc::float_v fullFlowAlpha;
+
+        if (oparams.averageOpacity > opacity) {
+            Vc::float_m fullFlowAlpha_mask = average_opacity_vec > dst_alpha;
+
+            if (fullFlowAlpha_mask.isEmpty()) {
+                fullFlowAlpha = dst_alpha;
+            } else {
+                Vc::float_v reverse_blend = dst_alpha / average_opacity_vec;
+                Vc::float_v opt1 = (average_opacity_vec - src_alpha) * reverse_blend + src_alpha;
+                fullFlowAlpha(!fullFlowAlpha_mask) = dst_alpha;
+                fullFlowAlpha(fullFlowAlpha_mask) = opt1;
+            }
+        } else {
+            Vc::float_m fullFlowAlpha_mask = opacity_vec > dst_alpha;
+
+            if (fullFlowAlpha_mask.isEmpty()) {
+                fullFlowAlpha = dst_alpha;
+            } else {
+                Vc::float_v opt1 = (opacity_vec - dst_alpha) * msk_norm_alpha + dst_alpha;
+                fullFlowAlpha(!fullFlowAlpha_mask) = dst_alpha;
+                fullFlowAlpha(fullFlowAlpha_mask) = opt1;
+            }
+        }
+
+        if (oparams.flow == 1.0) {
+            dst_alpha = fullFlowAlpha;
+        } else {
+            Vc::float_v zeroFlowAlpha = ParamsWrapper::calculateZeroFlowAlpha(src_alpha, dst_alpha, uint16MaxRec1);
+            dst_alpha = (fullFlowAlpha - zeroFlowAlpha) * flow_norm_vec + zeroFlowAlpha;
+        }
+
+        KoStreamedMath<_impl>::template write_channels_u16<pixelSize>(dst, dst_c, dst_alpha);
+    }
+
+    /**
+     * Composes one pixel of the source into the destination
+     */
+    template <bool haveMask, Vc::Implementation _impl>
+    static ALWAYS_INLINE void compositeOnePixelScalar(const quint8 *s, quint8 *d, const quint8 *mask, float opacity, const ParamsWrapper &oparams)
+    {
+        using namespace Arithmetic;
+
+        const quint16 *src = reinterpret_cast<const quint16*>(s);
+        quint16 *dst = reinterpret_cast<quint16*>(d);
+
+        const float uint16Rec1 = 1.0 / 65535.0;
+        const float maskNormCoeff = 1.0 / (255.0 * 65535.0);
+        const float uint16Max = 65535.0;
+
+        quint16 dstAlphaInt = dst[alpha_pos];
+        float dstAlphaNorm = dstAlphaInt ? dstAlphaInt * uint16Rec1 : 0.0;
+        float srcAlphaNorm;
+        float mskAlphaNorm;
+
+        Q_UNUSED(opacity);
+        opacity = oparams.opacity;
+
+        if (haveMask) {
+            mskAlphaNorm = float(*mask) * maskNormCoeff * src[alpha_pos];
+            srcAlphaNorm = mskAlphaNorm * opacity;
+        } else {
+            mskAlphaNorm = src[alpha_pos] * uint16Rec1;
+            srcAlphaNorm = mskAlphaNorm * opacity;
+        }
+
+        if (dstAlphaInt != 0) {
+            for (int i = 0; i < numColorChannels; i++) {
+                dst[i] = KoStreamedMath<_impl>::lerp_mixed_u16_float(dst[i], src[i], srcAlphaNorm);
+            }
+        } else {
+            KoStreamedMathFunctions::copyPixel<pixelSize>(s, d);
+        }
+
+        float flow = oparams.flow;
+        float averageOpacity = oparams.averageOpacity;
+
+        float fullFlowAlpha;
+
+        if (averageOpacity > opacity) {
+            fullFlowAlpha = averageOpacity > dstAlphaNorm ? lerp(srcAlphaNorm, averageOpacity, dstAlphaNorm / averageOpacity) : dstAlphaNorm;
+        } else {
+            fullFlowAlpha = opacity > dstAlphaNorm ? lerp(dstAlphaNorm, opacity, mskAlphaNorm) : dstAlphaNorm;
+        }
+
+        float dstAlpha;
+
+        if (flow == 1.0) {
+            dstAlpha = fullFlowAlpha * uint16Max;
+        } else {
+            float zeroFlowAlpha = ParamsWrapper::calculateZeroFlowAlpha(srcAlphaNorm, dstAlphaNorm);
+            dstAlpha = lerp(zeroFlowAlpha, fullFlowAlpha, flow) * uint16Max;
+        }
+
+        dst[alpha_pos] = KoStreamedMath<_impl>::round_float_to_u16(dstAlpha);
+    }
+};
+
+/**
+ * An optimized version of a composite op for the use in colorspaces
+ * with 16-bit channels and alpha channel placed at the last channel
+ * of the pixel: C1_C2_C3_A (\p pixelSize is 8) or C1_A (\p pixelSize
+ * is 4).
+ */
+template<Vc::Implementation _impl, int pixelSize, class ParamsWrapper>
+class KoOptimizedCompositeOpAlphaDarkenU16Impl : public KoCompositeOp
+{
+public:
+    KoOptimizedCompositeOpAlphaDarkenU16Impl(const KoColorSpace* cs)
+        : KoCompositeOp(cs, COMPOSITE_ALPHA_DARKEN, i18n("Alpha darken"), KoCompositeOp::categoryMix()) {}
+
+    using KoCompositeOp::composite;
+
+    virtual void composite(const KoCompositeOp::ParameterInfo& params) const override
+    {
+        if(params.maskRowStart) {
+            KoStreamedMath<_impl>::template genericComposite<true, true, AlphaDarkenCompositorU16<pixelSize, ParamsWrapper>, pixelSize>(params);
+        } else {
+            KoStreamedMath<_impl>::template genericComposite<false, true, AlphaDarkenCompositorU16<pixelSize, ParamsWrapper>, pixelSize>(params);
+        }
+    }
+};
+
+template<Vc::Implementation _impl>
+class KoOptimizedCompositeOpAlphaDarkenHardU16 :
+        public KoOptimizedCompositeOpAlphaDarkenU16Impl<_impl, 8, KoAlphaDarkenParamsWrapperHard>
+{
+public:
+    KoOptimizedCompositeOpAlphaDarkenHardU16(const KoColorSpace *cs)
+        : KoOptimizedCompositeOpAlphaDarkenU16Impl<_impl, 8, KoAlphaDarkenParamsWrapperHard>(cs) {
+    }
+};
+
+template<Vc::Implementation _impl>
+class KoOptimizedCompositeOpAlphaDarkenCreamyU16 :
+        public KoOptimizedCompositeOpAlphaDarkenU16Impl<_impl, 8, KoAlphaDarkenParamsWrapperCreamy>
+{
+public:
+    KoOptimizedCompositeOpAlphaDarkenCreamyU16(const KoColorSpace *cs)
+        : KoOptimizedCompositeOpAlphaDarkenU16Impl<_impl, 8, KoAlphaDarkenParamsWrapperCreamy>(cs) {
+    }
+};
+
+template<Vc::Implementation _impl>
+class KoOptimizedCompositeOpAlphaDarkenHardGrayU16 :
+        public KoOptimizedCompositeOpAlphaDarkenU16Impl<_impl, 4, KoAlphaDarkenParamsWrapperHard>
+{
+public:
+    KoOptimizedCompositeOpAlphaDarkenHardGrayU16(const KoColorSpace *cs)
+        : KoOptimizedCompositeOpAlphaDarkenU16Impl<_impl, 4, KoAlphaDarkenParamsWrapperHard>(cs) {
+    }
+};
+
+template<Vc::Implementation _impl>
+class KoOptimizedCompositeOpAlphaDarkenCreamyGrayU16 :
+        public KoOptimizedCompositeOpAlphaDarkenU16Impl<_impl, 4, KoAlphaDarkenParamsWrapperCreamy>
+{
+public:
+    KoOptimizedCompositeOpAlphaDarkenCreamyGrayU16(const KoColorSpace *cs)
+        : KoOptimizedCompositeOpAlphaDarkenU16Impl<_impl, 4, KoAlphaDarkenParamsWrapperCreamy>(cs) {
+    }
+};
+
+#endif // KOOPTIMIZEDCOMPOSITEOPALPHADARKENU16_H_
@@ -0,0 +1,201 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KOOPTIMIZEDCOMPOSITEOPCOPYU16_H_
+#define KOOPTIMIZEDCOMPOSITEOPCOPYU16_H_
+
+#include "KoCompositeOpBase.h"
+#include "KoCompositeOpRegistry.h"
+#include "KoCompositeOpCopy2.h"
+#include "KoColorSpaceTraits.h"
+#include "KoStreamedMath.h"
+
+
+/**
+ * Copy compositor for the pixels with 16-bit channels. \p pixelSize is
+ * either 8 (C1_C2_C3_A) or 4 (C1_A). The math is the same as in
+ * KoCompositeOpCopy2: the channels are premultiplied, blended and then
+ * unpremultiplied back.
+ */
+template<int pixelSize, bool alphaLocked, bool allChannelsFlag>
+struct CopyCompositorU16 {
+    static const int numColorChannels = pixelSize / 2 - 1;
+    static const int alpha_pos = numColorChannels;
+
+    typedef KoColorSpaceTrait<quint16, numColorChannels + 1, alpha_pos> Traits;
+
+    struct ParamsWrapper {
+        ParamsWrapper(const KoCompositeOp::ParameterInfo& params)
+            : channelFlags(params.channelFlags)
+        {
+        }
+        const QBitArray &channelFlags;
+    };
+
+    // \see docs in AlphaDarkenCompositor32
+    template<bool haveMask, bool src_aligned, Vc::Implementation _impl>
+    static ALWAYS_INLINE void compositeVector(const quint8 *src, quint8 *dst, const quint8 *mask, float opacity, const ParamsWrapper &oparams)
+    {
+        Q_UNUSED(oparams);
+
+        if (!haveMask && opacity == 1.0) {
+            memcpy(dst, src, pixelSize * Vc::float_v::size());
+            return;
+        }
+
+        Vc::float_v opacity_vec(opacity);
+
+        Vc::float_v uint16Max((float)65535.0);
+        Vc::float_v uint8MaxRec1((float)1.0 / 255.0);
+        Vc::float_v zeroValue(Vc::Zero);
+        Vc::float_v oneValue(Vc::One);
+        Vc::float_v halfValue((float)0.5);
+
+        if (haveMask) {
+            Vc::float_v mask_vec = KoStreamedMath<_impl>::fetch_mask_8(mask);
+            opacity_vec *= mask_vec * uint8MaxRec1;
+        }
+
+        if ((opacity_vec == zeroValue).isFull()) {
+            return;
+        }
+
+        Vc::float_v src_alpha;
+        Vc::float_v dst_alpha;
+
+        Vc::float_v src_c[3];
+        Vc::float_v dst_c[3];
+
+        KoStreamedMath<_impl>::template fetch_channels_u16<pixelSize, src_aligned>(src, src_c, src_alpha);
+        KoStreamedMath<_impl>::template fetch_channels_u16<pixelSize, true>(dst, dst_c, dst_alpha);
+
+        Vc::float_v new_alpha = (src_alpha - dst_alpha) * opacity_vec + dst_alpha;
+
+        // the color of the pixels with zero opacity is not changed...
+        Vc::float_m transparent_pixels_mask = new_alpha < halfValue;
+
+        // ... except the ones that are overwritten completely
+        Vc::float_m opaque_copy_mask = opacity_vec == oneValue;
+
+        for (int i = 0; i < numColorChannels; i++) {
+            Vc::float_v dst_mult = dst_c[i] * dst_alpha;
+            Vc::float_v src_mult = src_c[i] * src_alpha;
+            Vc::float_v result = ((src_mult - dst_mult) * opacity_vec + dst_mult) / new_alpha;
+
+            result(transparent_pixels_mask) = dst_c[i];
+            result(opaque_copy_mask) = src_c[i];
+
+            dst_c[i] = Vc::min(Vc::max(result, zeroValue), uint16Max);
+        }
+
+        KoStreamedMath<_impl>::template write_channels_u16<pixelSize>(dst, dst_c, new_alpha);
+    }
+
+    template <bool haveMask, Vc::Implementation _impl>
+    static ALWAYS_INLINE void compositeOnePixelScalar(const quint8 *s, quint8 *d, const quint8 *mask, float opacity, const ParamsWrapper &oparams)
+    {
+        using namespace Arithmetic;
+
+        const quint16 *src = reinterpret_cast<const quint16*>(s);
+        quint16 *dst = reinterpret_cast<quint16*>(d);
+
+        const quint16 srcAlpha = src[alpha_pos];
+        const quint16 dstAlpha = dst[alpha_pos];
+        const quint16 mskAlpha = haveMask ? scale<quint16>(*mask) : unitValue<quint16>();
+
+        if (!allChannelsFlag && dstAlpha == zeroValue<quint16>()) {
+            KoStreamedMathFunctions::clearPixel<pixelSize>(d);
+        }
+
+        const quint16 newDstAlpha =
+            KoCompositeOpCopy2<Traits>::template composeColorChannels<alphaLocked, allChannelsFlag>(
+                src, srcAlpha, dst, dstAlpha, mskAlpha, scale<quint16>(opacity), oparams.channelFlags);
+
+        dst[alpha_pos] = alphaLocked ? dstAlpha : newDstAlpha;
+    }
+};
+
+/**
+ * An optimized version of the COPY composite op for the use in
+ * colorspaces with 16-bit channels and alpha channel placed at the
+ * last channel of the pixel: C1_C2_C3_A (\p pixelSize is 8) or C1_A
+ * (\p pixelSize is 4).
+ */
+template<Vc::Implementation _impl, int pixelSize>
+class KoOptimizedCompositeOpCopyU16Impl : public KoCompositeOp
+{
+    static const int numChannels = pixelSize / 2;
+    static const int alpha_pos = numChannels - 1;
+
+public:
+    KoOptimizedCompositeOpCopyU16Impl(const KoColorSpace* cs)
+        : KoCompositeOp(cs, COMPOSITE_COPY, i18n("Copy"), KoCompositeOp::categoryMisc()) {}
+
+    using KoCompositeOp::composite;
+
+    virtual void composite(const KoCompositeOp::ParameterInfo& params) const
+    {
+        if(params.maskRowStart) {
+            composite<true>(params);
+        } else {
+            composite<false>(params);
+        }
+    }
+
+    template <bool haveMask>
+    inline void composite(const KoCompositeOp::ParameterInfo& params) const {
+        if (params.channelFlags.isEmpty() ||
+            params.channelFlags == QBitArray(numChannels, true)) {
+
+            KoStreamedMath<_impl>::template genericComposite<haveMask, false, CopyCompositorU16<pixelSize, false, true>, pixelSize>(params);
+        } else {
+            bool allChannelsFlag = true;
+            for (int i = 0; i < alpha_pos; i++) {
+                allChannelsFlag &= params.channelFlags.at(i);
+            }
+
+            const bool alphaLocked =
+                !params.channelFlags.at(alpha_pos);
+
+            if (allChannelsFlag && alphaLocked) {
+                KoStreamedMath<_impl>::template genericComposite_novector<haveMask, false, CopyCompositorU16<pixelSize, true, true>, pixelSize>(params);
+            } else if (!allChannelsFlag && !alphaLocked) {
+                KoStreamedMath<_impl>::template genericComposite_novector<haveMask, false, CopyCompositorU16<pixelSize, false, false>, pixelSize>(params);
+            } else /*if (!allChannelsFlag && alphaLocked) */{
+                KoStreamedMath<_impl>::template genericComposite_novector<haveMask, false, CopyCompositorU16<pixelSize, true, false>, pixelSize>(params);
+            }
+        }
+    }
+};
+
+template<Vc::Implementation _impl>
+class KoOptimizedCompositeOpCopyU16 : public KoOptimizedCompositeOpCopyU16Impl<_impl, 8>
+{
+public:
+    KoOptimizedCompositeOpCopyU16(const KoColorSpace* cs)
+        : KoOptimizedCompositeOpCopyU16Impl<_impl, 8>(cs) {}
+};
+
+template<Vc::Implementation _impl>
+class KoOptimizedCompositeOpCopyGrayU16 : public KoOptimizedCompositeOpCopyU16Impl<_impl, 4>
+{
+public:
+    KoOptimizedCompositeOpCopyGrayU16(const KoColorSpace* cs)
+        : KoOptimizedCompositeOpCopyU16Impl<_impl, 4>(cs) {}
+};
+
+#endif // KOOPTIMIZEDCOMPOSITEOPCOPYU16_H_
@@ -0,0 +1,185 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KOOPTIMIZEDCOMPOSITEOPF16_H_
+#define KOOPTIMIZEDCOMPOSITEOPF16_H_
+
+#include <KoConfig.h>
+
+#ifdef HAVE_OPENEXR
+
+#include <half.h>
+
+#include "KoCompositeOpBase.h"
+#include "KoCompositeOpRegistry.h"
+#include "KoCompositeOpAlphaDarken.h"
+#include "KoAlphaDarkenParamsWrapper.h"
+#include "KoOptimizedCompositeOpOver128.h"
+#include "KoColorSpaceTraits.h"
+#include "KoF16Conversion.h"
+
+/**
+ * A composite op for the colorspaces with half-float C1_C2_C3_A pixels.
+ * It converts the rows into 32-bit float buffers in chunks, composites
+ * them with \p FloatCompositeOp (an op for KoRgbF32Traits pixels) and
+ * converts the destination back.
+ *
+ * The conversion uses F16C instructions when the op is built for AVX
+ * and the CPU supports them. Otherwise the conversion tables of
+ * OpenEXR are used.
+ */
+template<Vc::Implementation _impl, class FloatCompositeOp>
+class KoOptimizedCompositeOpF16Wrapper : public KoCompositeOp
+{
+    static const int numChannels = 4;
+    static const int chunkSize = 256;
+
+public:
+    KoOptimizedCompositeOpF16Wrapper(const KoColorSpace *cs, const QString &id,
+                                     const QString &description, const QString &category)
+        : KoCompositeOp(cs, id, description, category),
+          m_floatOp(cs),
+          m_useF16C((_impl == Vc::AVXImpl || _impl == Vc::AVX2Impl) &&
+                    KoF16Conversion::isF16CSupported())
+    {
+    }
+
+    using KoCompositeOp::composite;
+
+    void composite(const KoCompositeOp::ParameterInfo& params) const override
+    {
+        alignas(64) float srcBuffer[chunkSize * numChannels];
+        alignas(64) float dstBuffer[chunkSize * numChannels];
+
+        const int floatPixelSize = numChannels * sizeof(float);
+        const int halfPixelSize = numChannels * sizeof(half);
+
+        KoCompositeOp::ParameterInfo chunkParams(params);
+        chunkParams.rows = 1;
+        chunkParams.srcRowStart = reinterpret_cast<quint8*>(srcBuffer);
+        chunkParams.dstRowStart = reinterpret_cast<quint8*>(dstBuffer);
+
+        // the source of zero stride is a single pixel that is
+        // applied to the whole area
+        const bool srcIsSinglePixel = !params.srcRowStride;
+
+        if (srcIsSinglePixel) {
+            toFloat(params.srcRowStart, srcBuffer, 1);
+            chunkParams.srcRowStride = 0;
+        }
+
+        const quint8 *srcRowStart = params.srcRowStart;
+        quint8 *dstRowStart = params.dstRowStart;
+        const quint8 *maskRowStart = params.maskRowStart;
+
+        for (int row = 0; row < params.rows; row++) {
+            for (int col = 0; col < params.cols; col += chunkSize) {
+                const int numPixels = qMin(chunkSize, params.cols - col);
+
+                if (!srcIsSinglePixel) {
+                    toFloat(srcRowStart + col * halfPixelSize, srcBuffer, numPixels);
+                    chunkParams.srcRowStride = numPixels * floatPixelSize;
+                }
+
+                toFloat(dstRowStart + col * halfPixelSize, dstBuffer, numPixels);
+
+                chunkParams.dstRowStride = numPixels * floatPixelSize;
+                chunkParams.maskRowStart = maskRowStart ? maskRowStart + col : 0;
+                chunkParams.cols = numPixels;
+
+                m_floatOp.composite(chunkParams);
+
+                fromFloat(dstBuffer, dstRowStart + col * halfPixelSize, numPixels);
+            }
+
+            srcRowStart += params.srcRowStride;
+            dstRowStart += params.dstRowStride;
+
+            if (maskRowStart) {
+                maskRowStart += params.maskRowStride;
+            }
+        }
+    }
+
+private:
+    inline void toFloat(const quint8 *src, float *dst, int numPixels) const {
+        const half *s = reinterpret_cast<const half*>(src);
+
+        if (m_useF16C) {
+            KoF16Conversion::halfToFloatF16C(s, dst, numPixels * numChannels);
+        } else {
+            KoF16Conversion::halfToFloatScalar(s, dst, numPixels * numChannels);
+        }
+    }
+
+    inline void fromFloat(const float *src, quint8 *dst, int numPixels) const {
+        half *d = reinterpret_cast<half*>(dst);
+
+        if (m_useF16C) {
+            KoF16Conversion::floatToHalfF16C(src, d, numPixels * numChannels);
+        } else {
+            KoF16Conversion::floatToHalfScalar(src, d, numPixels * numChannels);
+        }
+    }
+
+private:
+    FloatCompositeOp m_floatOp;
+    const bool m_useF16C;
+};
+
+/**
+ * Over op for half-float C1_C2_C3_A pixels that uses the vectorized
+ * KoOptimizedCompositeOpOver128 kernel
+ */
+template<Vc::Implementation _impl>
+class KoOptimizedCompositeOpOverF16
+    : public KoOptimizedCompositeOpF16Wrapper<_impl, KoOptimizedCompositeOpOver128<_impl>>
+{
+public:
+    KoOptimizedCompositeOpOverF16(const KoColorSpace *cs)
+        : KoOptimizedCompositeOpF16Wrapper<_impl, KoOptimizedCompositeOpOver128<_impl>>(
+              cs, COMPOSITE_OVER, i18n("Normal"), KoCompositeOp::categoryMix()) {}
+};
+
+/**
+ * Alpha darken ops for half-float C1_C2_C3_A pixels. They use the same
+ * float implementation as the RGBA F32 colorspace does, see the notes
+ * about the 128-bit kernel in KoCompositeOps.h
+ */
+template<Vc::Implementation _impl>
+class KoOptimizedCompositeOpAlphaDarkenHardF16
+    : public KoOptimizedCompositeOpF16Wrapper<_impl, KoCompositeOpAlphaDarken<KoRgbF32Traits, KoAlphaDarkenParamsWrapperHard>>
+{
+public:
+    KoOptimizedCompositeOpAlphaDarkenHardF16(const KoColorSpace *cs)
+        : KoOptimizedCompositeOpF16Wrapper<_impl, KoCompositeOpAlphaDarken<KoRgbF32Traits, KoAlphaDarkenParamsWrapperHard>>(
+              cs, COMPOSITE_ALPHA_DARKEN, i18n("Alpha darken"), KoCompositeOp::categoryMix()) {}
+};
+
+template<Vc::Implementation _impl>
+class KoOptimizedCompositeOpAlphaDarkenCreamyF16
+    : public KoOptimizedCompositeOpF16Wrapper<_impl, KoCompositeOpAlphaDarken<KoRgbF32Traits, KoAlphaDarkenParamsWrapperCreamy>>
+{
+public:
+    KoOptimizedCompositeOpAlphaDarkenCreamyF16(const KoColorSpace *cs)
+        : KoOptimizedCompositeOpF16Wrapper<_impl, KoCompositeOpAlphaDarken<KoRgbF32Traits, KoAlphaDarkenParamsWrapperCreamy>>(
+              cs, COMPOSITE_ALPHA_DARKEN, i18n("Alpha darken"), KoCompositeOp::categoryMix()) {}
+};
+
+#endif /* HAVE_OPENEXR */
+
+#endif // KOOPTIMIZEDCOMPOSITEOPF16_H_
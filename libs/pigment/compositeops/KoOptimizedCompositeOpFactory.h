@@ -21,9 +21,11 @@
 #define KOOPTIMIZEDCOMPOSITEOPFACTORY_H
 
 #include "kritapigment_export.h"
+#include <KoConfig.h>
 
 class KoCompositeOp;
 class KoColorSpace;
+class QString;
 
 /**
  * The creation of the optimized composite ops is moved into a separate
@@ -46,6 +48,33 @@ public:
     static KoCompositeOp* createAlphaDarkenOpHard128(const KoColorSpace *cs);
     static KoCompositeOp* createAlphaDarkenOpCreamy128(const KoColorSpace *cs);
     static KoCompositeOp* createOverOp128(const KoColorSpace *cs);
+    static KoCompositeOp* createAlphaDarkenOpHardU16(const KoColorSpace *cs);
+    static KoCompositeOp* createAlphaDarkenOpCreamyU16(const KoColorSpace *cs);
+    static KoCompositeOp* createOverOpU16(const KoColorSpace *cs);
+    static KoCompositeOp* createCopyOpU16(const KoColorSpace *cs);
+    static KoCompositeOp* createAlphaDarkenOpHardGrayU16(const KoColorSpace *cs);
+    static KoCompositeOp* createAlphaDarkenOpCreamyGrayU16(const KoColorSpace *cs);
+    static KoCompositeOp* createOverOpGrayU16(const KoColorSpace *cs);
+    static KoCompositeOp* createCopyOpGrayU16(const KoColorSpace *cs);
+
+#ifdef HAVE_OPENEXR
+    /**
+     * The ops for half-float C1_C2_C3_A pixels convert the pixels into
+     * 32-bit floats (using F16C instructions when available) and reuse
+     * the 32-bit float composition code
+     */
+    static KoCompositeOp* createAlphaDarkenOpHardF16(const KoColorSpace *cs);
+    static KoCompositeOp* createAlphaDarkenOpCreamyF16(const KoColorSpace *cs);
+    static KoCompositeOp* createOverOpF16(const KoColorSpace *cs);
+#endif
+
+    /**
+     * Creates a vectorized version of the separable composite op \p id
+     * for colorspaces with 8-bit channels. Returns null if the blending
+     * function has no vectorized version.
+     */
+    static KoCompositeOp* createGenericSCOp32(const KoColorSpace *cs, const QString &id,
+                                              const QString &description, const QString &category);
 };
 
 #endif /* KOOPTIMIZEDCOMPOSITEOPFACTORY_H */
@@ -22,6 +22,7 @@
 
 
 #include <compositeops/KoVcMultiArchBuildSupport.h>
+#include <QString>
 
 
 class KoCompositeOp;
@@ -46,6 +47,39 @@ class KoOptimizedCompositeOpAlphaDarkenCreamy128;
 template<Vc::Implementation _impl>
 class KoOptimizedCompositeOpOver128;
 
+template<Vc::Implementation _impl>
+class KoOptimizedCompositeOpAlphaDarkenHardU16;
+
+template<Vc::Implementation _impl>
+class KoOptimizedCompositeOpAlphaDarkenCreamyU16;
+
+template<Vc::Implementation _impl>
+class KoOptimizedCompositeOpOverU16;
+
+template<Vc::Implementation _impl>
+class KoOptimizedCompositeOpCopyU16;
+
+template<Vc::Implementation _impl>
+class KoOptimizedCompositeOpAlphaDarkenHardGrayU16;
+
+template<Vc::Implementation _impl>
+class KoOptimizedCompositeOpAlphaDarkenCreamyGrayU16;
+
+template<Vc::Implementation _impl>
+class KoOptimizedCompositeOpOverGrayU16;
+
+template<Vc::Implementation _impl>
+class KoOptimizedCompositeOpCopyGrayU16;
+
+template<Vc::Implementation _impl>
+class KoOptimizedCompositeOpAlphaDarkenHardF16;
+
+template<Vc::Implementation _impl>
+class KoOptimizedCompositeOpAlphaDarkenCreamyF16;
+
+template<Vc::Implementation _impl>
+class KoOptimizedCompositeOpOverF16;
+
 template<template<Vc::Implementation I> class CompositeOp>
 struct KoOptimizedCompositeOpFactoryPerArch
 {
@@ -56,5 +90,24 @@ struct KoOptimizedCompositeOpFactoryPerArch
     static ReturnType create(ParamType param);
 };
 
+/**
+ * The separable blending ops are created by id, so they have a
+ * separate factory. create() returns null if there is no optimized
+ * version of the op for the given id.
+ */
+struct KoOptimizedCompositeOpGenericSCFactoryPerArch
+{
+    struct ParamType {
+        const KoColorSpace *cs;
+        QString id;
+        QString description;
+        QString category;
+    };
+
+    typedef KoCompositeOp* ReturnType;
+
+    template<Vc::Implementation _impl>
+    static ReturnType create(ParamType param);
+};
 
 #endif /* KOOPTIMIZEDCOMPOSITEOPFACTORYPERARCH_H */
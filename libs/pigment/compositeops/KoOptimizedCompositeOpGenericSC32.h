@@ -0,0 +1,347 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KOOPTIMIZEDCOMPOSITEOPGENERICSC32_H_
+#define KOOPTIMIZEDCOMPOSITEOPGENERICSC32_H_
+
+#include "KoCompositeOpBase.h"
+#include "KoCompositeOpGeneric.h"
+#include "KoCompositeOpRegistry.h"
+#include "KoColorSpaceTraits.h"
+#include "KoStreamedMath.h"
+
+
+/**
+ * Vector versions of the separable blending functions from
+ * KoCompositeOpFunctions.h. blend() gets the channel values normalized
+ * into [0.0, 1.0] range. composeScalar() is the original function that
+ * is used for the pixels that cannot be processed in a vector.
+ *
+ * The comparisons with the half value use 127.5 / 255, so that the
+ * normalized values split exactly the way the integer ones compare
+ * with halfValue<quint8>() (127).
+ */
+namespace KoVectorBlendFunctions {
+
+static const float halfValueU8 = 127.0f / 255.0f;
+static const float halfThresholdU8 = 127.5f / 255.0f;
+
+struct Multiply {
+    static ALWAYS_INLINE Vc::float_v blend(Vc::float_v::AsArg src, Vc::float_v::AsArg dst) {
+        return src * dst;
+    }
+    static quint8 composeScalar(quint8 src, quint8 dst) { return cfMultiply(src, dst); }
+};
+
+struct Screen {
+    static ALWAYS_INLINE Vc::float_v blend(Vc::float_v::AsArg src, Vc::float_v::AsArg dst) {
+        return src + dst - src * dst;
+    }
+    static quint8 composeScalar(quint8 src, quint8 dst) { return cfScreen(src, dst); }
+};
+
+struct HardLight {
+    static ALWAYS_INLINE Vc::float_v blend(Vc::float_v::AsArg src, Vc::float_v::AsArg dst) {
+        const Vc::float_v src2 = src + src;
+
+        // screen(src * 2.0 - 1.0, dst)
+        const Vc::float_v srcScreen = src2 - Vc::float_v(Vc::One);
+        Vc::float_v result = srcScreen + dst - srcScreen * dst;
+
+        // multiply(src * 2.0, dst)
+        result(src < Vc::float_v(halfThresholdU8)) = src2 * dst;
+
+        return result;
+    }
+    static quint8 composeScalar(quint8 src, quint8 dst) { return cfHardLight(src, dst); }
+};
+
+struct Overlay {
+    static ALWAYS_INLINE Vc::float_v blend(Vc::float_v::AsArg src, Vc::float_v::AsArg dst) {
+        return HardLight::blend(dst, src);
+    }
+    static quint8 composeScalar(quint8 src, quint8 dst) { return cfOverlay(src, dst); }
+};
+
+struct Addition {
+    static ALWAYS_INLINE Vc::float_v blend(Vc::float_v::AsArg src, Vc::float_v::AsArg dst) {
+        return Vc::min(src + dst, Vc::float_v(Vc::One));
+    }
+    static quint8 composeScalar(quint8 src, quint8 dst) { return cfAddition(src, dst); }
+};
+
+struct Subtract {
+    static ALWAYS_INLINE Vc::float_v blend(Vc::float_v::AsArg src, Vc::float_v::AsArg dst) {
+        return Vc::max(dst - src, Vc::float_v(Vc::Zero));
+    }
+    static quint8 composeScalar(quint8 src, quint8 dst) { return cfSubtract(src, dst); }
+};
+
+struct LinearBurn {
+    static ALWAYS_INLINE Vc::float_v blend(Vc::float_v::AsArg src, Vc::float_v::AsArg dst) {
+        return Vc::max(src + dst - Vc::float_v(Vc::One), Vc::float_v(Vc::Zero));
+    }
+    static quint8 composeScalar(quint8 src, quint8 dst) { return cfLinearBurn(src, dst); }
+};
+
+struct DarkenOnly {
+    static ALWAYS_INLINE Vc::float_v blend(Vc::float_v::AsArg src, Vc::float_v::AsArg dst) {
+        return Vc::min(src, dst);
+    }
+    static quint8 composeScalar(quint8 src, quint8 dst) { return cfDarkenOnly(src, dst); }
+};
+
+struct LightenOnly {
+    static ALWAYS_INLINE Vc::float_v blend(Vc::float_v::AsArg src, Vc::float_v::AsArg dst) {
+        return Vc::max(src, dst);
+    }
+    static quint8 composeScalar(quint8 src, quint8 dst) { return cfLightenOnly(src, dst); }
+};
+
+struct Difference {
+    static ALWAYS_INLINE Vc::float_v blend(Vc::float_v::AsArg src, Vc::float_v::AsArg dst) {
+        return Vc::abs(src - dst);
+    }
+    static quint8 composeScalar(quint8 src, quint8 dst) { return cfDifference(src, dst); }
+};
+
+struct Exclusion {
+    static ALWAYS_INLINE Vc::float_v blend(Vc::float_v::AsArg src, Vc::float_v::AsArg dst) {
+        const Vc::float_v x = src * dst;
+        return Vc::min(Vc::max(dst + src - (x + x), Vc::float_v(Vc::Zero)), Vc::float_v(Vc::One));
+    }
+    static quint8 composeScalar(quint8 src, quint8 dst) { return cfExclusion(src, dst); }
+};
+
+struct GrainMerge {
+    static ALWAYS_INLINE Vc::float_v blend(Vc::float_v::AsArg src, Vc::float_v::AsArg dst) {
+        return Vc::min(Vc::max(dst + src - Vc::float_v(halfValueU8), Vc::float_v(Vc::Zero)), Vc::float_v(Vc::One));
+    }
+    static quint8 composeScalar(quint8 src, quint8 dst) { return cfGrainMerge(src, dst); }
+};
+
+struct GrainExtract {
+    static ALWAYS_INLINE Vc::float_v blend(Vc::float_v::AsArg src, Vc::float_v::AsArg dst) {
+        return Vc::min(Vc::max(dst - src + Vc::float_v(halfValueU8), Vc::float_v(Vc::Zero)), Vc::float_v(Vc::One));
+    }
+    static quint8 composeScalar(quint8 src, quint8 dst) { return cfGrainExtract(src, dst); }
+};
+
+}
+
+
+/**
+ * A compositor for the separable blending functions for 32-bit
+ * pixels with 8-bit channels and the alpha placed in the most
+ * significant byte. The vector path calculates the same formula as
+ * KoCompositeOpGenericSC, but in floating point:
+ *
+ *     newDstAlpha = unionShapeOpacity(srcAlpha, dstAlpha)
+ *     dst = blend(src, srcAlpha, dst, dstAlpha, func(src, dst)) / newDstAlpha
+ *
+ * The scalar path calls KoCompositeOpGenericSC directly, so the pixels
+ * of the row tails are bit-exact with the generic version.
+ */
+template<class BlendFunc, bool alphaLocked, bool allChannelsFlag>
+struct GenericSCCompositor32 {
+    typedef KoCompositeOpGenericSC<KoBgrU8Traits, &BlendFunc::composeScalar> GenericOp;
+
+    struct ParamsWrapper {
+        ParamsWrapper(const KoCompositeOp::ParameterInfo& params)
+            : channelFlags(params.channelFlags)
+        {
+        }
+        const QBitArray &channelFlags;
+    };
+
+    // \see docs in AlphaDarkenCompositor32
+    template<bool haveMask, bool src_aligned, Vc::Implementation _impl>
+    static ALWAYS_INLINE void compositeVector(const quint8 *src, quint8 *dst, const quint8 *mask, float opacity, const ParamsWrapper &oparams)
+    {
+        Q_UNUSED(oparams);
+
+        Vc::float_v uint8Max((float)255.0);
+        Vc::float_v uint8MaxRec1((float)1.0 / 255.0);
+        Vc::float_v zeroValue(Vc::Zero);
+        Vc::float_v oneValue(Vc::One);
+
+        Vc::float_v src_alpha = KoStreamedMath<_impl>::template fetch_alpha_32<src_aligned>(src);
+        src_alpha *= Vc::float_v(opacity) * uint8MaxRec1;
+
+        if (haveMask) {
+            Vc::float_v mask_vec = KoStreamedMath<_impl>::fetch_mask_8(mask);
+            src_alpha *= mask_vec * uint8MaxRec1;
+        }
+
+        // the fully transparent source doesn't change the destination
+        if ((src_alpha == zeroValue).isFull()) {
+            return;
+        }
+
+        Vc::float_v dst_alpha = KoStreamedMath<_impl>::template fetch_alpha_32<true>(dst);
+        dst_alpha *= uint8MaxRec1;
+
+        Vc::float_v src_c[3];
+        Vc::float_v dst_c[3];
+
+        KoStreamedMath<_impl>::template fetch_colors_32<src_aligned>(src, src_c[0], src_c[1], src_c[2]);
+        KoStreamedMath<_impl>::template fetch_colors_32<true>(dst, dst_c[0], dst_c[1], dst_c[2]);
+
+        const Vc::float_v src_dst_alpha = src_alpha * dst_alpha;
+        const Vc::float_v new_alpha = src_alpha + dst_alpha - src_dst_alpha;
+
+        /**
+         * The pixels with zero resulting alpha keep their colors
+         * (both source and destination alphas are zero there)
+         */
+        const Vc::float_m empty_pixels_mask = new_alpha == zeroValue;
+        const Vc::float_v new_alpha_rec = oneValue / new_alpha;
+
+        const Vc::float_v dst_only_weight = (oneValue - src_alpha) * dst_alpha;
+        const Vc::float_v src_only_weight = (oneValue - dst_alpha) * src_alpha;
+
+        for (int i = 0; i < 3; i++) {
+            const Vc::float_v s = src_c[i] * uint8MaxRec1;
+            const Vc::float_v d = dst_c[i] * uint8MaxRec1;
+
+            const Vc::float_v f = BlendFunc::blend(s, d);
+
+            Vc::float_v result =
+                (dst_only_weight * d + src_only_weight * s + src_dst_alpha * f) *
+                new_alpha_rec * uint8Max;
+
+            result(empty_pixels_mask) = dst_c[i];
+            dst_c[i] = result;
+        }
+
+        KoStreamedMath<_impl>::write_channels_32(dst, new_alpha * uint8Max, dst_c[0], dst_c[1], dst_c[2]);
+    }
+
+    template <bool haveMask, Vc::Implementation _impl>
+    static ALWAYS_INLINE void compositeOnePixelScalar(const quint8 *src, quint8 *dst, const quint8 *mask, float opacity, const ParamsWrapper &oparams)
+    {
+        using namespace Arithmetic;
+        const qint32 alpha_pos = 3;
+
+        const quint8 srcAlpha = src[alpha_pos];
+        const quint8 dstAlpha = dst[alpha_pos];
+        const quint8 mskAlpha = haveMask ? *mask : unitValue<quint8>();
+
+        if (!allChannelsFlag && dstAlpha == zeroValue<quint8>()) {
+            KoStreamedMathFunctions::clearPixel<4>(dst);
+        }
+
+        const quint8 newDstAlpha =
+            GenericOp::template composeColorChannels<alphaLocked, allChannelsFlag>(
+                src, srcAlpha, dst, dstAlpha, mskAlpha, scale<quint8>(opacity), oparams.channelFlags);
+
+        dst[alpha_pos] = alphaLocked ? dstAlpha : newDstAlpha;
+    }
+};
+
+/**
+ * An optimized version of KoCompositeOpGenericSC for the use in
+ * colorspaces with 8-bit channels and alpha channel placed at the last
+ * byte of the pixel: C1_C2_C3_A.
+ */
+template<Vc::Implementation _impl, class BlendFunc>
+class KoOptimizedCompositeOpGenericSC32 : public KoCompositeOp
+{
+public:
+    KoOptimizedCompositeOpGenericSC32(const KoColorSpace* cs, const QString& id, const QString& description, const QString& category)
+        : KoCompositeOp(cs, id, description, category) {}
+
+    using KoCompositeOp::composite;
+
+    virtual void composite(const KoCompositeOp::ParameterInfo& params) const
+    {
+        if(params.maskRowStart) {
+            composite<true>(params);
+        } else {
+            composite<false>(params);
+        }
+    }
+
+    template <bool haveMask>
+    inline void composite(const KoCompositeOp::ParameterInfo& params) const {
+        if (params.channelFlags.isEmpty() ||
+            params.channelFlags == QBitArray(4, true)) {
+
+            KoStreamedMath<_impl>::template genericComposite32<haveMask, false, GenericSCCompositor32<BlendFunc, false, true> >(params);
+        } else {
+            const bool allChannelsFlag =
+                params.channelFlags.at(0) &&
+                params.channelFlags.at(1) &&
+                params.channelFlags.at(2);
+
+            const bool alphaLocked =
+                !params.channelFlags.at(3);
+
+            if (allChannelsFlag && alphaLocked) {
+                KoStreamedMath<_impl>::template genericComposite32_novector<haveMask, false, GenericSCCompositor32<BlendFunc, true, true> >(params);
+            } else if (!allChannelsFlag && !alphaLocked) {
+                KoStreamedMath<_impl>::template genericComposite32_novector<haveMask, false, GenericSCCompositor32<BlendFunc, false, false> >(params);
+            } else /*if (!allChannelsFlag && alphaLocked) */{
+                KoStreamedMath<_impl>::template genericComposite32_novector<haveMask, false, GenericSCCompositor32<BlendFunc, true, false> >(params);
+            }
+        }
+    }
+};
+
+/**
+ * Creates a vectorized version of the separable composite op \p id.
+ * Returns null if there is no vectorized version of the blending
+ * function, then the generic op should be used.
+ */
+template<Vc::Implementation _impl>
+KoCompositeOp* createOptimizedCompositeOpGenericSC32(const KoColorSpace *cs, const QString &id,
+                                                     const QString &description, const QString &category)
+{
+    using namespace KoVectorBlendFunctions;
+
+    if (id == COMPOSITE_MULT) {
+        return new KoOptimizedCompositeOpGenericSC32<_impl, Multiply>(cs, id, description, category);
+    } else if (id == COMPOSITE_SCREEN) {
+        return new KoOptimizedCompositeOpGenericSC32<_impl, Screen>(cs, id, description, category);
+    } else if (id == COMPOSITE_OVERLAY) {
+        return new KoOptimizedCompositeOpGenericSC32<_impl, Overlay>(cs, id, description, category);
+    } else if (id == COMPOSITE_HARD_LIGHT) {
+        return new KoOptimizedCompositeOpGenericSC32<_impl, HardLight>(cs, id, description, category);
+    } else if (id == COMPOSITE_ADD || id == COMPOSITE_LINEAR_DODGE) {
+        return new KoOptimizedCompositeOpGenericSC32<_impl, Addition>(cs, id, description, category);
+    } else if (id == COMPOSITE_SUBTRACT) {
+        return new KoOptimizedCompositeOpGenericSC32<_impl, Subtract>(cs, id, description, category);
+    } else if (id == COMPOSITE_LINEAR_BURN) {
+        return new KoOptimizedCompositeOpGenericSC32<_impl, LinearBurn>(cs, id, description, category);
+    } else if (id == COMPOSITE_DARKEN) {
+        return new KoOptimizedCompositeOpGenericSC32<_impl, DarkenOnly>(cs, id, description, category);
+    } else if (id == COMPOSITE_LIGHTEN) {
+        return new KoOptimizedCompositeOpGenericSC32<_impl, LightenOnly>(cs, id, description, category);
+    } else if (id == COMPOSITE_DIFF) {
+        return new KoOptimizedCompositeOpGenericSC32<_impl, Difference>(cs, id, description, category);
+    } else if (id == COMPOSITE_EXCLUSION) {
+        return new KoOptimizedCompositeOpGenericSC32<_impl, Exclusion>(cs, id, description, category);
+    } else if (id == COMPOSITE_GRAIN_MERGE) {
+        return new KoOptimizedCompositeOpGenericSC32<_impl, GrainMerge>(cs, id, description, category);
+    } else if (id == COMPOSITE_GRAIN_EXTRACT) {
+        return new KoOptimizedCompositeOpGenericSC32<_impl, GrainExtract>(cs, id, description, category);
+    }
+
+    return 0;
+}
+
+#endif // KOOPTIMIZEDCOMPOSITEOPGENERICSC32_H_
@@ -258,6 +258,28 @@ public:
         }
     }
 
+    virtual void compositeSpans(const KoCompositeOp::ParameterInfo& params, const QVector<KoCompositeOp::Span> &spans) const
+    {
+        KoCompositeOp::ParameterInfo spanParams(params);
+
+        if (params.channelFlags.isEmpty() ||
+            params.channelFlags == QBitArray(4, true)) {
+
+            // skip the channel flags check for every span
+            spanParams.channelFlags = QBitArray();
+        }
+
+        for (auto it = spans.constBegin(); it != spans.constEnd(); ++it) {
+            spanParams.setSpan(*it);
+
+            if(spanParams.maskRowStart) {
+                composite<true>(spanParams);
+            } else {
+                composite<false>(spanParams);
+            }
+        }
+    }
+
     template <bool haveMask>
     inline void composite(const KoCompositeOp::ParameterInfo& params) const {
         if (params.channelFlags.isEmpty() ||
@@ -0,0 +1,267 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KOOPTIMIZEDCOMPOSITEOPOVERU16_H_
+#define KOOPTIMIZEDCOMPOSITEOPOVERU16_H_
+
+#include "KoCompositeOpBase.h"
+#include "KoCompositeOpRegistry.h"
+#include "KoStreamedMath.h"
+
+
+/**
+ * Over compositor for the pixels with 16-bit channels. \p pixelSize is
+ * either 8 (C1_C2_C3_A) or 4 (C1_A).
+ */
+template<int pixelSize, bool alphaLocked, bool allChannelsFlag>
+struct OverCompositorU16 {
+    static const int numColorChannels = pixelSize / 2 - 1;
+    static const int alpha_pos = numColorChannels;
+
+    struct ParamsWrapper {
+        ParamsWrapper(const KoCompositeOp::ParameterInfo& params)
+            : channelFlags(params.channelFlags)
+        {
+        }
+        const QBitArray &channelFlags;
+    };
+
+    // \see docs in AlphaDarkenCompositor32
+    template<bool haveMask, bool src_aligned, Vc::Implementation _impl>
+    static ALWAYS_INLINE void compositeVector(const quint8 *src, quint8 *dst, const quint8 *mask, float opacity, const ParamsWrapper &oparams)
+    {
+        Q_UNUSED(oparams);
+
+        Vc::float_v src_alpha;
+        Vc::float_v dst_alpha;
+
+        Vc::float_v src_c[3];
+        Vc::float_v dst_c[3];
+
+        KoStreamedMath<_impl>::template fetch_channels_u16<pixelSize, src_aligned>(src, src_c, src_alpha);
+
+        bool haveOpacity = opacity != 1.0;
+        Vc::float_v opacity_norm_vec(opacity);
+
+        Vc::float_v uint16Max((float)65535.0);
+        Vc::float_v uint16MaxRec1((float)1.0 / 65535.0);
+        Vc::float_v uint8MaxRec1((float)1.0 / 255.0);
+        Vc::float_v zeroValue(Vc::Zero);
+        Vc::float_v oneValue(Vc::One);
+
+        src_alpha *= opacity_norm_vec;
+
+        if (haveMask) {
+            Vc::float_v mask_vec = KoStreamedMath<_impl>::fetch_mask_8(mask);
+            src_alpha *= mask_vec * uint8MaxRec1;
+        }
+
+        // The source cannot change the colors in the destination,
+        // since its fully transparent
+        if ((src_alpha == zeroValue).isFull()) {
+            return;
+        }
+
+        KoStreamedMath<_impl>::template fetch_channels_u16<pixelSize, true>(dst, dst_c, dst_alpha);
+
+        Vc::float_v src_blend;
+        Vc::float_v new_alpha;
+
+        if ((dst_alpha == uint16Max).isFull()) {
+            new_alpha = dst_alpha;
+            src_blend = src_alpha * uint16MaxRec1;
+        } else if ((dst_alpha == zeroValue).isFull()) {
+            new_alpha = src_alpha;
+            src_blend = oneValue;
+        } else {
+            /**
+             * The value of new_alpha can have *some* zero values,
+             * which will result in NaN values while division.
+             *
+             * The approximate reciprocal used in OverCompositor32 has
+             * only 12 bits of precision, which is not enough for 16-bit
+             * channels, so we do the real division here.
+             */
+            new_alpha = dst_alpha + (uint16Max - dst_alpha) * src_alpha * uint16MaxRec1;
+            Vc::float_m mask = (new_alpha == zeroValue);
+            src_blend = src_alpha / new_alpha;
+            src_blend.setZero(mask);
+        }
+
+        if (!(src_blend == oneValue).isFull()) {
+            for (int i = 0; i < numColorChannels; i++) {
+                dst_c[i] = src_blend * (src_c[i] - dst_c[i]) + dst_c[i];
+            }
+        } else {
+            if (!haveMask && !haveOpacity) {
+                memcpy(dst, src, pixelSize * Vc::float_v::size());
+                return;
+            } else {
+                // opacity has changed the alpha of the source,
+                // so we can't just memcpy the bytes
+                for (int i = 0; i < numColorChannels; i++) {
+                    dst_c[i] = src_c[i];
+                }
+            }
+        }
+
+        KoStreamedMath<_impl>::template write_channels_u16<pixelSize>(dst, dst_c, new_alpha);
+    }
+
+    template <bool haveMask, Vc::Implementation _impl>
+    static ALWAYS_INLINE void compositeOnePixelScalar(const quint8 *s, quint8 *d, const quint8 *mask, float opacity, const ParamsWrapper &oparams)
+    {
+        using namespace Arithmetic;
+
+        const quint16 *src = reinterpret_cast<const quint16*>(s);
+        quint16 *dst = reinterpret_cast<quint16*>(d);
+
+        const float uint16Rec1 = 1.0 / 65535.0;
+        const float uint16Max = 65535.0;
+        const float uint8Rec1 = 1.0 / 255.0;
+
+        float srcAlpha = src[alpha_pos];
+        srcAlpha *= opacity;
+
+        if (haveMask) {
+            srcAlpha *= float(*mask) * uint8Rec1;
+        }
+
+        if (srcAlpha != 0.0) {
+
+            float dstAlpha = dst[alpha_pos];
+            float srcBlendNorm;
+
+            if (alphaLocked || dstAlpha == uint16Max) {
+                srcBlendNorm = srcAlpha * uint16Rec1;
+            } else if (dstAlpha == 0.0) {
+                dstAlpha = srcAlpha;
+                srcBlendNorm = 1.0;
+
+                if (!allChannelsFlag) {
+                    KoStreamedMathFunctions::clearPixel<pixelSize>(d);
+                }
+            } else {
+                dstAlpha += (uint16Max - dstAlpha) * srcAlpha * uint16Rec1;
+                srcBlendNorm = srcAlpha / dstAlpha;
+            }
+
+            if(allChannelsFlag) {
+                if (srcBlendNorm == 1.0) {
+                    if (!alphaLocked) {
+                        KoStreamedMathFunctions::copyPixel<pixelSize>(s, d);
+                    } else {
+                        for (int i = 0; i < numColorChannels; i++) {
+                            dst[i] = src[i];
+                        }
+                    }
+                } else if (srcBlendNorm != 0.0){
+                    for (int i = 0; i < numColorChannels; i++) {
+                        dst[i] = KoStreamedMath<_impl>::lerp_mixed_u16_float(dst[i], src[i], srcBlendNorm);
+                    }
+                }
+            } else {
+                const QBitArray &channelFlags = oparams.channelFlags;
+
+                if (srcBlendNorm == 1.0) {
+                    for (int i = 0; i < numColorChannels; i++) {
+                        if(channelFlags.at(i)) dst[i] = src[i];
+                    }
+                } else if (srcBlendNorm != 0.0) {
+                    for (int i = 0; i < numColorChannels; i++) {
+                        if(channelFlags.at(i)) dst[i] = KoStreamedMath<_impl>::lerp_mixed_u16_float(dst[i], src[i], srcBlendNorm);
+                    }
+                }
+            }
+
+            if (!alphaLocked) {
+                dst[alpha_pos] = KoStreamedMath<_impl>::round_float_to_u16(dstAlpha);
+            }
+        }
+    }
+};
+
+/**
+ * An optimized version of a composite op for the use in colorspaces
+ * with 16-bit channels and alpha channel placed at the last channel
+ * of the pixel: C1_C2_C3_A (\p pixelSize is 8) or C1_A (\p pixelSize
+ * is 4).
+ */
+template<Vc::Implementation _impl, int pixelSize>
+class KoOptimizedCompositeOpOverU16Impl : public KoCompositeOp
+{
+    static const int numChannels = pixelSize / 2;
+    static const int alpha_pos = numChannels - 1;
+
+public:
+    KoOptimizedCompositeOpOverU16Impl(const KoColorSpace* cs)
+        : KoCompositeOp(cs, COMPOSITE_OVER, i18n("Normal"), KoCompositeOp::categoryMix()) {}
+
+    using KoCompositeOp::composite;
+
+    virtual void composite(const KoCompositeOp::ParameterInfo& params) const
+    {
+        if(params.maskRowStart) {
+            composite<true>(params);
+        } else {
+            composite<false>(params);
+        }
+    }
+
+    template <bool haveMask>
+    inline void composite(const KoCompositeOp::ParameterInfo& params) const {
+        if (params.channelFlags.isEmpty() ||
+            params.channelFlags == QBitArray(numChannels, true)) {
+
+            KoStreamedMath<_impl>::template genericComposite<haveMask, false, OverCompositorU16<pixelSize, false, true>, pixelSize>(params);
+        } else {
+            bool allChannelsFlag = true;
+            for (int i = 0; i < alpha_pos; i++) {
+                allChannelsFlag &= params.channelFlags.at(i);
+            }
+
+            const bool alphaLocked =
+                !params.channelFlags.at(alpha_pos);
+
+            if (allChannelsFlag && alphaLocked) {
+                KoStreamedMath<_impl>::template genericComposite_novector<haveMask, false, OverCompositorU16<pixelSize, true, true>, pixelSize>(params);
+            } else if (!allChannelsFlag && !alphaLocked) {
+                KoStreamedMath<_impl>::template genericComposite_novector<haveMask, false, OverCompositorU16<pixelSize, false, false>, pixelSize>(params);
+            } else /*if (!allChannelsFlag && alphaLocked) */{
+                KoStreamedMath<_impl>::template genericComposite_novector<haveMask, false, OverCompositorU16<pixelSize, true, false>, pixelSize>(params);
+            }
+        }
+    }
+};
+
+template<Vc::Implementation _impl>
+class KoOptimizedCompositeOpOverU16 : public KoOptimizedCompositeOpOverU16Impl<_impl, 8>
+{
+public:
+    KoOptimizedCompositeOpOverU16(const KoColorSpace* cs)
+        : KoOptimizedCompositeOpOverU16Impl<_impl, 8>(cs) {}
+};
+
+template<Vc::Implementation _impl>
+class KoOptimizedCompositeOpOverGrayU16 : public KoOptimizedCompositeOpOverU16Impl<_impl, 4>
+{
+public:
+    KoOptimizedCompositeOpOverGrayU16(const KoColorSpace* cs)
+        : KoOptimizedCompositeOpOverU16Impl<_impl, 4>(cs) {}
+};
+
+#endif // KOOPTIMIZEDCOMPOSITEOPOVERU16_H_
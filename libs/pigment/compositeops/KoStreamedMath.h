@@ -111,6 +111,14 @@ static inline quint8 lerp_mixed_u8_float(quint8 a, quint8 b, float alpha) {
     return round_float_to_uint(qint16(b - a) * alpha + a);
 }
 
+static inline quint16 round_float_to_u16(float value) {
+    return quint16(value + float(0.5));
+}
+
+static inline quint16 lerp_mixed_u16_float(quint16 a, quint16 b, float alpha) {
+    return round_float_to_u16(qint32(b - a) * alpha + a);
+}
+
 /**
  * Get a vector containing first Vc::float_v::size() values of mask.
  * Each source mask element is considered to be a 8-bit integer
@@ -209,6 +217,74 @@ static inline void write_channels_32(quint8 *data,
     (v1 | v3).store((quint32*)data, Vc::Aligned);
 }
 
+/**
+ * Get color and alpha values from Vc::float_v::size() pixels with
+ * 16-bit channels. The pixel is either 64-bit (C1_C2_C3_A) or 32-bit
+ * (C1_A), the alpha channel is always placed in the last channel.
+ * Only the first (pixelSize / 2 - 1) elements of \p colors are filled.
+ *
+ * The 64-bit pixels are gathered as two interleaved 32-bit words, so
+ * \p aligned is taken into account for 32-bit pixels only.
+ */
+template <int pixelSize, bool aligned>
+static inline void fetch_channels_u16(const quint8 *data,
+                                      Vc::float_v *colors,
+                                      Vc::float_v &alpha) {
+    const quint32 *ptr = reinterpret_cast<const quint32*>(data);
+    const uint_v lowWordMask(0xFFFF);
+
+    if (pixelSize == 8) {
+        const int_v indexes = int_v(Vc::IndexesFromZero) * 2;
+
+        const uint_v low(ptr, indexes);
+        const uint_v high(ptr, indexes + 1);
+
+        colors[0] = Vc::simd_cast<Vc::float_v>(int_v(low & lowWordMask));
+        colors[1] = Vc::simd_cast<Vc::float_v>(int_v(low >> 16));
+        colors[2] = Vc::simd_cast<Vc::float_v>(int_v(high & lowWordMask));
+        alpha = Vc::simd_cast<Vc::float_v>(int_v(high >> 16));
+    } else {
+        uint_v data_i;
+        if (aligned) {
+            data_i.load(ptr, Vc::Aligned);
+        } else {
+            data_i.load(ptr, Vc::Unaligned);
+        }
+
+        colors[0] = Vc::simd_cast<Vc::float_v>(int_v(data_i & lowWordMask));
+        alpha = Vc::simd_cast<Vc::float_v>(int_v(data_i >> 16));
+    }
+}
+
+/**
+ * Pack color and alpha values to Vc::float_v::size() pixels with 16-bit
+ * channels. The layout of the pixels is the same as in fetch_channels_u16().
+ *
+ * NOTE: \p data must be aligned pointer!
+ */
+template <int pixelSize>
+static inline void write_channels_u16(quint8 *data,
+                                      const Vc::float_v *colors,
+                                      Vc::float_v::AsArg alpha) {
+    quint32 *ptr = reinterpret_cast<quint32*>(data);
+    const uint_v lowWordMask(0xFFFF);
+
+    const uint_v alpha_i = uint_v(int_v(Vc::round(alpha))) << 16;
+    const uint_v c1_i = uint_v(int_v(Vc::round(colors[0]))) & lowWordMask;
+
+    if (pixelSize == 8) {
+        const int_v indexes = int_v(Vc::IndexesFromZero) * 2;
+
+        const uint_v c2_i = uint_v(int_v(Vc::round(colors[1]))) << 16;
+        const uint_v c3_i = uint_v(int_v(Vc::round(colors[2]))) & lowWordMask;
+
+        (c1_i | c2_i).scatter(ptr, indexes);
+        (c3_i | alpha_i).scatter(ptr, indexes + 1);
+    } else {
+        (c1_i | alpha_i).store(ptr, Vc::Aligned);
+    }
+}
+
 /**
  * Composes src pixels into dst pixles. Is optimized for 32-bit-per-pixel
  * colorspaces. Uses \p Compositor strategy parameter for doing actual
@@ -396,6 +472,13 @@ ALWAYS_INLINE void clearPixel<4>(quint8* dst)
     *d = 0;
 }
 
+template<>
+ALWAYS_INLINE void clearPixel<8>(quint8* dst)
+{
+    quint64 *d = reinterpret_cast<quint64*>(dst);
+    *d = 0;
+}
+
 template<>
 ALWAYS_INLINE void clearPixel<16>(quint8* dst)
 {
@@ -415,6 +498,14 @@ ALWAYS_INLINE void copyPixel<4>(const quint8 *src, quint8* dst)
     *d = *s;
 }
 
+template<>
+ALWAYS_INLINE void copyPixel<8>(const quint8 *src, quint8* dst)
+{
+    const quint64 *s = reinterpret_cast<const quint64*>(src);
+    quint64 *d = reinterpret_cast<quint64*>(dst);
+    *d = *s;
+}
+
 template<>
 ALWAYS_INLINE void copyPixel<16>(const quint8 *src, quint8* dst)
 {
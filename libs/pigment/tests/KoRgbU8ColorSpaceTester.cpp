@@ -24,6 +24,7 @@
 #include <QTest>
 #include <DebugPigment.h>
 #include <string.h>
+#include <QRect>
 
 #include "KoColor.h"
 #include "KoColorSpace.h"
@@ -305,4 +306,79 @@ void KoRgbU8ColorSpaceTester::testCompositeOpsWithChannelFlags()
     }
 }
 
+void KoRgbU8ColorSpaceTester::testCompositeSpans()
+{
+    const KoColorSpace* cs = KoColorSpaceRegistry::instance()->rgb8();
+    QList<KoCompositeOp*> ops = cs->compositeOps();
+
+    const int width = 64;
+    const int height = 16;
+    const int pixelSize = cs->pixelSize();
+    const int rowStride = width * pixelSize;
+
+    QVector<quint8> src(width * height * pixelSize);
+    QVector<quint8> mask(width * height);
+    QVector<quint8> dstInitial(width * height * pixelSize);
+
+    qsrand(1);
+    for (int i = 0; i < src.size(); i++) {
+        src[i] = qrand() & 0xFF;
+        dstInitial[i] = qrand() & 0xFF;
+    }
+    for (int i = 0; i < mask.size(); i++) {
+        mask[i] = qrand() & 0xFF;
+    }
+
+    // the spans are arbitrary non-overlapping rects of the buffer
+    const QVector<QRect> rects({QRect(0, 0, 17, 5), QRect(17, 0, 47, 5), QRect(3, 5, 40, 11)});
+
+    Q_FOREACH (const KoCompositeOp *op, ops) {
+        if (op->id() == COMPOSITE_DISSOLVE) continue;
+
+        for (int useMask = 0; useMask <= 1; useMask++) {
+            QVector<quint8> dstExpected(dstInitial);
+            QVector<quint8> dstActual(dstInitial);
+
+            KoCompositeOp::ParameterInfo params;
+            params.opacity = 0.7f;
+            params.flow = 0.5f;
+
+            QVector<KoCompositeOp::Span> spans;
+
+            Q_FOREACH (const QRect &rc, rects) {
+                const int offset = rc.y() * rowStride + rc.x() * pixelSize;
+                const int maskOffset = rc.y() * width + rc.x();
+
+                params.dstRowStart = dstExpected.data() + offset;
+                params.dstRowStride = rowStride;
+                params.srcRowStart = src.data() + offset;
+                params.srcRowStride = rowStride;
+                params.maskRowStart = useMask ? mask.data() + maskOffset : 0;
+                params.maskRowStride = useMask ? width : 0;
+                params.rows = rc.height();
+                params.cols = rc.width();
+                op->composite(params);
+
+                KoCompositeOp::Span span;
+                span.dstRowStart = dstActual.data() + offset;
+                span.dstRowStride = rowStride;
+                span.srcRowStart = src.data() + offset;
+                span.srcRowStride = rowStride;
+                span.maskRowStart = useMask ? mask.data() + maskOffset : 0;
+                span.maskRowStride = useMask ? width : 0;
+                span.rows = rc.height();
+                span.cols = rc.width();
+                spans << span;
+            }
+
+            op->compositeSpans(params, spans);
+
+            if (dstExpected != dstActual) {
+                qWarning() << "Batched composition differs for op" << op->id() << "useMask" << useMask;
+                QFAIL("Failed to composite spans");
+            }
+        }
+    }
+}
+
 QTEST_GUILESS_MAIN(KoRgbU8ColorSpaceTester)
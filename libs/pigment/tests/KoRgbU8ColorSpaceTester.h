@@ -31,6 +31,7 @@ private Q_SLOTS:
     void testMixColors();
     void testMixColorsAverage();
     void testCompositeOpsWithChannelFlags();
+    void testCompositeSpans();
 };
 
 #endif
@@ -2,10 +2,13 @@
 
 #include "KoColorSpaceAbstract.h"
 #include "KoColorSpaceTraits.h"
+#include "KoMixColorsOpFactory.h"
+#include "KoColorModelStandardIds.h"
 
 #include <cfloat>
 
 #include <QTest>
+#include <QScopedPointer>
 
 template <class T>
 T mixOpExpectedAlpha(T alpha1, T alpha2, const qint16 *weights)
@@ -394,5 +397,92 @@ void TestKoColorSpaceAbstract::testMixColorsOpU8NoAlphaLinear()
     QCOMPARE(outputPixel[COLOR_CHANNEL_2], mixOpNoAlphaExpectedColor(pixel1[COLOR_CHANNEL_2], pixel2[COLOR_CHANNEL_2], weights));
 }
 
+template <typename channels_type>
+bool compareMixedPixels(const channels_type *ref, const channels_type *result)
+{
+    bool isEqual = true;
+
+    for (int i = 0; i < 4; i++) {
+        isEqual &= std::is_floating_point<channels_type>::value ?
+            qAbs(float(ref[i]) - float(result[i])) < 1e-5 :
+            ref[i] == result[i];
+    }
+
+    if (!isEqual) {
+        qDebug() << "Expected:" << ref[0] << ref[1] << ref[2] << ref[3];
+        qDebug() << "Result:  " << result[0] << result[1] << result[2] << result[3];
+    }
+
+    return isEqual;
+}
+
+template <typename channels_type>
+void testOptimizedMixColorsOpImpl(const KoID &depthId)
+{
+    typedef KoColorSpaceTrait<channels_type, 4, 3> Trait;
+
+    KoMixColorsOpImpl<Trait> refOp;
+    QScopedPointer<KoMixColorsOp> op(KoMixColorsOpFactory::createOptimized(depthId, 4, 3));
+    QVERIFY(op);
+
+    const int maxColors = 37;
+
+    QVector<channels_type> pixels(4 * maxColors);
+    QVector<const quint8*> pixelPointers(maxColors);
+    QVector<qint16> weights(maxColors);
+
+    for (int i = 0; i < maxColors; i++) {
+        for (int ch = 0; ch < 4; ch++) {
+            pixels[4 * i + ch] =
+                KoColorSpaceMaths<quint8, channels_type>::scaleToA(quint8(i * 73 + ch * 151 + 17));
+        }
+
+        // some fully transparent pixels
+        if (i % 5 == 0) {
+            pixels[4 * i + 3] = KoColorSpaceMathsTraits<channels_type>::zeroValue;
+        }
+
+        pixelPointers[i] = reinterpret_cast<const quint8*>(pixels.constData() + 4 * i);
+        weights[i] = (i * 37) % 256;
+    }
+
+    const quint8 *pixelData = reinterpret_cast<const quint8*>(pixels.constData());
+
+    for (int numColors = 1; numColors <= maxColors; numColors++) {
+        int weightSum = 0;
+        for (int i = 0; i < numColors; i++) {
+            weightSum += weights[i];
+        }
+
+        channels_type ref[4];
+        channels_type result[4];
+
+        quint8 *refPtr = reinterpret_cast<quint8*>(ref);
+        quint8 *resultPtr = reinterpret_cast<quint8*>(result);
+
+        refOp.mixColors(pixelPointers.constData(), weights.constData(), numColors, refPtr, weightSum);
+        op->mixColors(pixelPointers.constData(), weights.constData(), numColors, resultPtr, weightSum);
+        QVERIFY(compareMixedPixels(ref, result));
+
+        refOp.mixColors(pixelData, weights.constData(), numColors, refPtr, weightSum);
+        op->mixColors(pixelData, weights.constData(), numColors, resultPtr, weightSum);
+        QVERIFY(compareMixedPixels(ref, result));
+
+        refOp.mixColors(pixelPointers.constData(), numColors, refPtr);
+        op->mixColors(pixelPointers.constData(), numColors, resultPtr);
+        QVERIFY(compareMixedPixels(ref, result));
+
+        refOp.mixColors(pixelData, numColors, refPtr);
+        op->mixColors(pixelData, numColors, resultPtr);
+        QVERIFY(compareMixedPixels(ref, result));
+    }
+}
+
+void TestKoColorSpaceAbstract::testOptimizedMixColorsOp()
+{
+    testOptimizedMixColorsOpImpl<quint8>(Integer8BitsColorDepthID);
+    testOptimizedMixColorsOpImpl<quint16>(Integer16BitsColorDepthID);
+    testOptimizedMixColorsOpImpl<float>(Float32BitsColorDepthID);
+}
 
 QTEST_GUILESS_MAIN(TestKoColorSpaceAbstract)
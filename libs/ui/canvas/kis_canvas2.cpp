@@ -69,6 +69,8 @@
 #include "flake/kis_shape_selection.h"
 #include "kis_selection_mask.h"
 #include "kis_image_config.h"
+#include "kis_paint_device.h"
+#include "kis_datamanager.h"
 #include "kis_infinity_manager.h"
 #include "kis_signal_compressor.h"
 #include "kis_display_color_converter.h"
@@ -160,11 +162,15 @@ public:
     QRect renderingLimit;
     int isBatchUpdateActive = 0;
 
+    bool tilePrefetchEnabled = true;
+    QPointF pendingViewportMove;
+
     bool effectiveLodAllowedInImage() {
         return lodAllowedInImage && !bootstrapLodBlocked;
     }
 
     void setActiveShapeManager(KoShapeManager *shapeManager);
+    void prefetchViewportTiles(KisImageSP image);
 };
 
 namespace {
@@ -224,6 +230,7 @@ void KisCanvas2::setup()
     m_d->vastScrolling = cfg.vastScrolling();
     m_d->lodAllowedInImage = cfg.levelOfDetailEnabled();
     m_d->regionOfInterestMargin = KisImageConfig(true).animationCacheRegionOfInterestMargin();
+    m_d->tilePrefetchEnabled = KisImageConfig(true).enableTilePrefetch();
 
     createCanvas(cfg.useOpenGL());
 
@@ -989,6 +996,35 @@ void KisCanvas2::slotUpdateRegionOfInterest()
     if (m_d->regionOfInterest != oldRegionOfInterest) {
         emit sigRegionOfInterestChanged(m_d->regionOfInterest);
     }
+
+    m_d->prefetchViewportTiles(image());
+}
+
+void KisCanvas2::KisCanvas2Private::prefetchViewportTiles(KisImageSP image)
+{
+    const QPointF viewportMove = pendingViewportMove;
+    pendingViewportMove = QPointF();
+
+    if (!tilePrefetchEnabled || !image) return;
+
+    /**
+     * The region of interest is updated at most every 100ms, so
+     * extrapolate the panning over a few of these intervals
+     */
+    const qreal lookAhead = 3.0;
+
+    const QRectF viewRect = coordinatesConverter->widgetRectInImagePixels();
+
+    // when the content moves right, the view moves left
+    const QPointF imageMove =
+        coordinatesConverter->viewportToImage(QPointF()) -
+        coordinatesConverter->viewportToImage(viewportMove);
+
+    const QRect prefetchRect =
+        (viewRect | viewRect.translated(lookAhead * imageMove)).toAlignedRect() &
+        coordinatesConverter->imageRectInImagePixels();
+
+    image->projection()->dataManager()->prefetchRect(prefetchRect);
 }
 
 void KisCanvas2::slotReferenceImagesChanged()
@@ -1078,6 +1114,7 @@ void KisCanvas2::documentOffsetMoved(const QPoint &documentOffset)
     QPointF offsetAfter = m_d->coordinatesConverter->imageRectInViewportPixels().topLeft();
 
     QPointF moveOffset = offsetAfter - offsetBefore;
+    m_d->pendingViewportMove += moveOffset;
 
     if (!m_d->currentCanvasIsOpenGL)
         m_d->prescaledProjection->viewportMoved(moveOffset);
@@ -1094,6 +1131,7 @@ void KisCanvas2::slotConfigChanged()
     KisConfig cfg(true);
     m_d->vastScrolling = cfg.vastScrolling();
     m_d->regionOfInterestMargin = KisImageConfig(true).animationCacheRegionOfInterestMargin();
+    m_d->tilePrefetchEnabled = KisImageConfig(true).enableTilePrefetch();
 
     resetCanvas(cfg.useOpenGL());
 
@@ -421,6 +421,7 @@ KisDisplayColorConverter::conversionFlags()
 
     if (cfg.useBlackPointCompensation()) conversionFlags |= KoColorConversionTransformation::BlackpointCompensation;
     if (!cfg.allowLCMSOptimization()) conversionFlags |= KoColorConversionTransformation::NoOptimization;
+    if (cfg.useLut3DDisplayConversion()) conversionFlags |= KoColorConversionTransformation::UseLut3D;
 
     return conversionFlags;
 }
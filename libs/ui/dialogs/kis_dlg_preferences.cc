@@ -649,6 +649,7 @@ ColorSettingsTab::ColorSettingsTab(QWidget *parent, const char *name)
 
     m_page->chkBlackpoint->setChecked(cfg.useBlackPointCompensation());
     m_page->chkAllowLCMSOptimization->setChecked(cfg.allowLCMSOptimization());
+    m_page->chkUseLut3DDisplayConversion->setChecked(cfg.useLut3DDisplayConversion());
     m_page->chkForcePaletteColor->setChecked(cfg.forcePaletteColors());
     KisImageConfig cfgImage(true);
 
@@ -777,6 +778,7 @@ void ColorSettingsTab::setDefault()
 
     m_page->chkBlackpoint->setChecked(cfg.useBlackPointCompensation(true));
     m_page->chkAllowLCMSOptimization->setChecked(cfg.allowLCMSOptimization(true));
+    m_page->chkUseLut3DDisplayConversion->setChecked(cfg.useLut3DDisplayConversion(true));
     m_page->chkForcePaletteColor->setChecked(cfg.forcePaletteColors(true));
     m_page->cmbMonitorIntent->setCurrentIndex(cfg.monitorRenderIntent(true));
     m_page->chkUseSystemMonitorProfile->setChecked(cfg.useSystemMonitorProfile(true));
@@ -1818,6 +1820,7 @@ bool KisDlgPreferences::editPreferences()
                                           (double)m_colorSettings->m_page->sldAdaptationState->value()/20);
         cfg.setUseBlackPointCompensation(m_colorSettings->m_page->chkBlackpoint->isChecked());
         cfg.setAllowLCMSOptimization(m_colorSettings->m_page->chkAllowLCMSOptimization->isChecked());
+        cfg.setUseLut3DDisplayConversion(m_colorSettings->m_page->chkUseLut3DDisplayConversion->isChecked());
         cfg.setForcePaletteColors(m_colorSettings->m_page->chkForcePaletteColor->isChecked());
         cfg.setPasteBehaviour(m_colorSettings->m_pasteBehaviourGroup.checkedId());
         cfg.setRenderIntent(m_colorSettings->m_page->cmbMonitorIntent->currentIndex());
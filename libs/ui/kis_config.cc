@@ -629,6 +629,16 @@ void KisConfig::setAllowLCMSOptimization(bool allowLCMSOptimization)
     m_cfg.writeEntry("allowLCMSOptimization", allowLCMSOptimization);
 }
 
+bool KisConfig::useLut3DDisplayConversion(bool defaultValue) const
+{
+    return (defaultValue ? false : m_cfg.readEntry("useLut3DDisplayConversion", false));
+}
+
+void KisConfig::setUseLut3DDisplayConversion(bool value)
+{
+    m_cfg.writeEntry("useLut3DDisplayConversion", value);
+}
+
 bool KisConfig::forcePaletteColors(bool defaultValue) const
 {
     return (defaultValue ? false : m_cfg.readEntry("colorsettings/forcepalettecolors", false));
@@ -163,6 +163,9 @@ public:
     bool allowLCMSOptimization(bool defaultValue = false) const;
     void setAllowLCMSOptimization(bool allowLCMSOptimization);
 
+    bool useLut3DDisplayConversion(bool defaultValue = false) const;
+    void setUseLut3DDisplayConversion(bool value);
+
     bool forcePaletteColors(bool defaultValue = false) const;
     void setForcePaletteColors(bool forcePaletteColors);
 
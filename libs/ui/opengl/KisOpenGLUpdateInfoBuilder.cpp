@@ -93,7 +93,8 @@ KisOpenGLUpdateInfoSP KisOpenGLUpdateInfoBuilder::buildUpdateInfo(const QRect &r
                                              proofingSpace,
                                              m_d->conversionOptions.m_renderingIntent,
                                              m_d->proofingConfig->intent,
-                                             m_d->proofingConfig->conversionFlags,
+                                             m_d->proofingConfig->conversionFlags |
+                                                 (m_d->conversionOptions.m_conversionFlags & KoColorConversionTransformation::UseLut3D),
                                              m_d->proofingConfig->warningColor,
                                              m_d->proofingConfig->adaptationState));
         }
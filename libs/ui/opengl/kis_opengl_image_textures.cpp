@@ -78,6 +78,7 @@ KisOpenGLImageTextures::KisOpenGLImageTextures()
     m_conversionFlags = KoColorConversionTransformation::HighQuality;
     if (cfg.useBlackPointCompensation()) m_conversionFlags |= KoColorConversionTransformation::BlackpointCompensation;
     if (!cfg.allowLCMSOptimization()) m_conversionFlags |= KoColorConversionTransformation::NoOptimization;
+    if (cfg.useLut3DDisplayConversion()) m_conversionFlags |= KoColorConversionTransformation::UseLut3D;
     m_useOcio = cfg.useOcio();
 }
 
@@ -21,6 +21,7 @@
 #include <QTimer>
 #include <QElapsedTimer>
 #include <QQueue>
+#include <QtMath>
 
 #include <klocalizedstring.h>
 
@@ -32,13 +33,19 @@
 #include "kis_painting_information_builder.h"
 #include "kis_image.h"
 #include "kis_painter.h"
+#include "kis_node.h"
+#include "kis_paint_device.h"
 #include <brushengine/kis_paintop_preset.h>
 #include <brushengine/kis_paintop_utils.h>
+#include <brushengine/kis_paintop_settings.h>
+#include <brushengine/KisStrokeSpeedMeasurer.h>
 
 #include "kis_update_time_monitor.h"
 #include "kis_stabilized_events_sampler.h"
 #include "KisStabilizerDelayedPaintHelper.h"
 #include "kis_config.h"
+#include "kis_image_config.h"
+#include "kis_datamanager.h"
 
 #include "kis_random_source.h"
 #include "KisPerStrokeRandomSource.h"
@@ -114,7 +121,14 @@ struct KisToolFreehandHelper::Private
     KisStabilizedEventsSampler stabilizedSampler;
     KisStabilizerDelayedPaintHelper stabilizerDelayedPaintHelper;
 
+    // Tile prefetch data
+    bool tilePrefetchEnabled;
+    QRect prefetchedRect;
+    QPointF lastPrefetchPos;
+    KisStrokeSpeedMeasurer prefetchSpeedMeasurer {100};
+
     qreal effectiveSmoothnessDistance() const;
+    void prefetchStrokeTiles(const KisPaintInformation &info);
 };
 
 
@@ -283,6 +297,12 @@ void KisToolFreehandHelper::initPaintImpl(qreal startAngle,
 
     m_d->previousPaintInformation = pi;
 
+    m_d->tilePrefetchEnabled = KisImageConfig(true).enableTilePrefetch();
+    m_d->prefetchedRect = QRect();
+    m_d->lastPrefetchPos = pi.pos();
+    m_d->prefetchSpeedMeasurer.reset();
+    m_d->prefetchSpeedMeasurer.addSample(pi.pos(), pi.currentTime());
+
     m_d->resources = new KisResourcesSnapshot(image,
                                               currentNode,
                                               resourceManager,
@@ -442,6 +462,50 @@ qreal KisToolFreehandHelper::Private::effectiveSmoothnessDistance() const
     return smoothingOptions->smoothnessDistance() * zoomingCoeff;
 }
 
+void KisToolFreehandHelper::Private::prefetchStrokeTiles(const KisPaintInformation &info)
+{
+    if (!tilePrefetchEnabled) return;
+
+    KisNodeSP node = resources->currentNode();
+    KisPaintDeviceSP device = node ? node->paintDevice() : 0;
+    if (!device) return;
+
+    /**
+     * Extrapolate the cursor movement for a short period of time and
+     * ask the swapper to load the tiles the brush is going to reach,
+     * so that the paintop doesn't have to wait for them
+     */
+    const qreal lookAheadTime = 150.0; // ms
+
+    prefetchSpeedMeasurer.addSample(info.pos(), info.currentTime());
+
+    const QPointF offset = info.pos() - lastPrefetchPos;
+    const qreal offsetLength = kisDistance(info.pos(), lastPrefetchPos);
+    if (offsetLength <= 0) return;
+
+    lastPrefetchPos = info.pos();
+
+    const QPointF predictedPos =
+        info.pos() + offset / offsetLength *
+        prefetchSpeedMeasurer.currentSpeed() * lookAheadTime;
+
+    KisPaintOpPresetSP preset = resources->currentPaintOpPreset();
+    const qreal brushSize = preset && preset->settings() ? preset->settings()->paintOpSize() : 0.0;
+
+    const QRect rect =
+        kisGrowRect(QRectF(info.pos(), predictedPos).normalized().toAlignedRect(),
+                    qCeil(0.5 * brushSize) + 1);
+
+    if (prefetchedRect.contains(rect)) return;
+
+    /**
+     * Prefetch a bit more than needed to avoid issuing a new
+     * request on every event
+     */
+    prefetchedRect = kisGrowRect(rect, qMax(rect.width(), rect.height()) / 2);
+    device->dataManager()->prefetchRect(prefetchedRect);
+}
+
 void KisToolFreehandHelper::paintEvent(KoPointerEvent *event)
 {
     KisPaintInformation info =
@@ -454,6 +518,8 @@ void KisToolFreehandHelper::paintEvent(KoPointerEvent *event)
 
 void KisToolFreehandHelper::paint(KisPaintInformation &info)
 {
+    m_d->prefetchStrokeTiles(info);
+
     /**
      * Smooth the coordinates out using the history and the
      * distance. This is a heavily modified version of an algo used in
@@ -22,9 +22,12 @@
 
 #include "KoColorModelStandardIds.h"
 
+#include <QScopedPointer>
+
 #include <klocalizedstring.h>
 
 #include "LcmsColorSpace.h"
+#include "LcmsLut3D.h"
 
 // -- KoLcmsColorConversionTransformation --
 
@@ -51,27 +54,56 @@ public:
                 conversionFlags |= KoColorConversionTransformation::NoOptimization;
             }
         }
-        conversionFlags |= KoColorConversionTransformation::CopyAlpha;
+        const bool useLut3D =
+            conversionFlags.testFlag(KoColorConversionTransformation::UseLut3D) &&
+            LcmsLut3D::canBake(srcCs, dstCs);
+
+        conversionFlags &= ~KoColorConversionTransformation::UseLut3D;
+
+        if (useLut3D) {
+            cmsHTRANSFORM transform16 =
+                cmsCreateTransform(srcProfile->lcmsProfile(),
+                                   TYPE_RGB_16,
+                                   dstProfile->lcmsProfile(),
+                                   TYPE_RGB_16,
+                                   renderingIntent,
+                                   conversionFlags);
+
+            if (transform16) {
+                m_lut.reset(new LcmsLut3D(srcCs, dstCs, transform16));
+                cmsDeleteTransform(transform16);
+            }
+        }
 
-        m_transform = cmsCreateTransform(srcProfile->lcmsProfile(),
-                                         srcColorSpaceType,
-                                         dstProfile->lcmsProfile(),
-                                         dstColorSpaceType,
-                                         renderingIntent,
-                                         conversionFlags);
+        if (!m_lut || !m_lut->coversSourceRange()) {
+            conversionFlags |= KoColorConversionTransformation::CopyAlpha;
 
-        Q_ASSERT(m_transform);
+            m_transform = cmsCreateTransform(srcProfile->lcmsProfile(),
+                                             srcColorSpaceType,
+                                             dstProfile->lcmsProfile(),
+                                             dstColorSpaceType,
+                                             renderingIntent,
+                                             conversionFlags);
+
+            Q_ASSERT(m_transform);
+        }
     }
 
     ~KoLcmsColorConversionTransformation() override
     {
-        cmsDeleteTransform(m_transform);
+        if (m_transform) {
+            cmsDeleteTransform(m_transform);
+        }
     }
 
 public:
 
     void transform(const quint8 *src, quint8 *dst, qint32 numPixels) const override
     {
+        if (m_lut && m_lut->transform(src, dst, numPixels)) {
+            return;
+        }
+
         Q_ASSERT(m_transform);
 
         cmsDoTransform(m_transform, const_cast<quint8 *>(src), dst, numPixels);
@@ -79,6 +111,7 @@ public:
     }
 private:
     mutable cmsHTRANSFORM m_transform;
+    QScopedPointer<LcmsLut3D> m_lut;
 };
 
 class KoLcmsColorProofingConversionTransformation : public KoColorProofingConversionTransformation
@@ -109,7 +142,11 @@ public:
                 conversionFlags |= KoColorConversionTransformation::NoOptimization;
             }
         }
-        conversionFlags |= KoColorConversionTransformation::CopyAlpha;
+        const bool useLut3D =
+            conversionFlags.testFlag(KoColorConversionTransformation::UseLut3D) &&
+            LcmsLut3D::canBake(srcCs, dstCs);
+
+        conversionFlags &= ~KoColorConversionTransformation::UseLut3D;
 
         quint16 alarm[cmsMAXCHANNELS];//this seems to be bgr???
         alarm[0] = (cmsUInt16Number)gamutWarning[2]*256;
@@ -118,28 +155,59 @@ public:
         cmsSetAlarmCodes(alarm);
         cmsSetAdaptationState(adaptationState);
 
-        m_transform = cmsCreateProofingTransform(srcProfile->lcmsProfile(),
-                                                 srcColorSpaceType,
-                                                 dstProfile->lcmsProfile(),
-                                                 dstColorSpaceType,
-                                                 dynamic_cast<const IccColorProfile *>(proofingSpace->profile())->asLcms()->lcmsProfile(),
-                                                 renderingIntent,
-                                                 proofingIntent,
-                                                 conversionFlags);
+        cmsHPROFILE proofingProfile =
+            dynamic_cast<const IccColorProfile *>(proofingSpace->profile())->asLcms()->lcmsProfile();
+
+        if (useLut3D) {
+            // the gamut alarm is baked into the LUT as well
+            cmsHTRANSFORM transform16 =
+                cmsCreateProofingTransform(srcProfile->lcmsProfile(),
+                                           TYPE_RGB_16,
+                                           dstProfile->lcmsProfile(),
+                                           TYPE_RGB_16,
+                                           proofingProfile,
+                                           renderingIntent,
+                                           proofingIntent,
+                                           conversionFlags);
+
+            if (transform16) {
+                m_lut.reset(new LcmsLut3D(srcCs, dstCs, transform16));
+                cmsDeleteTransform(transform16);
+            }
+        }
+
+        if (!m_lut || !m_lut->coversSourceRange()) {
+            conversionFlags |= KoColorConversionTransformation::CopyAlpha;
+
+            m_transform = cmsCreateProofingTransform(srcProfile->lcmsProfile(),
+                                                     srcColorSpaceType,
+                                                     dstProfile->lcmsProfile(),
+                                                     dstColorSpaceType,
+                                                     proofingProfile,
+                                                     renderingIntent,
+                                                     proofingIntent,
+                                                     conversionFlags);
+        }
         cmsSetAdaptationState(1);
 
-        Q_ASSERT(m_transform);
+        Q_ASSERT(m_transform || m_lut);
     }
 
     ~KoLcmsColorProofingConversionTransformation() override
     {
-        cmsDeleteTransform(m_transform);
+        if (m_transform) {
+            cmsDeleteTransform(m_transform);
+        }
     }
 
 public:
 
     void transform(const quint8 *src, quint8 *dst, qint32 numPixels) const override
     {
+        if (m_lut && m_lut->transform(src, dst, numPixels)) {
+            return;
+        }
+
         Q_ASSERT(m_transform);
 
         cmsDoTransform(m_transform, const_cast<quint8 *>(src), dst, numPixels);
@@ -147,6 +215,7 @@ public:
     }
 private:
     mutable cmsHTRANSFORM m_transform;
+    QScopedPointer<LcmsLut3D> m_lut;
 };
 
 struct IccColorSpaceEngine::Private {
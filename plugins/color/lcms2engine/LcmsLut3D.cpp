@@ -0,0 +1,276 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "LcmsLut3D.h"
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+#include <KoColorSpace.h>
+#include <KoColorProfile.h>
+#include <KoColorSpaceMaths.h>
+#include <KoColorSpaceTraits.h>
+#include <KoColorModelStandardIds.h>
+
+#include "kis_assert.h"
+
+#include <type_traits>
+
+
+bool LcmsLut3D::canBake(const KoColorSpace *srcCs, const KoColorSpace *dstCs)
+{
+    if (srcCs->colorModelId() != RGBAColorModelID ||
+        dstCs->colorModelId() != RGBAColorModelID) {
+
+        return false;
+    }
+
+    const KoID srcDepth = srcCs->colorDepthId();
+    const KoID dstDepth = dstCs->colorDepthId();
+
+    const bool srcSupported =
+        srcDepth == Integer16BitsColorDepthID ||
+#ifdef HAVE_OPENEXR
+        srcDepth == Float16BitsColorDepthID ||
+#endif
+        srcDepth == Float32BitsColorDepthID;
+
+    const bool dstSupported =
+        dstDepth == Integer8BitsColorDepthID ||
+        dstDepth == Integer16BitsColorDepthID;
+
+    if (!srcSupported || !dstSupported) {
+        return false;
+    }
+
+    /**
+     * The grid is uniform in the encoded values, so for the linear
+     * and close to linear TRCs it would be too sparse in the shadows.
+     */
+    const KoColorProfile *srcProfile = srcCs->profile();
+    if (!srcProfile || srcProfile->isLinear()) {
+        return false;
+    }
+
+    if (srcProfile->hasTRC()) {
+        const QVector<qreal> trc = srcProfile->getEstimatedTRC();
+
+        Q_FOREACH (qreal gamma, trc) {
+            // the estimation returns a negative value if it fails
+            if (gamma > 0.0 && gamma < 1.5) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+LcmsLut3D::LcmsLut3D(const KoColorSpace *srcCs, const KoColorSpace *dstCs,
+                     cmsHTRANSFORM transform16,
+                     int gridSize)
+    : m_gridSize(gridSize),
+      m_coversSourceRange(srcCs->colorDepthId() == Integer16BitsColorDepthID),
+      m_transformFunc(0)
+{
+    KIS_ASSERT_RECOVER_NOOP(gridSize >= 2);
+
+    const int numNodes = gridSize * gridSize * gridSize;
+
+    QVector<quint16> input(3 * numNodes);
+    QVector<quint16> output(3 * numNodes);
+
+    quint16 *ptr = input.data();
+
+    for (int r = 0; r < gridSize; r++) {
+        for (int g = 0; g < gridSize; g++) {
+            for (int b = 0; b < gridSize; b++) {
+                *ptr++ = qRound(r * 65535.0 / (gridSize - 1));
+                *ptr++ = qRound(g * 65535.0 / (gridSize - 1));
+                *ptr++ = qRound(b * 65535.0 / (gridSize - 1));
+            }
+        }
+    }
+
+    cmsDoTransform(transform16, input.constData(), output.data(), numNodes);
+
+    m_table.resize(4 * numNodes);
+
+    for (int i = 0; i < numNodes; i++) {
+        m_table[4 * i + 0] = KoColorSpaceMaths<quint16, float>::scaleToA(output[3 * i + 0]);
+        m_table[4 * i + 1] = KoColorSpaceMaths<quint16, float>::scaleToA(output[3 * i + 1]);
+        m_table[4 * i + 2] = KoColorSpaceMaths<quint16, float>::scaleToA(output[3 * i + 2]);
+        m_table[4 * i + 3] = 0.0f;
+    }
+
+    const KoID srcDepth = srcCs->colorDepthId();
+    const bool dstIs8Bit = dstCs->colorDepthId() == Integer8BitsColorDepthID;
+
+    if (srcDepth == Integer16BitsColorDepthID) {
+        m_transformFunc = dstIs8Bit ?
+            &LcmsLut3D::transformImpl<KoBgrU16Traits, KoBgrU8Traits> :
+            &LcmsLut3D::transformImpl<KoBgrU16Traits, KoBgrU16Traits>;
+#ifdef HAVE_OPENEXR
+    } else if (srcDepth == Float16BitsColorDepthID) {
+        m_transformFunc = dstIs8Bit ?
+            &LcmsLut3D::transformImpl<KoRgbF16Traits, KoBgrU8Traits> :
+            &LcmsLut3D::transformImpl<KoRgbF16Traits, KoBgrU16Traits>;
+#endif
+    } else if (srcDepth == Float32BitsColorDepthID) {
+        m_transformFunc = dstIs8Bit ?
+            &LcmsLut3D::transformImpl<KoRgbF32Traits, KoBgrU8Traits> :
+            &LcmsLut3D::transformImpl<KoRgbF32Traits, KoBgrU16Traits>;
+    }
+
+    KIS_ASSERT_RECOVER_NOOP(m_transformFunc);
+}
+
+bool LcmsLut3D::transform(const quint8 *src, quint8 *dst, qint32 numPixels) const
+{
+    return (this->*m_transformFunc)(src, dst, numPixels);
+}
+
+bool LcmsLut3D::coversSourceRange() const
+{
+    return m_coversSourceRange;
+}
+
+int LcmsLut3D::gridSize() const
+{
+    return m_gridSize;
+}
+
+template <class SrcTraits, class DstTraits>
+bool LcmsLut3D::transformImpl(const quint8 *src, quint8 *dst, qint32 numPixels) const
+{
+    typedef typename SrcTraits::channels_type src_channel_type;
+    typedef typename DstTraits::channels_type dst_channel_type;
+
+    if (!std::is_integral<src_channel_type>::value) {
+        const quint8 *pixel = src;
+
+        for (qint32 i = 0; i < numPixels; i++) {
+            const src_channel_type *s = reinterpret_cast<const src_channel_type*>(pixel);
+
+            for (int ch : {SrcTraits::red_pos, SrcTraits::green_pos, SrcTraits::blue_pos}) {
+                const float value = KoColorSpaceMaths<src_channel_type, float>::scaleToA(s[ch]);
+
+                // written this way to reject NaN as well
+                if (!(value >= 0.0f && value <= 1.0f)) {
+                    return false;
+                }
+            }
+
+            pixel += SrcTraits::pixelSize;
+        }
+    }
+
+    float result[4];
+
+    for (qint32 i = 0; i < numPixels; i++) {
+        const src_channel_type *s = reinterpret_cast<const src_channel_type*>(src);
+        dst_channel_type *d = reinterpret_cast<dst_channel_type*>(dst);
+
+        interpolate(KoColorSpaceMaths<src_channel_type, float>::scaleToA(s[SrcTraits::red_pos]),
+                    KoColorSpaceMaths<src_channel_type, float>::scaleToA(s[SrcTraits::green_pos]),
+                    KoColorSpaceMaths<src_channel_type, float>::scaleToA(s[SrcTraits::blue_pos]),
+                    result);
+
+        d[DstTraits::red_pos] = KoColorSpaceMaths<float, dst_channel_type>::scaleToA(result[0]);
+        d[DstTraits::green_pos] = KoColorSpaceMaths<float, dst_channel_type>::scaleToA(result[1]);
+        d[DstTraits::blue_pos] = KoColorSpaceMaths<float, dst_channel_type>::scaleToA(result[2]);
+        d[DstTraits::alpha_pos] = KoColorSpaceMaths<src_channel_type, dst_channel_type>::scaleToA(s[SrcTraits::alpha_pos]);
+
+        src += SrcTraits::pixelSize;
+        dst += DstTraits::pixelSize;
+    }
+
+    return true;
+}
+
+inline void LcmsLut3D::interpolate(float r, float g, float b, float *result) const
+{
+    const int maxIndex = m_gridSize - 1;
+
+    r = qBound(0.0f, r, 1.0f) * maxIndex;
+    g = qBound(0.0f, g, 1.0f) * maxIndex;
+    b = qBound(0.0f, b, 1.0f) * maxIndex;
+
+    const int ri = qMin(int(r), maxIndex - 1);
+    const int gi = qMin(int(g), maxIndex - 1);
+    const int bi = qMin(int(b), maxIndex - 1);
+
+    const float fr = r - ri;
+    const float fg = g - gi;
+    const float fb = b - bi;
+
+    const int strideB = 4;
+    const int strideG = 4 * m_gridSize;
+    const int strideR = 4 * m_gridSize * m_gridSize;
+
+    /**
+     * The cube is split into six tetrahedra along its main diagonal. The
+     * tetrahedron is selected by the order of the fractional parts, then
+     * the value is a weighted sum of its four vertices: c000, cA, cB and
+     * c111, where cA differs from c000 in the largest coordinate and cB
+     * in the two largest ones.
+     */
+    float w1, w2, w3;
+    int offsetA, offsetB;
+
+    if (fr >= fg) {
+        if (fg >= fb) {
+            w1 = fr; w2 = fg; w3 = fb;
+            offsetA = strideR; offsetB = strideR + strideG;
+        } else if (fr >= fb) {
+            w1 = fr; w2 = fb; w3 = fg;
+            offsetA = strideR; offsetB = strideR + strideB;
+        } else {
+            w1 = fb; w2 = fr; w3 = fg;
+            offsetA = strideB; offsetB = strideR + strideB;
+        }
+    } else {
+        if (fr >= fb) {
+            w1 = fg; w2 = fr; w3 = fb;
+            offsetA = strideG; offsetB = strideR + strideG;
+        } else if (fg >= fb) {
+            w1 = fg; w2 = fb; w3 = fr;
+            offsetA = strideG; offsetB = strideG + strideB;
+        } else {
+            w1 = fb; w2 = fg; w3 = fr;
+            offsetA = strideB; offsetB = strideG + strideB;
+        }
+    }
+
+    const float *c000 = m_table.constData() + ri * strideR + gi * strideG + bi * strideB;
+    const float *cA = c000 + offsetA;
+    const float *cB = c000 + offsetB;
+    const float *c111 = c000 + strideR + strideG + strideB;
+
+#ifdef __SSE__
+    __m128 value = _mm_mul_ps(_mm_loadu_ps(c000), _mm_set1_ps(1.0f - w1));
+    value = _mm_add_ps(value, _mm_mul_ps(_mm_loadu_ps(cA), _mm_set1_ps(w1 - w2)));
+    value = _mm_add_ps(value, _mm_mul_ps(_mm_loadu_ps(cB), _mm_set1_ps(w2 - w3)));
+    value = _mm_add_ps(value, _mm_mul_ps(_mm_loadu_ps(c111), _mm_set1_ps(w3)));
+    _mm_storeu_ps(result, value);
+#else
+    for (int i = 0; i < 3; i++) {
+        result[i] = c000[i] * (1.0f - w1) + cA[i] * (w1 - w2) + cB[i] * (w2 - w3) + c111[i] * w3;
+    }
+#endif
+}
@@ -0,0 +1,97 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _LCMS_LUT_3D_H_
+#define _LCMS_LUT_3D_H_
+
+#include <QVector>
+#include <lcms2.h>
+
+class KoColorSpace;
+
+/**
+ * A source/destination profile pair baked into a 3D lookup table.
+ *
+ * The table is sampled from an lcms transformation on a regular grid
+ * and the pixels are converted with tetrahedral interpolation, which
+ * is much faster than cmsDoTransform() for 16-bit and floating point
+ * sources. The table is used for the display and proofing conversions
+ * when KoColorConversionTransformation::UseLut3D flag is set.
+ *
+ * Only RGBA -> RGBA conversions are supported and the alpha channel
+ * is just copied. The table covers [0, 1] range of the source values
+ * only, so the floating point pixels outside of it are rejected by
+ * transform() and should be converted by lcms.
+ */
+class LcmsLut3D
+{
+public:
+    static const int defaultGridSize = 33;
+
+    /**
+     * \return true if the conversion from \p srcCs into \p dstCs can be
+     * done with a LUT with an acceptable precision
+     */
+    static bool canBake(const KoColorSpace *srcCs, const KoColorSpace *dstCs);
+
+    /**
+     * Samples \p transform16 on a grid of \p gridSize^3 points. The
+     * transformation should have TYPE_RGB_16 format for both, input
+     * and output.
+     */
+    LcmsLut3D(const KoColorSpace *srcCs, const KoColorSpace *dstCs,
+              cmsHTRANSFORM transform16,
+              int gridSize = defaultGridSize);
+
+    /**
+     * Converts \p numPixels pixels. Returns false and doesn't touch
+     * \p dst if some of the source values are outside the range of
+     * the table (possible for floating point sources only).
+     */
+    bool transform(const quint8 *src, quint8 *dst, qint32 numPixels) const;
+
+    /**
+     * \return true if the table covers all the possible source values,
+     * that is, transform() never fails
+     */
+    bool coversSourceRange() const;
+
+    int gridSize() const;
+
+private:
+    template <class SrcTraits, class DstTraits>
+    bool transformImpl(const quint8 *src, quint8 *dst, qint32 numPixels) const;
+
+    inline void interpolate(float r, float g, float b, float *result) const;
+
+private:
+    typedef bool (LcmsLut3D::*TransformFunc)(const quint8 *, quint8 *, qint32) const;
+
+    int m_gridSize;
+    bool m_coversSourceRange;
+
+    /**
+     * The nodes of the grid, blue coordinate changing the fastest. Every
+     * node is stored as four floats (r, g, b, padding) to let the
+     * interpolation be done in one SIMD register.
+     */
+    QVector<float> m_table;
+
+    TransformFunc m_transformFunc;
+};
+
+#endif
@@ -123,7 +123,21 @@ class LcmsRGBP2020PQColorSpaceFactoryWrapper : public BaseColorSpaceFactory
          * color space for the conversion chain, e.g.
          * p709-g10 F32 -> p2020-g10 U16 -> Rec2020-pq U16, which is incorrect and loses
          * all the HDR data
+         *
+         * The same applies to the profile-independent depth conversions of the base
+         * factory: only the ones that don't clip the floating point values into an
+         * integer range are kept.
          */
+        Q_FOREACH (KoColorConversionTransformationFactory *factory,
+                   BaseColorSpaceFactory::colorConversionLinks()) {
+
+            if (factory->conserveDynamicRange()) {
+                list << factory;
+            } else {
+                delete factory;
+            }
+        }
+
         list << new LcmsFromRGBP2020PQTransformationFactory<RelatedColorSpaceType, KoRgbF32Traits>();
         list << new LcmsToRGBP2020PQTransformationFactory<RelatedColorSpaceType, KoRgbF32Traits>();
 #ifdef HAVE_OPENEXR
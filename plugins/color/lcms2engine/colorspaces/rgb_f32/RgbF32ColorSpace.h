@@ -22,6 +22,7 @@
 
 #include "LcmsColorSpace.h"
 #include "KoColorModelStandardIds.h"
+#include "KoRgbaDepthConversionTransformation.h"
 
 struct KoRgbF32Traits;
 
@@ -109,6 +110,11 @@ public:
         return new RgbF32ColorSpace(name(), p->clone());
     }
 
+    QList<KoColorConversionTransformationFactory *> colorConversionLinks() const override
+    {
+        return KoRgbaDepthConversionTransformationFactory::createOutgoingLinks(colorDepthId());
+    }
+
     QString defaultProfile() const override
     {
         return "sRGB-elle-V2-g10.icc";
@@ -22,6 +22,7 @@
 
 #include "LcmsColorSpace.h"
 #include "KoColorModelStandardIds.h"
+#include "KoRgbaDepthConversionTransformation.h"
 
 struct KoBgrU16Traits;
 
@@ -98,6 +99,11 @@ public:
         return new RgbU16ColorSpace(name(), p->clone());
     }
 
+    QList<KoColorConversionTransformationFactory *> colorConversionLinks() const override
+    {
+        return KoRgbaDepthConversionTransformationFactory::createOutgoingLinks(colorDepthId());
+    }
+
     QString defaultProfile() const override
     {
         return "sRGB-elle-V2-g10.icc";//this is a linear space, because 16bit is enough to only enjoy advantages of linear space
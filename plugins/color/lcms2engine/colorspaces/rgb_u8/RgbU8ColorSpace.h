@@ -21,6 +21,7 @@
 #include <klocalizedstring.h>
 #include <LcmsColorSpace.h>
 #include "KoColorModelStandardIds.h"
+#include "KoRgbaDepthConversionTransformation.h"
 
 struct KoBgrU8Traits;
 
@@ -110,6 +111,11 @@ public:
         return new RgbU8ColorSpace(name(), p->clone());
     }
 
+    QList<KoColorConversionTransformationFactory *> colorConversionLinks() const override
+    {
+        return KoRgbaDepthConversionTransformationFactory::createOutgoingLinks(colorDepthId());
+    }
+
     QString defaultProfile() const override
     {
         return "sRGB-elle-V2-srgbtrc.icc";
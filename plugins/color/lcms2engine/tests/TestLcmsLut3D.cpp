@@ -0,0 +1,266 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "TestLcmsLut3D.h"
+
+#include <QTest>
+#include <QScopedPointer>
+#include "sdk/tests/testpigment.h"
+
+#include "kis_debug.h"
+
+#include "KoColorProfile.h"
+#include "KoColorSpaceRegistry.h"
+#include "KoColorModelStandardIds.h"
+#include "KoColorConversionTransformation.h"
+
+namespace {
+
+/**
+ * Fills the pixels with the colors placed between the nodes of the LUT,
+ * where the interpolation error is the highest
+ */
+QVector<quint8> generatePixels(const KoColorSpace *cs, int numSteps,
+                               float minValue = 0.0, float maxValue = 1.0)
+{
+    QVector<quint8> pixels(numSteps * numSteps * numSteps * cs->pixelSize());
+    quint8 *ptr = pixels.data();
+
+    QVector<float> channels(4);
+
+    for (int r = 0; r < numSteps; r++) {
+        for (int g = 0; g < numSteps; g++) {
+            for (int b = 0; b < numSteps; b++) {
+                channels[0] = minValue + (maxValue - minValue) * r / (numSteps - 1);
+                channels[1] = minValue + (maxValue - minValue) * g / (numSteps - 1);
+                channels[2] = minValue + (maxValue - minValue) * b / (numSteps - 1);
+                channels[3] = 0.5;
+
+                cs->fromNormalisedChannelsValue(ptr, channels);
+                ptr += cs->pixelSize();
+            }
+        }
+    }
+
+    return pixels;
+}
+
+void compareWithLcms(const KoColorSpace *srcCS, const KoColorSpace *dstCS,
+                     KoColorConversionTransformation *reference,
+                     KoColorConversionTransformation *lut)
+{
+    const int numSteps = 41;
+    const int numPixels = numSteps * numSteps * numSteps;
+
+    QVector<quint8> src = generatePixels(srcCS, numSteps);
+    QVector<quint8> refDst(numPixels * dstCS->pixelSize());
+    QVector<quint8> lutDst(numPixels * dstCS->pixelSize());
+
+    reference->transform(src.constData(), refDst.data(), numPixels);
+    lut->transform(src.constData(), lutDst.data(), numPixels);
+
+    // lcms would give exactly the same result, so the LUT must be in use
+    QVERIFY(refDst != lutDst);
+
+    QVector<float> refChannels(4);
+    QVector<float> lutChannels(4);
+
+    float maxError = 0;
+    float sumError = 0;
+
+    for (int i = 0; i < numPixels; i++) {
+        dstCS->normalisedChannelsValue(refDst.constData() + i * dstCS->pixelSize(), refChannels);
+        dstCS->normalisedChannelsValue(lutDst.constData() + i * dstCS->pixelSize(), lutChannels);
+
+        for (int ch = 0; ch < 3; ch++) {
+            const float error = qAbs(refChannels[ch] - lutChannels[ch]);
+            maxError = qMax(maxError, error);
+            sumError += error;
+        }
+
+        // lcms and Krita round the alpha channel a bit differently
+        QVERIFY(qAbs(refChannels[3] - lutChannels[3]) < 1.5 / 255);
+    }
+
+    const float meanError = sumError / (3 * numPixels);
+
+    if (maxError >= 0.015 || meanError >= 0.002) {
+        qDebug() << srcCS->name() << "->" << dstCS->name()
+                 << "max error:" << maxError
+                 << "mean error:" << meanError;
+    }
+
+    QVERIFY(maxError < 0.015);
+    QVERIFY(meanError < 0.002);
+}
+
+void compareExactly(const KoColorSpace *srcCS, const KoColorSpace *dstCS,
+                    float minValue, float maxValue)
+{
+    const KoColorConversionTransformation::ConversionFlags flags =
+        KoColorConversionTransformation::HighQuality |
+        KoColorConversionTransformation::BlackpointCompensation;
+
+    QScopedPointer<KoColorConversionTransformation> reference(
+        srcCS->createColorConverter(dstCS, KoColorConversionTransformation::IntentPerceptual, flags));
+
+    QScopedPointer<KoColorConversionTransformation> lut(
+        srcCS->createColorConverter(dstCS, KoColorConversionTransformation::IntentPerceptual,
+                                    flags | KoColorConversionTransformation::UseLut3D));
+
+    const int numSteps = 9;
+    const int numPixels = numSteps * numSteps * numSteps;
+
+    QVector<quint8> src = generatePixels(srcCS, numSteps, minValue, maxValue);
+    QVector<quint8> refDst(numPixels * dstCS->pixelSize());
+    QVector<quint8> lutDst(numPixels * dstCS->pixelSize());
+
+    reference->transform(src.constData(), refDst.data(), numPixels);
+    lut->transform(src.constData(), lutDst.data(), numPixels);
+
+    QVERIFY(refDst == lutDst);
+}
+
+}
+
+void TestLcmsLut3D::testAccuracy_data()
+{
+    QTest::addColumn<QString>("srcDepth");
+    QTest::addColumn<QString>("srcProfile");
+    QTest::addColumn<QString>("dstDepth");
+    QTest::addColumn<QString>("dstProfile");
+
+    KoColorSpaceRegistry *registry = KoColorSpaceRegistry::instance();
+
+    const QString srgbProfile = registry->rgb8()->profile()->name();
+    const QString pqProfile = registry->p2020PQProfile()->name();
+    const QString linearProfile = registry->p709G10Profile()->name();
+
+    QTest::newRow("u16-srgb -> u8-linear")
+        << Integer16BitsColorDepthID.id() << srgbProfile
+        << Integer8BitsColorDepthID.id() << linearProfile;
+
+    QTest::newRow("u16-pq -> u8-srgb")
+        << Integer16BitsColorDepthID.id() << pqProfile
+        << Integer8BitsColorDepthID.id() << srgbProfile;
+
+    QTest::newRow("f32-pq -> u16-srgb")
+        << Float32BitsColorDepthID.id() << pqProfile
+        << Integer16BitsColorDepthID.id() << srgbProfile;
+
+    QTest::newRow("f16-pq -> u8-srgb")
+        << Float16BitsColorDepthID.id() << pqProfile
+        << Integer8BitsColorDepthID.id() << srgbProfile;
+}
+
+void TestLcmsLut3D::testAccuracy()
+{
+    QFETCH(QString, srcDepth);
+    QFETCH(QString, srcProfile);
+    QFETCH(QString, dstDepth);
+    QFETCH(QString, dstProfile);
+
+    KoColorSpaceRegistry *registry = KoColorSpaceRegistry::instance();
+
+    const KoColorSpace *srcCS = registry->colorSpace(RGBAColorModelID.id(), srcDepth, srcProfile);
+    const KoColorSpace *dstCS = registry->colorSpace(RGBAColorModelID.id(), dstDepth, dstProfile);
+
+    /*
+     *  On some systems these colorspaces cannot be created, so don't die:
+     */
+    if (!srcCS || !dstCS) {
+        QSKIP("The color spaces are not available");
+    }
+
+    const KoColorConversionTransformation::ConversionFlags flags =
+        KoColorConversionTransformation::HighQuality |
+        KoColorConversionTransformation::BlackpointCompensation;
+
+    QScopedPointer<KoColorConversionTransformation> reference(
+        srcCS->createColorConverter(dstCS, KoColorConversionTransformation::IntentPerceptual, flags));
+
+    QScopedPointer<KoColorConversionTransformation> lut(
+        srcCS->createColorConverter(dstCS, KoColorConversionTransformation::IntentPerceptual,
+                                    flags | KoColorConversionTransformation::UseLut3D));
+
+    compareWithLcms(srcCS, dstCS, reference.data(), lut.data());
+}
+
+void TestLcmsLut3D::testProofingAccuracy()
+{
+    KoColorSpaceRegistry *registry = KoColorSpaceRegistry::instance();
+
+    const KoColorSpace *srcCS = registry->colorSpace(RGBAColorModelID.id(), Integer16BitsColorDepthID.id(), registry->p2020PQProfile());
+    const KoColorSpace *dstCS = registry->rgb8();
+    const KoColorSpace *proofingCS = registry->colorSpace(CMYKAColorModelID.id(), Integer8BitsColorDepthID.id(), 0);
+
+    if (!srcCS || !dstCS || !proofingCS) {
+        QSKIP("The color spaces are not available");
+    }
+
+    const KoColorConversionTransformation::ConversionFlags flags =
+        KoColorConversionTransformation::HighQuality |
+        KoColorConversionTransformation::BlackpointCompensation |
+        KoColorConversionTransformation::SoftProofing;
+
+    quint8 gamutWarning[4] = {0, 255, 0, 255};
+
+    QScopedPointer<KoColorConversionTransformation> reference(
+        srcCS->createProofingTransform(dstCS, proofingCS,
+                                       KoColorConversionTransformation::IntentPerceptual,
+                                       KoColorConversionTransformation::IntentAbsoluteColorimetric,
+                                       flags, gamutWarning, 1.0));
+
+    QScopedPointer<KoColorConversionTransformation> lut(
+        srcCS->createProofingTransform(dstCS, proofingCS,
+                                       KoColorConversionTransformation::IntentPerceptual,
+                                       KoColorConversionTransformation::IntentAbsoluteColorimetric,
+                                       flags | KoColorConversionTransformation::UseLut3D,
+                                       gamutWarning, 1.0));
+
+    compareWithLcms(srcCS, dstCS, reference.data(), lut.data());
+}
+
+void TestLcmsLut3D::testLinearSourceIsNotBaked()
+{
+    KoColorSpaceRegistry *registry = KoColorSpaceRegistry::instance();
+
+    const KoColorSpace *srcCS = registry->colorSpace(RGBAColorModelID.id(), Float32BitsColorDepthID.id(), registry->p709G10Profile());
+    const KoColorSpace *dstCS = registry->rgb8();
+
+    if (!srcCS || !dstCS) {
+        QSKIP("The color spaces are not available");
+    }
+
+    QVERIFY(srcCS->profile()->isLinear());
+    compareExactly(srcCS, dstCS, 0.0, 1.0);
+}
+
+void TestLcmsLut3D::testOutOfRangeSourceFallsBack()
+{
+    KoColorSpaceRegistry *registry = KoColorSpaceRegistry::instance();
+
+    const KoColorSpace *srcCS = registry->colorSpace(RGBAColorModelID.id(), Float32BitsColorDepthID.id(), registry->p2020PQProfile());
+    const KoColorSpace *dstCS = registry->rgb8();
+
+    if (!srcCS || !dstCS) {
+        QSKIP("The color spaces are not available");
+    }
+
+    compareExactly(srcCS, dstCS, -0.5, 1.5);
+}
+
+KISTEST_MAIN(TestLcmsLut3D)
@@ -27,6 +27,7 @@
 #include "KoColorSpaceRegistry.h"
 #include "KoColor.h"
 #include "KoColorModelStandardIds.h"
+#include "KoColorConversionSystem.h"
 
 inline QString truncated(QString value) {
     value.truncate(24);
@@ -183,4 +184,52 @@ void TestLcmsRGBP2020PQColorSpace::testConvertToCmyk()
     testRoundTrip(srcCS, dstCS, SDR);
 }
 
+void TestLcmsRGBP2020PQColorSpace::testNoIntegerLinearIntermediate()
+{
+    const KoColorProfile *p2020PQProfile = KoColorSpaceRegistry::instance()->p2020PQProfile();
+    const KoColorProfile *p709G10Profile = KoColorSpaceRegistry::instance()->p709G10Profile();
+
+    QVERIFY(p2020PQProfile);
+    QVERIFY(p709G10Profile);
+
+    const QString srcKey = QString("%1 %2 %3")
+        .arg(RGBAColorModelID.id())
+        .arg(Float32BitsColorDepthID.id())
+        .arg(p709G10Profile->name());
+
+    QVector<KoID> pqModes;
+    pqModes << Integer8BitsColorDepthID;
+    pqModes << Integer16BitsColorDepthID;
+    pqModes << Float32BitsColorDepthID;
+
+    Q_FOREACH(const KoID &dst, pqModes) {
+        const QString dstKey = QString("%1 %2 %3")
+            .arg(RGBAColorModelID.id())
+            .arg(dst.id())
+            .arg(p2020PQProfile->name());
+
+        const QString dot =
+            KoColorSpaceRegistry::instance()->colorConversionSystem()->bestPathToDot(srcKey, dstKey);
+
+        // the vertexes of the best path are marked red, all their nodes
+        // must be either floating point or use the PQ profile
+        Q_FOREACH (const QString &line, dot.split('\n')) {
+            if (!line.endsWith("[color=red]") || !line.contains("->")) continue;
+
+            const QStringList nodes = line.split("->");
+            Q_FOREACH (QString node, nodes) {
+                node = node.left(node.lastIndexOf('"')).trimmed();
+                node.remove(0, 1);
+
+                const bool isIntegerNode =
+                    node.startsWith(QString("%1 %2 ").arg(RGBAColorModelID.id()).arg(Integer8BitsColorDepthID.id())) ||
+                    node.startsWith(QString("%1 %2 ").arg(RGBAColorModelID.id()).arg(Integer16BitsColorDepthID.id()));
+
+                QVERIFY2(!isIntegerNode || node.endsWith(p2020PQProfile->name()),
+                         qPrintable(QString("%1 is converted through %2").arg(dstKey).arg(node)));
+            }
+        }
+    }
+}
+
 KISTEST_MAIN(TestLcmsRGBP2020PQColorSpace)
@@ -27,6 +27,7 @@ private Q_SLOTS:
     void test();
     void testInternalConversions();
     void testConvertToCmyk();
+    void testNoIntegerLinearIntermediate();
 };
 
 #endif // TESTLCMSRGBP2020PQCOLORSPACE_H
@@ -0,0 +1,156 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "TestRgbaDepthConversion.h"
+
+#include <QTest>
+#include <QScopedPointer>
+#include "sdk/tests/testpigment.h"
+
+#include "kis_debug.h"
+
+#include <KoConfig.h>
+#include "KoColorProfile.h"
+#include "KoColorSpaceRegistry.h"
+#include "KoColorSpaceEngine.h"
+#include "KoColorModelStandardIds.h"
+#include "KoColorConversionTransformation.h"
+#include "KoRgbaDepthConverter.h"
+#include "KoRgbaDepthConverterFactoryImpl.h"
+
+namespace {
+
+QVector<quint8> generatePixels(const KoColorSpace *cs, int numPixels)
+{
+    QVector<quint8> pixels(numPixels * cs->pixelSize());
+    quint8 *ptr = pixels.data();
+
+    QVector<float> channels(4);
+
+    for (int i = 0; i < numPixels; i++) {
+        for (int ch = 0; ch < 4; ch++) {
+            channels[ch] = float((i * 37 + ch * 101) % 1021) / 1020;
+        }
+
+        cs->fromNormalisedChannelsValue(ptr, channels);
+        ptr += cs->pixelSize();
+    }
+
+    return pixels;
+}
+
+}
+
+void TestRgbaDepthConversion::testConversion_data()
+{
+    QTest::addColumn<QString>("srcDepth");
+    QTest::addColumn<QString>("dstDepth");
+    QTest::addColumn<QString>("profile");
+
+    KoColorSpaceRegistry *registry = KoColorSpaceRegistry::instance();
+
+    QList<QString> profiles;
+    profiles << registry->rgb8()->profile()->name();
+    profiles << registry->p709G10Profile()->name();
+
+    QList<KoID> depths;
+    depths << Integer8BitsColorDepthID << Integer16BitsColorDepthID;
+#ifdef HAVE_OPENEXR
+    depths << Float16BitsColorDepthID;
+#endif
+    depths << Float32BitsColorDepthID;
+
+    Q_FOREACH (const QString &profile, profiles) {
+        Q_FOREACH (const KoID &src, depths) {
+            Q_FOREACH (const KoID &dst, depths) {
+                if (src == dst) continue;
+
+                QTest::newRow(QString("%1 -> %2 (%3)").arg(src.id()).arg(dst.id()).arg(profile).toLatin1())
+                    << src.id() << dst.id() << profile;
+            }
+        }
+    }
+}
+
+void TestRgbaDepthConversion::testConversion()
+{
+    QFETCH(QString, srcDepth);
+    QFETCH(QString, dstDepth);
+    QFETCH(QString, profile);
+
+    KoColorSpaceRegistry *registry = KoColorSpaceRegistry::instance();
+
+    const KoColorSpace *srcCS = registry->colorSpace(RGBAColorModelID.id(), srcDepth, profile);
+    const KoColorSpace *dstCS = registry->colorSpace(RGBAColorModelID.id(), dstDepth, profile);
+
+    /*
+     *  On some systems these colorspaces cannot be created, so don't die:
+     */
+    if (!srcCS || !dstCS) {
+        QSKIP("The color spaces are not available");
+    }
+
+    // not a multiple of the vector size to check the tails as well
+    const int numPixels = 1001;
+
+    const QVector<quint8> src = generatePixels(srcCS, numPixels);
+    QVector<quint8> dst(numPixels * dstCS->pixelSize());
+    QVector<quint8> scalarDst(numPixels * dstCS->pixelSize());
+    QVector<quint8> lcmsDst(numPixels * dstCS->pixelSize());
+
+    const KoColorConversionTransformation::Intent intent = KoColorConversionTransformation::internalRenderingIntent();
+    const KoColorConversionTransformation::ConversionFlags flags = KoColorConversionTransformation::internalConversionFlags();
+
+    QScopedPointer<KoColorConversionTransformation> transform(
+        srcCS->createColorConverter(dstCS, intent, flags));
+    transform->transform(src.constData(), dst.data(), numPixels);
+
+    // the conversion system should pick the depth conversion, which
+    // gives exactly the same result as its scalar version
+    QScopedPointer<KoRgbaDepthConverter> scalarConverter(
+        createOptimizedClass<KoRgbaDepthConverterFactoryImpl>(
+            qMakePair(srcCS->colorDepthId(), dstCS->colorDepthId()), true));
+    scalarConverter->convert(src.constData(), scalarDst.data(), numPixels);
+
+    QVERIFY(dst == scalarDst);
+
+    // ... and should be as precise as lcms
+    KoColorSpaceEngine *engine = KoColorSpaceEngineRegistry::instance()->get("icc");
+    QVERIFY(engine);
+
+    QScopedPointer<KoColorConversionTransformation> lcmsTransform(
+        engine->createColorTransformation(srcCS, dstCS, intent, flags));
+    lcmsTransform->transform(src.constData(), lcmsDst.data(), numPixels);
+
+    QVector<float> channels(4);
+    QVector<float> lcmsChannels(4);
+
+    for (int i = 0; i < numPixels; i++) {
+        dstCS->normalisedChannelsValue(dst.constData() + i * dstCS->pixelSize(), channels);
+        dstCS->normalisedChannelsValue(lcmsDst.constData() + i * dstCS->pixelSize(), lcmsChannels);
+
+        for (int ch = 0; ch < 4; ch++) {
+            if (qAbs(channels[ch] - lcmsChannels[ch]) >= 1.5 / 255) {
+                qDebug() << "pixel" << i << "channel" << ch
+                         << "value:" << channels[ch]
+                         << "lcms:" << lcmsChannels[ch];
+                QFAIL("the conversion differs from lcms");
+            }
+        }
+    }
+}
+
+KISTEST_MAIN(TestRgbaDepthConversion)
@@ -40,6 +40,11 @@
 #include <kis_spacing_information.h>
 #include <KoColorModelStandardIds.h>
 #include "kis_paintop_plugin_utils.h"
+#include <KisRunnableStrokeJobData.h>
+#include <kis_image_config.h>
+#include <kis_pointer_utils.h>
+
+#include <QElapsedTimer>
 
 
 KisColorSmudgeOp::KisColorSmudgeOp(const KisPaintOpSettingsSP settings, KisPainter* painter, KisNodeSP node, KisImageSP image)
@@ -55,6 +60,10 @@ KisColorSmudgeOp::KisColorSmudgeOp(const KisPaintOpSettingsSP settings, KisPaint
     , m_smudgeRateOption()
     , m_colorRateOption("ColorRate", KisPaintOpOption::GENERAL, false)
     , m_smudgeRadiusOption()
+    , m_avgDabRenderingTime(50)
+    , m_idealNumRects(KisImageConfig(true).maxNumberOfThreads())
+    , m_minUpdatePeriod(10)
+    , m_maxUpdatePeriod(100)
 {
     Q_UNUSED(node);
 
@@ -156,16 +165,6 @@ KisSpacingInformation KisColorSmudgeOp::paintAt(const KisPaintInformation& info)
     KisBrushSP brush = m_brush;
     const bool useDullingMode = m_smudgeRateOption.getMode() == KisSmudgeOption::DULLING_MODE;
 
-    /* This is a fix for dulling + overlay + paint,
-     * this should allow the image to composite paint addition effects correctly
-     * while also respecting overlay mode. */
-    bool useAlternatePrecisionSource = (m_overlayModeOption.isChecked() &&
-                                        useDullingMode &&
-                                        m_preciseImageDeviceWrapper!= nullptr);
-
-    KisPrecisePaintDeviceWrapper &activeWrapper = useAlternatePrecisionSource ? *m_preciseImageDeviceWrapper :
-                                                                                 m_precisePainterWrapper;
-
     // Simple error catching
     if (!painter()->device() || !brush || !brush->canPaintFor(info)) {
         return KisSpacingInformation(1.0);
@@ -247,71 +246,132 @@ KisSpacingInformation KisColorSmudgeOp::paintAt(const KisPaintInformation& info)
 
     const qreal fpOpacity = (qreal(painter()->opacity()) / 255.0) * m_opacityOption.getOpacityf(info);
 
+    DabRequest request;
+    request.dstDabRect = m_dstDabRect;
+    request.srcDabRect = srcDabRect;
+    request.samplePoint = (srcDabRect.topLeft() + hotSpot).toPoint();
+
+    // the dab cache overwrites its device on the next fetch, so
+    // the queued dab needs its own copy of the mask
+    request.maskDab = new KisFixedPaintDevice(*m_maskDab);
+
+    if (useDullingMode && m_smudgeRadiusOption.isChecked()) {
+        const qreal effectiveSize = 0.5 * (m_dstDabRect.width() + m_dstDabRect.height());
+        request.smudgeRadius = m_smudgeRadiusOption.smudgeRadius(info, effectiveSize);
+    }
+
+    // if the user selected the color smudge option,
+    // we will mix some color into the temporary painting device (m_tempDev)
+    if (m_colorRateOption.isChecked()) {
+        // this will calculate the opacity (selected by the user) of copyPainter
+        // (but fit the rate inbetween the range 0.0 to (1.0-SmudgeRate))
+        qreal maxColorRate = qMax<qreal>(1.0 - m_smudgeRateOption.getRate(), 0.2);
+        request.colorRateOpacity = m_colorRateOption.computeOpacity(info, 0.0, maxColorRate, fpOpacity);
+
+        // the current color (foreground color) or a gradient
+        // color (if enabled)
+        KoColor color = m_paintColor;
+        m_gradientOption.apply(color, m_gradient, info);
+        if (m_hsvTransform) {
+            Q_FOREACH (KisPressureHSVOption * option, m_hsvOptions) {
+                option->apply(m_hsvTransform, info);
+            }
+            m_hsvTransform->transform(color.data(), color.data(), 1);
+        }
+
+        request.paintColor = color;
+    }
+
+    // opacity calculated by the rate option
+    request.smudgeRateOpacity = m_smudgeRateOption.computeOpacity(info, 0.0, 1.0, fpOpacity);
+
+    {
+        QMutexLocker l(&m_dabsQueueLock);
+        m_dabsQueue.append(request);
+    }
+
+    return spacingInfo;
+}
+
+KisPrecisePaintDeviceWrapper &KisColorSmudgeOp::activePrecisionWrapper()
+{
+    const bool useDullingMode = m_smudgeRateOption.getMode() == KisSmudgeOption::DULLING_MODE;
+
+    /* This is a fix for dulling + overlay + paint,
+     * this should allow the image to composite paint addition effects correctly
+     * while also respecting overlay mode. */
+    bool useAlternatePrecisionSource = (m_overlayModeOption.isChecked() &&
+                                        useDullingMode &&
+                                        m_preciseImageDeviceWrapper!= nullptr);
+
+    return useAlternatePrecisionSource ? *m_preciseImageDeviceWrapper : m_precisePainterWrapper;
+}
+
+void KisColorSmudgeOp::prefetchDabRects(const DabRequest &request)
+{
+    const bool useDullingMode = m_smudgeRateOption.getMode() == KisSmudgeOption::DULLING_MODE;
+    KisPrecisePaintDeviceWrapper &activeWrapper = activePrecisionWrapper();
+
+    if (!useDullingMode) {
+        activeWrapper.readRect(request.srcDabRect);
+    } else if (m_smudgeRadiusOption.isChecked()) {
+        activeWrapper.readRect(m_smudgeRadiusOption.sampleRect(request.smudgeRadius, request.samplePoint));
+    } else {
+        activeWrapper.readRect(QRect(request.samplePoint, QSize(1,1)));
+    }
+
+    m_precisePainterWrapper.readRects(m_finalPainter->calculateAllMirroredRects(request.dstDabRect));
+}
+
+void KisColorSmudgeOp::prepareDab(const DabRequest &request)
+{
+    const bool useDullingMode = m_smudgeRateOption.getMode() == KisSmudgeOption::DULLING_MODE;
+    KisPrecisePaintDeviceWrapper &activeWrapper = activePrecisionWrapper();
+
+    const QRect &dstDabRect = request.dstDabRect;
+
     if (m_image && m_overlayModeOption.isChecked()) {
         m_image->blockUpdates();
-        m_backgroundPainter->bitBlt(QPoint(), m_image->projection(), srcDabRect);
+        m_backgroundPainter->bitBlt(QPoint(), m_image->projection(), request.srcDabRect);
         m_image->unblockUpdates();
     }
     else {
         // IMPORTANT: Clear the temporary painting device to transparent black.
         //            It will only clear the extents of the brush.
-        m_tempDev->clear(QRect(QPoint(), m_dstDabRect.size()));
+        m_tempDev->clear(QRect(QPoint(), dstDabRect.size()));
     }
 
     // stored in the color space of the paintColor
     KoColor dullingFillColor = m_paintColor;
 
-    QPoint canvasLocalSamplePoint = (srcDabRect.topLeft() + hotSpot).toPoint();
-
     if (!useDullingMode) {
-        activeWrapper.readRect(srcDabRect);
-        m_smudgePainter->bitBlt(QPoint(), activeWrapper.preciseDevice(), srcDabRect);
+        m_smudgePainter->bitBlt(QPoint(), activeWrapper.preciseDevice(), request.srcDabRect);
     } else {
         if (m_smudgeRadiusOption.isChecked()) {
-            const qreal effectiveSize = 0.5 * (m_dstDabRect.width() + m_dstDabRect.height());
-
-            const QRect sampleRect = m_smudgeRadiusOption.sampleRect(info, effectiveSize, canvasLocalSamplePoint);
-            activeWrapper.readRect(sampleRect);
-
-            m_smudgeRadiusOption.apply(&dullingFillColor, info, effectiveSize, canvasLocalSamplePoint.x(), canvasLocalSamplePoint.y(), activeWrapper.preciseDevice());
+            m_smudgeRadiusOption.apply(&dullingFillColor, request.smudgeRadius, request.samplePoint.x(), request.samplePoint.y(), activeWrapper.preciseDevice());
             KIS_SAFE_ASSERT_RECOVER_NOOP(*dullingFillColor.colorSpace() == *m_tempDev->colorSpace());
         } else {
             // get the pixel on the canvas that lies beneath the hot spot
             // of the dab and fill  the temporary paint device with that color
-            activeWrapper.readRect(QRect(canvasLocalSamplePoint, QSize(1,1)));
             KisCrossDeviceColorPickerInt colorPicker(activeWrapper.preciseDevice(), dullingFillColor);
-            colorPicker.pickColor(canvasLocalSamplePoint.x(), canvasLocalSamplePoint.y(), dullingFillColor.data());
+            colorPicker.pickColor(request.samplePoint.x(), request.samplePoint.y(), dullingFillColor.data());
             KIS_SAFE_ASSERT_RECOVER_NOOP(*dullingFillColor.colorSpace() == *m_tempDev->colorSpace());
         }
     }
 
-    // if the user selected the color smudge option,
-    // we will mix some color into the temporary painting device (m_tempDev)
     if (m_colorRateOption.isChecked()) {
-        // this will apply the opacity (selected by the user) to copyPainter
-        // (but fit the rate inbetween the range 0.0 to (1.0-SmudgeRate))
-        qreal maxColorRate = qMax<qreal>(1.0 - m_smudgeRateOption.getRate(), 0.2);
-        m_colorRateOption.apply(*m_colorRatePainter, info, 0.0, maxColorRate, fpOpacity);
+        m_colorRatePainter->setOpacity(request.colorRateOpacity);
 
-        // paint a rectangle with the current color (foreground color)
-        // or a gradient color (if enabled)
-        // into the temporary painting device and use the user selected
-        // composite mode
-        KoColor color = m_paintColor;
-        m_gradientOption.apply(color, m_gradient, info);
-        if (m_hsvTransform) {
-            Q_FOREACH (KisPressureHSVOption * option, m_hsvOptions) {
-                option->apply(m_hsvTransform, info);
-            }
-            m_hsvTransform->transform(color.data(), color.data(), 1);
-        }
+        // paint a rectangle with the current color into the temporary
+        // painting device and use the user selected composite mode
+        KoColor color = request.paintColor;
 
         if (!useDullingMode) {
             KIS_SAFE_ASSERT_RECOVER(*m_colorRatePainter->device()->colorSpace() == *color.colorSpace()) {
                 color.convertTo(m_colorRatePainter->device()->colorSpace());
             }
 
-            m_colorRatePainter->fill(0, 0, m_dstDabRect.width(), m_dstDabRect.height(), color);
+            m_colorRatePainter->fill(0, 0, dstDabRect.width(), dstDabRect.height(), color);
         } else {
             KIS_SAFE_ASSERT_RECOVER(*dullingFillColor.colorSpace() == *color.colorSpace()) {
                 color.convertTo(dullingFillColor.colorSpace());
@@ -327,11 +387,9 @@ KisSpacingInformation KisColorSmudgeOp::paintAt(const KisPaintInformation& info)
 
     if (useDullingMode) {
         KIS_SAFE_ASSERT_RECOVER_NOOP(*dullingFillColor.colorSpace() == *m_tempDev->colorSpace());
-        m_tempDev->fill(QRect(0, 0, m_dstDabRect.width(), m_dstDabRect.height()), dullingFillColor);
+        m_tempDev->fill(QRect(0, 0, dstDabRect.width(), dstDabRect.height()), dullingFillColor);
     }
 
-    m_precisePainterWrapper.readRects(m_finalPainter->calculateAllMirroredRects(m_dstDabRect));
-
     // if color is disabled (only smudge) and "overlay mode" is enabled
     // then first blit the region under the brush from the image projection
     // to the painting device to prevent a rapid build up of alpha value
@@ -342,23 +400,183 @@ KisSpacingInformation KisColorSmudgeOp::paintAt(const KisPaintInformation& info)
         // TODO: check if this code is correct in mirrored mode! Technically, the
         //       painter renders the mirrored dab only, so we should also prepare
         //       the overlay for it in all the places.
-        m_finalPainter->bitBlt(m_dstDabRect.topLeft(), m_image->projection(), m_dstDabRect);
+        m_finalPainter->bitBlt(dstDabRect.topLeft(), m_image->projection(), dstDabRect);
         m_image->unblockUpdates();
     }
 
-    // set opacity calculated by the rate option
-    m_smudgeRateOption.apply(*m_finalPainter, info, 0.0, 1.0, fpOpacity);
+    m_finalPainter->setOpacity(request.smudgeRateOpacity);
+}
+
+void KisColorSmudgeOp::compositeDab(const DabRequest &request)
+{
+    const QRect &rc = request.dstDabRect;
 
     // then blit the temporary painting device on the canvas at the current brush position
     // the alpha mask (maskDab) will be used here to only blit the pixels that are in the area (shape) of the brush
-    m_finalPainter->bitBltWithFixedSelection(m_dstDabRect.x(), m_dstDabRect.y(), m_tempDev, m_maskDab, m_dstDabRect.width(), m_dstDabRect.height());
-    m_finalPainter->renderMirrorMaskSafe(m_dstDabRect, m_tempDev, 0, 0, m_maskDab, !m_dabCache->needSeparateOriginal());
+    m_finalPainter->bitBltWithFixedSelection(rc.x(), rc.y(), m_tempDev, request.maskDab, rc.width(), rc.height());
+
+    // the mask is owned by the request, so it can be mirrored in place
+    m_finalPainter->renderMirrorMaskSafe(rc, m_tempDev, 0, 0, request.maskDab, false);
+}
+
+void KisColorSmudgeOp::compositeDabPatch(const DabRequest &request, const QRect &rc)
+{
+    /**
+     * The patches are painted in parallel, so every one of
+     * them needs its own painter
+     */
+    KisPainter gc(m_precisePainterWrapper.preciseDevice());
+    gc.setCompositeOp(m_finalPainter->compositeOp());
+    gc.setSelection(m_finalPainter->selection());
+    gc.setChannelFlags(m_finalPainter->channelFlags());
+    gc.setOpacity(request.smudgeRateOpacity);
+
+    const QPoint offset = rc.topLeft() - request.dstDabRect.topLeft();
+
+    gc.bitBltWithFixedSelection(rc.x(), rc.y(),
+                                m_tempDev, request.maskDab,
+                                offset.x(), offset.y(),
+                                offset.x(), offset.y(),
+                                rc.width(), rc.height());
+}
+
+void KisColorSmudgeOp::finishDab(const DabRequest &request, bool compositedInPatches)
+{
+    if (compositedInPatches) {
+        m_finalPainter->addDirtyRect(request.dstDabRect);
+    }
 
     const QVector<QRect> dirtyRects = m_finalPainter->takeDirtyRegion();
     m_precisePainterWrapper.writeRects(dirtyRects);
     painter()->addDirtyRects(dirtyRects);
+}
 
-    return spacingInfo;
+struct KisColorSmudgeOp::UpdateSharedState
+{
+    QList<DabRequest> dabsQueue;
+    QElapsedTimer dabRenderingTimer;
+};
+
+std::pair<int, bool> KisColorSmudgeOp::doAsyncronousUpdate(QVector<KisRunnableStrokeJobData *> &jobs)
+{
+    bool someDabsAreStillInQueue = false;
+
+    if (m_updateSharedState) {
+        QMutexLocker l(&m_dabsQueueLock);
+        someDabsAreStillInQueue = !m_dabsQueue.isEmpty();
+        return std::make_pair(m_currentUpdatePeriod, someDabsAreStillInQueue);
+    }
+
+    UpdateSharedStateSP state = toQShared(new UpdateSharedState());
+
+    {
+        QMutexLocker l(&m_dabsQueueLock);
+
+        // we limit the number of fetched dabs to fit the maximum update
+        // period and not make visual hiccups
+        const qreal timePerDab = m_avgDabRenderingTime.rollingMeanSafe();
+        const int dabsLimit =
+            timePerDab > 0 ?
+                qMax(1, int(m_maxUpdatePeriod / timePerDab)) :
+                m_dabsQueue.size();
+
+        const int numDabs = qMin(dabsLimit, m_dabsQueue.size());
+
+        state->dabsQueue = m_dabsQueue.mid(0, numDabs);
+        m_dabsQueue.erase(m_dabsQueue.begin(), m_dabsQueue.begin() + numDabs);
+
+        someDabsAreStillInQueue = !m_dabsQueue.isEmpty();
+    }
+
+    if (state->dabsQueue.isEmpty()) {
+        return std::make_pair(m_currentUpdatePeriod, false);
+    }
+
+    m_updateSharedState = state;
+
+    /**
+     * Every dab samples the result of the previous one, so the dabs are
+     * painted one by one. Only the compositing of every dab is split
+     * into patches that are painted in parallel.
+     *
+     * The areas of the next dab cannot be prefetched while the current
+     * one is being composited: the precise wrapper may drop its prepared
+     * region and convert the overlapping area from the source device
+     * again, overwriting the pixels of the dab which are not written
+     * back yet.
+     */
+
+    jobs.append(
+        new KisRunnableStrokeJobData(
+            [state] () {
+                state->dabRenderingTimer.start();
+            },
+            KisStrokeJobData::SEQUENTIAL));
+
+    for (int i = 0; i < state->dabsQueue.size(); i++) {
+        const DabRequest &request = state->dabsQueue.at(i);
+
+        jobs.append(
+            new KisRunnableStrokeJobData(
+                [state, this, i] () {
+                    prefetchDabRects(state->dabsQueue.at(i));
+                    prepareDab(state->dabsQueue.at(i));
+                },
+                KisStrokeJobData::SEQUENTIAL));
+
+        QVector<QRect> patches;
+
+        // the mirrored dabs are painted by the painter's own machinery
+        if (!m_finalPainter->hasMirroring()) {
+            const int diameter = qMax(request.dstDabRect.width(), request.dstDabRect.height());
+            patches = KisPaintOpUtils::splitDabsIntoRects({request.dstDabRect}, m_idealNumRects, diameter, 1.0);
+        }
+
+        const bool compositeInPatches = patches.size() > 1;
+
+        if (compositeInPatches) {
+            Q_FOREACH (const QRect &rc, patches) {
+                jobs.append(
+                    new KisRunnableStrokeJobData(
+                        [state, this, i, rc] () {
+                            compositeDabPatch(state->dabsQueue.at(i), rc);
+                        },
+                        KisStrokeJobData::CONCURRENT));
+            }
+        } else {
+            jobs.append(
+                new KisRunnableStrokeJobData(
+                    [state, this, i] () {
+                        compositeDab(state->dabsQueue.at(i));
+                    },
+                    KisStrokeJobData::CONCURRENT));
+        }
+
+        jobs.append(
+            new KisRunnableStrokeJobData(
+                [state, this, i, compositeInPatches] () {
+                    finishDab(state->dabsQueue.at(i), compositeInPatches);
+                },
+                KisStrokeJobData::SEQUENTIAL));
+    }
+
+    jobs.append(
+        new KisRunnableStrokeJobData(
+            [state, this, someDabsAreStillInQueue] () {
+                const qreal timePerDab =
+                    qreal(state->dabRenderingTimer.elapsed()) / state->dabsQueue.size();
+
+                m_avgDabRenderingTime(timePerDab);
+
+                m_currentUpdatePeriod =
+                    someDabsAreStillInQueue ? m_minUpdatePeriod :
+                    qBound(m_minUpdatePeriod, int(1.5 * timePerDab * state->dabsQueue.size()), m_maxUpdatePeriod);
+
+                m_updateSharedState.clear();
+            },
+            KisStrokeJobData::SEQUENTIAL));
+
+    return std::make_pair(m_currentUpdatePeriod, someDabsAreStillInQueue);
 }
 
 KisSpacingInformation KisColorSmudgeOp::updateSpacingImpl(const KisPaintInformation &info) const
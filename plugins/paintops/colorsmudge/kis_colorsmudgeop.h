@@ -20,6 +20,8 @@
 #define _KIS_COLORSMUDGEOP_H_
 
 #include <QRect>
+#include <QMutex>
+#include <QSharedPointer>
 
 #include "KoColorTransformation.h"
 #include <KoAbstractGradient.h>
@@ -43,11 +45,14 @@
 #include "kis_smudge_radius_option.h"
 #include "KisPrecisePaintDeviceWrapper.h"
 
+#include <KisRollingMeanAccumulatorWrapper.h>
+
 class QPointF;
 
 class KisBrushBasedPaintOpSettings;
 class KisPainter;
 class KoColorSpace;
+class KisRunnableStrokeJobData;
 
 class KisColorSmudgeOp: public KisBrushBasedPaintOp
 {
@@ -55,6 +60,8 @@ public:
     KisColorSmudgeOp(const KisPaintOpSettingsSP settings, KisPainter* painter, KisNodeSP node, KisImageSP image);
     ~KisColorSmudgeOp() override;
 
+    std::pair<int, bool> doAsyncronousUpdate(QVector<KisRunnableStrokeJobData *> &jobs) override;
+
 protected:
     KisSpacingInformation paintAt(const KisPaintInformation& info) override;
 
@@ -67,6 +74,32 @@ private:
 
     inline void getTopLeftAligned(const QPointF &pos, const QPointF &hotSpot, qint32 *x, qint32 *y);
 
+    /**
+     * Everything paintAt() calculates for a dab. The dab itself is
+     * painted later by the jobs created in doAsyncronousUpdate(),
+     * because it needs the result of the previous dab
+     */
+    struct DabRequest {
+        QRect dstDabRect;
+        QRect srcDabRect;
+        QPoint samplePoint;
+        KisFixedPaintDeviceSP maskDab;
+        KoColor paintColor;
+        int smudgeRadius = 0;
+        quint8 colorRateOpacity = OPACITY_OPAQUE_U8;
+        quint8 smudgeRateOpacity = OPACITY_OPAQUE_U8;
+    };
+
+    struct UpdateSharedState;
+    typedef QSharedPointer<UpdateSharedState> UpdateSharedStateSP;
+
+    KisPrecisePaintDeviceWrapper& activePrecisionWrapper();
+    void prefetchDabRects(const DabRequest &request);
+    void prepareDab(const DabRequest &request);
+    void compositeDab(const DabRequest &request);
+    void compositeDabPatch(const DabRequest &request, const QRect &rc);
+    void finishDab(const DabRequest &request, bool compositedInPatches);
+
 private:
     bool                      m_firstRun;
     KisImageWSP               m_image;
@@ -99,6 +132,17 @@ private:
 
     KoColorTransformation *m_hsvTransform {0};
     const KoCompositeOp *m_preciseColorRateCompositeOp {0};
+
+    QMutex m_dabsQueueLock;
+    QList<DabRequest> m_dabsQueue;
+    UpdateSharedStateSP m_updateSharedState;
+
+    int m_currentUpdatePeriod = 20;
+    KisRollingMeanAccumulatorWrapper m_avgDabRenderingTime;
+
+    const int m_idealNumRects;
+    const int m_minUpdatePeriod;
+    const int m_maxUpdatePeriod;
 };
 
 #endif // _KIS_COLORSMUDGEOP_H_
@@ -35,15 +35,18 @@ KisRateOption::KisRateOption(const QString& name, KisPaintOpOption::PaintopCateg
 }
 
 void KisRateOption::apply(KisPainter& painter, const KisPaintInformation& info, qreal scaleMin, qreal scaleMax, qreal multiplicator) const
+{
+    painter.setOpacity(computeOpacity(info, scaleMin, scaleMax, multiplicator));
+}
+
+quint8 KisRateOption::computeOpacity(const KisPaintInformation& info, qreal scaleMin, qreal scaleMax, qreal multiplicator) const
 {
     if (!isChecked()) {
-        painter.setOpacity((quint8)(scaleMax * 255.0));
-        return;
+        return (quint8)(scaleMax * 255.0);
     }
 
     qreal value = computeSizeLikeValue(info);
 
     qreal  rate    = scaleMin + (scaleMax - scaleMin) * multiplicator * value; // scale m_rate into the range scaleMin - scaleMax
-    quint8 opacity = qBound(OPACITY_TRANSPARENT_U8, (quint8)(rate * 255.0), OPACITY_OPAQUE_U8);
-    painter.setOpacity(opacity);
+    return qBound(OPACITY_TRANSPARENT_U8, (quint8)(rate * 255.0), OPACITY_OPAQUE_U8);
 }
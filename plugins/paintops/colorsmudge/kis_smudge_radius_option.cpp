@@ -46,29 +46,25 @@ KisSmudgeRadiusOption::KisSmudgeRadiusOption():
     setValueRange(0.0,300.0);
 }
 
-QRect KisSmudgeRadiusOption::sampleRect(const KisPaintInformation& info,
-                                        qreal diameter,
-                                        const QPoint &pos) const
+int KisSmudgeRadiusOption::smudgeRadius(const KisPaintInformation& info, qreal diameter) const
 {
     const qreal sliderValue = computeSizeLikeValue(info);
-    const int smudgeRadius = ((sliderValue * diameter) * 0.5) / 100.0;
+    return ((sliderValue * diameter) * 0.5) / 100.0;
+}
 
+QRect KisSmudgeRadiusOption::sampleRect(int smudgeRadius, const QPoint &pos) const
+{
     return kisGrowRect(QRect(pos, QSize(1,1)), smudgeRadius + 1);
 }
 
 void KisSmudgeRadiusOption::apply(KoColor *resultColor,
-                                  const KisPaintInformation& info,
-                                  qreal diameter,
+                                  int smudgeRadius,
                                   qreal posx,
                                   qreal posy,
                                   KisPaintDeviceSP dev) const
 {
     if (!isChecked()) return;
 
-    qreal sliderValue = computeSizeLikeValue(info);
-
-    int smudgeRadius = ((sliderValue * diameter) * 0.5) / 100.0;
-
 
     KoColor color(Qt::transparent, dev->colorSpace());
 
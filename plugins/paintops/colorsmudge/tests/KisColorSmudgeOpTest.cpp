@@ -0,0 +1,177 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisColorSmudgeOpTest.h"
+
+#include <cmath>
+
+#include <QTest>
+#include <QtConcurrent>
+
+#include <KoColor.h>
+#include <KoColorSpaceRegistry.h>
+#include <KisGlobalResourcesInterface.h>
+
+#include <testutil.h>
+#include <kis_painter.h>
+#include <kis_paint_device.h>
+#include <kis_distance_information.h>
+#include <brushengine/kis_paint_information.h>
+#include <KisRunnableStrokeJobData.h>
+#include <kis_auto_brush.h>
+#include <kis_circle_mask_generator.h>
+#include <kis_brush_option.h>
+#include <kis_brush_based_paintop_settings.h>
+
+#include "../kis_colorsmudgeop.h"
+#include "../kis_smudge_option.h"
+#include "../kis_rate_option.h"
+
+namespace {
+
+KisPaintDeviceSP createCanvas()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+
+    // stripes of different colors, so the smudging has something to mix
+    const QColor colors[] = {Qt::red, Qt::green, Qt::blue, Qt::yellow};
+
+    for (int i = 0; i < 16; i++) {
+        dev->fill(QRect(i * 32, 0, 32, 300), KoColor(colors[i % 4], cs));
+    }
+
+    return dev;
+}
+
+KisPaintOpSettingsSP createSettings(KisSmudgeOption::Mode mode)
+{
+    KisPaintOpSettingsSP settings =
+        new KisBrushBasedPaintOpSettings(KisGlobalResourcesInterface::instance());
+
+    KisBrushSP brush(new KisAutoBrush(new KisCircleMaskGenerator(80, 1.0, 0.5, 0.5, 2, true), 0.0, 0.0));
+    brush->setSpacing(0.1);
+
+    KisBrushOptionProperties brushOption;
+    brushOption.setBrush(brush);
+    brushOption.writeOptionSetting(settings);
+
+    KisSmudgeOption smudgeOption;
+    smudgeOption.setChecked(true);
+    smudgeOption.setCurveUsed(false);
+    smudgeOption.setRate(0.8);
+    smudgeOption.setMode(mode);
+    smudgeOption.writeOptionSetting(settings);
+
+    KisRateOption colorRateOption("ColorRate", KisPaintOpOption::GENERAL, false);
+    colorRateOption.setChecked(true);
+    colorRateOption.setCurveUsed(false);
+    colorRateOption.setRate(0.3);
+    colorRateOption.writeOptionSetting(settings);
+
+    return settings;
+}
+
+/**
+ * Runs the jobs the way the strokes queue does: the groups of
+ * concurrent jobs are executed in parallel, the sequential ones
+ * are executed one by one. When \p parallel is false, all the jobs
+ * are executed in order in the current thread, which is what the
+ * synchronous smudge op used to do.
+ */
+void runJobs(QVector<KisRunnableStrokeJobData*> &jobs, bool parallel)
+{
+    int i = 0;
+
+    while (i < jobs.size()) {
+        if (!parallel || jobs[i]->isSequential()) {
+            jobs[i]->run();
+            i++;
+            continue;
+        }
+
+        QVector<KisRunnableStrokeJobData*> concurrentJobs;
+
+        while (i < jobs.size() && !jobs[i]->isSequential()) {
+            concurrentJobs << jobs[i];
+            i++;
+        }
+
+        QtConcurrent::blockingMap(concurrentJobs,
+                                  [] (KisRunnableStrokeJobData *job) {
+                                      job->run();
+                                  });
+    }
+
+    qDeleteAll(jobs);
+    jobs.clear();
+}
+
+KisPaintDeviceSP paintStroke(KisSmudgeOption::Mode mode, bool parallel)
+{
+    KisPaintDeviceSP dev = createCanvas();
+
+    KisPainter painter(dev);
+    painter.setPaintColor(KoColor(Qt::black, dev->colorSpace()));
+
+    KisColorSmudgeOp op(createSettings(mode), &painter, 0, 0);
+
+    KisDistanceInformation distance;
+
+    for (int i = 0; i < 100; i++) {
+        const QPointF pt(50 + 4 * i, 150 + 50 * std::sin(i * 0.1));
+        op.paintAt(KisPaintInformation(pt, 1.0), &distance);
+    }
+
+    bool someDabsAreStillInQueue = true;
+
+    while (someDabsAreStillInQueue) {
+        QVector<KisRunnableStrokeJobData*> jobs;
+        someDabsAreStillInQueue = op.doAsyncronousUpdate(jobs).second;
+        runJobs(jobs, parallel);
+    }
+
+    return dev;
+}
+
+void testAsynchronousRendering(KisSmudgeOption::Mode mode)
+{
+    KisPaintDeviceSP serialResult = paintStroke(mode, false);
+
+    for (int i = 0; i < 5; i++) {
+        KisPaintDeviceSP parallelResult = paintStroke(mode, true);
+
+        QPoint errorPoint;
+        if (!TestUtil::comparePaintDevices(errorPoint, serialResult, parallelResult)) {
+            QFAIL(QString("The parallel result differs from the serial one at %1,%2")
+                  .arg(errorPoint.x()).arg(errorPoint.y()).toLatin1());
+        }
+    }
+}
+
+}
+
+void KisColorSmudgeOpTest::testAsynchronousRenderingSmearing()
+{
+    testAsynchronousRendering(KisSmudgeOption::SMEARING_MODE);
+}
+
+void KisColorSmudgeOpTest::testAsynchronousRenderingDulling()
+{
+    testAsynchronousRendering(KisSmudgeOption::DULLING_MODE);
+}
+
+QTEST_MAIN(KisColorSmudgeOpTest)
@@ -26,6 +26,8 @@
 #include <QVariant>
 #include <QHash>
 #include <QVector>
+#include <QThread>
+#include <QtConcurrentMap>
 
 #include <kis_types.h>
 #include <kis_random_accessor_ng.h>
@@ -36,6 +38,56 @@
 #include <cmath>
 #include <ctime>
 
+namespace {
+
+/**
+ * A minimal random accessor over a KisFixedPaintDevice, which lets the
+ * worker threads paint the bristles with the same pixel functions as
+ * the dab accessor does. The pixels outside the device are written
+ * into a scratch pixel. Every pixel the accessor is moved to is marked
+ * in the \p touched mask, so that the merge can tell the pixels written
+ * with zero opacity from the untouched ones.
+ */
+class FixedDeviceAccessor
+{
+public:
+    FixedDeviceAccessor(KisFixedPaintDeviceSP device, quint8 *touched)
+        : m_data(device->data()),
+          m_touched(touched),
+          m_bounds(device->bounds()),
+          m_pixelSize(device->pixelSize()),
+          m_rowStride(m_bounds.width() * m_pixelSize),
+          m_pixel(m_scratch)
+    {
+        memset(m_scratch, 0, sizeof(m_scratch));
+    }
+
+    inline void moveTo(int x, int y) {
+        if (m_bounds.contains(x, y)) {
+            const int index = (y - m_bounds.y()) * m_bounds.width() + (x - m_bounds.x());
+            m_pixel = m_data + index * m_pixelSize;
+            m_touched[index] = 1;
+        } else {
+            memset(m_scratch, 0, m_pixelSize);
+            m_pixel = m_scratch;
+        }
+    }
+
+    inline quint8* rawData() {
+        return m_pixel;
+    }
+
+private:
+    quint8 *m_data;
+    quint8 *m_touched;
+    QRect m_bounds;
+    int m_pixelSize;
+    int m_rowStride;
+    quint8 *m_pixel;
+    quint8 m_scratch[MAX_PIXEL_SIZE];
+};
+
+}
 
 HairyBrush::HairyBrush()
 {
@@ -50,6 +102,7 @@ HairyBrush::HairyBrush()
 HairyBrush::~HairyBrush()
 {
     delete m_transfo;
+    qDeleteAll(m_chunkTransfos);
     qDeleteAll(m_bristles.begin(), m_bristles.end());
     m_bristles.clear();
 }
@@ -134,7 +187,6 @@ void HairyBrush::paintLine(KisPaintDeviceSP dab, KisPaintDeviceSP layer, const K
     qreal pressure = mousePressure * (pi2.pressure() * 2);
 
     Bristle *bristle = 0;
-    KoColor bristleColor(dab->colorSpace());
 
     m_dabAccessor = dab->createRandomAccessorNG();
 
@@ -163,11 +215,16 @@ void HairyBrush::paintLine(KisPaintDeviceSP dab, KisPaintDeviceSP layer, const K
     qreal randomX, randomY;
     qreal shear;
 
-    float inkDeplation = 0.0;
-    int inkDepletionSize = m_properties->inkDepletionCurve.size();
     int bristleCount = m_bristles.size();
-    int bristlePathSize;
     qreal threshold = 1.0 - pi2.pressure();
+
+    QVector<BristleSegment> segments;
+    segments.reserve(bristleCount);
+
+    /**
+     * The positions of the bristles are computed serially, so the
+     * random numbers are consumed in the same order in both modes
+     */
     for (int i = 0; i < bristleCount; i++) {
 
         if (!m_bristles.at(i)->enabled()) continue;
@@ -208,44 +265,199 @@ void HairyBrush::paintLine(KisPaintDeviceSP dab, KisPaintDeviceSP layer, const K
         fy2 += y2;
 
         if (m_properties->threshold && (bristle->length() < threshold)) continue;
-        // paint between first and last dab
-        const QVector<QPointF> bristlePath = m_trajectory.getLinearTrajectory(QPointF(fx1, fy1), QPointF(fx2, fy2), 1.0);
-        bristlePathSize = m_trajectory.size();
 
-        // avoid overlapping bristle caps with antialias on
-        if (m_properties->antialias) {
-            bristlePathSize -= 1;
+        BristleSegment segment;
+        segment.bristle = bristle;
+        segment.start = QPointF(fx1, fy1);
+        segment.end = QPointF(fx2, fy2);
+        segments.append(segment);
+    }
+
+    // a thread is not worth starting for just a few bristles
+    static const int minSegmentsPerChunk = 64;
+
+    const int numChunks = m_properties->paintInParallel ?
+        qMin(QThread::idealThreadCount(), segments.size() / minSegmentsPerChunk) : 1;
+
+    if (numChunks > 1) {
+        paintSegmentsInParallel(segments, numChunks, pressure);
+    } else {
+        paintSegmentsSerially(segments, pressure);
+    }
+
+    m_dab = 0;
+    m_dabAccessor = 0;
+}
+
+void HairyBrush::paintSegmentsSerially(const QVector<BristleSegment> &segments, qreal pressure)
+{
+    KoColor bristleColor(m_dab->colorSpace());
+
+    for (int i = 0; i < segments.size(); i++) {
+        paintBristleSegment(segments[i], *m_dabAccessor, m_trajectory, m_transfo, bristleColor, pressure);
+    }
+}
+
+void HairyBrush::paintSegmentsInParallel(const QVector<BristleSegment> &segments, int numChunks, qreal pressure)
+{
+    const KoColorSpace *cs = m_dab->colorSpace();
+
+    // the saturation transformation keeps its parameters, so every thread needs its own one
+    while (m_chunkTransfos.size() < numChunks) {
+        KoColorTransformation *transfo = 0;
+        if (m_properties->useSaturation && m_transfo) {
+            transfo = cs->createColorTransformation("hsv_adjustment", m_params);
         }
+        m_chunkTransfos.append(transfo);
+    }
 
-        memcpy(bristleColor.data(), bristle->color().data() , m_pixelSize);
-        for (int i = 0; i < bristlePathSize ; i++) {
+    /**
+     * Every bristle belongs to exactly one chunk, so its ink state is
+     * updated in the same order as in the serial mode
+     */
+    QVector<BristleChunk> chunks;
+    chunks.reserve(numChunks);
+
+    for (int i = 0; i < numChunks; i++) {
+        BristleChunk chunk;
+        chunk.begin = i * segments.size() / numChunks;
+        chunk.end = (i + 1) * segments.size() / numChunks;
+        chunk.transfo = m_chunkTransfos[i];
+
+        qreal minX = segments[chunk.begin].start.x();
+        qreal minY = segments[chunk.begin].start.y();
+        qreal maxX = minX;
+        qreal maxY = minY;
+
+        for (int j = chunk.begin; j < chunk.end; j++) {
+            const BristleSegment &segment = segments[j];
+            minX = qMin(minX, qMin(segment.start.x(), segment.end.x()));
+            minY = qMin(minY, qMin(segment.start.y(), segment.end.y()));
+            maxX = qMax(maxX, qMax(segment.start.x(), segment.end.x()));
+            maxY = qMax(maxY, qMax(segment.start.y(), segment.end.y()));
+        }
 
-            if (m_properties->inkDepletionEnabled) {
-                inkDeplation = fetchInkDepletion(bristle, inkDepletionSize);
+        // the particles also touch the pixels to the right and below the path
+        const QRect bounds =
+            QRectF(QPointF(minX, minY), QPointF(maxX, maxY)).toAlignedRect().adjusted(-1, -1, 2, 2);
 
-                if (m_properties->useSaturation && m_transfo != 0) {
-                    saturationDepletion(bristle, bristleColor, pressure, inkDeplation);
-                }
+        chunk.device = new KisFixedPaintDevice(cs);
+        chunk.device->setRect(bounds);
+        chunk.device->initialize();
+        chunk.touched.fill(0, bounds.width() * bounds.height());
 
-                if (m_properties->useOpacity) {
-                    opacityDepletion(bristle, bristleColor, pressure, inkDeplation);
-                }
+        chunks.append(chunk);
+    }
 
+    QtConcurrent::blockingMap(chunks,
+        [this, &segments, pressure] (BristleChunk &chunk) {
+            FixedDeviceAccessor accessor(chunk.device, chunk.touched.data());
+            Trajectory trajectory;
+            KoColor bristleColor(m_dab->colorSpace());
+
+            for (int i = chunk.begin; i < chunk.end; i++) {
+                paintBristleSegment(segments[i], accessor, trajectory, chunk.transfo, bristleColor, pressure);
             }
-            else {
-                if (bristleColor.opacityU8() != 0) {
-                    bristleColor.setOpacity(bristle->length());
-                }
+        });
+
+    // the chunks are merged in the order of the bristles, so the result
+    // doesn't depend on the scheduling of the threads
+    for (int i = 0; i < chunks.size(); i++) {
+        mergeChunk(chunks[i]);
+    }
+}
+
+void HairyBrush::mergeChunk(const BristleChunk &chunk)
+{
+    const QRect rc = chunk.device->bounds();
+    const KoColorSpace *cs = m_dab->colorSpace();
+    const int numPixels = rc.width() * rc.height();
+
+    QVector<quint8> buffer(numPixels * m_pixelSize);
+    m_dab->readBytes(buffer.data(), rc);
+
+    quint8 *dst = buffer.data();
+    const quint8 *src = chunk.device->data();
+
+    if (m_properties->useCompositing) {
+        const int rowStride = rc.width() * m_pixelSize;
+        m_compositeOp->composite(dst, rowStride, src, rowStride, 0, 0, rc.height(), rc.width(), OPACITY_OPAQUE_U8);
+    } else if (m_properties->antialias) {
+        /**
+         * The particles sum up the opacity and take the color of the last
+         * one, see paintParticle(). A particle with zero weight still
+         * overwrites the color, so every touched pixel is merged, not
+         * only the ones with non-zero opacity.
+         */
+        const quint8 *touched = chunk.touched.constData();
+
+        for (int i = 0; i < numPixels; i++) {
+            if (touched[i]) {
+                const quint8 srcOpacity = cs->opacityU8(src);
+                const quint8 dstOpacity = cs->opacityU8(dst);
+                memcpy(dst, src, m_pixelSize);
+                cs->setOpacity(dst, quint8(qMin<quint16>(srcOpacity + dstOpacity, OPACITY_OPAQUE_U8)), 1);
+            }
+            src += m_pixelSize;
+            dst += m_pixelSize;
+        }
+    } else {
+        // see darkenPixel()
+        for (int i = 0; i < numPixels; i++) {
+            if (cs->opacityU8(dst) < cs->opacityU8(src)) {
+                memcpy(dst, src, m_pixelSize);
+            }
+            src += m_pixelSize;
+            dst += m_pixelSize;
+        }
+    }
+
+    m_dab->writeBytes(buffer.data(), rc);
+}
+
+template <class Accessor>
+void HairyBrush::paintBristleSegment(const BristleSegment &segment, Accessor &accessor, Trajectory &trajectory,
+                                     KoColorTransformation *transfo, KoColor &bristleColor, qreal pressure)
+{
+    Bristle *bristle = segment.bristle;
+
+    float inkDeplation = 0.0;
+    int inkDepletionSize = m_properties->inkDepletionCurve.size();
+
+    // paint between first and last dab
+    const QVector<QPointF> bristlePath = trajectory.getLinearTrajectory(segment.start, segment.end, 1.0);
+    int bristlePathSize = trajectory.size();
+
+    // avoid overlapping bristle caps with antialias on
+    if (m_properties->antialias) {
+        bristlePathSize -= 1;
+    }
+
+    memcpy(bristleColor.data(), bristle->color().data() , m_pixelSize);
+    for (int i = 0; i < bristlePathSize ; i++) {
+
+        if (m_properties->inkDepletionEnabled) {
+            inkDeplation = fetchInkDepletion(bristle, inkDepletionSize);
+
+            if (m_properties->useSaturation && transfo != 0) {
+                saturationDepletion(bristle, bristleColor, pressure, inkDeplation, transfo);
+            }
+
+            if (m_properties->useOpacity) {
+                opacityDepletion(bristle, bristleColor, pressure, inkDeplation);
             }
 
-            addBristleInk(bristle, bristlePath.at(i), bristleColor);
-            bristle->setInkAmount(1.0 - inkDeplation);
-            bristle->upIncrement();
+        }
+        else {
+            if (bristleColor.opacityU8() != 0) {
+                bristleColor.setOpacity(bristle->length());
+            }
         }
 
+        addBristleInk(accessor, bristlePath.at(i), bristleColor);
+        bristle->setInkAmount(1.0 - inkDeplation);
+        bristle->upIncrement();
     }
-    m_dab = 0;
-    m_dabAccessor = 0;
 }
 
 
@@ -259,7 +471,7 @@ inline qreal HairyBrush::fetchInkDepletion(Bristle* bristle, int inkDepletionSiz
 }
 
 
-void HairyBrush::saturationDepletion(Bristle * bristle, KoColor &bristleColor, qreal pressure, qreal inkDeplation)
+void HairyBrush::saturationDepletion(Bristle * bristle, KoColor &bristleColor, qreal pressure, qreal inkDeplation, KoColorTransformation *transfo)
 {
     qreal saturation;
     if (m_properties->useWeights) {
@@ -279,12 +491,12 @@ void HairyBrush::saturationDepletion(Bristle * bristle, KoColor &bristleColor, q
                          (1.0 - inkDeplation)) - 1.0;
 
     }
-    m_transfo->setParameter(m_transfo->parameterId("h"), 0.0);
-    m_transfo->setParameter(m_transfo->parameterId("v"), 0.0);
-    m_transfo->setParameter(m_saturationId, saturation);
-    m_transfo->setParameter(3, 1);//sets the type to
-    m_transfo->setParameter(4, false);//sets the colorize to none.
-    m_transfo->transform(bristleColor.data(), bristleColor.data() , 1);
+    transfo->setParameter(transfo->parameterId("h"), 0.0);
+    transfo->setParameter(transfo->parameterId("v"), 0.0);
+    transfo->setParameter(m_saturationId, saturation);
+    transfo->setParameter(3, 1);//sets the type to
+    transfo->setParameter(4, false);//sets the colorize to none.
+    transfo->transform(bristleColor.data(), bristleColor.data() , 1);
 }
 
 void HairyBrush::opacityDepletion(Bristle* bristle, KoColor& bristleColor, qreal pressure, qreal inkDeplation)
@@ -306,29 +518,30 @@ void HairyBrush::opacityDepletion(Bristle* bristle, KoColor& bristleColor, qreal
     bristleColor.setOpacity(opacity);
 }
 
-inline void HairyBrush::addBristleInk(Bristle *bristle,const QPointF &pos, const KoColor &color)
+template <class Accessor>
+inline void HairyBrush::addBristleInk(Accessor &accessor, const QPointF &pos, const KoColor &color)
 {
-    Q_UNUSED(bristle);
     if (m_properties->antialias) {
         if (m_properties->useCompositing) {
-            paintParticle(pos, color);
+            paintParticle(accessor, pos, color);
         } else {
-            paintParticle(pos, color, 1.0);
+            paintParticle(accessor, pos, color, 1.0);
         }
     }
     else {
         int ix = qRound(pos.x());
         int iy = qRound(pos.y());
         if (m_properties->useCompositing) {
-            plotPixel(ix, iy, color);
+            plotPixel(accessor, ix, iy, color);
         }
         else {
-            darkenPixel(ix, iy, color);
+            darkenPixel(accessor, ix, iy, color);
         }
     }
 }
 
-void HairyBrush::paintParticle(QPointF pos, const KoColor& color, qreal weight)
+template <class Accessor>
+void HairyBrush::paintParticle(Accessor &accessor, QPointF pos, const KoColor& color, qreal weight)
 {
     // opacity top left, right, bottom left, right
     quint8 opacity = color.opacityU8();
@@ -346,31 +559,32 @@ void HairyBrush::paintParticle(QPointF pos, const KoColor& color, qreal weight)
 
     const KoColorSpace * cs = m_dab->colorSpace();
 
-    m_dabAccessor->moveTo(ipx  , ipy);
-    btl = quint8(qBound<quint16>(OPACITY_TRANSPARENT_U8, btl + cs->opacityU8(m_dabAccessor->rawData()), OPACITY_OPAQUE_U8));
-    memcpy(m_dabAccessor->rawData(), color.data(), cs->pixelSize());
-    cs->setOpacity(m_dabAccessor->rawData(), btl, 1);
-
-    m_dabAccessor->moveTo(ipx + 1, ipy);
-    btr =  quint8(qBound<quint16>(OPACITY_TRANSPARENT_U8, btr + cs->opacityU8(m_dabAccessor->rawData()), OPACITY_OPAQUE_U8));
-    memcpy(m_dabAccessor->rawData(), color.data(), cs->pixelSize());
-    cs->setOpacity(m_dabAccessor->rawData(), btr, 1);
-
-    m_dabAccessor->moveTo(ipx, ipy + 1);
-    bbl = quint8(qBound<quint16>(OPACITY_TRANSPARENT_U8, bbl + cs->opacityU8(m_dabAccessor->rawData()), OPACITY_OPAQUE_U8));
-    memcpy(m_dabAccessor->rawData(), color.data(), cs->pixelSize());
-    cs->setOpacity(m_dabAccessor->rawData(), bbl, 1);
-
-    m_dabAccessor->moveTo(ipx + 1, ipy + 1);
-    bbr = quint8(qBound<quint16>(OPACITY_TRANSPARENT_U8, bbr + cs->opacityU8(m_dabAccessor->rawData()), OPACITY_OPAQUE_U8));
-    memcpy(m_dabAccessor->rawData(), color.data(), cs->pixelSize());
-    cs->setOpacity(m_dabAccessor->rawData(), bbr, 1);
+    accessor.moveTo(ipx  , ipy);
+    btl = quint8(qBound<quint16>(OPACITY_TRANSPARENT_U8, btl + cs->opacityU8(accessor.rawData()), OPACITY_OPAQUE_U8));
+    memcpy(accessor.rawData(), color.data(), cs->pixelSize());
+    cs->setOpacity(accessor.rawData(), btl, 1);
+
+    accessor.moveTo(ipx + 1, ipy);
+    btr =  quint8(qBound<quint16>(OPACITY_TRANSPARENT_U8, btr + cs->opacityU8(accessor.rawData()), OPACITY_OPAQUE_U8));
+    memcpy(accessor.rawData(), color.data(), cs->pixelSize());
+    cs->setOpacity(accessor.rawData(), btr, 1);
+
+    accessor.moveTo(ipx, ipy + 1);
+    bbl = quint8(qBound<quint16>(OPACITY_TRANSPARENT_U8, bbl + cs->opacityU8(accessor.rawData()), OPACITY_OPAQUE_U8));
+    memcpy(accessor.rawData(), color.data(), cs->pixelSize());
+    cs->setOpacity(accessor.rawData(), bbl, 1);
+
+    accessor.moveTo(ipx + 1, ipy + 1);
+    bbr = quint8(qBound<quint16>(OPACITY_TRANSPARENT_U8, bbr + cs->opacityU8(accessor.rawData()), OPACITY_OPAQUE_U8));
+    memcpy(accessor.rawData(), color.data(), cs->pixelSize());
+    cs->setOpacity(accessor.rawData(), bbr, 1);
 }
 
-void HairyBrush::paintParticle(QPointF pos, const KoColor& color)
+template <class Accessor>
+void HairyBrush::paintParticle(Accessor &accessor, QPointF pos, const KoColor& color)
 {
     // opacity top left, right, bottom left, right
-    memcpy(m_color.data(), color.data(), m_pixelSize);
+    KoColor particleColor(color);
     quint8 opacity = color.opacityU8();
 
     int ipx = int (pos.x());
@@ -383,31 +597,33 @@ void HairyBrush::paintParticle(QPointF pos, const KoColor& color)
     quint8 bbl = qRound((1.0 - fx) * (fy)  * opacity);
     quint8 bbr = qRound((fx)  * (fy)  * opacity);
 
-    m_color.setOpacity(btl);
-    plotPixel(ipx  , ipy, m_color);
+    particleColor.setOpacity(btl);
+    plotPixel(accessor, ipx  , ipy, particleColor);
 
-    m_color.setOpacity(btr);
-    plotPixel(ipx + 1  , ipy, m_color);
+    particleColor.setOpacity(btr);
+    plotPixel(accessor, ipx + 1  , ipy, particleColor);
 
-    m_color.setOpacity(bbl);
-    plotPixel(ipx  , ipy + 1, m_color);
+    particleColor.setOpacity(bbl);
+    plotPixel(accessor, ipx  , ipy + 1, particleColor);
 
-    m_color.setOpacity(bbr);
-    plotPixel(ipx + 1 , ipy + 1, m_color);
+    particleColor.setOpacity(bbr);
+    plotPixel(accessor, ipx + 1 , ipy + 1, particleColor);
 }
 
 
-inline void HairyBrush::plotPixel(int wx, int wy, const KoColor &color)
+template <class Accessor>
+inline void HairyBrush::plotPixel(Accessor &accessor, int wx, int wy, const KoColor &color)
 {
-    m_dabAccessor->moveTo(wx, wy);
-    m_compositeOp->composite(m_dabAccessor->rawData(), m_pixelSize, color.data() , m_pixelSize, 0, 0, 1, 1, OPACITY_OPAQUE_U8);
+    accessor.moveTo(wx, wy);
+    m_compositeOp->composite(accessor.rawData(), m_pixelSize, color.data() , m_pixelSize, 0, 0, 1, 1, OPACITY_OPAQUE_U8);
 }
 
-inline void HairyBrush::darkenPixel(int wx, int wy, const KoColor &color)
+template <class Accessor>
+inline void HairyBrush::darkenPixel(Accessor &accessor, int wx, int wy, const KoColor &color)
 {
-    m_dabAccessor->moveTo(wx, wy);
-    if (m_dab->colorSpace()->opacityU8(m_dabAccessor->rawData()) < color.opacityU8()) {
-        memcpy(m_dabAccessor->rawData(), color.data(), m_pixelSize);
+    accessor.moveTo(wx, wy);
+    if (m_dab->colorSpace()->opacityU8(accessor.rawData()) < color.opacityU8()) {
+        memcpy(accessor.rawData(), color.data(), m_pixelSize);
     }
 }
 
@@ -29,10 +29,12 @@
 #include "bristle.h"
 
 #include <kis_paint_device.h>
+#include <kis_fixed_paint_device.h>
 #include <brushengine/kis_paint_information.h>
 #include <kis_random_accessor_ng.h>
 
 class KoCompositeOp;
+class KoColorTransformation;
 
 
 class KisHairyProperties
@@ -53,6 +55,7 @@ public:
     bool connectedPath;
     bool antialias;
     bool useCompositing;
+    bool paintInParallel;
 
     quint8 pressureWeight;
     quint8 bristleLengthWeight;
@@ -86,16 +89,50 @@ public:
     void fromDabWithDensity(KisFixedPaintDeviceSP dab, qreal density);
 
 private:
+    friend class KisHairyBrushTest;
+
+    /// the path of a single bristle between two paintLine() positions
+    struct BristleSegment {
+        Bristle *bristle;
+        QPointF start;
+        QPointF end;
+    };
+
+    /// a contiguous range of segments painted by one worker thread
+    struct BristleChunk {
+        int begin;
+        int end;
+        KisFixedPaintDeviceSP device;
+        QVector<quint8> touched;
+        KoColorTransformation *transfo;
+    };
+
+    /// paints the whole path of a single bristle, updates its ink state
+    template <class Accessor>
+    void paintBristleSegment(const BristleSegment &segment, Accessor &accessor, Trajectory &trajectory,
+                             KoColorTransformation *transfo, KoColor &bristleColor, qreal pressure);
+    /// paints the segments one by one directly into the dab
+    void paintSegmentsSerially(const QVector<BristleSegment> &segments, qreal pressure);
+    /// paints the segments into per-thread fixed devices and merges them into the dab
+    void paintSegmentsInParallel(const QVector<BristleSegment> &segments, int numChunks, qreal pressure);
+    /// merges the device painted by a worker thread into the dab
+    void mergeChunk(const BristleChunk &chunk);
+
     /// paints single bristle
-    void addBristleInk(Bristle *bristle,const QPointF &pos, const KoColor &color);
+    template <class Accessor>
+    void addBristleInk(Accessor &accessor, const QPointF &pos, const KoColor &color);
     /// composite single pixel to dab
-    void plotPixel(int wx, int wy, const KoColor &color);
+    template <class Accessor>
+    void plotPixel(Accessor &accessor, int wx, int wy, const KoColor &color);
     /// check the opacity of dab pixel and if the opacity is less then color, it will copy color to dab
-    void darkenPixel(int wx, int wy, const KoColor &color);
+    template <class Accessor>
+    void darkenPixel(Accessor &accessor, int wx, int wy, const KoColor &color);
     /// paint wu particle by copying the color and setup just the opacity, weight is complementary to opacity of the color
-    void paintParticle(QPointF pos, const KoColor& color, qreal weight);
+    template <class Accessor>
+    void paintParticle(Accessor &accessor, QPointF pos, const KoColor& color, qreal weight);
     /// paint wu particle using composite operation
-    void paintParticle(QPointF pos, const KoColor& color);
+    template <class Accessor>
+    void paintParticle(Accessor &accessor, QPointF pos, const KoColor& color);
     /// similar to sample input color in spray
     void colorifyBristles(KisPaintDeviceSP source, QPointF point);
 
@@ -104,7 +141,7 @@ private:
     double computeMousePressure(double distance);
 
     /// simulate running out of saturation
-    void saturationDepletion(Bristle * bristle, KoColor &bristleColor, qreal pressure, qreal inkDeplation);
+    void saturationDepletion(Bristle * bristle, KoColor &bristleColor, qreal pressure, qreal inkDeplation, KoColorTransformation *transfo);
     /// simulate running out of ink through opacity decreasing
     void opacityDepletion(Bristle * bristle, KoColor &bristleColor, qreal pressure, qreal inkDeplation);
     /// fetch actual ink status according depletion curve
@@ -135,6 +172,8 @@ private:
 
     int m_saturationId;
     KoColorTransformation * m_transfo;
+    // saturation transformations of the worker threads, one per chunk
+    QVector<KoColorTransformation*> m_chunkTransfos;
 
     // internal counter counts the calls of paint, the counter is 1 when the first call occurs
     inline bool firstStroke() const {
@@ -63,6 +63,7 @@ KisHairyBristleOption::KisHairyBristleOption()
     connect(m_options->connectedCBox, SIGNAL(toggled(bool)), SLOT(emitSettingChanged()));
     connect(m_options->antialiasCBox, SIGNAL(toggled(bool)), SLOT(emitSettingChanged()));
     connect(m_options->compositingCBox, SIGNAL(toggled(bool)), SLOT(emitSettingChanged()));
+    connect(m_options->parallelCBox, SIGNAL(toggled(bool)), SLOT(emitSettingChanged()));
     setConfigurationPage(m_options);
 }
 
@@ -82,6 +83,7 @@ void KisHairyBristleOption::readOptionSetting(const KisPropertiesConfigurationSP
     m_options->connectedCBox->setChecked(config->getBool(HAIRY_BRISTLE_CONNECTED));
     m_options->antialiasCBox->setChecked(config->getBool(HAIRY_BRISTLE_ANTI_ALIASING));
     m_options->compositingCBox->setChecked(config->getBool(HAIRY_BRISTLE_USE_COMPOSITING));
+    m_options->parallelCBox->setChecked(config->getBool(HAIRY_BRISTLE_PARALLEL));
 }
 
 
@@ -96,6 +98,7 @@ void KisHairyBristleOption::writeOptionSetting(KisPropertiesConfigurationSP conf
     config->setProperty(HAIRY_BRISTLE_CONNECTED, m_options->connectedCBox->isChecked());
     config->setProperty(HAIRY_BRISTLE_ANTI_ALIASING, m_options->antialiasCBox->isChecked());
     config->setProperty(HAIRY_BRISTLE_USE_COMPOSITING, m_options->compositingCBox->isChecked());
+    config->setProperty(HAIRY_BRISTLE_PARALLEL, m_options->parallelCBox->isChecked());
 }
 
 void KisHairyBristleOption::lodLimitations(KisPaintopLodLimitations *l) const
@@ -31,6 +31,7 @@ const QString HAIRY_BRISTLE_THRESHOLD = "HairyBristle/threshold";
 const QString HAIRY_BRISTLE_ANTI_ALIASING = "HairyBristle/antialias";
 const QString HAIRY_BRISTLE_USE_COMPOSITING = "HairyBristle/useCompositing";
 const QString HAIRY_BRISTLE_CONNECTED = "HairyBristle/isConnected";
+const QString HAIRY_BRISTLE_PARALLEL = "HairyBristle/parallel";
 
 class KisBristleOptionsWidget;
 
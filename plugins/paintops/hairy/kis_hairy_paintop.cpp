@@ -110,6 +110,7 @@ void KisHairyPaintOp::loadSettings(const KisBrushBasedPaintOpSettings *settings)
     m_properties.antialias = settings->getBool(HAIRY_BRISTLE_ANTI_ALIASING);
     m_properties.useCompositing = settings->getBool(HAIRY_BRISTLE_USE_COMPOSITING);
     m_properties.connectedPath = settings->getBool(HAIRY_BRISTLE_CONNECTED);
+    m_properties.paintInParallel = settings->getBool(HAIRY_BRISTLE_PARALLEL);
 }
 
 
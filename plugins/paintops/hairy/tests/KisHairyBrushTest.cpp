@@ -0,0 +1,203 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisHairyBrushTest.h"
+
+#include <cmath>
+
+#include <QTest>
+#include <QThread>
+
+#include <KoColor.h>
+#include <KoColorSpaceRegistry.h>
+
+#include <kis_paint_device.h>
+#include <kis_fixed_paint_device.h>
+#include <brushengine/kis_paint_information.h>
+#include <brushengine/kis_random_source.h>
+
+#include "../hairy_brush.h"
+
+namespace {
+
+const int bristleDabRadius = 24;
+
+KisFixedPaintDeviceSP createBristleDab(const KoColorSpace *cs)
+{
+    const int size = 2 * bristleDabRadius;
+
+    KisFixedPaintDeviceSP dab = new KisFixedPaintDevice(cs);
+    dab->setRect(QRect(0, 0, size, size));
+    dab->initialize();
+
+    // the opacity of the dab defines the length of the bristles
+    KoColor color(Qt::red, cs);
+    quint8 *pixel = dab->data();
+
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            const qreal distance = std::hypot(x - bristleDabRadius + 0.5, y - bristleDabRadius + 0.5);
+            const qreal opacity = qMax(0.0, 1.0 - distance / bristleDabRadius);
+
+            color.setOpacity(quint8(qRound(opacity * 255)));
+            memcpy(pixel, color.data(), cs->pixelSize());
+            pixel += cs->pixelSize();
+        }
+    }
+
+    return dab;
+}
+
+KisHairyProperties createProperties(bool antialias, bool paintInParallel)
+{
+    KisHairyProperties properties;
+
+    properties.radius = bristleDabRadius;
+    properties.inkAmount = 256;
+    properties.sigma = 1.0;
+
+    properties.inkDepletionCurve.resize(properties.inkAmount);
+    for (int i = 0; i < properties.inkAmount; i++) {
+        properties.inkDepletionCurve[i] = qreal(i) / (properties.inkAmount - 1);
+    }
+
+    properties.inkDepletionEnabled = true;
+    properties.isbrushDimension1D = false;
+    properties.useMousePressure = false;
+    properties.useSaturation = true;
+    properties.useOpacity = true;
+    properties.useWeights = false;
+
+    properties.useSoakInk = false;
+    properties.connectedPath = true;
+    properties.antialias = antialias;
+    properties.useCompositing = false;
+    properties.paintInParallel = paintInParallel;
+
+    properties.pressureWeight = 0;
+    properties.bristleLengthWeight = 0;
+    properties.bristleInkAmountWeight = 0;
+    properties.inkDepletionWeight = 0;
+
+    properties.shearFactor = 0.5;
+    properties.randomFactor = 2.0;
+    properties.scaleFactor = 1.0;
+    properties.threshold = false;
+
+    return properties;
+}
+
+bool operator==(const KisHairyBrushTest::BristleState &lhs, const KisHairyBrushTest::BristleState &rhs)
+{
+    return lhs.inkAmount == rhs.inkAmount &&
+        lhs.counter == rhs.counter &&
+        lhs.prevX == rhs.prevX &&
+        lhs.prevY == rhs.prevY;
+}
+
+}
+
+KisPaintDeviceSP KisHairyBrushTest::paintStroke(KisHairyProperties *properties, QVector<BristleState> *state)
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+
+    HairyBrush brush;
+    brush.fromDabWithDensity(createBristleDab(cs), 1.0);
+    brush.setInkColor(KoColor(Qt::red, cs));
+    brush.setProperties(properties);
+
+    // all the lines are painted into the same dab, so the merging
+    // of the chunks is checked against the already painted pixels
+    KisPaintDeviceSP dab = new KisPaintDevice(cs);
+    KisRandomSourceSP randomSource = new KisRandomSource(42);
+
+    KisPaintInformation pi1(QPointF(100, 100), 0.3);
+    pi1.setRandomSource(randomSource);
+
+    for (int i = 1; i <= 10; i++) {
+        KisPaintInformation pi2(QPointF(100 + 20 * i, 100 + 10 * std::sin(qreal(i))), 0.3 + 0.07 * i);
+        pi2.setRandomSource(randomSource);
+
+        brush.paintLine(dab, 0, pi1, pi2, 1.0, 0.1 * i);
+        pi1 = pi2;
+    }
+
+    state->clear();
+    Q_FOREACH (Bristle *bristle, brush.m_bristles) {
+        BristleState bristleState;
+        bristleState.inkAmount = bristle->inkAmount();
+        bristleState.counter = bristle->counter();
+        bristleState.prevX = bristle->prevX();
+        bristleState.prevY = bristle->prevY();
+        state->append(bristleState);
+    }
+
+    return dab;
+}
+
+void KisHairyBrushTest::testParallelMatchesSerial_data()
+{
+    QTest::addColumn<bool>("antialias");
+
+    QTest::newRow("antialias") << true;
+    QTest::newRow("darken") << false;
+}
+
+void KisHairyBrushTest::testParallelMatchesSerial()
+{
+    QFETCH(bool, antialias);
+
+    if (QThread::idealThreadCount() < 2) {
+        QSKIP("the bristles are painted in parallel only with more than one thread");
+    }
+
+    KisHairyProperties serialProperties = createProperties(antialias, false);
+    KisHairyProperties parallelProperties = createProperties(antialias, true);
+
+    QVector<BristleState> serialState;
+    QVector<BristleState> parallelState;
+
+    KisPaintDeviceSP serialDab = paintStroke(&serialProperties, &serialState);
+    KisPaintDeviceSP parallelDab = paintStroke(&parallelProperties, &parallelState);
+
+    // make sure the stroke is big enough to be split between the threads
+    QVERIFY(serialState.size() > 128);
+
+    QCOMPARE(parallelState.size(), serialState.size());
+    for (int i = 0; i < serialState.size(); i++) {
+        QVERIFY2(parallelState[i] == serialState[i], qPrintable(QString("bristle %1").arg(i)));
+    }
+
+    const QRect rc = serialDab->exactBounds();
+    QCOMPARE(parallelDab->exactBounds(), rc);
+
+    const int pixelSize = serialDab->pixelSize();
+    QVector<quint8> serialBytes(rc.width() * rc.height() * pixelSize);
+    QVector<quint8> parallelBytes(rc.width() * rc.height() * pixelSize);
+
+    serialDab->readBytes(serialBytes.data(), rc);
+    parallelDab->readBytes(parallelBytes.data(), rc);
+
+    for (int i = 0; i < serialBytes.size(); i += pixelSize) {
+        const int pixel = i / pixelSize;
+        const QPoint pt(rc.x() + pixel % rc.width(), rc.y() + pixel / rc.width());
+
+        QVERIFY2(!memcmp(serialBytes.constData() + i, parallelBytes.constData() + i, pixelSize),
+                 qPrintable(QString("pixel (%1, %2) differs").arg(pt.x()).arg(pt.y())));
+    }
+}
+
+QTEST_MAIN(KisHairyBrushTest)
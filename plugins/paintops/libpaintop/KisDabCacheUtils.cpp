@@ -55,9 +55,8 @@ QRect correctDabRectWhenFetchedFromCache(const QRect &dabRect,
 }
 
 
-void generateDab(const DabGenerationInfo &di, DabRenderingResources *resources, KisFixedPaintDeviceSP *dab)
+static void generateDabImpl(const DabGenerationInfo &di, DabRenderingResources *resources, KisFixedPaintDeviceSP *dab)
 {
-    KIS_SAFE_ASSERT_RECOVER_RETURN(*dab);
     const KoColorSpace *cs = (*dab)->colorSpace();
 
 
@@ -102,6 +101,48 @@ void generateDab(const DabGenerationInfo &di, DabRenderingResources *resources,
     }
 }
 
+void generateDab(const DabGenerationInfo &di, DabRenderingResources *resources, KisFixedPaintDeviceSP *dab)
+{
+    KIS_SAFE_ASSERT_RECOVER_RETURN(*dab);
+
+    if (!di.cacheKey.isValid()) {
+        generateDabImpl(di, resources, dab);
+        return;
+    }
+
+    KisPersistentDabCache *cache = KisPersistentDabCache::instance();
+
+    KisPersistentDabCache::Key key = di.cacheKey;
+    key.colorSpace = (*dab)->colorSpace();
+
+    KisFixedPaintDeviceSP cachedDab = cache->fetchDab(key);
+
+    if (cachedDab) {
+        if (di.cacheUsage) {
+            di.cacheUsage->registerHit();
+        }
+
+        /**
+         * The cached dab is shared with other users of the cache, so
+         * we copy it into our own device. The size of the dab may differ
+         * from di.dstDabRect a bit, the callers recenter the dab the same
+         * way as they do for the dabs reused within a stroke.
+         */
+        **dab = *cachedDab;
+        return;
+    }
+
+    generateDabImpl(di, resources, dab);
+
+    /**
+     * Adding a dab costs a deep copy of it, so the users that
+     * almost never hit the cache add only a few of their dabs
+     */
+    if (!di.cacheUsage || di.cacheUsage->registerMiss()) {
+        cache->addDab(key, *dab);
+    }
+}
+
 void postProcessDab(KisFixedPaintDeviceSP dab,
                     const QPoint &dabTopLeft,
                     const KisPaintInformation& info,
@@ -26,6 +26,7 @@
 
 #include <kis_pressure_mirror_option.h>
 #include "kis_dab_shape.h"
+#include "KisPersistentDabCache.h"
 
 #include "kritapaintop_export.h"
 #include <functional>
@@ -103,6 +104,13 @@ struct PAINTOP_EXPORT DabGenerationInfo
     qreal lightnessStrength = 1.0;
 
     bool needsPostprocessing = false;
+
+    /// the key of the dab in KisPersistentDabCache, the
+    /// dabs with an invalid key are always generated
+    KisPersistentDabCache::Key cacheKey;
+
+    /// the statistics of the owner of the dab, owned by KisDabCacheBase
+    KisPersistentDabCache::Usage *cacheUsage = 0;
 };
 
 PAINTOP_EXPORT QRect correctDabRectWhenFetchedFromCache(const QRect &dabRect,
@@ -0,0 +1,212 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisPersistentDabCache.h"
+
+#include <QGlobalStatic>
+#include <QMutexLocker>
+
+#include <kis_assert.h>
+#include <kis_fixed_paint_device.h>
+
+namespace {
+// the default limit is enough for a few hundreds of middle-sized dabs
+const qint64 defaultMemoryLimit = 64 * 1024 * 1024;
+
+/**
+ * The user of the cache that hits it less often than minUsefulHitRate
+ * after warmUpLookups lookups adds only every sampleRate-th missed dab,
+ * so that the cache could still notice the change of the hit rate
+ */
+const int warmUpLookups = 64;
+const qreal minUsefulHitRate = 0.1;
+const int sampleRate = 16;
+
+// QCache counts the cost in ints, so we count it in kibibytes
+inline int costForBytes(qint64 bytes) {
+    return int(qMax(qint64(1), (bytes + 1023) / 1024));
+}
+}
+
+bool KisPersistentDabCache::Key::operator==(const Key &rhs) const
+{
+    return brushSignature == rhs.brushSignature &&
+        colorSpace == rhs.colorSpace &&
+        color == rhs.color &&
+        brushIndex == rhs.brushIndex &&
+        precisionLevel == rhs.precisionLevel &&
+        width == rhs.width &&
+        height == rhs.height &&
+        angle == rhs.angle &&
+        subPixelX == rhs.subPixelX &&
+        subPixelY == rhs.subPixelY &&
+        softnessFactor == rhs.softnessFactor &&
+        lightnessStrength == rhs.lightnessStrength &&
+        ratio == rhs.ratio &&
+        horizontalMirror == rhs.horizontalMirror &&
+        verticalMirror == rhs.verticalMirror;
+}
+
+uint qHash(const KisPersistentDabCache::Key &key, uint seed)
+{
+    uint hash = qHash(key.brushSignature, seed);
+    hash ^= qHash(quintptr(key.colorSpace), seed);
+    hash ^= qHash(key.color, seed) * 3;
+    hash ^= qHash(key.brushIndex, seed) * 5;
+    hash ^= qHash(key.width, seed) * 7;
+    hash ^= qHash(key.height, seed) * 11;
+    hash ^= qHash(key.angle, seed) * 13;
+    hash ^= qHash(key.subPixelX, seed) * 17;
+    hash ^= qHash(key.subPixelY, seed) * 19;
+    hash ^= qHash(key.softnessFactor, seed) * 23;
+    hash ^= qHash(key.lightnessStrength, seed) * 29;
+    hash ^= qHash(key.ratio, seed) * 31;
+    hash ^= qHash(key.precisionLevel * 4 +
+                  int(key.horizontalMirror) * 2 +
+                  int(key.verticalMirror), seed) * 37;
+    return hash;
+}
+
+void KisPersistentDabCache::Usage::registerHit()
+{
+    m_hits.ref();
+}
+
+bool KisPersistentDabCache::Usage::registerMiss()
+{
+    const int misses = m_misses.fetchAndAddOrdered(1) + 1;
+    const int hits = m_hits.loadAcquire();
+
+    if (hits + misses < warmUpLookups ||
+        hits >= minUsefulHitRate * (hits + misses) ||
+        misses % sampleRate == 0) {
+
+        return true;
+    }
+
+    m_bypasses.ref();
+    return false;
+}
+
+qint64 KisPersistentDabCache::Usage::hits() const
+{
+    return m_hits.loadAcquire();
+}
+
+qint64 KisPersistentDabCache::Usage::misses() const
+{
+    return m_misses.loadAcquire();
+}
+
+qint64 KisPersistentDabCache::Usage::bypasses() const
+{
+    return m_bypasses.loadAcquire();
+}
+
+struct KisPersistentDabCache::CachedDab
+{
+    CachedDab(KisFixedPaintDeviceSP _dab) : dab(_dab) {}
+    KisFixedPaintDeviceSP dab;
+};
+
+KisPersistentDabCache::KisPersistentDabCache()
+    : m_cache(costForBytes(defaultMemoryLimit))
+{
+}
+
+KisPersistentDabCache::~KisPersistentDabCache()
+{
+}
+
+Q_GLOBAL_STATIC(KisPersistentDabCache, s_instance)
+
+KisPersistentDabCache *KisPersistentDabCache::instance()
+{
+    return s_instance;
+}
+
+KisFixedPaintDeviceSP KisPersistentDabCache::fetchDab(const Key &key)
+{
+    QMutexLocker l(&m_mutex);
+
+    CachedDab *cachedDab = m_cache.object(key);
+
+    if (cachedDab) {
+        m_statistics.hits++;
+        return cachedDab->dab;
+    }
+
+    m_statistics.misses++;
+    return KisFixedPaintDeviceSP();
+}
+
+void KisPersistentDabCache::addDab(const Key &key, KisFixedPaintDeviceSP dab)
+{
+    KIS_SAFE_ASSERT_RECOVER_RETURN(key.isValid());
+    KIS_SAFE_ASSERT_RECOVER_RETURN(dab);
+
+    // the copy is done outside the lock, the dab belongs to the caller
+    KisFixedPaintDeviceSP copy = new KisFixedPaintDevice(*dab);
+    const QRect bounds = copy->bounds();
+    const int cost = costForBytes(qint64(bounds.width()) * bounds.height() * copy->pixelSize());
+
+    QMutexLocker l(&m_mutex);
+
+    const int oldCount = m_cache.count() - int(m_cache.contains(key));
+
+    // QCache deletes the object itself if it cannot be inserted
+    if (m_cache.insert(key, new CachedDab(copy), cost)) {
+        m_statistics.evictions += oldCount + 1 - m_cache.count();
+    }
+}
+
+void KisPersistentDabCache::setMemoryLimit(qint64 bytes)
+{
+    QMutexLocker l(&m_mutex);
+
+    const int oldCount = m_cache.count();
+    m_cache.setMaxCost(costForBytes(bytes));
+    m_statistics.evictions += oldCount - m_cache.count();
+}
+
+qint64 KisPersistentDabCache::memoryLimit() const
+{
+    QMutexLocker l(&m_mutex);
+    return qint64(m_cache.maxCost()) * 1024;
+}
+
+KisPersistentDabCache::Statistics KisPersistentDabCache::statistics() const
+{
+    QMutexLocker l(&m_mutex);
+
+    Statistics statistics = m_statistics;
+    statistics.numDabs = m_cache.count();
+    statistics.memoryUsage = qint64(m_cache.totalCost()) * 1024;
+
+    return statistics;
+}
+
+void KisPersistentDabCache::resetStatistics()
+{
+    QMutexLocker l(&m_mutex);
+    m_statistics = Statistics();
+}
+
+void KisPersistentDabCache::clear()
+{
+    QMutexLocker l(&m_mutex);
+    m_cache.clear();
+}
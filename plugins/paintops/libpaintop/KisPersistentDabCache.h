@@ -0,0 +1,160 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KISPERSISTENTDABCACHE_H
+#define KISPERSISTENTDABCACHE_H
+
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QCache>
+#include <QMutex>
+
+#include <kis_types.h>
+
+#include "kritapaintop_export.h"
+
+class KoColorSpace;
+
+/**
+ * @brief The KisPersistentDabCache class keeps the generated dabs
+ * between the strokes
+ *
+ * KisDabCacheBase can reuse only the previous dab of the current stroke,
+ * so any jitter in size or rotation makes it regenerate every dab. This
+ * cache keeps the recently generated dabs (before the postprocessing by
+ * the texture and sharpness options) in a process-wide LRU list limited
+ * by memory. The dabs are looked up by a Key, where all the floating
+ * point parameters are quantized according to the precision level of
+ * the paintop, so a cached dab is never further from the requested one
+ * than KisDabCacheBase allows for its own reuse.
+ *
+ * The cache is thread-safe. The returned devices are shared between the
+ * users of the cache and must not be modified.
+ */
+class PAINTOP_EXPORT KisPersistentDabCache
+{
+public:
+    struct PAINTOP_EXPORT Key
+    {
+        /// the invalid keys are never cached
+        bool isValid() const {
+            return !brushSignature.isEmpty();
+        }
+
+        bool operator==(const Key &rhs) const;
+
+        QByteArray brushSignature;
+        const KoColorSpace *colorSpace = 0;
+        QByteArray color;
+        quint32 brushIndex = 0;
+        int precisionLevel = 0;
+
+        int width = 0;
+        int height = 0;
+        qint64 angle = 0;
+        qint64 subPixelX = 0;
+        qint64 subPixelY = 0;
+        qint64 softnessFactor = 0;
+        qint64 lightnessStrength = 0;
+        qint64 ratio = 0;
+
+        bool horizontalMirror = false;
+        bool verticalMirror = false;
+    };
+
+    struct Statistics
+    {
+        qint64 hits = 0;
+        qint64 misses = 0;
+        qint64 evictions = 0;
+        int numDabs = 0;
+        qint64 memoryUsage = 0;
+
+        qreal hitRate() const {
+            const qint64 total = hits + misses;
+            return total ? qreal(hits) / total : 0.0;
+        }
+    };
+
+    /**
+     * The statistics of a single user of the cache, e.g. a paintop.
+     * Every miss makes the user copy the generated dab into the cache,
+     * so when the user almost never hits the cache, the usage asks it
+     * to add only a small sample of its dabs (see registerMiss()).
+     *
+     * The dabs of one user may be generated in several threads, so
+     * the counters are atomic.
+     */
+    class PAINTOP_EXPORT Usage
+    {
+    public:
+        void registerHit();
+
+        /**
+         * Counts a miss and returns true if the generated dab should
+         * be added to the cache
+         */
+        bool registerMiss();
+
+        qint64 hits() const;
+        qint64 misses() const;
+
+        /// the number of the missed dabs that were not added to the cache
+        qint64 bypasses() const;
+
+    private:
+        QAtomicInt m_hits;
+        QAtomicInt m_misses;
+        QAtomicInt m_bypasses;
+    };
+
+public:
+    KisPersistentDabCache();
+    ~KisPersistentDabCache();
+
+    static KisPersistentDabCache *instance();
+
+    /**
+     * @return the dab cached for \p key or a null pointer. The dab
+     * should be copied before any modification.
+     */
+    KisFixedPaintDeviceSP fetchDab(const Key &key);
+
+    /**
+     * Saves a copy of \p dab in the cache, the least recently used
+     * dabs are dropped if the cache becomes too big
+     */
+    void addDab(const Key &key, KisFixedPaintDeviceSP dab);
+
+    void setMemoryLimit(qint64 bytes);
+    qint64 memoryLimit() const;
+
+    Statistics statistics() const;
+    void resetStatistics();
+
+    void clear();
+
+private:
+    struct CachedDab;
+
+    mutable QMutex m_mutex;
+    QCache<Key, CachedDab> m_cache;
+    Statistics m_statistics;
+};
+
+PAINTOP_EXPORT uint qHash(const KisPersistentDabCache::Key &key, uint seed = 0);
+
+#endif // KISPERSISTENTDABCACHE_H
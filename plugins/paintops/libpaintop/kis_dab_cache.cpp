@@ -213,6 +213,9 @@ KisFixedPaintDeviceSP KisDabCache::fetchDabCommon(const KoColorSpace *cs,
 
     generateDab(di, &resources, &m_d->dab);
 
+    // the dab could be fetched from the persistent cache
+    *dstDabRect = correctDabRectWhenFetchedFromCache(*dstDabRect, m_d->dab->bounds().size());
+
     // 4. Do postprocessing
     if (di.needsPostprocessing) {
         if (!m_d->dabOriginal || *cs != *m_d->dabOriginal->colorSpace()) {
@@ -221,7 +224,7 @@ KisFixedPaintDeviceSP KisDabCache::fetchDabCommon(const KoColorSpace *cs,
 
         *m_d->dabOriginal = *m_d->dab;
 
-        postProcessDab(m_d->dab, di.dstDabRect.topLeft(), info, &resources);
+        postProcessDab(m_d->dab, dstDabRect->topLeft(), info, &resources);
     }
 
     return m_d->dab;
@@ -27,10 +27,17 @@
 #include <kis_texture_option.h>
 #include <kis_precision_option.h>
 #include <kis_fixed_paint_device.h>
+#include <kis_auto_brush.h>
+#include <kis_debug.h>
 #include <brushengine/kis_paintop.h>
+#include "KisPersistentDabCache.h"
+
+#include <QDomDocument>
 
 #include <kundo2command.h>
 
+#include <cmath>
+
 struct PrecisionValues {
     qreal angle;
     qreal sizeFrac;
@@ -94,7 +101,17 @@ struct KisDabCacheBase::Private {
 
     SavedDabParameters lastSavedDabParameters;
 
+    // null until the first dab is generated, empty if the brush cannot be cached
+    QByteArray brushSignature;
+    KisPersistentDabCache::Usage cacheUsage;
+
     static qreal positiveFraction(qreal x);
+    static QByteArray calculateBrushSignature(KisBrushSP brush);
+
+    KisPersistentDabCache::Key persistentCacheKey(KisBrushSP brush,
+                                                  const SavedDabParameters &params,
+                                                  bool solidColorFill,
+                                                  int precisionLevel);
 };
 
 
@@ -106,6 +123,17 @@ KisDabCacheBase::KisDabCacheBase()
 
 KisDabCacheBase::~KisDabCacheBase()
 {
+    if (!m_d->brushSignature.isEmpty()) {
+        const KisPersistentDabCache::Usage &usage = m_d->cacheUsage;
+        const qint64 lookups = usage.hits() + usage.misses();
+
+        dbgKrita << "Persistent dab cache:"
+                 << "hits" << usage.hits()
+                 << "misses" << usage.misses()
+                 << "hit rate" << (lookups ? qreal(usage.hits()) / lookups : 0.0)
+                 << "bypassed" << usage.bypasses();
+    }
+
     delete m_d;
 }
 
@@ -180,6 +208,86 @@ qreal KisDabCacheBase::Private::positiveFraction(qreal x) {
     return fraction;
 }
 
+QByteArray KisDabCacheBase::Private::calculateBrushSignature(KisBrushSP brush)
+{
+    /**
+     * The gradient of the gradient-mapped brushes is not saved into
+     * XML, and the auto brushes with randomness should look different
+     * for every dab, so such dabs are never cached between strokes
+     */
+    KisAutoBrush *autoBrush = dynamic_cast<KisAutoBrush*>(brush.data());
+
+    if (brush->applyingGradient() ||
+        (autoBrush && (autoBrush->randomness() > 0.0 || autoBrush->density() < 1.0))) {
+
+        return QByteArray("");
+    }
+
+    QDomDocument doc;
+    QDomElement element = doc.createElement("Brush");
+    brush->toXML(doc, element);
+    doc.appendChild(element);
+
+    return doc.toByteArray() + brush->md5();
+}
+
+namespace {
+inline qint64 quantize(qreal value, qreal step) {
+    return qint64(std::floor(value / step));
+}
+
+inline int quantizeSize(int size, qreal sizeFrac) {
+    // the sizes that differ by less than sizeFrac share the bucket
+    return sizeFrac > 0 ? qRound(std::log(qreal(qMax(1, size))) / std::log1p(sizeFrac)) : size;
+}
+}
+
+KisPersistentDabCache::Key
+KisDabCacheBase::Private::persistentCacheKey(KisBrushSP brush,
+                                             const SavedDabParameters &params,
+                                             bool solidColorFill,
+                                             int precisionLevel)
+{
+    KisPersistentDabCache::Key key;
+
+    // the dabs painted with a non-uniform color source are unique
+    if (!solidColorFill) return key;
+
+    if (brushSignature.isNull()) {
+        brushSignature = calculateBrushSignature(brush);
+    }
+
+    key.brushSignature = brushSignature;
+    if (!key.isValid()) return key;
+
+    /**
+     * All the values are quantized with the same precision that
+     * SavedDabParameters::compare() uses for reusing the dab
+     */
+    const PrecisionValues &prec = precisionLevels[precisionLevel];
+
+    if (brush->brushApplication() != IMAGESTAMP) {
+        const KoColorSpace *colorCs = params.color.colorSpace();
+        key.color = QByteArray(reinterpret_cast<const char*>(params.color.data()), colorCs->pixelSize());
+        key.color += QByteArray::number(quintptr(colorCs));
+    }
+
+    key.brushIndex = params.index;
+    key.precisionLevel = precisionLevel;
+    key.width = quantizeSize(params.width, prec.sizeFrac);
+    key.height = quantizeSize(params.height, prec.sizeFrac);
+    key.angle = quantize(normalizeAngle(params.angle), prec.angle);
+    key.subPixelX = quantize(params.subPixelX, prec.subPixel);
+    key.subPixelY = quantize(params.subPixelY, prec.subPixel);
+    key.softnessFactor = quantize(params.softnessFactor, prec.softnessFactor);
+    key.lightnessStrength = quantize(params.lightnessStrength, prec.lightnessStrength);
+    key.ratio = quantize(params.ratio, prec.ratio);
+    key.horizontalMirror = params.mirrorProperties.horizontalMirror;
+    key.verticalMirror = params.mirrorProperties.verticalMirror;
+
+    return key;
+}
+
 inline
 KisDabCacheBase::DabPosition
 KisDabCacheBase::calculateDabRect(KisBrushSP brush,
@@ -288,6 +396,9 @@ void KisDabCacheBase::fetchDabGenerationInfo(bool hasDabInCache,
 
     if (!*shouldUseCache) {
         m_d->lastSavedDabParameters = newParams;
+        di->cacheKey = m_d->persistentCacheKey(resources->brush, newParams,
+                                               di->solidColorFill, precisionLevel);
+        di->cacheUsage = &m_d->cacheUsage;
     }
 
     di->needsPostprocessing = needSeparateOriginal(resources->textureOption.data(), resources->sharpnessOption.data());
@@ -0,0 +1,149 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisPersistentDabCacheTest.h"
+
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+
+#include <kis_fixed_paint_device.h>
+
+#include "KisPersistentDabCache.h"
+
+namespace {
+KisPersistentDabCache::Key createKey(int angle)
+{
+    KisPersistentDabCache::Key key;
+    key.brushSignature = "test-brush";
+    key.colorSpace = KoColorSpaceRegistry::instance()->alpha8();
+    key.width = 32;
+    key.height = 32;
+    key.angle = angle;
+    return key;
+}
+
+KisFixedPaintDeviceSP createDab(quint8 value)
+{
+    // 32x32 alpha8 dab takes exactly one kibibyte
+    KisFixedPaintDeviceSP dab = new KisFixedPaintDevice(KoColorSpaceRegistry::instance()->alpha8());
+    dab->setRect(QRect(0, 0, 32, 32));
+    dab->initialize(value);
+    return dab;
+}
+}
+
+void KisPersistentDabCacheTest::testFetch()
+{
+    KisPersistentDabCache cache;
+
+    QVERIFY(createKey(0).isValid());
+    QVERIFY(!KisPersistentDabCache::Key().isValid());
+
+    QVERIFY(!cache.fetchDab(createKey(0)));
+
+    cache.addDab(createKey(0), createDab(10));
+
+    KisFixedPaintDeviceSP dab = cache.fetchDab(createKey(0));
+    QVERIFY(dab);
+    QCOMPARE(dab->bounds(), QRect(0, 0, 32, 32));
+    QCOMPARE(dab->data()[0], quint8(10));
+
+    QVERIFY(!cache.fetchDab(createKey(1)));
+
+    KisPersistentDabCache::Statistics stats = cache.statistics();
+    QCOMPARE(stats.hits, qint64(1));
+    QCOMPARE(stats.misses, qint64(2));
+    QCOMPARE(stats.numDabs, 1);
+    QCOMPARE(stats.memoryUsage, qint64(1024));
+    QCOMPARE(stats.hitRate(), 1.0 / 3.0);
+
+    cache.resetStatistics();
+    QCOMPARE(cache.statistics().hits, qint64(0));
+    QCOMPARE(cache.statistics().numDabs, 1);
+
+    cache.clear();
+    QVERIFY(!cache.fetchDab(createKey(0)));
+}
+
+void KisPersistentDabCacheTest::testLeastRecentlyUsedEviction()
+{
+    KisPersistentDabCache cache;
+    cache.setMemoryLimit(3 * 1024);
+
+    cache.addDab(createKey(0), createDab(0));
+    cache.addDab(createKey(1), createDab(1));
+    cache.addDab(createKey(2), createDab(2));
+
+    // touch the first dab, so the second one becomes the oldest
+    QVERIFY(cache.fetchDab(createKey(0)));
+
+    cache.addDab(createKey(3), createDab(3));
+
+    QVERIFY(cache.fetchDab(createKey(0)));
+    QVERIFY(!cache.fetchDab(createKey(1)));
+    QVERIFY(cache.fetchDab(createKey(2)));
+    QVERIFY(cache.fetchDab(createKey(3)));
+
+    QCOMPARE(cache.statistics().evictions, qint64(1));
+    QCOMPARE(cache.statistics().numDabs, 3);
+}
+
+void KisPersistentDabCacheTest::testCachedDabIsDetached()
+{
+    KisPersistentDabCache cache;
+
+    KisFixedPaintDeviceSP dab = createDab(10);
+    cache.addDab(createKey(0), dab);
+
+    // neither the source, nor the copies can change the cached dab
+    dab->data()[0] = 20;
+
+    KisFixedPaintDeviceSP copy = createDab(0);
+    *copy = *cache.fetchDab(createKey(0));
+    copy->data()[0] = 30;
+
+    QCOMPARE(cache.fetchDab(createKey(0))->data()[0], quint8(10));
+}
+
+void KisPersistentDabCacheTest::testUsageBypass()
+{
+    KisPersistentDabCache::Usage usage;
+
+    // all the dabs are added while the hit rate is not known yet
+    for (int i = 0; i < 63; i++) {
+        QVERIFY(usage.registerMiss());
+    }
+    QCOMPARE(usage.bypasses(), qint64(0));
+
+    // then only every 16th missed dab is added
+    int numAdded = 0;
+    for (int i = 0; i < 64; i++) {
+        numAdded += usage.registerMiss();
+    }
+    QCOMPARE(numAdded, 4);
+    QCOMPARE(usage.bypasses(), qint64(60));
+
+    // the hits make the user add all the dabs again
+    for (int i = 0; i < 20; i++) {
+        usage.registerHit();
+    }
+    QVERIFY(usage.registerMiss());
+
+    QCOMPARE(usage.hits(), qint64(20));
+    QCOMPARE(usage.misses(), qint64(128));
+}
+
+QTEST_MAIN(KisPersistentDabCacheTest)
@@ -0,0 +1,265 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KISOPTIMIZEDSPRAYCOVERAGERENDERER_H
+#define KISOPTIMIZEDSPRAYCOVERAGERENDERER_H
+
+#include <cmath>
+#include <kis_global.h>
+#include <type_traits>
+
+#include "KisSprayCoverageRenderer.h"
+#include "KisSprayCoverageRendererFactoryImpl.h"
+
+/**
+ * The parameters of a single row of the coverage mask. The pixel
+ * (x0 + col, dy) relative to the center of the shape is mapped into
+ * the coordinate system of the shape as:
+ *
+ * u = (x0 + col) * cosA + uRow
+ * v = -(x0 + col) * sinA + vRow
+ */
+struct KisSprayCoverageRow
+{
+    float x0;
+    float uRow;
+    float vRow;
+    float cosA;
+    float sinA;
+
+    // the ellipse parameters
+    float invA2;
+    float invB2;
+    float areaFactor;
+
+    // the rectangle parameters
+    float halfWidth;
+    float halfHeight;
+};
+
+/**
+ * Renders the rows of the coverage mask. The generic version processes
+ * one pixel at a time, the vectorized one processes Vc::float_v::size()
+ * pixels at once and uses the generic version for the tail of the row.
+ */
+template<Vc::Implementation _impl,
+         typename EnableDummyType = void>
+struct KisSprayCoverageRowRenderer
+{
+    static inline quint8 coverageToU8(float coverage) {
+        return quint8(coverage * 255.0f + 0.5f);
+    }
+
+    static void ellipseRow(const KisSprayCoverageRow &p, int startCol, int endCol, quint8 *mask)
+    {
+        for (int col = startCol; col < endCol; col++) {
+            const float dx = p.x0 + col;
+
+            // the pixel in the coordinate system of the ellipse
+            const float u = dx * p.cosA + p.uRow;
+            const float v = -dx * p.sinA + p.vRow;
+
+            /**
+             * The distance to the edge is approximated by the value of
+             * the implicit function divided by the length of its gradient
+             */
+            const float f = u * u * p.invA2 + v * v * p.invB2 - 1.0f;
+            const float gu = u * p.invA2;
+            const float gv = v * p.invB2;
+            const float gradLength = 2.0f * std::sqrt(gu * gu + gv * gv) + 1e-6f;
+            const float distance = f / gradLength;
+
+            const float coverage = qBound(0.0f, 0.5f - distance, 1.0f) * p.areaFactor;
+            mask[col] = coverageToU8(coverage);
+        }
+    }
+
+    static void rectangleRow(const KisSprayCoverageRow &p, int startCol, int endCol, quint8 *mask)
+    {
+        for (int col = startCol; col < endCol; col++) {
+            const float dx = p.x0 + col;
+
+            const float u = dx * p.cosA + p.uRow;
+            const float v = -dx * p.sinA + p.vRow;
+
+            // the overlap of the pixel with the rectangle along each of its axes
+            const float coverageU =
+                qBound(0.0f, qMin(u + 0.5f, p.halfWidth) - qMax(u - 0.5f, -p.halfWidth), 1.0f);
+            const float coverageV =
+                qBound(0.0f, qMin(v + 0.5f, p.halfHeight) - qMax(v - 0.5f, -p.halfHeight), 1.0f);
+
+            mask[col] = coverageToU8(coverageU * coverageV);
+        }
+    }
+};
+
+#ifdef HAVE_VC
+
+template<Vc::Implementation _impl>
+struct KisSprayCoverageRowRenderer<
+        _impl,
+        typename std::enable_if<_impl != Vc::ScalarImpl>::type>
+{
+    typedef KisSprayCoverageRowRenderer<Vc::ScalarImpl> ScalarRenderer;
+
+    static inline void storeCoverage(const Vc::float_v &coverage, quint8 *mask) {
+        alignas(64) float values[Vc::float_v::size()];
+        coverage.store(values, Vc::Aligned);
+
+        for (size_t i = 0; i < Vc::float_v::size(); i++) {
+            mask[i] = ScalarRenderer::coverageToU8(values[i]);
+        }
+    }
+
+    static void ellipseRow(const KisSprayCoverageRow &p, int startCol, int endCol, quint8 *mask)
+    {
+        const int vectorSize = Vc::float_v::size();
+
+        const Vc::float_v zeroValue(Vc::Zero);
+        const Vc::float_v oneValue(Vc::One);
+        const Vc::float_v halfValue(0.5f);
+        const Vc::float_v twoValue(2.0f);
+        const Vc::float_v epsilon(1e-6f);
+
+        const Vc::float_v cosA(p.cosA);
+        const Vc::float_v sinA(p.sinA);
+        const Vc::float_v uRow(p.uRow);
+        const Vc::float_v vRow(p.vRow);
+        const Vc::float_v invA2(p.invA2);
+        const Vc::float_v invB2(p.invB2);
+        const Vc::float_v areaFactor(p.areaFactor);
+
+        int col = startCol;
+
+        for (; col + vectorSize <= endCol; col += vectorSize) {
+            const Vc::float_v dx = Vc::float_v::IndexesFromZero() + Vc::float_v(p.x0 + col);
+
+            const Vc::float_v u = dx * cosA + uRow;
+            const Vc::float_v v = vRow - dx * sinA;
+
+            // see the comment in the generic version
+            const Vc::float_v f = u * u * invA2 + v * v * invB2 - oneValue;
+            const Vc::float_v gu = u * invA2;
+            const Vc::float_v gv = v * invB2;
+            const Vc::float_v gradLength = twoValue * Vc::sqrt(gu * gu + gv * gv) + epsilon;
+            const Vc::float_v distance = f / gradLength;
+
+            const Vc::float_v coverage =
+                Vc::min(Vc::max(halfValue - distance, zeroValue), oneValue) * areaFactor;
+
+            storeCoverage(coverage, mask + col);
+        }
+
+        ScalarRenderer::ellipseRow(p, col, endCol, mask);
+    }
+
+    static void rectangleRow(const KisSprayCoverageRow &p, int startCol, int endCol, quint8 *mask)
+    {
+        const int vectorSize = Vc::float_v::size();
+
+        const Vc::float_v zeroValue(Vc::Zero);
+        const Vc::float_v oneValue(Vc::One);
+        const Vc::float_v halfValue(0.5f);
+
+        const Vc::float_v cosA(p.cosA);
+        const Vc::float_v sinA(p.sinA);
+        const Vc::float_v uRow(p.uRow);
+        const Vc::float_v vRow(p.vRow);
+        const Vc::float_v halfWidth(p.halfWidth);
+        const Vc::float_v halfHeight(p.halfHeight);
+
+        int col = startCol;
+
+        for (; col + vectorSize <= endCol; col += vectorSize) {
+            const Vc::float_v dx = Vc::float_v::IndexesFromZero() + Vc::float_v(p.x0 + col);
+
+            const Vc::float_v u = dx * cosA + uRow;
+            const Vc::float_v v = vRow - dx * sinA;
+
+            const Vc::float_v coverageU =
+                Vc::min(Vc::max(Vc::min(u + halfValue, halfWidth) - Vc::max(u - halfValue, -halfWidth),
+                                zeroValue), oneValue);
+            const Vc::float_v coverageV =
+                Vc::min(Vc::max(Vc::min(v + halfValue, halfHeight) - Vc::max(v - halfValue, -halfHeight),
+                                zeroValue), oneValue);
+
+            storeCoverage(coverageU * coverageV, mask + col);
+        }
+
+        ScalarRenderer::rectangleRow(p, col, endCol, mask);
+    }
+};
+
+#endif /* HAVE_VC */
+
+template<Vc::Implementation _impl>
+class KisOptimizedSprayCoverageRenderer : public KisSprayCoverageRenderer
+{
+public:
+    void ellipseCoverage(const Shape &shape, const QRect &rc, quint8 *mask) const override
+    {
+        KisSprayCoverageRow p = rowParams(shape, rc);
+
+        p.invA2 = 1.0f / qMax(shape.a * shape.a, 1e-6f);
+        p.invB2 = 1.0f / qMax(shape.b * shape.b, 1e-6f);
+
+        // the particles smaller than a pixel are faded out by their area
+        p.areaFactor = qMin(1.0f, float(M_PI) * shape.a * shape.b);
+
+        const float y0 = float(rc.y() + 0.5 - shape.y);
+
+        for (int row = 0; row < rc.height(); row++) {
+            setRow(&p, shape, y0 + row);
+            KisSprayCoverageRowRenderer<_impl>::ellipseRow(p, 0, rc.width(), mask);
+            mask += rc.width();
+        }
+    }
+
+    void rectangleCoverage(const Shape &shape, const QRect &rc, quint8 *mask) const override
+    {
+        KisSprayCoverageRow p = rowParams(shape, rc);
+
+        p.halfWidth = shape.a;
+        p.halfHeight = shape.b;
+
+        const float y0 = float(rc.y() + 0.5 - shape.y);
+
+        for (int row = 0; row < rc.height(); row++) {
+            setRow(&p, shape, y0 + row);
+            KisSprayCoverageRowRenderer<_impl>::rectangleRow(p, 0, rc.width(), mask);
+            mask += rc.width();
+        }
+    }
+
+private:
+    static KisSprayCoverageRow rowParams(const Shape &shape, const QRect &rc) {
+        KisSprayCoverageRow p = KisSprayCoverageRow();
+
+        // offset of the center of the first pixel from the center of the shape
+        p.x0 = float(rc.x() + 0.5 - shape.x);
+        p.cosA = shape.cosA;
+        p.sinA = shape.sinA;
+
+        return p;
+    }
+
+    static void setRow(KisSprayCoverageRow *p, const Shape &shape, float dy) {
+        p->uRow = dy * shape.sinA;
+        p->vRow = dy * shape.cosA;
+    }
+};
+
+#endif // KISOPTIMIZEDSPRAYCOVERAGERENDERER_H
@@ -0,0 +1,61 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KISSPRAYCOVERAGERENDERER_H
+#define KISSPRAYCOVERAGERENDERER_H
+
+#include <QRect>
+#include <QtGlobal>
+
+/**
+ * Computes the anti-aliased coverage masks of the simple spray
+ * particles. The coverage is calculated analytically for every pixel
+ * of the mask, so the rows can be processed in vectors.
+ */
+class KisSprayCoverageRenderer
+{
+public:
+    struct Shape {
+        /// the center of the shape in the dab coordinates
+        float x = 0.0;
+        float y = 0.0;
+
+        /// the half-axes of an ellipse or the half-sizes of a rectangle
+        float a = 0.0;
+        float b = 0.0;
+
+        /// the rotation of the shape
+        float cosA = 1.0;
+        float sinA = 0.0;
+    };
+
+public:
+    virtual ~KisSprayCoverageRenderer() {}
+
+    /**
+     * Fills \p mask with the coverage of the pixels of \p rc by the
+     * ellipse. The mask has rc.width() bytes per row.
+     */
+    virtual void ellipseCoverage(const Shape &shape, const QRect &rc, quint8 *mask) const = 0;
+
+    /**
+     * Fills \p mask with the coverage of the pixels of \p rc by the
+     * rectangle. The mask has rc.width() bytes per row.
+     */
+    virtual void rectangleCoverage(const Shape &shape, const QRect &rc, quint8 *mask) const = 0;
+};
+
+#endif // KISSPRAYCOVERAGERENDERER_H
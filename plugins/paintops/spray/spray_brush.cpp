@@ -133,7 +133,6 @@ void SprayBrush::paint(KisPaintDeviceSP dab, KisPaintDeviceSP source,
 
     qreal x = info.pos().x();
     qreal y = info.pos().y();
-    KisRandomAccessorSP accessor = dab->createRandomAccessorNG();
 
     Q_ASSERT(color.colorSpace()->pixelSize() == dab->pixelSize());
     m_inkColor = color;
@@ -178,6 +177,15 @@ void SprayBrush::paint(KisPaintDeviceSP dab, KisPaintDeviceSP source,
     m.rotateRadians(-rotation + deg2rad(m_properties->brushRotation));
     m.scale(m_properties->scale, m_properties->scale);
 
+    // the simple shapes are collected and rasterized in one pass after the loop
+    const bool useParticleBatch =
+        m_shapeProperties->enabled &&
+        m_shapeProperties->shape >= 0 && m_shapeProperties->shape <= 3;
+
+    if (useParticleBatch) {
+        m_particleBatch.reset(SprayParticleBatch::Shape(m_shapeProperties->shape), dab->colorSpace());
+    }
+
     for (quint32 i = 0; i < m_particlesCount; i++) {
         // generate random angle
         angle = randomSource->generateNormalized() * M_PI * 2;
@@ -276,30 +284,27 @@ void SprayBrush::paint(KisPaintDeviceSP dab, KisPaintDeviceSP source,
             case 0:
             {
                 if (m_shapeProperties->width == m_shapeProperties->height){
-                    paintCircle(m_painter, nx + x, ny + y, jitteredWidth * 0.5);
+                    m_particleBatch.addShape(nx + x, ny + y, jitteredWidth * 0.5, jitteredWidth * 0.5, 0.0,
+                                             m_inkColor, m_painter->opacity());
                 }
                 else {
-                    paintEllipse(m_painter, nx + x, ny + y, jitteredWidth * 0.5 , jitteredHeight * 0.5, rotationZ);
+                    m_particleBatch.addShape(nx + x, ny + y, jitteredWidth * 0.5 , jitteredHeight * 0.5, rotationZ,
+                                             m_inkColor, m_painter->opacity());
                 }
                 break;
             }
             // rectangle
             case 1:
             {
-                paintRectangle(m_painter, nx + x, ny + y, qRound(jitteredWidth) , qRound(jitteredHeight), rotationZ);
+                m_particleBatch.addShape(nx + x, ny + y, qRound(jitteredWidth) * 0.5, qRound(jitteredHeight) * 0.5, rotationZ,
+                                         m_inkColor, m_painter->opacity());
                 break;
             }
             // wu-particle
-            case 2: {
-                paintParticle(accessor, m_inkColor, nx + x, ny + y);
-                break;
-            }
+            case 2:
             // pixel
             case 3: {
-                ix = qRound(nx + x);
-                iy = qRound(ny + y);
-                accessor->moveTo(ix, iy);
-                memcpy(accessor->rawData(), m_inkColor.data(), m_dabPixelSize);
+                m_particleBatch.addPoint(nx + x, ny + y, m_inkColor);
                 break;
             }
             case 4: {
@@ -375,49 +380,17 @@ void SprayBrush::paint(KisPaintDeviceSP dab, KisPaintDeviceSP source,
             m_inkColor=color;//reset color//
         }
     }
+
+    if (useParticleBatch) {
+        m_particleBatch.render(dab);
+    }
+
     // recover from jittering of color,
     // m_inkColor.opacity is recovered with every paint
 }
 
 
 
-void SprayBrush::paintParticle(KisRandomAccessorSP &writeAccessor, const KoColor &color, qreal rx, qreal ry)
-{
-    // opacity top left, right, bottom left, right
-    KoColor pcolor(color);
-    //int opacity = pcolor.opacityU8();
-
-    int ipx = int (rx);
-    int ipy = int (ry);
-    qreal fx = rx - ipx;
-    qreal fy = ry - ipy;
-
-    qreal btl = (1 - fx) * (1 - fy);
-    qreal btr = (fx)  * (1 - fy);
-    qreal bbl = (1 - fx) * (fy);
-    qreal bbr = (fx)  * (fy);
-
-    // this version overwrite pixels, e.g. when it sprays two particle next
-    // to each other, the pixel with lower opacity can override other pixel.
-    // Maybe some kind of compositing using here would be cool
-
-    pcolor.setOpacity(btl);
-    writeAccessor->moveTo(ipx  , ipy);
-    memcpy(writeAccessor->rawData(), pcolor.data(), m_dabPixelSize);
-
-    pcolor.setOpacity(btr);
-    writeAccessor->moveTo(ipx + 1, ipy);
-    memcpy(writeAccessor->rawData(), pcolor.data(), m_dabPixelSize);
-
-    pcolor.setOpacity(bbl);
-    writeAccessor->moveTo(ipx, ipy + 1);
-    memcpy(writeAccessor->rawData(), pcolor.data(), m_dabPixelSize);
-
-    pcolor.setOpacity(bbr);
-    writeAccessor->moveTo(ipx + 1, ipy + 1);
-    memcpy(writeAccessor->rawData(), pcolor.data(), m_dabPixelSize);
-}
-
 void SprayBrush::paintCircle(KisPainter* painter, qreal x, qreal y, qreal radius)
 {
     QPainterPath path;
@@ -426,29 +399,6 @@ void SprayBrush::paintCircle(KisPainter* painter, qreal x, qreal y, qreal radius
 }
 
 
-void SprayBrush::paintEllipse(KisPainter* painter, qreal x, qreal y, qreal a, qreal b, qreal angle)
-{
-    QPainterPath path;
-    path.addEllipse(QPointF(), a, b);
-    QTransform t;
-    t.translate(x, y);
-    t.rotateRadians(angle);
-    path = t.map(path);
-    painter->fillPainterPath(path);
-}
-
-void SprayBrush::paintRectangle(KisPainter* painter, qreal x, qreal y, qreal width, qreal height, qreal angle)
-{
-    QPainterPath path;
-    path.addRect(QRectF(-0.5 * width, -0.5 * height, width, height));
-    QTransform t;
-    t.translate(x, y);
-    t.rotateRadians(angle);
-    path = t.map(path);
-    painter->fillPainterPath(path);
-}
-
-
 void SprayBrush::paintOutline(KisPaintDeviceSP dev , const KoColor &outlineColor, qreal posX, qreal posY, qreal radius)
 {
     QList<QPointF> antiPixels;
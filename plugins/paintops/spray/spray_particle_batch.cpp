@@ -0,0 +1,312 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "spray_particle_batch.h"
+
+#include <KoColor.h>
+#include <KoColorSpace.h>
+#include <KoCompositeOp.h>
+#include <KoCompositeOpRegistry.h>
+
+#include <kis_global.h>
+#include <kis_assert.h>
+#include <kis_paint_device.h>
+
+#include "KisSprayCoverageRenderer.h"
+#include "KisSprayCoverageRendererFactoryImpl.h"
+
+#include <QGlobalStatic>
+#include <QScopedPointer>
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// the dab is read and written in patches of the size of a tile
+const int patchSize = 64;
+
+struct PatchEntry {
+    int patchY;
+    int patchX;
+    int particle;
+
+    bool operator<(const PatchEntry &rhs) const {
+        if (patchY != rhs.patchY) return patchY < rhs.patchY;
+        if (patchX != rhs.patchX) return patchX < rhs.patchX;
+        return particle < rhs.particle;
+    }
+
+    bool samePatch(const PatchEntry &rhs) const {
+        return patchY == rhs.patchY && patchX == rhs.patchX;
+    }
+};
+
+inline int patchIndex(int coord)
+{
+    // the dab coordinates may be negative, so round towards -inf
+    return coord >= 0 ? coord / patchSize : -((-coord - 1) / patchSize) - 1;
+}
+
+struct CoverageRendererHolder
+{
+    CoverageRendererHolder()
+        : renderer(createOptimizedClass<KisSprayCoverageRendererFactoryImpl>(0))
+    {
+    }
+
+    QScopedPointer<KisSprayCoverageRenderer> renderer;
+};
+
+Q_GLOBAL_STATIC(CoverageRendererHolder, s_coverageRendererHolder)
+
+}
+
+SprayParticleBatch::SprayParticleBatch()
+    : m_shape(Ellipse),
+      m_colorSpace(0),
+      m_compositeOp(0),
+      m_pixelSize(0)
+{
+}
+
+void SprayParticleBatch::reset(Shape shape, const KoColorSpace *colorSpace)
+{
+    m_shape = shape;
+    m_colorSpace = colorSpace;
+    m_compositeOp = colorSpace->compositeOp(COMPOSITE_OVER);
+    m_pixelSize = colorSpace->pixelSize();
+
+    m_x.clear();
+    m_y.clear();
+    m_a.clear();
+    m_b.clear();
+    m_cos.clear();
+    m_sin.clear();
+    m_opacity.clear();
+    m_bounds.clear();
+    m_colors.clear();
+}
+
+void SprayParticleBatch::appendColor(const KoColor &color)
+{
+    const int offset = m_colors.size();
+    m_colors.resize(offset + m_pixelSize);
+    memcpy(m_colors.data() + offset, color.data(), m_pixelSize);
+}
+
+void SprayParticleBatch::addShape(qreal x, qreal y, qreal a, qreal b, qreal angle, const KoColor &color, quint8 opacity)
+{
+    KIS_SAFE_ASSERT_RECOVER_RETURN(m_shape == Ellipse || m_shape == Rectangle);
+
+    const qreal cosA = std::cos(angle);
+    const qreal sinA = std::sin(angle);
+
+    qreal extentX;
+    qreal extentY;
+
+    if (m_shape == Ellipse) {
+        extentX = std::sqrt(pow2(a * cosA) + pow2(b * sinA));
+        extentY = std::sqrt(pow2(a * sinA) + pow2(b * cosA));
+    } else {
+        extentX = qAbs(a * cosA) + qAbs(b * sinA);
+        extentY = qAbs(a * sinA) + qAbs(b * cosA);
+    }
+
+    // expand the rectangle to allow for anti-aliasing
+    const QRect bounds =
+        QRectF(x - extentX, y - extentY, 2 * extentX, 2 * extentY).toAlignedRect().adjusted(-1, -1, 1, 1);
+
+    m_x.append(x);
+    m_y.append(y);
+    m_a.append(a);
+    m_b.append(b);
+    m_cos.append(cosA);
+    m_sin.append(sinA);
+    m_opacity.append(opacity);
+    m_bounds.append(bounds);
+    appendColor(color);
+}
+
+void SprayParticleBatch::addPoint(qreal x, qreal y, const KoColor &color)
+{
+    KIS_SAFE_ASSERT_RECOVER_RETURN(m_shape == WuParticle || m_shape == Pixel);
+
+    const QRect bounds = m_shape == WuParticle ?
+        QRect(int(x), int(y), 2, 2) :
+        QRect(qRound(x), qRound(y), 1, 1);
+
+    m_x.append(x);
+    m_y.append(y);
+    m_a.append(0.0f);
+    m_b.append(0.0f);
+    m_cos.append(1.0f);
+    m_sin.append(0.0f);
+    m_opacity.append(OPACITY_OPAQUE_U8);
+    m_bounds.append(bounds);
+    appendColor(color);
+}
+
+void SprayParticleBatch::render(KisPaintDeviceSP dab)
+{
+    if (isEmpty()) return;
+
+    KIS_SAFE_ASSERT_RECOVER_RETURN(*dab->colorSpace() == *m_colorSpace);
+
+    QVector<PatchEntry> entries;
+    entries.reserve(size());
+
+    for (int i = 0; i < size(); i++) {
+        const QRect &rc = m_bounds[i];
+        if (rc.isEmpty()) continue;
+
+        const int left = patchIndex(rc.left());
+        const int right = patchIndex(rc.right());
+        const int top = patchIndex(rc.top());
+        const int bottom = patchIndex(rc.bottom());
+
+        for (int patchY = top; patchY <= bottom; patchY++) {
+            for (int patchX = left; patchX <= right; patchX++) {
+                PatchEntry entry;
+                entry.patchY = patchY;
+                entry.patchX = patchX;
+                entry.particle = i;
+                entries.append(entry);
+            }
+        }
+    }
+
+    // the particles of every patch stay in the order they were added in
+    std::sort(entries.begin(), entries.end());
+
+    int begin = 0;
+    while (begin < entries.size()) {
+        int end = begin + 1;
+        while (end < entries.size() && entries[end].samePatch(entries[begin])) {
+            end++;
+        }
+
+        const QRect patchRect(entries[begin].patchX * patchSize,
+                              entries[begin].patchY * patchSize,
+                              patchSize, patchSize);
+
+        QRect tileRect;
+        for (int i = begin; i < end; i++) {
+            tileRect |= m_bounds[entries[i].particle];
+        }
+        tileRect &= patchRect;
+
+        m_tileData.resize(tileRect.width() * tileRect.height() * m_pixelSize);
+        dab->readBytes(m_tileData.data(), tileRect);
+
+        for (int i = begin; i < end; i++) {
+            const int particle = entries[i].particle;
+
+            if (m_shape == Ellipse || m_shape == Rectangle) {
+                renderShape(particle, m_bounds[particle] & tileRect, tileRect, m_tileData.data());
+            } else {
+                renderPoint(particle, tileRect, m_tileData.data());
+            }
+        }
+
+        dab->writeBytes(m_tileData.constData(), tileRect);
+
+        begin = end;
+    }
+}
+
+void SprayParticleBatch::renderShape(int index, const QRect &rc, const QRect &tileRect, quint8 *tileData)
+{
+    const int tileRowStride = tileRect.width() * m_pixelSize;
+
+    m_mask.resize(rc.width() * rc.height());
+
+    KisSprayCoverageRenderer::Shape shape;
+    shape.x = m_x[index];
+    shape.y = m_y[index];
+    shape.a = m_a[index];
+    shape.b = m_b[index];
+    shape.cosA = m_cos[index];
+    shape.sinA = m_sin[index];
+
+    const KisSprayCoverageRenderer *renderer = s_coverageRendererHolder->renderer.data();
+
+    if (m_shape == Ellipse) {
+        renderer->ellipseCoverage(shape, rc, m_mask.data());
+    } else {
+        renderer->rectangleCoverage(shape, rc, m_mask.data());
+    }
+
+    quint8 *dst = tileData +
+        (rc.y() - tileRect.y()) * tileRowStride +
+        (rc.x() - tileRect.x()) * m_pixelSize;
+
+    // the source is a single pixel, hence the zero stride
+    m_compositeOp->composite(dst, tileRowStride,
+                             m_colors.constData() + index * m_pixelSize, 0,
+                             m_mask.constData(), rc.width(),
+                             rc.height(), rc.width(),
+                             m_opacity[index]);
+}
+
+void SprayParticleBatch::renderPoint(int index, const QRect &tileRect, quint8 *tileData)
+{
+    const int tileRowStride = tileRect.width() * m_pixelSize;
+    const quint8 *color = m_colors.constData() + index * m_pixelSize;
+
+    if (m_shape == Pixel) {
+        const QPoint pt = m_bounds[index].topLeft();
+        quint8 *dst = tileData +
+            (pt.y() - tileRect.y()) * tileRowStride +
+            (pt.x() - tileRect.x()) * m_pixelSize;
+
+        memcpy(dst, color, m_pixelSize);
+        return;
+    }
+
+    // a wu-particle overwrites the pixels of the dab, the opacity of the
+    // pixels is set to the weights of the particle
+    const qreal rx = m_x[index];
+    const qreal ry = m_y[index];
+
+    const int ipx = int(rx);
+    const int ipy = int(ry);
+    const qreal fx = rx - ipx;
+    const qreal fy = ry - ipy;
+
+    const qreal weights[4] = {
+        (1 - fx) * (1 - fy),
+        (fx) * (1 - fy),
+        (1 - fx) * (fy),
+        (fx) * (fy)
+    };
+
+    const QPoint offsets[4] = {
+        QPoint(0, 0), QPoint(1, 0), QPoint(0, 1), QPoint(1, 1)
+    };
+
+    for (int i = 0; i < 4; i++) {
+        const QPoint pt = QPoint(ipx, ipy) + offsets[i];
+        if (!tileRect.contains(pt)) continue;
+
+        quint8 *dst = tileData +
+            (pt.y() - tileRect.y()) * tileRowStride +
+            (pt.x() - tileRect.x()) * m_pixelSize;
+
+        memcpy(dst, color, m_pixelSize);
+        m_colorSpace->setOpacity(dst, weights[i], 1);
+    }
+}
@@ -0,0 +1,116 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _SPRAY_PARTICLE_BATCH_H_
+#define _SPRAY_PARTICLE_BATCH_H_
+
+#include <QVector>
+#include <QRect>
+
+#include <kis_types.h>
+
+class KoColor;
+class KoColorSpace;
+class KoCompositeOp;
+
+/**
+ * Collects the simple particles of a single spray dab (ellipses,
+ * rectangles, wu-particles and pixels) and rasterizes all of them in
+ * one pass.
+ *
+ * The particles are stored as a structure of arrays. On render() they
+ * are sorted by the tiles they touch, and every tile of the dab is read
+ * and written only once. Inside a tile the particles are painted in the
+ * order they were added, so the overlapping particles look the same as
+ * when painted one by one.
+ *
+ * The coverage of the ellipses and rectangles is computed analytically
+ * by KisSprayCoverageRenderer, which is compiled with Vc for every
+ * supported instruction set and processes a vector of pixels of a row
+ * at once. It replaces the QPainterPath based rasterization of
+ * KisPainter::fillPainterPath().
+ */
+class SprayParticleBatch
+{
+public:
+    enum Shape {
+        Ellipse,
+        Rectangle,
+        WuParticle,
+        Pixel
+    };
+
+public:
+    SprayParticleBatch();
+
+    /// removes all the particles and prepares the batch for the particles of \p shape
+    void reset(Shape shape, const KoColorSpace *colorSpace);
+
+    bool isEmpty() const {
+        return m_x.isEmpty();
+    }
+
+    int size() const {
+        return m_x.size();
+    }
+
+    /**
+     * Adds an ellipse (or a rectangle, depending on the shape of the
+     * batch) centered at \p x, \p y, rotated by \p angle radians. For
+     * ellipses \p a and \p b are the half-axes, for rectangles they
+     * are the half-sizes.
+     *
+     * The particle is composited with COMPOSITE_OVER and \p opacity,
+     * like KisPainter::fillPainterPath() would do.
+     */
+    void addShape(qreal x, qreal y, qreal a, qreal b, qreal angle, const KoColor &color, quint8 opacity);
+
+    /// adds a pixel or a wu-particle at \p x, \p y, they overwrite the pixels of the dab
+    void addPoint(qreal x, qreal y, const KoColor &color);
+
+    /// paints all the particles into \p dab
+    void render(KisPaintDeviceSP dab);
+
+private:
+    void appendColor(const KoColor &color);
+
+    void renderShape(int index, const QRect &rc, const QRect &tileRect, quint8 *tileData);
+    void renderPoint(int index, const QRect &tileRect, quint8 *tileData);
+
+private:
+    Shape m_shape;
+    const KoColorSpace *m_colorSpace;
+    const KoCompositeOp *m_compositeOp;
+    int m_pixelSize;
+
+    // the particles, one element per particle
+    QVector<float> m_x;
+    QVector<float> m_y;
+    QVector<float> m_a;
+    QVector<float> m_b;
+    QVector<float> m_cos;
+    QVector<float> m_sin;
+    QVector<quint8> m_opacity;
+    QVector<QRect> m_bounds;
+    // m_pixelSize bytes per particle
+    QVector<quint8> m_colors;
+
+    // scratch buffers reused between the dabs
+    QVector<quint8> m_tileData;
+    QVector<quint8> m_mask;
+};
+
+#endif
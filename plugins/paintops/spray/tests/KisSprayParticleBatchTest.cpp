@@ -0,0 +1,169 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisSprayParticleBatchTest.h"
+
+#include <QTest>
+#include <QtMath>
+
+#include <KoColor.h>
+#include <KoColorSpaceRegistry.h>
+
+#include <kis_paint_device.h>
+
+#include "../KisSprayCoverageRenderer.h"
+#include "../KisSprayCoverageRendererFactoryImpl.h"
+#include "../spray_particle_batch.h"
+
+namespace {
+
+enum ShapeType {
+    EllipseShape,
+    RectangleShape
+};
+
+QVector<KisSprayCoverageRenderer::Shape> testShapes()
+{
+    QVector<KisSprayCoverageRenderer::Shape> shapes;
+
+    // the sizes and the positions are chosen so that the rows are not
+    // a multiple of the vector size and the tails are also tested
+    const float sizes[][2] = {{0.3f, 0.4f}, {3.0f, 3.0f}, {7.5f, 2.25f}, {12.3f, 9.7f}};
+    const float angles[] = {0.0f, 0.3f, 1.2f, 2.5f};
+
+    for (auto size : sizes) {
+        for (float angle : angles) {
+            KisSprayCoverageRenderer::Shape shape;
+            shape.x = 17.3f;
+            shape.y = -5.6f;
+            shape.a = size[0];
+            shape.b = size[1];
+            shape.cosA = std::cos(angle);
+            shape.sinA = std::sin(angle);
+            shapes.append(shape);
+        }
+    }
+
+    return shapes;
+}
+
+QRect shapeRect(const KisSprayCoverageRenderer::Shape &shape)
+{
+    const int extent = qCeil(qMax(shape.a, shape.b) * M_SQRT2) + 1;
+    return QRect(qFloor(shape.x) - extent, qFloor(shape.y) - extent, 2 * extent + 1, 2 * extent + 3);
+}
+
+void compareWithScalarImplementation(ShapeType type)
+{
+    QScopedPointer<KisSprayCoverageRenderer> optimized(
+        createOptimizedClass<KisSprayCoverageRendererFactoryImpl>(0));
+    QScopedPointer<KisSprayCoverageRenderer> scalar(
+        createOptimizedClass<KisSprayCoverageRendererFactoryImpl>(0, true));
+
+    Q_FOREACH (const KisSprayCoverageRenderer::Shape &shape, testShapes()) {
+        const QRect rc = shapeRect(shape);
+
+        QVector<quint8> optimizedMask(rc.width() * rc.height());
+        QVector<quint8> scalarMask(rc.width() * rc.height());
+
+        if (type == EllipseShape) {
+            optimized->ellipseCoverage(shape, rc, optimizedMask.data());
+            scalar->ellipseCoverage(shape, rc, scalarMask.data());
+        } else {
+            optimized->rectangleCoverage(shape, rc, optimizedMask.data());
+            scalar->rectangleCoverage(shape, rc, scalarMask.data());
+        }
+
+        // the vector sqrt and division may be rounded differently
+        for (int i = 0; i < optimizedMask.size(); i++) {
+            if (qAbs(int(optimizedMask[i]) - int(scalarMask[i])) > 1) {
+                qDebug() << "a" << shape.a << "b" << shape.b << "cos" << shape.cosA
+                         << "pixel" << i % rc.width() << i / rc.width()
+                         << "optimized" << optimizedMask[i] << "scalar" << scalarMask[i];
+                QFAIL("the optimized coverage differs from the scalar one");
+            }
+        }
+    }
+}
+
+}
+
+void KisSprayParticleBatchTest::testEllipseCoverage()
+{
+    compareWithScalarImplementation(EllipseShape);
+}
+
+void KisSprayParticleBatchTest::testRectangleCoverage()
+{
+    compareWithScalarImplementation(RectangleShape);
+}
+
+void KisSprayParticleBatchTest::testRenderEllipse()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisPaintDeviceSP dab = new KisPaintDevice(cs);
+
+    SprayParticleBatch batch;
+    batch.reset(SprayParticleBatch::Ellipse, cs);
+
+    // the ellipse crosses the border of the tiles
+    batch.addShape(64.0, 64.0, 20.0, 10.0, 0.0, KoColor(Qt::red, cs), OPACITY_OPAQUE_U8);
+    batch.render(dab);
+
+    // the anti-aliased edge spreads one pixel out of the ellipse
+    QCOMPARE(dab->exactBounds(), QRect(43, 53, 42, 22));
+
+    KoColor pixel(cs);
+
+    dab->pixel(64, 64, &pixel);
+    QCOMPARE(pixel, KoColor(Qt::red, cs));
+
+    dab->pixel(63, 63, &pixel);
+    QCOMPARE(pixel, KoColor(Qt::red, cs));
+
+    // the corners of the bounding rect are outside the ellipse
+    dab->pixel(44, 54, &pixel);
+    QCOMPARE(pixel.opacityU8(), OPACITY_TRANSPARENT_U8);
+
+    dab->pixel(83, 73, &pixel);
+    QCOMPARE(pixel.opacityU8(), OPACITY_TRANSPARENT_U8);
+}
+
+void KisSprayParticleBatchTest::benchmarkEllipseCoverage()
+{
+    QScopedPointer<KisSprayCoverageRenderer> renderer(
+        createOptimizedClass<KisSprayCoverageRendererFactoryImpl>(0));
+
+    const QVector<KisSprayCoverageRenderer::Shape> shapes = testShapes();
+
+    QVector<QRect> rects;
+    int maxMaskSize = 0;
+
+    Q_FOREACH (const KisSprayCoverageRenderer::Shape &shape, shapes) {
+        rects.append(shapeRect(shape));
+        maxMaskSize = qMax(maxMaskSize, rects.last().width() * rects.last().height());
+    }
+
+    QVector<quint8> mask(maxMaskSize);
+
+    QBENCHMARK {
+        for (int i = 0; i < shapes.size(); i++) {
+            renderer->ellipseCoverage(shapes[i], rects[i], mask.data());
+        }
+    }
+}
+
+QTEST_MAIN(KisSprayParticleBatchTest)